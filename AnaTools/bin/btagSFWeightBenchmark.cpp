@@ -0,0 +1,141 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+
+#include "OSUT3Analysis/AnaTools/interface/BtagSFWeight.h"
+
+using namespace std;
+
+void printHelp (const string &);
+bool check (BtagSFWeight &, mt19937 &, const unsigned, const unsigned);
+double timePerCall (BtagSFWeight &, const vector<double> &, const int, const bool);
+
+////////////////////////////////////////////////////////////////////////////////
+// Checks BtagSFWeight::weight against the brute-force sum over all tag
+// configurations, BtagSFWeight::weightBruteForce, for random tagging
+// probabilities with up to a given number of jets and every value of minTags,
+// and then times both for 4 to 25 jets. Returns a nonzero exit code if any of
+// the checks fails.
+////////////////////////////////////////////////////////////////////////////////
+int
+main (int argc, char *argv[])
+{
+  unsigned maxCheckedJets = 12,
+           trials = 100;
+  if (argc > 3)
+    {
+      printHelp (argv[0]);
+      return 0;
+    }
+  if (argc > 1)
+    maxCheckedJets = atoi (argv[1]);
+  if (argc > 2)
+    trials = atoi (argv[2]);
+
+  BtagSFWeight btagSFWeight;
+  mt19937 generator (12345);
+
+  bool success = check (btagSFWeight, generator, maxCheckedJets, trials);
+  cout << "checked weight against the brute-force sum for 0 to " << maxCheckedJets << " jets: " << (success ? "OK" : "FAILED") << endl;
+
+  uniform_real_distribution<double> probability (0.0, 1.0);
+  cout << endl << setw (6) << "njets" << setw (16) << "brute force (s)" << setw (16) << "weight (s)" << setw (12) << "speedup" << endl;
+  for (unsigned njets = 4; njets <= 25; njets++)
+    {
+      vector<double> jets (njets);
+      for (auto &jet : jets)
+        jet = probability (generator);
+      int minTags = 2;
+
+      double bruteForce = timePerCall (btagSFWeight, jets, minTags, true),
+             recursive = timePerCall (btagSFWeight, jets, minTags, false);
+      cout << setw (6) << njets << setw (16) << bruteForce << setw (16) << recursive << setw (12) << bruteForce / recursive << endl;
+    }
+
+  return (success ? 0 : 1);
+}
+
+void
+printHelp (const string &exeName)
+{
+  cout << "Usage: " << exeName << " [MAX_CHECKED_JETS [TRIALS]]" << endl;
+  cout << "Checks BtagSFWeight::weight against the brute-force sum over all tag configurations" << endl;
+  cout << "for up to MAX_CHECKED_JETS jets (default: 12), with TRIALS sets of random tagging" << endl;
+  cout << "probabilities for each number of jets (default: 100), and times both methods for" << endl;
+  cout << "4 to 25 jets." << endl;
+}
+
+bool
+check (BtagSFWeight &btagSFWeight, mt19937 &generator, const unsigned maxJets, const unsigned trials)
+{
+  uniform_real_distribution<double> probability (0.0, 1.0);
+  bool success = true;
+  double maxDifference = 0.0;
+  for (unsigned njets = 0; njets <= maxJets; njets++)
+    {
+      for (unsigned trial = 0; trial < trials; trial++)
+        {
+          vector<double> jets (njets);
+          for (auto &jet : jets)
+            jet = probability (generator);
+          // Include jets which are never or always tagged.
+          if (njets > 1 && trial % 10 == 0)
+            jets[0] = 0.0, jets[1] = 1.0;
+
+          // Several sets of probabilities, the first of which is the nominal
+          // one, for checking the overload which takes all of them at once.
+          vector<vector<double> > jetSets (njets);
+          for (unsigned j = 0; j < njets; j++)
+            jetSets[j] = {jets[j], probability (generator), probability (generator)};
+
+          for (int minTags = 0; minTags <= (int) njets + 1; minTags++)
+            {
+              double expected = btagSFWeight.weightBruteForce (jets, minTags),
+                     observed = btagSFWeight.weight (jets, minTags),
+                     difference = fabs (observed - expected);
+              vector<double> observedSets = btagSFWeight.weight (jetSets, minTags);
+              for (unsigned s = 0; s < observedSets.size (); s++)
+                {
+                  vector<double> jetsInSet (njets);
+                  for (unsigned j = 0; j < njets; j++)
+                    jetsInSet[j] = jetSets[j][s];
+                  difference = max (difference, fabs (observedSets[s] - btagSFWeight.weightBruteForce (jetsInSet, minTags)));
+                }
+              maxDifference = max (maxDifference, difference);
+              if (difference > 1.0e-12)
+                {
+                  cout << "ERROR: weight differs from the brute-force sum by " << difference << " for " << njets << " jets and minTags = " << minTags << endl;
+                  success = false;
+                }
+            }
+        }
+    }
+  cout << "largest difference from the brute-force sum: " << maxDifference << endl;
+  return success;
+}
+
+double
+timePerCall (BtagSFWeight &btagSFWeight, const vector<double> &jets, const int minTags, const bool bruteForce)
+{
+  // Repeat the call until at least a tenth of a second has passed.
+  unsigned calls = 0;
+  double sum = 0.0, seconds = 0.0;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+  do
+    {
+      sum += (bruteForce ? btagSFWeight.weightBruteForce (jets, minTags) : btagSFWeight.weight (jets, minTags));
+      calls++;
+      seconds = chrono::duration<double> (chrono::steady_clock::now () - start).count ();
+    }
+  while (seconds < 0.1);
+
+  // Use the sum so that the calls are not optimized away.
+  if (sum < 0.0)
+    cout << sum << endl;
+  return seconds / calls;
+}
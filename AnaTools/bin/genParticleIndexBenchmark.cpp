@@ -0,0 +1,261 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <random>
+
+#include "DataFormats/Common/interface/Handle.h"
+#include "DataFormats/HepMCCandidate/interface/GenParticle.h"
+#include "DataFormats/Math/interface/deltaPhi.h"
+#include "DataFormats/Provenance/interface/BranchDescription.h"
+#include "DataFormats/Provenance/interface/Provenance.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+#include "OSUT3Analysis/Collections/interface/GenParticleIndex.h"
+#include "OSUT3Analysis/Collections/interface/Mcparticle.h"
+#include "OSUT3Analysis/Collections/interface/Muon.h"
+
+using namespace std;
+
+void printHelp (const string &);
+
+#if IS_VALID(mcparticles) && IS_VALID(muons) && (DATA_FORMAT == MINI_AOD || DATA_FORMAT == MINI_AOD_CUSTOM)
+
+struct SyntheticEvent
+{
+  vector<osu::Mcparticle> particles;
+  vector<TYPE(muons)> muons;
+};
+
+void generateEvent (mt19937 &, const unsigned, const unsigned, SyntheticEvent &);
+bool sameMatch (const osu::Muon &, const osu::Muon &);
+bool check (mt19937 &, const unsigned, const vector<double> &);
+void timePerEvent (mt19937 &, const unsigned, const unsigned, const double, double &, double &);
+
+////////////////////////////////////////////////////////////////////////////////
+// Checks that gen matching through a GenParticleIndex finds exactly the same
+// particles, at exactly the same deltaR, as looping over every particle, for
+// synthetic events and several values of maxDeltaRForGenMatching, and then
+// times both for increasing numbers of particles per event. The time for the
+// index includes building it once per event. Returns a nonzero exit code if
+// any of the checks fails.
+////////////////////////////////////////////////////////////////////////////////
+int
+main (int argc, char *argv[])
+{
+  unsigned events = 200,
+           muonsPerEvent = 10;
+  if (argc > 3)
+    {
+      printHelp (argv[0]);
+      return 0;
+    }
+  if (argc > 1)
+    events = atoi (argv[1]);
+  if (argc > 2)
+    muonsPerEvent = atoi (argv[2]);
+
+  mt19937 generator (12345);
+
+  vector<double> maxDeltaRs = {0.01, 0.1, 0.3, 1.0, 4.0};
+  bool success = check (generator, events, maxDeltaRs);
+  cout << "checked the index against the loop over all particles for " << events << " events: " << (success ? "OK" : "FAILED") << endl;
+
+  cout << endl << setw (10) << "particles" << setw (14) << "loop (s)" << setw (14) << "index (s)" << setw (12) << "speedup" << endl;
+  for (unsigned nParticles = 100; nParticles <= 6400; nParticles *= 2)
+    {
+      double loop, index;
+      timePerEvent (generator, nParticles, muonsPerEvent, 0.1, loop, index);
+      cout << setw (10) << nParticles << setw (14) << loop << setw (14) << index << setw (12) << loop / index << endl;
+    }
+
+  return (success ? 0 : 1);
+}
+
+void
+generateEvent (mt19937 &generator, const unsigned nParticles, const unsigned nMuons, SyntheticEvent &event)
+{
+  uniform_real_distribution<double> eta (-6.0, 6.0), phi (-M_PI, M_PI), pt (1.0, 100.0), flag (0.0, 1.0);
+  normal_distribution<double> smear (0.0, 0.05);
+  const int pdgIds[] = {13, -13, 11, 211, 22};
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Particles are spread beyond the edges of the grid in eta, some sit exactly
+  // at phi = +-pi, and about a third have none of the flags used for matching.
+  //////////////////////////////////////////////////////////////////////////////
+  event.particles.clear ();
+  for (unsigned i = 0; i < nParticles; i++)
+    {
+      double particlePhi = (i % 50 == 0 ? (i % 100 == 0 ? M_PI : -M_PI) : phi (generator));
+      reco::Candidate::PolarLorentzVector p4 (pt (generator), eta (generator), particlePhi, 0.1);
+      int pdgId = pdgIds[i % 5];
+      reco::GenParticle particle (pdgId > 0 ? -1 : 1, reco::Candidate::LorentzVector (p4), reco::Candidate::Point (), pdgId, 1, true);
+      particle.statusFlags ().setIsPrompt (flag (generator) < 0.5);
+      particle.statusFlags ().setFromHardProcess (flag (generator) < 0.3);
+      particle.statusFlags ().setIsDirectPromptTauDecayProduct (flag (generator) < 0.2);
+      particle.statusFlags ().setIsDirectHardProcessTauDecayProduct (flag (generator) < 0.1);
+      event.particles.push_back (osu::Mcparticle (pat::PackedGenParticle (particle, edm::Ref<reco::GenParticleCollection> ())));
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Half of the muons are close to one of the particles, and the rest are
+  // anywhere.
+  //////////////////////////////////////////////////////////////////////////////
+  event.muons.clear ();
+  for (unsigned i = 0; i < nMuons; i++)
+    {
+      double muonEta = eta (generator), muonPhi = phi (generator);
+      if (i % 2 == 0 && nParticles)
+        {
+          const osu::Mcparticle &particle = event.particles.at ((i * 7919) % nParticles);
+          muonEta = particle.eta () + smear (generator);
+          muonPhi = reco::deltaPhi (particle.phi () + smear (generator), 0.0);
+        }
+      reco::Candidate::PolarLorentzVector p4 (pt (generator), muonEta, muonPhi, 0.105);
+      event.muons.push_back (TYPE(muons) (reco::Muon (-1, reco::Candidate::LorentzVector (p4))));
+    }
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+bool
+sameMatch (const osu::Muon &a, const osu::Muon &b)
+{
+  const osu::Muon::GenMatchedParticle matchesA[] = {a.genMatchedParticle (), a.genMatchedParticleOfSameType ()},
+                                      matchesB[] = {b.genMatchedParticle (), b.genMatchedParticleOfSameType ()};
+  const osu::Muon::DRToGenMatchedParticle dRsA[] = {a.dRToGenMatchedParticle (), a.dRToGenMatchedParticleOfSameType ()},
+                                          dRsB[] = {b.dRToGenMatchedParticle (), b.dRToGenMatchedParticleOfSameType ()};
+  for (unsigned i = 0; i < 2; i++)
+    {
+      const edm::Ref<vector<osu::Mcparticle> > refsA[] = {matchesA[i].promptFinalState, matchesA[i].directPromptTauDecayProductFinalState, matchesA[i].hardProcessFinalState, matchesA[i].directHardProcessTauDecayProductFinalState},
+                                               refsB[] = {matchesB[i].promptFinalState, matchesB[i].directPromptTauDecayProductFinalState, matchesB[i].hardProcessFinalState, matchesB[i].directHardProcessTauDecayProductFinalState};
+      for (unsigned j = 0; j < 4; j++)
+        {
+          if (refsA[j].isNull () != refsB[j].isNull ())
+            return false;
+          if (refsA[j].isNonnull () && refsA[j].key () != refsB[j].key ())
+            return false;
+        }
+      if (dRsA[i].promptFinalState != dRsB[i].promptFinalState
+       || dRsA[i].directPromptTauDecayProductFinalState != dRsB[i].directPromptTauDecayProductFinalState
+       || dRsA[i].hardProcessFinalState != dRsB[i].hardProcessFinalState
+       || dRsA[i].directHardProcessTauDecayProductFinalState != dRsB[i].directHardProcessTauDecayProductFinalState)
+        return false;
+    }
+  return true;
+}
+
+bool
+check (mt19937 &generator, const unsigned events, const vector<double> &maxDeltaRs)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // The handle needs a provenance, which only has to give the refs a product
+  // ID.
+  //////////////////////////////////////////////////////////////////////////////
+  edm::Provenance provenance (make_shared<edm::BranchDescription> (), edm::ProductID (1, 1));
+  //////////////////////////////////////////////////////////////////////////////
+
+  bool success = true;
+  unsigned matches = 0, comparisons = 0;
+  SyntheticEvent event;
+  for (unsigned i = 0; i < events; i++)
+    {
+      generateEvent (generator, 50 + (i % 20) * 100, 20, event);
+      edm::Handle<vector<osu::Mcparticle> > particles (&event.particles, &provenance);
+      for (const auto &maxDeltaR : maxDeltaRs)
+        {
+          edm::ParameterSet cfg;
+          cfg.addParameter<double> ("maxDeltaRForGenMatching", maxDeltaR);
+          osu::GenParticleIndex index (particles, maxDeltaR);
+          for (const auto &muon : event.muons)
+            {
+              osu::Muon loop (muon, particles, cfg),
+                        indexed (muon, index, cfg);
+              comparisons++;
+              if (loop.genMatchedParticle ().promptFinalState.isNonnull ())
+                matches++;
+              if (!sameMatch (loop, indexed))
+                {
+                  cout << "ERROR: the index gives a different match than the loop for event " << i << ", maxDeltaR = " << maxDeltaR << ", eta = " << muon.eta () << ", phi = " << muon.phi () << endl;
+                  success = false;
+                }
+            }
+        }
+    }
+  cout << "compared " << comparisons << " objects, " << matches << " of which were matched to a prompt final-state particle" << endl;
+  return success;
+}
+
+void
+timePerEvent (mt19937 &generator, const unsigned nParticles, const unsigned nMuons, const double maxDeltaR, double &loop, double &index)
+{
+  edm::Provenance provenance (make_shared<edm::BranchDescription> (), edm::ProductID (1, 1));
+  edm::ParameterSet cfg;
+  cfg.addParameter<double> ("maxDeltaRForGenMatching", maxDeltaR);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Repeat each event until at least a tenth of a second has passed for both
+  // methods, and return the time per event.
+  //////////////////////////////////////////////////////////////////////////////
+  SyntheticEvent event;
+  generateEvent (generator, nParticles, nMuons, event);
+  edm::Handle<vector<osu::Mcparticle> > particles (&event.particles, &provenance);
+  double sum = 0.0;
+  for (unsigned method = 0; method < 2; method++)
+    {
+      unsigned calls = 0;
+      double seconds = 0.0;
+      chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+      do
+        {
+          if (method == 0)
+            {
+              for (const auto &muon : event.muons)
+                sum += osu::Muon (muon, particles, cfg).dRToGenMatchedParticle ().promptFinalState;
+            }
+          else
+            {
+              osu::GenParticleIndex genParticles (particles, maxDeltaR);
+              for (const auto &muon : event.muons)
+                sum += osu::Muon (muon, genParticles, cfg).dRToGenMatchedParticle ().promptFinalState;
+            }
+          calls++;
+          seconds = chrono::duration<double> (chrono::steady_clock::now () - start).count ();
+        }
+      while (seconds < 0.1);
+      (method == 0 ? loop : index) = seconds / calls;
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  // Use the sum so that the calls are not optimized away.
+  if (sum < -1.0e30)
+    cout << sum << endl;
+}
+
+#else
+
+int
+main (int argc, char *argv[])
+{
+  if (argc > 3)
+    printHelp (argv[0]);
+  else
+    cout << "gen matching is only available for MiniAOD, so there is nothing to check." << endl;
+  return 0;
+}
+
+#endif
+
+void
+printHelp (const string &exeName)
+{
+  cout << "Usage: " << exeName << " [EVENTS [MUONS_PER_EVENT]]" << endl;
+  cout << "Checks that gen matching through a GenParticleIndex gives the same matches as" << endl;
+  cout << "looping over every particle for EVENTS synthetic events (default: 200), and" << endl;
+  cout << "times both with MUONS_PER_EVENT muons per event (default: 10) for 100 to 6400" << endl;
+  cout << "particles per event." << endl;
+}
@@ -1,11 +1,16 @@
 #include <TFile.h>
 #include <TROOT.h>
 #include <TKey.h>
+#include <TClass.h>
 #include <TH1.h>
 #include <TH2.h>
 #include <TDirectory.h>
 #include <TList.h>
 #include <TMath.h>
+#include <RVersion.h>
+#if ROOT_VERSION_CODE < ROOT_VERSION(6,0,0)
+#include <TThread.h>
+#endif
 #include <boost/tokenizer.hpp>
 #include <boost/program_options.hpp>
 #include <string>
@@ -15,16 +20,53 @@
 #include <cassert>
 #include <sstream>
 #include <cstdlib>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 using namespace boost::program_options;
 using namespace boost;
 using namespace std;
 
-void make(TDirectory & out, TObject * o);
-void fill(TDirectory & out, TObject * o, double);
+////////////////////////////////////////////////////////////////////////////////
+// The histograms are merged in memory. The directories and histograms of the
+// first input file are read into a tree of Nodes, which gives the structure of
+// the output file, and each histogram is given an index into the vectors of
+// histograms in which the input files are accumulated. The histograms of the
+// first file are kept as the first accumulator, so that it is only read once.
+//
+// The remaining input files are shared among a number of threads, each of which
+// reads every file given to it exactly once and adds it to its own accumulator.
+// ROOT 5 cannot read TFiles in several threads at once, so with it only one
+// thread reads a file at a time, and the threads only run in parallel while
+// adding the histograms they have read to their accumulators. Since every
+// thread holds a full copy of the histograms, only one thread is used unless
+// more are requested with -j. The accumulators are then added together
+// pairwise, also in parallel, and the result is written to the output file in a
+// single pass, along with the upper limit cut flows.
+////////////////////////////////////////////////////////////////////////////////
+struct Node {
+  string name;
+  string title;
+  int histogram;  // index of the histogram in the accumulators, or -1 for a directory
+  vector<Node> children;
+};
+
+typedef vector<TH1 *> Accumulator;
+
+bool makeTree(TDirectory &, const string &, double, Node &, Accumulator &, unordered_map<string, int> &);
+Accumulator cloneAccumulator(const Accumulator &);
+bool addFile(const string &, double, const unordered_map<string, int> &, Accumulator &, Long64_t &);
+bool readDirectory(TDirectory &, const string &, const string &, const unordered_map<string, int> &, vector<pair<int, TH1 *> > &);
+void addAccumulators(Accumulator &, Accumulator &);
+void write(TDirectory &, const Node &, const Accumulator &, double);
 double normCDF (const double);
-void generateUpperLimitCutFlow (TDirectoryFile &, TH1D * const, const double);
-void upperLimitCutFlow (TDirectoryFile &, const double);
+void generateUpperLimitCutFlow (TDirectory &, TH1D * const, const double);
 
 static const char * const kHelpOpt = "help";
 static const char * const kHelpCommandOpt = "help,h";
@@ -34,9 +76,17 @@ static const char * const kInputFilesOpt = "input-files";
 static const char * const kInputFilesCommandOpt = "input-files,i";
 static const char * const kWeightsOpt = "weights";
 static const char * const kWeightsCommandOpt = "weights,w";
+static const char * const kThreadsOpt = "threads";
+static const char * const kThreadsCommandOpt = "threads,j";
 
 vector<double> weights;
 
+// Serializes the messages printed by the threads.
+mutex outputMutex;
+
+// Serializes reading the input files with ROOT 5.
+mutex readMutex;
+
 int main(int argc, char * argv[]) {
   string programName(argv[0]);
   string descString(programName);
@@ -48,7 +98,8 @@ int main(int argc, char * argv[]) {
     (kHelpCommandOpt, "produce help message")
     (kOutputFileCommandOpt, value<string>()->default_value("out.root"), "output root file")
     (kWeightsCommandOpt, value<string>(), "list of weights (comma separates).\ndefault: weights are assumed to be 1")
-    (kInputFilesCommandOpt, value<vector<string> >()->multitoken(), "input root files");
+    (kInputFilesCommandOpt, value<vector<string> >()->multitoken(), "input root files")
+    (kThreadsCommandOpt, value<unsigned>(), "number of threads.\ndefault: 1");
 
   positional_options_description p;
 
@@ -111,195 +162,279 @@ int main(int argc, char * argv[]) {
     exit(-1);
   }
 
+  unsigned nThreads = 1;
+  if(vm.count(kThreadsOpt))
+    nThreads = vm[kThreadsOpt].as<unsigned>();
+  nThreads = max(min(nThreads, (unsigned) fileNames.size() - 1), 1u);
+
   gROOT->SetBatch();
+  TH1::AddDirectory(kFALSE);
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+  ROOT::EnableThreadSafety();
+#else
+  TThread::Initialize();
+#endif
 
-  TFile out(outputFile.c_str(), "RECREATE");
-  if(!out.IsOpen()) {
-    cerr << "can't open output file: " << outputFile <<endl;
-    return -1;
-  }
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
 
-  for(size_t i = 0; i < fileNames.size(); ++i) {
-    string fileName = fileNames[i];
-    TFile file(fileName.c_str(), "read");
-    if(!file.IsOpen()) {
-      cerr << "can't open input file: " << fileName <<endl;
+  //////////////////////////////////////////////////////////////////////////////
+  // Take the structure of the output from the first input file, whose
+  // histograms become the accumulator of the first thread.
+  //////////////////////////////////////////////////////////////////////////////
+  Node root;
+  root.histogram = -1;
+  vector<Accumulator> accumulators(nThreads);
+  unordered_map<string, int> histogramIndices;
+  atomic<Long64_t> totalBytes(0);
+  {
+    TFile *file = TFile::Open(fileNames[0].c_str(), "read");
+    if(!file || !file->IsOpen()) {
+      cerr << "can't open input file: " << fileNames[0] <<endl;
       return -1;
     }
+    totalBytes = file->GetSize();
+    bool success = makeTree(*file, "", weights[0], root, accumulators[0], histogramIndices);
+    file->Close();
+    delete file;
+    if(!success)
+      return -1;
+  }
+  //////////////////////////////////////////////////////////////////////////////
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Each thread takes the next file which has not been read yet until there
+  // are none left, and adds it to its own accumulator.
+  //////////////////////////////////////////////////////////////////////////////
+  for(unsigned i = 1; i < nThreads; i++)
+    accumulators[i] = cloneAccumulator(accumulators[0]);
 
-    TIter next(file.GetListOfKeys());
-    TKey *key;
-    while ((key = dynamic_cast<TKey*>(next()))) {
-      string className(key->GetClassName());
-      string name(key->GetName());
-      TObject * obj = file.Get(name.c_str());
-      if(obj == 0) {
-        cerr <<"error: key " << name << " not found in file " << fileName << endl;
-        return -1;
+  atomic<unsigned> nextFile(1);
+  atomic<bool> failed(false);
+  vector<thread> threads;
+  for(unsigned i = 0; i < nThreads; i++) {
+    threads.push_back(thread([&, i]() {
+      for(unsigned j = nextFile++; j < fileNames.size() && !failed; j = nextFile++) {
+        Long64_t bytes = 0;
+        if(!addFile(fileNames[j], weights[j], histogramIndices, accumulators[i], bytes))
+          failed = true;
+        totalBytes += bytes;
       }
-      make(out, obj);
-    }
-    file.Close();
+    }));
   }
-  for(size_t i = 0; i < fileNames.size(); ++i) {
-    string fileName = fileNames[i];
-    TFile file(fileName.c_str(), "read");
-    if(!file.IsOpen()) {
-      cerr << "can't open input file: " << fileName <<endl;
-      return -1;
-    }
+  for(unsigned i = 0; i < threads.size(); i++)
+    threads[i].join();
+  threads.clear();
+  if(failed)
+    return -1;
+  //////////////////////////////////////////////////////////////////////////////
 
-    TIter next(file.GetListOfKeys());
-    TKey *key;
-    while ((key = dynamic_cast<TKey*>(next()))) {
-      string className(key->GetClassName());
-      string name(key->GetName());
-      TObject * obj = file.Get(name.c_str());
-      if(obj == 0) {
-        cerr <<"error: key " << name << " not found in file " << fileName << endl;
-        return -1;
-      }
-      fill(out, obj, weights[i]);
-    }
-    file.Close();
+  //////////////////////////////////////////////////////////////////////////////
+  // Add the accumulators together pairwise, so that the number of steps only
+  // grows with the logarithm of the number of threads.
+  //////////////////////////////////////////////////////////////////////////////
+  for(unsigned stride = 1; stride < accumulators.size(); stride *= 2) {
+    for(unsigned i = 0; i + stride < accumulators.size(); i += 2 * stride)
+      threads.push_back(thread(addAccumulators, std::ref(accumulators[i]), std::ref(accumulators[i + stride])));
+    for(unsigned i = 0; i < threads.size(); i++)
+      threads[i].join();
+    threads.clear();
   }
+  //////////////////////////////////////////////////////////////////////////////
 
-  out.Write();
+  TFile out(outputFile.c_str(), "RECREATE");
+  if(!out.IsOpen()) {
+    cerr << "can't open output file: " << outputFile <<endl;
+    return -1;
+  }
+  write(out, root, accumulators[0], weights[0]);
   out.Close();
 
-  TFile fout (outputFile.c_str(), "UPDATE");
-  upperLimitCutFlow (fout, weights[0]);
-  fout.Write();
-  fout.Close();
+  for(unsigned i = 0; i < accumulators[0].size(); i++)
+    delete accumulators[0][i];
+
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count(),
+         megabytes = totalBytes / (1024.0 * 1024.0);
+  cout << "merged " << fileNames.size() << " files (" << megabytes << " MB) with " << nThreads << " threads in " << seconds << " s: "
+       << fileNames.size() / seconds << " files/s, " << megabytes / seconds << " MB/s" << endl;
 
   return 0;
 }
 
-void make(TDirectory & out, TObject * o) {
-  TDirectory * dir = dynamic_cast<TDirectory*>(o);
-  bool exists = out.Get (o->GetName ());
-  TH1F * th1f;
-  TH1D * th1d;
-  TH2F * th2f;
-  TH2D * th2d;
-  out.cd();
-  if (!dir && exists)
-    return;
-  if(dir != 0) {
-    TDirectory * outDir;
-    if (!exists)
-      outDir = out.mkdir(dir->GetName(), dir->GetTitle());
-    else
-      outDir = (TDirectory *) out.Get(dir->GetName());
-    TIter next(dir->GetListOfKeys());
-    TKey *key;
-    while( (key = dynamic_cast<TKey*>(next())) ) {
-      string className(key->GetClassName());
-      string name(key->GetName());
-      TObject * obj = dir->Get(name.c_str());
-      if(obj == 0) {
-        cerr <<"error: key " << name << " not found in directory " << dir->GetName() << endl;
-        exit(-1);
+/**
+ * Reads the directories and histograms in a directory of the first input file
+ * into the tree describing the output, adding each histogram, scaled by the
+ * given weight, to the accumulator.
+ */
+bool makeTree(TDirectory & dir, const string & path, double w, Node & node, Accumulator & accumulator, unordered_map<string, int> & histogramIndices) {
+  unordered_set<string> names;
+  TIter next(dir.GetListOfKeys());
+  TKey *key;
+  while ((key = dynamic_cast<TKey*>(next()))) {
+    // Only the highest cycle of each object is used, as with TDirectory::Get.
+    string name(key->GetName());
+    if(!names.insert(name).second)
+      continue;
+    key = dir.GetKey(name.c_str());
+
+    TClass *c = TClass::GetClass(key->GetClassName());
+    if(c && c->InheritsFrom(TDirectory::Class())) {
+      TDirectory * subDir = dir.GetDirectory(name.c_str());
+      if(subDir == 0) {
+        cerr <<"error: directory " << name << " could not be read from " << dir.GetName() << endl;
+        return false;
+      }
+      Node child;
+      child.name = name;
+      child.title = subDir->GetTitle();
+      child.histogram = -1;
+      if(!makeTree(*subDir, path + name + "/", w, child, accumulator, histogramIndices))
+        return false;
+      node.children.push_back(child);
+    } else if(c && c->InheritsFrom(TH1::Class())) {
+      TH1 * h = dynamic_cast<TH1*>(key->ReadObj());
+      if(h == 0) {
+        cerr <<"error: key " << name << " not found in directory " << dir.GetName() << endl;
+        return false;
       }
-      make(*outDir, obj);
+      if(!h->GetSumw2N())
+        h->Sumw2();
+      h->Scale(w);
+      Node child;
+      child.name = name;
+      child.histogram = accumulator.size();
+      histogramIndices[path + name] = accumulator.size();
+      accumulator.push_back(h);
+      node.children.push_back(child);
     }
-  } else if((th1f = dynamic_cast<TH1F*>(o)) != 0) {
-    TH1F *h = (TH1F*) th1f->Clone();
-    h->Reset();
-    h->Sumw2();
-    h->SetDirectory(&out);
-  } else if((th1d = dynamic_cast<TH1D*>(o)) != 0) {
-    TH1D *h = (TH1D*) th1d->Clone();
-    h->Reset();
-    h->Sumw2();
-    h->SetDirectory(&out);
-  } else if((th2f = dynamic_cast<TH2F*>(o)) != 0) {
-    TH2F *h = (TH2F*) th2f->Clone();
-    h->Reset();
-    h->Sumw2();
-    h->SetDirectory(&out);
-  } else if((th2d = dynamic_cast<TH2D*>(o)) != 0) {
-    TH2D *h = (TH2D*) th2d->Clone();
-    h->Reset();
-    h->Sumw2();
-    h->SetDirectory(&out);
   }
+  return true;
 }
 
-void fill(TDirectory & out, TObject * o, double w) {
-  TDirectory * dir;
-  TH1F * th1f;
-  TH1D * th1d;
-  TH2F * th2f;
-  TH2D * th2d;
-  if((dir  = dynamic_cast<TDirectory*>(o)) != 0) {
-    const char * name = dir->GetName();
-    TDirectory * outDir = dynamic_cast<TDirectory*>(out.Get(name));
-    if(outDir == 0) {
-      cerr << "can't find directory " << name << " in output file" << endl;
-      exit(-1);
-    }
-    TIter next(dir->GetListOfKeys());
-    TKey *key;
-    while( (key = dynamic_cast<TKey*>(next())) ) {
-      string className(key->GetClassName());
-      string name(key->GetName());
-      TObject * obj = dir->Get(name.c_str());
-      if(obj == 0) {
-        cerr <<"error: key " << name << " not found in directory " << dir->GetName() << endl;
-        exit(-1);
-      }
-      fill(*outDir, obj, w);
-    }
-  } else if((th1f = dynamic_cast<TH1F*>(o)) != 0) {
-    const char * name = th1f->GetName();
-    TH1F * outTh1f = dynamic_cast<TH1F*>(out.Get(name));
-    if(outTh1f == 0) {
-      cerr <<"error: histogram TH1F" << name << " not found in directory " << out.GetName() << endl;
-      exit(-1);
-    }
-    th1f->Scale(w);
-
-    TList *list = new TList();
-    list->Add(th1f);
-    outTh1f->Merge(list);
-  } else if((th1d = dynamic_cast<TH1D*>(o)) != 0) {
-    const char * name = th1d->GetName();
-    TH1D * outTh1d = dynamic_cast<TH1D*>(out.Get(name));
-    if(outTh1d == 0) {
-      cerr <<"error: histogram TH1D" << name << " not found in directory " << out.GetName() << endl;
-      exit(-1);
+/**
+ * Returns empty copies of the given histograms.
+ */
+Accumulator cloneAccumulator(const Accumulator & templates) {
+  Accumulator accumulator(templates.size());
+  for(unsigned i = 0; i < templates.size(); i++) {
+    accumulator[i] = (TH1 *) templates[i]->Clone();
+    accumulator[i]->Reset();
+  }
+  return accumulator;
+}
+
+/**
+ * Adds every histogram in an input file, scaled by the given weight, to the
+ * accumulator, and stores the size of the file in the last argument. With
+ * ROOT 5, the file is read while holding readMutex, and the histograms are
+ * only added to the accumulator once it has been released.
+ */
+bool addFile(const string & fileName, double w, const unordered_map<string, int> & histogramIndices, Accumulator & accumulator, Long64_t & bytes) {
+  vector<pair<int, TH1 *> > histograms;
+  {
+#if ROOT_VERSION_CODE < ROOT_VERSION(6,0,0)
+    lock_guard<mutex> readLock(readMutex);
+#endif
+    TFile *file = TFile::Open(fileName.c_str(), "read");
+    if(!file || !file->IsOpen()) {
+      lock_guard<mutex> lock(outputMutex);
+      cerr << "can't open input file: " << fileName <<endl;
+      delete file;
+      return false;
     }
-    th1d->Scale(w);
-
-    TList *list = new TList();
-    list->Add(th1d);
-    outTh1d->Merge(list);
-  } else if((th2f = dynamic_cast<TH2F*>(o)) != 0) {
-    const char * name = th2f->GetName();
-    TH2F * outTh2f = dynamic_cast<TH2F*>(out.Get(name));
-    if(outTh2f == 0) {
-      cerr <<"error: histogram TH2F" << name << " not found in directory " << out.GetName() << endl;
-      exit(-1);
+    bytes = file->GetSize();
+    bool success = readDirectory(*file, "", fileName, histogramIndices, histograms);
+    file->Close();
+    delete file;
+    if(!success) {
+      for(unsigned i = 0; i < histograms.size(); i++)
+        delete histograms[i].second;
+      return false;
     }
-    th2f->Scale(w);
-
-    TList *list = new TList();
-    list->Add(th2f);
-    outTh2f->Merge(list);
-  } else if((th2d = dynamic_cast<TH2D*>(o)) != 0) {
-    const char * name = th2d->GetName();
-    TH2D * outTh2d = dynamic_cast<TH2D*>(out.Get(name));
-    if(outTh2d == 0) {
-      cerr <<"error: histogram TH2D" << name << " not found in directory " << out.GetName() << endl;
-      exit(-1);
+  }
+
+  for(unsigned i = 0; i < histograms.size(); i++) {
+    TH1 * h = histograms[i].second;
+    h->Scale(w);
+
+    TList list;
+    list.Add(h);
+    accumulator[histograms[i].first]->Merge(&list);
+    delete h;
+  }
+  return true;
+}
+
+/**
+ * Reads the histograms in a directory of an input file, along with the index of
+ * each in the accumulators, into the last argument.
+ */
+bool readDirectory(TDirectory & dir, const string & path, const string & fileName, const unordered_map<string, int> & histogramIndices, vector<pair<int, TH1 *> > & histograms) {
+  unordered_set<string> names;
+  TIter next(dir.GetListOfKeys());
+  TKey *key;
+  while ((key = dynamic_cast<TKey*>(next()))) {
+    string name(key->GetName());
+    if(!names.insert(name).second)
+      continue;
+    key = dir.GetKey(name.c_str());
+
+    TClass *c = TClass::GetClass(key->GetClassName());
+    if(c && c->InheritsFrom(TDirectory::Class())) {
+      TDirectory * subDir = dir.GetDirectory(name.c_str());
+      if(subDir == 0 || !readDirectory(*subDir, path + name + "/", fileName, histogramIndices, histograms))
+        return false;
+    } else if(c && c->InheritsFrom(TH1::Class())) {
+      unordered_map<string, int>::const_iterator index = histogramIndices.find(path + name);
+      if(index == histogramIndices.end()) {
+        lock_guard<mutex> lock(outputMutex);
+        cerr <<"error: histogram " << path + name << " from " << fileName << " is not in the first input file" << endl;
+        return false;
+      }
+      TH1 * h = dynamic_cast<TH1*>(key->ReadObj());
+      if(h == 0) {
+        lock_guard<mutex> lock(outputMutex);
+        cerr <<"error: key " << name << " not found in directory " << dir.GetName() << " of " << fileName << endl;
+        return false;
+      }
+      histograms.push_back(make_pair(index->second, h));
     }
-    th2d->Scale(w);
+  }
+  return true;
+}
 
-    TList *list = new TList();
-    list->Add(th2d);
-    outTh2d->Merge(list);
+/**
+ * Adds the second accumulator to the first and deletes its histograms.
+ */
+void addAccumulators(Accumulator & a, Accumulator & b) {
+  for(unsigned i = 0; i < a.size(); i++) {
+    TList list;
+    list.Add(b[i]);
+    a[i]->Merge(&list);
+    delete b[i];
+  }
+  b.clear();
+}
+
+/**
+ * Writes the merged histograms in a directory of the tree to the output,
+ * followed by the upper limit cut flows if the directory has a cut flow.
+ */
+void write(TDirectory & dir, const Node & node, const Accumulator & accumulator, double w) {
+  TH1D * cutFlow = 0;
+  for(unsigned i = 0; i < node.children.size(); i++) {
+    const Node & child = node.children[i];
+    if(child.histogram < 0) {
+      TDirectory * outDir = dir.mkdir(child.name.c_str(), child.title.c_str());
+      write(*outDir, child, accumulator, w);
+    } else {
+      TH1 * h = accumulator[child.histogram];
+      dir.WriteTObject(h, child.name.c_str());
+      if(child.name == "cutFlow" && string(h->ClassName()) == "TH1D")
+        cutFlow = (TH1D *) h;
+    }
   }
+  if(cutFlow)
+    generateUpperLimitCutFlow(dir, cutFlow, w);
 }
 
 double
@@ -309,10 +444,9 @@ normCDF (const double x)
 }
 
 void
-generateUpperLimitCutFlow (TDirectoryFile &dirFile, TH1D * const cutFlow, const double w)
+generateUpperLimitCutFlow (TDirectory &dir, TH1D * const cutFlow, const double w)
 {
   vector<double> sigmas = {1.0, 2.0, 3.0};
-  cutFlow->SetDirectory (0);
   for (const auto &sigma : sigmas)
     {
       double cl = 1.0 - 2.0 * normCDF (-sigma);
@@ -320,7 +454,6 @@ generateUpperLimitCutFlow (TDirectoryFile &dirFile, TH1D * const cutFlow, const
       ss << ((int) (cl * 100.0));
 
       TH1D * const upperLimitCutFlowHist = (TH1D *) cutFlow->Clone (("cutFlow_" + ss.str () + "CL").c_str ());
-      upperLimitCutFlowHist->SetDirectory (&dirFile);
       for (int i = 0; i <= cutFlow->GetXaxis ()->GetNbins () + 1; i++)
         {
           // The calculation of upper and lower limits is taken from the PDG Statistics chapter.  
@@ -332,19 +465,7 @@ generateUpperLimitCutFlow (TDirectoryFile &dirFile, TH1D * const cutFlow, const
           upperLimit = 0.5 * TMath::ChisquareQuantile (cl, 2 * (content + 1));
           upperLimitCutFlowHist->SetBinContent (i, upperLimit * w);
         }
-    }
-}
-
-void
-upperLimitCutFlow (TDirectoryFile &dirFile, const double w)
-{
-  TIter next (dirFile.GetListOfKeys ());
-  TKey *key;
-  while ((key = (TKey *) next ()))
-    {
-      if (string (key->GetClassName ()) == "TDirectoryFile")
-        upperLimitCutFlow (*((TDirectoryFile *) dirFile.Get (key->GetName ())), w);
-      if (string (key->GetClassName ()) == "TH1D" && string (key->GetName ()) == "cutFlow")
-        generateUpperLimitCutFlow (dirFile, (TH1D *) dirFile.Get (key->GetName ()), w);
+      dir.WriteTObject (upperLimitCutFlowHist);
+      delete upperLimitCutFlowHist;
     }
 }
@@ -1,9 +1,13 @@
 #ifndef ANALYSIS_TYPES
 #define ANALYSIS_TYPES
 
+#include <unordered_map>
+
 #include "boost/variant.hpp"
 
 #include "DataFormats/Common/interface/Handle.h"
+#include "FWCore/Utilities/interface/EDGetToken.h"
+#include "FWCore/Utilities/interface/InputTag.h"
 
 #include "OSUT3Analysis/Collections/interface/Basicjet.h"
 #include "OSUT3Analysis/Collections/interface/Beamspot.h"
@@ -26,12 +30,15 @@
 #include "OSUT3Analysis/Collections/interface/Uservariable.h"
 #include "OSUT3Analysis/Collections/interface/PileUpInfo.h"
 
+#include "OSUT3Analysis/AnaTools/interface/ObjectFlags.h"
+
+class HistogramBuffer;
+class MemberAccessor;
+class TH1;
 class ValueLookupTree;
 
 typedef boost::variant<double, string> Leaf;
 
-typedef vector<map<string, vector<pair<bool, bool> > > > FlagMap;
-
 struct Cut
 {
   ValueLookupTree  *valueLookupTree;
@@ -44,29 +51,58 @@ struct Cut
   string           name;
   vector<string>   inputCollections;
   string           arbitration;
+  unsigned         inputLabelId;      // ID of inputLabel in the ObjectFlags
+  vector<string>   singleObjects;     // collections making up inputLabel
+  vector<unsigned> singleObjectIds;   // IDs of singleObjects in the ObjectFlags
 };
 
 typedef vector<Cut> Cuts;
 
+// Information about the cuts which is the same for every event, so it is only
+// stored once per job by the CutCalculator, and each payload points to it.
+struct CutCalculatorMetadata
+{
+  Cuts            cuts;
+  vector<string>  triggers;
+  vector<string>  triggersToVeto;
+  vector<string>  triggerFilters;
+  vector<string>  collections;  // collection labels, indexed by their IDs
+
+  // Returns the ID of the collection with the given label, or -1 if it has
+  // none.
+  int getCollectionId (const string &collection) const
+  {
+    for (unsigned i = 0; i < collections.size (); i++)
+      {
+        if (collections[i] == collection)
+          return i;
+      }
+    return -1;
+  }
+};
+
 struct CutCalculatorPayload
 {
-  FlagMap         cumulativeObjectFlags;
-  FlagMap         individualObjectFlags;
+  CutCalculatorPayload () :
+    metadata (NULL)
+  {
+  }
+
+  ObjectFlags     cumulativeObjectFlags;
+  ObjectFlags     individualObjectFlags;
   bool            cutDecision;         // whether event passes current cut (independant from other cuts)
   bool            cutsDecision;        // whether event passes all cuts, without trigger
   bool            eventDecision;       // whether event passes all cuts and the trigger 
   bool            isValid;
   bool            triggerDecision;
   bool            triggerFilterDecision;
-  Cuts            cuts;
   vector<bool>    cumulativeEventFlags;
   vector<bool>    individualEventFlags;
   vector<bool>    triggerFlags;
   vector<bool>    vetoTriggerFlags;
   vector<bool>    triggerFilterFlags;
-  vector<string>  triggers;
-  vector<string>  triggersToVeto;
-  vector<string>  triggerFilters;
+
+  const CutCalculatorMetadata  *metadata;  // not persistent
 };
 
 struct HistoDef {
@@ -82,6 +118,8 @@ struct HistoDef {
   vector<string> inputVariables;
   vector<ValueLookupTree *> valueLookupTrees;
   int dimensions;
+  TH1 *histogram; // booked once for all streams, NULL if booking failed
+  HistogramBuffer *buffer; // filled instead of the histogram by one stream, and merged into it at the end of the job
 };
 
 struct Weight
@@ -94,9 +132,10 @@ struct Weight
 
 struct Node
 {
-  Node            *parent;
-  string          value;
-  vector<Node *>  branches;
+  Node                  *parent;
+  string                value;
+  vector<Node *>        branches;
+  const MemberAccessor  *accessor;  // bound when the node is a member lookup
 };
 
 struct Collections
@@ -119,12 +158,83 @@ struct Collections
   edm::Handle<vector<osu::Track> >          tracks;
   edm::Handle<vector<osu::PileUpInfo> >     pileupinfos;
   edm::Handle<vector<osu::Trigobj> >        trigobjs;
-  vector<edm::Handle<osu::Uservariable> >   uservariables;
-  vector<edm::Handle<osu::Eventvariable> >  eventvariables;
+  vector<edm::Handle<TYPE(uservariables)> > uservariables;
+  vector<edm::Handle<TYPE(eventvariables)> > eventvariables;
 
   edm::Handle<TYPE(triggers)>                 triggers;
   edm::Handle<TYPE(prescales)>                prescales;
   edm::Handle<TYPE(generatorweights)>         generatorweights;
+
+  // Names of the event variables in each of the eventvariables products, which
+  // are put in the run rather than in each event.
+  vector<edm::Handle<vector<string> > >  eventvariableNames;
+
+  // Indices of the objects selected by an ObjectSelector, keyed by the name of
+  // the collection, for each collection which is given as the unfiltered
+  // collection and a selection instead of a copy of the selected objects.
+  unordered_map<string, edm::Handle<vector<unsigned> > >  selections;
+
+  // Index of the stream processing the event the collections belong to, which
+  // selects the ValueCache used for the event.
+  unsigned  stream;
+
+  // Run of the event the collections belong to.
+  unsigned  run;
+
+  Collections () : stream (0), run (0) {}
+};
+
+// Everything needed to retrieve one collection from each event, filled by
+// anatools::consumeCollection in the constructor of a module. The label is the
+// one given in the configuration. If byType is true, e.g., when the label is
+// empty, and the collection is not found by its label,
+// anatools::getCollection falls back to searching all the collections of the
+// same type, and the one it finds is stored in resolved, so that the search is
+// only done for the first event.
+template<class T> struct CollectionToken
+{
+  bool                 required;
+  bool                 byType;
+  edm::InputTag        label;
+  edm::EDGetTokenT<T>  token;
+  edm::InputTag        resolved;
+
+  CollectionToken () : required (false), byType (false) {}
+};
+
+// Tokens for retrieving the members of Collections, declared with
+// anatools::getCollectionTokens. Tokens for collections which are not needed
+// are left with required set to false.
+struct CollectionTokens
+{
+  CollectionToken<osu::Beamspot>                beamspots;
+  CollectionToken<vector<osu::Bxlumi> >         bxlumis;
+  CollectionToken<vector<osu::Electron> >       electrons;
+  CollectionToken<vector<osu::Event> >          events;
+  CollectionToken<vector<osu::Genjet> >         genjets;
+  CollectionToken<vector<osu::Jet> >            jets;
+  CollectionToken<vector<osu::Bjet> >           bjets;
+  CollectionToken<vector<osu::Basicjet> >       basicjets;
+  CollectionToken<vector<osu::Mcparticle> >     mcparticles;
+  CollectionToken<vector<osu::Met> >            mets;
+  CollectionToken<vector<osu::Muon> >           muons;
+  CollectionToken<vector<osu::Photon> >         photons;
+  CollectionToken<vector<osu::Primaryvertex> >  primaryvertexs;
+  CollectionToken<vector<osu::Supercluster> >   superclusters;
+  CollectionToken<vector<osu::Tau> >            taus;
+  CollectionToken<vector<osu::Track> >          tracks;
+  CollectionToken<vector<osu::PileUpInfo> >     pileupinfos;
+  CollectionToken<vector<osu::Trigobj> >        trigobjs;
+  vector<CollectionToken<TYPE(uservariables)> > uservariables;
+  vector<CollectionToken<TYPE(eventvariables)> > eventvariables;
+
+  CollectionToken<TYPE(triggers)>                 triggers;
+  CollectionToken<TYPE(prescales)>                prescales;
+  CollectionToken<TYPE(generatorweights)>         generatorweights;
+
+  vector<edm::EDGetTokenT<vector<string> > >  eventvariableNames;
+
+  unordered_map<string, edm::EDGetTokenT<vector<unsigned> > >  selections;
 };
 
 struct ValueToPrint
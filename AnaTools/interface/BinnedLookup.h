@@ -0,0 +1,101 @@
+#ifndef BINNED_LOOKUP
+#define BINNED_LOOKUP
+
+#include <vector>
+
+#include "TAxis.h"
+#include "TH1.h"
+#include "TH2.h"
+
+using namespace std;
+
+/*
+BinnedLookup1D and BinnedLookup2D hold a snapshot of the contents and errors of
+a ROOT histogram in contiguous arrays, so that looking up a value does not go
+through the virtual methods of the histogram or search its axes repeatedly.
+
+Bins are numbered as in ROOT, with bin 0 being the underflow and bin nBins () + 1
+the overflow, and findBin gives the same result as TAxis::FindBin: for axes
+with fixed bin widths the bin is computed directly, and otherwise by a binary
+search on the bin edges.
+
+The policy for values outside of the range of an axis is chosen when the lookup
+is constructed. With USE_OVERFLOW, such values fall in the underflow or overflow
+bin, exactly as with TH1::FindBin. With CLAMP, they fall in the first or last
+bin of the axis instead.
+*/
+
+class BinnedAxis
+{
+  public:
+    enum OutOfRangePolicy { USE_OVERFLOW, CLAMP };
+
+    BinnedAxis ();
+    BinnedAxis (const TAxis &, OutOfRangePolicy);
+
+    int findBin (double) const;
+    int nBins () const;
+    double binLowEdge (int) const;
+    double binUpEdge (int) const;
+    double binWidth (int) const;
+
+  private:
+    int               nBins_;
+    double            min_;
+    double            max_;
+    bool              fixedWidth_;
+    vector<double>    edges_;  // bin edges, only for variable bin widths
+    OutOfRangePolicy  policy_;
+};
+
+class BinnedLookup1D
+{
+  public:
+    BinnedLookup1D ();
+    BinnedLookup1D (const TH1 &, BinnedAxis::OutOfRangePolicy = BinnedAxis::USE_OVERFLOW);
+
+    const BinnedAxis &axis () const { return axis_; };
+    int findBin (double x) const { return axis_.findBin (x); };
+
+    double value (int bin) const { return values_[bin]; };
+    double error (int bin) const { return errors_[bin]; };
+    double at (double x) const { return values_[findBin (x)]; };
+    double errorAt (double x) const { return errors_[findBin (x)]; };
+
+    // Looks up the values, and optionally the errors, for a batch of inputs.
+    void at (const vector<double> &x, vector<double> &values, vector<double> *errors = NULL) const;
+
+  private:
+    BinnedAxis      axis_;
+    vector<double>  values_;
+    vector<double>  errors_;
+};
+
+class BinnedLookup2D
+{
+  public:
+    BinnedLookup2D ();
+    BinnedLookup2D (const TH2 &, BinnedAxis::OutOfRangePolicy = BinnedAxis::USE_OVERFLOW);
+
+    const BinnedAxis &xAxis () const { return xAxis_; };
+    const BinnedAxis &yAxis () const { return yAxis_; };
+
+    // Returns the global bin number, as TH2::FindBin does.
+    int findBin (double x, double y) const { return xAxis_.findBin (x) + (xAxis_.nBins () + 2) * yAxis_.findBin (y); };
+
+    double value (int bin) const { return values_[bin]; };
+    double error (int bin) const { return errors_[bin]; };
+    double at (double x, double y) const { return values_[findBin (x, y)]; };
+    double errorAt (double x, double y) const { return errors_[findBin (x, y)]; };
+
+    // Looks up the values, and optionally the errors, for a batch of inputs.
+    void at (const vector<double> &x, const vector<double> &y, vector<double> &values, vector<double> *errors = NULL) const;
+
+  private:
+    BinnedAxis      xAxis_;
+    BinnedAxis      yAxis_;
+    vector<double>  values_;
+    vector<double>  errors_;
+};
+
+#endif
@@ -5,6 +5,17 @@ using namespace std;
 class BtagSFWeight {
  public:
   bool filter(int t, int minTags);
+  // Returns the probability that at least minTags of the jets are tagged,
+  // given the probability of each jet being tagged.
   double weight(vector<double> jets, int useMinTags);
+  // Same as above for several sets of tagging probabilities at once, e.g.,
+  // for different working points or systematic shifts, where jets[i][j] is
+  // the probability of jet i being tagged in set j. Returns one weight for
+  // each set.
+  vector<double> weight(const vector<vector<double> > &jets, int useMinTags);
+  // Reference implementation of weight(), which sums over all 2^njets tag
+  // configurations. Only meant for checking the result of weight() for small
+  // numbers of jets, see bin/btagSFWeightBenchmark.cpp.
+  double weightBruteForce(const vector<double> &jets, int useMinTags);
   double sflookup(double jetCSV, double pt, double flavor, double jetEta);
 };
@@ -11,15 +11,24 @@
 #include <unordered_set>
 #include <typeinfo>
 
+#include "FWCore/Framework/interface/ConsumesCollector.h"
 #include "FWCore/Framework/interface/Event.h"
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
 #include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
+#include "OSUT3Analysis/AnaTools/interface/MemberAccessor.h"
 
 namespace anatools
 {
   template <class T> bool getCollection (const edm::InputTag& label, edm::Handle<T>& collection, const edm::Event& event, bool verbose = true);
+  template <class T> bool getCollection (CollectionToken<T>& token, edm::Handle<T>& collection, const edm::Event& event, bool verbose = true);
+  template <class T> bool getCollectionByType (const edm::InputTag& label, edm::Handle<T>& collection, const edm::Event& event, bool verbose);
+
+  // Declares that a collection will be retrieved with getCollection, and
+  // returns the token for it. The last argument allows getCollection to fall
+  // back to searching by type, which is always the case if the label is empty.
+  template <class T> CollectionToken<T> consumeCollection (const edm::InputTag& label, edm::ConsumesCollector&& iC, bool byType = false);
 
   // Return a (hopefully) unique hashed integer for an object
   template <class T> int getObjectHash (const T &);
@@ -133,6 +142,13 @@ namespace anatools
   // Removes whitespace from both sides of a string.
   string &trim (string &);
 
+  // Quotes a string for JSON output, escaping any special characters.
+  string jsonString (const string &);
+
+  // Returns true if the expression looks up any user variables, e.g.,
+  // "muon.uservariable.isoCorr".
+  bool usesUserVariables (const string &);
+
   ////////////////////////////////////////////////////////////////////////////////
   // Comparison functions for sorting.
   ////////////////////////////////////////////////////////////////////////////////
@@ -145,6 +161,16 @@ namespace anatools
   // first argument.
   void getRequiredCollections (const unordered_set<string> &, const edm::ParameterSet &, Collections &, const edm::Event &);
 
+  ////////////////////////////////////////////////////////////////////////////////
+  // Versions of getRequiredCollections for modules which declare what they
+  // consume: getCollectionTokens must be called from the constructor of the
+  // module, and the tokens it returns are then used for each event without
+  // looking at the configuration again.
+  ////////////////////////////////////////////////////////////////////////////////
+  void getCollectionTokens (const unordered_set<string> &, const edm::ParameterSet &, CollectionTokens &, edm::ConsumesCollector &&);
+  void getRequiredCollections (CollectionTokens &, Collections &, const edm::Event &);
+  ////////////////////////////////////////////////////////////////////////////////
+
   double getMember (const string &type, const void * const obj, const string &member);
 
   template <class T> double getMember (const T &obj, const string &member);
@@ -175,40 +201,135 @@ namespace anatools
 template <class T> bool
 anatools::getCollection(const edm::InputTag& label, edm::Handle<T>& collection, const edm::Event &event, bool verbose) {
   event.getByLabel(label, collection);
-  if (!collection.isValid()) {
-    vector<edm::Handle<T> > objVec;
-    event.getManyByType(objVec);
-    int collWithFewestParents = -1, fewestParents = 99;
-    for (uint i=0; i<objVec.size(); i++) {
-      int parents = objVec.at(i).provenance()->parents().size();
-      if ((objVec.at(i).provenance()->productInstanceName() == label.instance() || 
-	   objVec.at(i).provenance()->productInstanceName() == ORIGINAL_FORMAT) &&
-	  parents < fewestParents) {
-        collWithFewestParents = i;
-        fewestParents = parents;
-      }
-    }
-    if (collWithFewestParents != -1){
-      collection = objVec.at(collWithFewestParents);
-    }
-    else {
-      if (verbose) clog << "ERROR: did not find any collections that match input tag:  " << label 
-			<< ", with type:  " << typeid(collection).name()  
-			<< endl;  
-      return false;
-    }
-    if (!collection.isValid()) {
-      if (verbose) clog << "ERROR: could not get input collection with product instance label: " << label.instance()
-			<< ", but found " << objVec.size() << " collections of the specified type." << endl;
-      return false;
+  if (!collection.isValid())
+    return getCollectionByType(label, collection, event, verbose);
+  return true;
+}
+
+/**
+ * Retrieves a collection from the event using a token from consumeCollection,
+ * storing it in the second argument.
+ *
+ * Behaves like the version taking only an InputTag, except that the result of
+ * the fallback is remembered in the token. Once a collection has been found
+ * by its type, it is retrieved directly by its full InputTag for the events
+ * which follow, and the search through all the collections of the type is
+ * only repeated if that fails. The fallback is only used if it was requested
+ * from consumeCollection. If the token is uninitialized, i.e., if the
+ * InputTag has an empty module label, only the fallback is used.
+ *
+ * @param  token token returned by consumeCollection
+ * @param  collection edm::Handle in which to store the retrieved collection
+ * @param  event edm::Event from which to get the collection
+ * @return boolean representing whether retrieval was successful
+ */
+template <class T> bool
+anatools::getCollection(CollectionToken<T>& token, edm::Handle<T>& collection, const edm::Event &event, bool verbose) {
+  // The handle may still hold the collection from the previous event.
+  collection.clear();
+  if (token.resolved.label() != "") {
+    event.getByLabel(token.resolved, collection);
+    if (collection.isValid())
+      return true;
+  }
+  else if (!token.token.isUninitialized()) {
+    event.getByToken(token.token, collection);
+    if (collection.isValid())
+      return true;
+  }
+  if (!token.byType) {
+    if (verbose) clog << "ERROR: did not find any collection that matches input tag:  " << token.label
+		      << ", with type:  " << typeid(collection).name()
+		      << endl;
+    return false;
+  }
+  if (!getCollectionByType(token.label, collection, event, verbose))
+    return false;
+  const edm::Provenance *provenance = collection.provenance();
+  token.resolved = edm::InputTag(provenance->moduleLabel(), provenance->productInstanceName(), provenance->processName());
+  return true;
+}
+
+/**
+ * Retrieves a collection from the event by its type alone, for when it could
+ * not be retrieved by its label.
+ *
+ * Gets all collections with the given type and picks the one with the fewest
+ * parents, provided its instance label is equal to either the specified label
+ * or "originalFormat", as is the case for a skim.
+ *
+ * @param  label product instance label of collection to retrieve
+ * @param  collection edm::Handle in which to store the retrieved collection
+ * @param  event edm::Event from which to get the collection
+ * @return boolean representing whether retrieval was successful
+ */
+template <class T> bool
+anatools::getCollectionByType(const edm::InputTag& label, edm::Handle<T>& collection, const edm::Event &event, bool verbose) {
+  vector<edm::Handle<T> > objVec;
+  event.getManyByType(objVec);
+  int collWithFewestParents = -1, fewestParents = 99;
+  for (uint i=0; i<objVec.size(); i++) {
+    int parents = objVec.at(i).provenance()->parents().size();
+    if ((objVec.at(i).provenance()->productInstanceName() == label.instance() || 
+	 objVec.at(i).provenance()->productInstanceName() == ORIGINAL_FORMAT) &&
+	parents < fewestParents) {
+      collWithFewestParents = i;
+      fewestParents = parents;
     }
   }
+  if (collWithFewestParents != -1){
+    collection = objVec.at(collWithFewestParents);
+  }
+  else {
+    if (verbose) clog << "ERROR: did not find any collections that match input tag:  " << label 
+		      << ", with type:  " << typeid(collection).name()  
+		      << endl;  
+    return false;
+  }
+  if (!collection.isValid()) {
+    if (verbose) clog << "ERROR: could not get input collection with product instance label: " << label.instance()
+		      << ", but found " << objVec.size() << " collections of the specified type." << endl;
+    return false;
+  }
   return true;
 }
 
+/**
+ * Declares a collection which will be retrieved with getCollection.
+ *
+ * Every collection of the given type is only declared as well if
+ * getCollection may fall back to searching them, i.e., if this is requested or
+ * if the module label is empty. Otherwise the module only depends on the
+ * labeled collection. The fallback is needed by the modules reading the
+ * original collections, which may be replaced by the copies in a skim.
+ *
+ * @param  label InputTag of the collection to retrieve
+ * @param  iC edm::ConsumesCollector of the module
+ * @param  byType whether to fall back to searching by type
+ * @return token for the collection, whose edm::EDGetTokenT is uninitialized
+ *         if the module label is empty
+ */
+template <class T> CollectionToken<T>
+anatools::consumeCollection(const edm::InputTag& label, edm::ConsumesCollector&& iC, bool byType) {
+  CollectionToken<T> token;
+  token.required = true;
+  token.byType = (byType || label.label() == "");
+  token.label = label;
+  if (token.byType)
+    iC.consumesMany<T>();
+  if (label.label() != "")
+    token.token = iC.consumes<T>(label);
+  return token;
+}
+
 /**
  * Returns the value of a member of an object.
  *
+ * The member is only resolved by name the first time it is requested for a
+ * given type; see MemberAccessor. Each thread also keeps the accessors it has
+ * used for the type in its own table, so that the shared table, which is
+ * locked, is only consulted the first time a thread requests a member.
+ *
  * @param  obj object whose member will be evaluated
  * @param  member string giving the member, data or function, to evaluate
  * @return value of the member of the given object
@@ -216,8 +337,11 @@ anatools::getCollection(const edm::InputTag& label, edm::Handle<T>& collection,
 template <class T> double
 anatools::getMember(const T &obj, const string &member)
 {
-  string type = getObjectClass(obj);
-  return getMember(type, &obj, member);
+  static thread_local unordered_map<string, const MemberAccessor *> accessors;
+  const MemberAccessor *&accessor = accessors[member];
+  if (!accessor)
+    accessor = &MemberAccessor::get (getObjectClass (obj), member);
+  return (*accessor) (&obj);
 }
 
 /**
@@ -10,6 +10,7 @@
 #define INVALID_TYPE void *
 
 #define ORIGINAL_FORMAT "originalFormat"  // Must match definition used in processingUtilities.py 
+#define SELECTION "selection"  // Must match definition used in processingUtilities.py
 
 #if DATA_FORMAT == BEAN
 
@@ -67,26 +68,38 @@
 
 using namespace std;
 
-// type to hold list of hashed indices corresponding to objects
-// string - object type
-// int - object hash
-typedef multimap <string, int>  ObjectList;
-
-// struct to connect objects to the calculated variable's value
-struct UserVariable
+// N.B. VariableProducerPayload and EventVariableProducerPayload used to be
+// typedefs of maps keyed by the variable name. Their products in files written
+// before they became the structs below, e.g., old skims, cannot be read; the
+// variable producers have to be run again over such files instead.
+//
+// VariableProducerPayload type: the user-defined variables of the objects in
+// each collection, stored as one array per variable, so that the value for an
+// object is found directly from its index in the collection.
+//   collections - name of the collection of each variable, e.g., "muons"
+//   names       - user-defined name of each variable
+//   values      - values[i][j] is the value of variable i for object j of its
+//                 collection, or INVALID_VALUE if it was not set
+// Since the objects are given by their indices in the unfiltered collection,
+// skims in which collections are filtered hold a payload written by a
+// UserVariableSelector instead, in which the values follow the filtered
+// copies.
+struct VariableProducerPayload
 {
-  double value;
-  ObjectList objects;
+  vector<string>           collections;
+  vector<string>           names;
+  vector<vector<double> >  values;
 };
 
-// VariableProducerPayload type:
-//   string - user-defined name of variable
-//   vector - one UserVariable per combination of input objects
-typedef map<string, vector<UserVariable> > VariableProducerPayload;
-
-// EventVariableProducerPayload type:
-//   string - user-defined name of variable
-//   double - value of variable for the event
-typedef map<string, double > EventVariableProducerPayload;
+// EventVariableProducerPayload type: the variables of the event, stored as a
+// flat array. The names of the variables are not stored in each event, but in
+// a vector<string> with the same label in each run, so that the position of
+// each variable only has to be found once per run.
+//   values - value of each variable for the event, in the order of the names
+//            in the run, or INVALID_VALUE if it was not set
+struct EventVariableProducerPayload
+{
+  vector<double>  values;
+};
 
 #endif
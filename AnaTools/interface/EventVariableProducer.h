@@ -2,23 +2,80 @@
 
 #define EVENT_VARIABLE_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
+#include <mutex>
+
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/Run.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
 #include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
 
+#define EXIT_CODE 4
+
+// Shared by the instances of an EventVariableProducer in all streams. It holds
+// the names of the variables, which are registered while the instances are
+// constructed, before the first run, and are put in each run, as well as any
+// data the daughter class shares between streams, e.g., the pileup weights of
+// PUScalingFactorProducer.
+template<class T>
+class EventVariableProducerCache
+  {
+    public:
+      EventVariableProducerCache (T *data = NULL) : data_ (data) {};
+
+      const T *data () const { return data_.get (); };
+      vector<string> names () const;
+
+      // Registers the name of the variable with the given ID. Every instance
+      // registers the same variables in the same order, so the ID is either
+      // the next one or that of the same name registered by another instance.
+      void registerName (unsigned id, const string &name) const;
+
+    private:
+      unique_ptr<T> data_;
+
+      mutable mutex mutex_;
+      mutable vector<string> names_;
+  };
+
+// Placeholder for the data of daughter classes which share none.
+struct EventVariableProducerNoData {};
 
-class EventVariableProducer : public edm::EDProducer
+// Base class for producers of event variables. This is a stream module, so
+// daughter classes must declare any collections they need in their
+// constructor.
+//
+// Daughter classes must also register each of their variables in their
+// constructor, e.g., puScalingFactor_ = registerEventVar ("puScalingFactor"),
+// and set them in AddVariables with the ID which is returned, e.g.,
+// setEventVar (puScalingFactor_, x). The names of the variables are only put
+// in each run, and each event only holds their values, in the order of their
+// IDs.
+//
+// The constructor of a daughter class takes the cache shared by all streams
+// as its second argument. Daughter classes which share data between streams
+// derive from EventVariableProducerBase<T>, with the type of the data as T,
+// and provide initializeGlobalCache to create the cache with the data. All
+// others can simply derive from EventVariableProducer.
+template<class T = EventVariableProducerNoData>
+class EventVariableProducerBase : public edm::stream::EDProducer<edm::GlobalCache<EventVariableProducerCache<T> >, edm::BeginRunProducer>
   {
     public:
-      EventVariableProducer (const edm::ParameterSet &);
-      ~EventVariableProducer ();
+      typedef EventVariableProducerCache<T> Cache;
+      typedef typename edm::stream::EDProducer<edm::GlobalCache<Cache>, edm::BeginRunProducer>::RunContext RunContext;
+
+      EventVariableProducerBase (const edm::ParameterSet &, const Cache *);
+      ~EventVariableProducerBase ();
 
       // Methods
 
+      static unique_ptr<Cache> initializeGlobalCache (const edm::ParameterSet &);
+      static void globalBeginRunProduce (edm::Run &, const edm::EventSetup &, const RunContext *);
+      static void globalEndJob (const Cache *);
+
       void produce (edm::Event &, const edm::EventSetup &);
     
     protected:
@@ -29,12 +86,150 @@ class EventVariableProducer : public edm::EDProducer
       unordered_set<string> objectsToGet_;
       auto_ptr<EventVariableProducerPayload> eventvariables;
 
+      // Methods
+
+      // Registers a variable, returning its ID, which is its position in the
+      // payload of every event.
+      unsigned registerEventVar (const string &name);
+
+      // Sets the value of the variable with the given ID.
+      void setEventVar (unsigned id, double value);
+
+      // Sets the value of the named variable, which must have been registered.
+      void addEventVar (const string &name, double value);
+
     private:
 
+      // Variables
+
+      const Cache * const cache_;
+
+      // ID of each variable, keyed by its name, and the name with each ID.
+      unordered_map<string, unsigned> variableIndices_;
+      vector<string> variableNames_;
+
       // Methods
 
       virtual void AddVariables(const edm::Event &);
 
   };
 
+typedef EventVariableProducerBase<> EventVariableProducer;
+
+template<class T> vector<string>
+EventVariableProducerCache<T>::names () const
+{
+  lock_guard<mutex> lock (mutex_);
+  return names_;
+}
+
+template<class T> void
+EventVariableProducerCache<T>::registerName (unsigned id, const string &name) const
+{
+  lock_guard<mutex> lock (mutex_);
+  if (id == names_.size ())
+    names_.push_back (name);
+  else if (id > names_.size () || names_.at (id) != name)
+    {
+      clog << "ERROR [EventVariableProducer::registerEventVar]: the event variable " << name << " was registered with a different ID in another stream." << endl;
+      exit (EXIT_CODE);
+    }
+}
+
+template<class T>
+EventVariableProducerBase<T>::EventVariableProducerBase(const edm::ParameterSet &cfg, const Cache *cache) :
+  collections_  (cfg.getParameter<edm::ParameterSet>  ("collections")),
+  cache_        (cache)
+{
+  assert (strcmp (PROJECT_VERSION, SUPPORTED_VERSION) == 0);
+
+  this->template produces<EventVariableProducerPayload> ("eventvariables");
+  this->template produces<vector<string>, edm::InRun> ("eventvariables");
+}
+
+template<class T>
+EventVariableProducerBase<T>::~EventVariableProducerBase()
+{
+}
+
+template<class T> unique_ptr<typename EventVariableProducerBase<T>::Cache>
+EventVariableProducerBase<T>::initializeGlobalCache (const edm::ParameterSet &cfg)
+{
+  return unique_ptr<Cache> (new Cache);
+}
+
+template<class T> void
+EventVariableProducerBase<T>::globalBeginRunProduce (edm::Run &run, const edm::EventSetup &setup, const RunContext *context)
+{
+  // The names of the variables, in the order of their IDs.
+  auto_ptr<vector<string> > names (new vector<string> (context->global ()->names ()));
+  run.put (names, "eventvariables");
+}
+
+template<class T> void
+EventVariableProducerBase<T>::globalEndJob (const Cache *cache)
+{
+}
+
+template<class T> void
+EventVariableProducerBase<T>::produce (edm::Event &event, const edm::EventSetup &setup)
+{
+  // The payload starts with every variable registered, in the order of their
+  // IDs, and with no values.
+  eventvariables = auto_ptr<EventVariableProducerPayload> (new EventVariableProducerPayload);
+  eventvariables->values.assign (variableNames_.size (), INVALID_VALUE);
+
+  AddVariables(event);
+
+  // store all of our calculated quantities in the event
+  event.put (eventvariables, "eventvariables");
+  eventvariables.reset ();
+}
+
+// implementation left up to the daughter class
+template<class T> void
+EventVariableProducerBase<T>::AddVariables (const edm::Event &event) {}
+
+template<class T> unsigned
+EventVariableProducerBase<T>::registerEventVar (const string &name)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // A variable which is already registered keeps its ID. New variables can
+  // only be registered in the constructor, since their names are put in the
+  // run before any event is produced.
+  //////////////////////////////////////////////////////////////////////////////
+  auto variable = variableIndices_.find (name);
+  if (variable != variableIndices_.end ())
+    return variable->second;
+  if (eventvariables.get ())
+    {
+      clog << "ERROR [EventVariableProducer::registerEventVar]: the event variable " << name << " must be registered in the constructor." << endl;
+      exit (EXIT_CODE);
+    }
+
+  unsigned id = variableNames_.size ();
+  variableIndices_[name] = id;
+  variableNames_.push_back (name);
+  cache_->registerName (id, name);
+  return id;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+template<class T> void
+EventVariableProducerBase<T>::setEventVar (unsigned id, double value)
+{
+  if (id >= eventvariables->values.size ())
+    {
+      clog << "ERROR [EventVariableProducer::setEventVar]: no event variable has been registered with ID " << id << "." << endl;
+      exit (EXIT_CODE);
+    }
+  eventvariables->values[id] = value;
+}
+
+template<class T> void
+EventVariableProducerBase<T>::addEventVar (const string &name, double value)
+{
+  setEventVar (registerEventVar (name), value);
+}
+
 #endif
@@ -0,0 +1,64 @@
+#ifndef HISTOGRAM_BUFFER
+#define HISTOGRAM_BUFFER
+
+#include <vector>
+
+#include "TH1.h"
+
+#include "OSUT3Analysis/AnaTools/interface/BinnedLookup.h"
+
+using namespace std;
+
+/*
+A HistogramBuffer accumulates the fills of a TH1 or TH2 in plain arrays which
+belong to it alone, so that filling does not touch any ROOT object. Each
+module, or each stream of a module, can therefore fill its own buffers without
+any locking. The buffers of all the streams are added together with mergeInto
+when each stream ends, and the sum is added into the histogram booked with the
+TFileService at the end of the job, also with mergeInto.
+
+The buffer is constructed from the histogram it is to be merged into, whose
+binning it copies. Fills are treated exactly as in TH1::Fill and TH2::Fill:
+the sum of weights and of squared weights is kept for each bin, including the
+underflow and overflow, and the statistics used for the mean and RMS only
+include fills within the range of the axes.
+*/
+
+class HistogramBuffer
+{
+  public:
+    HistogramBuffer ();
+    HistogramBuffer (const TH1 &);
+
+    const BinnedAxis &xAxis () const { return xAxis_; };
+    const BinnedAxis &yAxis () const { return yAxis_; };
+
+    void fill (double x, double w);
+    void fill (double x, double y, double w);
+
+    // Adds the contents of the buffer to the given histogram, or to the given
+    // buffer, which must have the same binning, and empties this buffer.
+    void mergeInto (TH1 &);
+    void mergeInto (HistogramBuffer &);
+
+  private:
+    void clear ();
+
+    BinnedAxis      xAxis_;
+    BinnedAxis      yAxis_;
+    int             nBinsX_;  // number of bins in x, including underflow and overflow
+
+    vector<double>  sumw_;
+    vector<double>  sumw2_;
+    double          entries_;
+    bool            weighted_;  // whether any fill had a weight other than one
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Statistics in the same order as in TH1::GetStats, i.e., the sums of w,
+    // w^2, w*x, w*x^2, w*y, w*y^2, and w*x*y.
+    ////////////////////////////////////////////////////////////////////////////
+    vector<double>  stats_;
+    ////////////////////////////////////////////////////////////////////////////
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef INSTRUMENTATION
+#define INSTRUMENTATION
+
+#include <chrono>
+#include <string>
+
+using namespace std;
+
+/*
+Instrumentation collects statistics about where the time of the analysis chain
+is spent, so that slow cut strings or producers can be found without an
+external profiler. Nothing is collected unless it is enabled, which any module
+reading the untracked parameter "instrumentationFile" does if the parameter is
+not empty.
+
+Two kinds of statistics are collected:
+
+   expressions:  for each ValueLookupTree given a label with
+                 setInstrumentationLabel, the number of times it was evaluated,
+                 the wall time spent evaluating it, the number of combinations
+                 of objects evaluated, the number of member lookups, the number
+                 of invalid values, and the number of times its values were
+                 found in the ValueCache
+   producers:    for each module timing itself with an Instrumentation::Timer,
+                 the number of calls and the wall time spent in them
+
+At the end of the job, a table of both, sorted by the time spent, is printed,
+and the same statistics are written as JSON to the file given by the
+parameter.
+*/
+
+struct EvaluationStats
+{
+  EvaluationStats ();
+
+  EvaluationStats &operator+= (const EvaluationStats &);
+
+  unsigned long long  evaluations;
+  unsigned long long  combinations;
+  unsigned long long  memberLookups;
+  unsigned long long  invalidValues;
+  unsigned long long  cacheHits;
+  double              seconds;
+};
+
+class Instrumentation
+{
+  public:
+    // Turns on the instrumentation for the whole job, writing the statistics
+    // to the given file at the end of the job.
+    static void enable (const string &fileName);
+    static bool isEnabled ();
+
+    // Adds the statistics of an expression, identified by the label of the
+    // module evaluating it, the kind of expression, e.g., "cut", and its name.
+    static void addExpression (const string &module, const string &kind, const string &name, const EvaluationStats &);
+
+    // Adds one call of the given producer.
+    static void addProducerCall (const string &module, const double seconds);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // A Timer measures the wall time from its construction to its destruction
+    // and adds it to the producer with the given label, if the
+    // instrumentation is enabled.
+    ////////////////////////////////////////////////////////////////////////////
+    class Timer
+    {
+      public:
+        Timer (const string &module);
+        ~Timer ();
+
+      private:
+        bool                                   isEnabled_;
+        string                                 module_;  // only copied if the instrumentation is enabled
+        chrono::steady_clock::time_point       start_;
+    };
+    ////////////////////////////////////////////////////////////////////////////
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef MEMBER_ACCESSOR
+#define MEMBER_ACCESSOR
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "OSUT3Analysis/AnaTools/interface/DataFormat.h"
+
+#ifdef ROOT6
+  #include "FWCore/Utilities/interface/FunctionWithDict.h"
+  #include "FWCore/Utilities/interface/TypeWithDict.h"
+#else
+  #include "Reflex/Member.h"
+  #include "Reflex/Type.h"
+#endif
+
+/*
+A MemberAccessor is the compiled form of a (type, member) pair, as used by
+anatools::getMember. The member may be a data member or a function member,
+may be inherited from a base class, and may be a dotted path such as
+"innerTrack.hitPattern_.numberOfValidPixelHits".
+
+All of the lookups by name are done once, when the accessor is resolved, and
+the result is stored as a list of steps which are applied to the address of
+the object:
+
+   data member:      add the offset of the member (or of the base class)
+   dereference:      follow a pointer
+   function member:  invoke the pre-resolved function member
+
+The last step converts the primitive type it finds to a double. If any part of
+the path cannot be resolved this way, e.g., because it involves a reference,
+the accessor falls back to anatools::getMember, so the behavior is identical
+to what it was before.
+
+Accessors are shared by the whole job and should be retrieved with
+MemberAccessor::get (), which only resolves each (type, member) pair once. Since
+it takes a lock shared by all the threads, code which evaluates the same member
+many times should keep the accessor it returns rather than call it each time.
+*/
+
+class MemberAccessor
+{
+  public:
+    MemberAccessor (const string &type, const string &member);
+    ~MemberAccessor ();
+
+    // Returns the accessor for the given type and member, resolving it the
+    // first time it is requested.
+    static const MemberAccessor &get (const string &type, const string &member);
+
+    // Returns true if all the steps could be resolved, i.e., if the accessor
+    // does not need to fall back to anatools::getMember.
+    bool isResolved () const;
+
+    const string &type () const;
+    const string &member () const;
+
+    // Returns the value of the member for the object at the given address.
+    double operator() (const void * const) const;
+
+  private:
+    enum StepType { DATA_MEMBER, DEREFERENCE, FUNCTION_MEMBER };
+    enum ValueType { NO_VALUE, FLOAT, DOUBLE, LONG_DOUBLE, CHAR, INT, UNSIGNED_INT, BOOL, UNSIGNED_SHORT_INT, UNSIGNED_LONG_INT };
+
+    struct Step
+    {
+      StepType   stepType;
+      size_t     offset;
+      ValueType  valueType;   // NO_VALUE unless the step yields a primitive
+      bool       isPointer;   // whether the function member returns a pointer
+#ifdef ROOT6
+      edm::TypeWithDict      scope;
+      edm::TypeWithDict      returnType;
+      edm::FunctionWithDict  function;
+#else
+      Reflex::Type    scope;
+      Reflex::Type    returnType;
+      Reflex::Member  function;
+#endif
+    };
+
+    // The maximum number of steps which can be evaluated without falling back
+    // to anatools::getMember.
+    static const unsigned MAX_STEPS = 16;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Recursive methods which append the steps needed to reach a member of the
+    // given type. They return false if the member cannot be resolved, in which
+    // case the steps are left as they were.
+    ////////////////////////////////////////////////////////////////////////////
+#ifdef ROOT6
+    bool resolve (const edm::TypeWithDict &, const string &);
+    bool resolveSingle (const edm::TypeWithDict &, const string &, edm::TypeWithDict &);
+#else
+    bool resolve (const Reflex::Type &, const string &);
+    bool resolveSingle (const Reflex::Type &, const string &, Reflex::Type &);
+#endif
+    ////////////////////////////////////////////////////////////////////////////
+
+    // Returns the enumerator corresponding to a primitive type name, or
+    // NO_VALUE if the type is not one we know how to convert to a double.
+    ValueType getValueType (const string &) const;
+
+    // Converts the primitive at the given address to a double.
+    double toDouble (const ValueType, const void * const) const;
+
+    // Invokes a function member whose return type is a primitive, and converts
+    // the result to a double.
+    double invoke (const Step &, const void * const) const;
+    template<class T> double invoke (const Step &, const void * const) const;
+
+    string        type_;
+    string        member_;
+    vector<Step>  steps_;
+    bool          isResolved_;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef OBJECT_FLAGS
+#define OBJECT_FLAGS
+
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/*
+ObjectFlags holds the flags set by the CutCalculator for each object in each
+collection after each cut. Each flag is a pair of bools, the first of which
+indicates whether the object passes and the second whether the flag is valid.
+
+Collections are referred to by small integer IDs rather than by their labels.
+The IDs are assigned by the CutCalculator when it is constructed, in the
+alphabetical order of the labels, and the label corresponding to each ID is
+stored in the CutCalculatorMetadata which each payload points to.
+
+The flags for each (cut, collection) pair are stored as two packed bitsets,
+the first for whether each object passes and the second for whether each flag
+is valid, in a single vector of words shared by all the pairs, so that filling
+the flags for an event only needs a handful of allocations. A pair which has
+no flags, e.g., because the collection is not used by any cut up to that one,
+is distinguished from one with flags for zero objects.
+*/
+
+class ObjectFlags
+{
+  public:
+    ObjectFlags ();
+    ObjectFlags (unsigned nCollections);
+
+    // Returns the number of cuts for which flags can be stored.
+    unsigned size () const;
+
+    // Changes the number of cuts for which flags can be stored. Flags for any
+    // cuts beyond the new size are dropped.
+    void resize (unsigned nCuts);
+
+    // Returns the number of collections, i.e., one more than the largest ID.
+    unsigned nCollections () const;
+
+    // Returns true if there are flags for the given cut and collection.
+    bool has (unsigned cut, unsigned collection) const;
+
+    // Returns the number of objects with flags for the given cut and
+    // collection, or zero if there are no flags.
+    unsigned nObjects (unsigned cut, unsigned collection) const;
+
+    // Creates flags for the given number of objects for the given cut and
+    // collection, all initialized to the given flag. Any existing flags for
+    // the cut and collection are replaced.
+    void add (unsigned cut, unsigned collection, unsigned nObjects, const pair<bool, bool> &flag = make_pair (false, false));
+
+    // Copies the flags for the given collection from one cut to another.
+    void copy (unsigned fromCut, unsigned toCut, unsigned collection);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Methods for retrieving and setting the flag of a single object. The
+    // flags for the given cut and collection must exist.
+    ////////////////////////////////////////////////////////////////////////////
+    pair<bool, bool> get (unsigned cut, unsigned collection, unsigned object) const;
+    bool passes (unsigned cut, unsigned collection, unsigned object) const;
+    bool isValid (unsigned cut, unsigned collection, unsigned object) const;
+    void set (unsigned cut, unsigned collection, unsigned object, const pair<bool, bool> &flag);
+    void setPasses (unsigned cut, unsigned collection, unsigned object, bool passes);
+    ////////////////////////////////////////////////////////////////////////////
+
+  private:
+    unsigned getOffset (unsigned cut, unsigned collection) const;
+    void setBit (unsigned word, unsigned object, bool value);
+    bool getBit (unsigned word, unsigned object) const;
+
+    unsigned nCollections_;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // For each (cut, collection) pair, at index cut * nCollections_ +
+    // collection, the offset of its words in bits_, or -1 if it has no flags,
+    // and its number of objects.
+    ////////////////////////////////////////////////////////////////////////////
+    vector<int>       offsets_;
+    vector<unsigned>  nObjects_;
+    ////////////////////////////////////////////////////////////////////////////
+
+    vector<unsigned long long>  bits_;
+};
+
+#endif
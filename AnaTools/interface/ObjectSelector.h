@@ -5,17 +5,28 @@
 
 #include "DataFormats/Common/interface/Handle.h"
 
-#include "FWCore/Framework/interface/EDFilter.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDFilter.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
 
 #define EXIT_CODE 2
 
+////////////////////////////////////////////////////////////////////////////////
+// The type of the product holding objects of type T, which is a vector except
+// for beamspots.
+////////////////////////////////////////////////////////////////////////////////
+template<class T> struct ObjectSelectorProduct { typedef vector<T> type; };
+#if IS_VALID(beamspots)
+template<> struct ObjectSelectorProduct<osu::Beamspot> { typedef osu::Beamspot type; };
+template<> struct ObjectSelectorProduct<TYPE(beamspots)> { typedef TYPE(beamspots) type; };
+#endif
+////////////////////////////////////////////////////////////////////////////////
+
 template<class T, class TO>
-class ObjectSelector : public edm::EDFilter
+class ObjectSelector : public edm::stream::EDFilter<>
 {
   public:
     ObjectSelector (const edm::ParameterSet &);
@@ -30,12 +41,21 @@ class ObjectSelector : public edm::EDFilter
     edm::ParameterSet  collections_;
     string             collectionToFilter_;
     edm::InputTag      cutDecisions_;
+    bool               copyObjects_;
     bool               firstEvent_;
     ////////////////////////////////////////////////////////////////////////////
 
     // InputTag for the collection which is to be filtered.
     edm::InputTag            collection_;
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collection, in both formats, and for the cut decisions.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<typename ObjectSelectorProduct<T>::type>    collectionToken_;
+    CollectionToken<typename ObjectSelectorProduct<TO>::type>   collectionOrigToken_;
+    edm::EDGetTokenT<CutCalculatorPayload>                      cutDecisionsToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     ////////////////////////////////////////////////////////////////////////////
     // Objects which can be gotten from the event.
     ////////////////////////////////////////////////////////////////////////////
@@ -54,6 +74,7 @@ ObjectSelector<T, TO>::ObjectSelector (const edm::ParameterSet &cfg) :
   collections_         (cfg.getParameter<edm::ParameterSet>  ("collections")),
   collectionToFilter_  (cfg.getParameter<string>             ("collectionToFilter")),
   cutDecisions_        (cfg.getParameter<edm::InputTag>      ("cutDecisions")),
+  copyObjects_         (cfg.getUntrackedParameter<bool>      ("copyObjects", true)),
   firstEvent_          (true)
 {
   assert (strcmp (PROJECT_VERSION, SUPPORTED_VERSION) == 0);
@@ -61,8 +82,23 @@ ObjectSelector<T, TO>::ObjectSelector (const edm::ParameterSet &cfg) :
   // Retrieve the InputTag for the collection which is to be filtered.
   collection_ = collections_.getParameter<edm::InputTag> (collectionToFilter_);
 
-  produces<vector<T> >  (collection_.instance ());
-  produces<vector<TO> > (ORIGINAL_FORMAT);  
+  collectionToken_      =  anatools::consumeCollection<typename ObjectSelectorProduct<T>::type>   (collection_,  consumesCollector  ());
+  cutDecisionsToken_    =  consumes<CutCalculatorPayload>  (cutDecisions_);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // The indices of the objects which pass are always produced, and are enough
+  // for modules reading the collection through a selection. The selected
+  // objects are only copied, in both formats, if copyObjects is true, which is
+  // needed if they are to be written to a skim.
+  //////////////////////////////////////////////////////////////////////////////
+  produces<vector<unsigned> > (SELECTION);
+  if (copyObjects_)
+    {
+      collectionOrigToken_ = anatools::consumeCollection<typename ObjectSelectorProduct<TO>::type> (collection_, consumesCollector (), true);
+      produces<typename ObjectSelectorProduct<T>::type>   (collection_.instance ());
+      produces<typename ObjectSelectorProduct<TO>::type>  (ORIGINAL_FORMAT);
+    }
+  //////////////////////////////////////////////////////////////////////////////
 }
 
 template<class T, class TO>
@@ -77,22 +113,25 @@ template<class T, class TO> bool
   // Get the collection and cut decisions from the event and print a warning if
   // there is a problem.
   //////////////////////////////////////////////////////////////////////////////
-  anatools::getCollection (collection_, collection,     event);
-  anatools::getCollection (collection_, collectionOrig, event);
-  event.getByLabel (cutDecisions_, cutDecisions);  
+  anatools::getCollection (collectionToken_,     collection,     event);
+  if (copyObjects_)
+    anatools::getCollection (collectionOrigToken_, collectionOrig, event);
+  event.getByToken (cutDecisionsToken_, cutDecisions);
   if (firstEvent_ && !collection.isValid ())
     clog << "WARNING: failed to retrieve requested collection from the event." << endl;
-  if (firstEvent_ && !collectionOrig.isValid ())
+  if (firstEvent_ && copyObjects_ && !collectionOrig.isValid ())
     clog << "WARNING: failed to retrieve original collection from the event." << endl;
   if (firstEvent_ && !cutDecisions.isValid ())
     clog << "WARNING: failed to retrieve cut decisions from the event." << endl;
+  if (firstEvent_ && cutDecisions.isValid () && !cutDecisions->metadata)
+    clog << "ERROR: the cut decisions have no metadata, as is the case when they are read from a file, so no objects are cut." << endl;
   //////////////////////////////////////////////////////////////////////////////
 
   //////////////////////////////////////////////////////////////////////////////
   // The OSU collection and the original collection should always be the same
   // size.
   //////////////////////////////////////////////////////////////////////////////
-  if (collection->size () != collectionOrig->size ())
+  if (copyObjects_ && collection->size () != collectionOrig->size ())
     {
       clog << "ERROR: original collection and OSU collection have different sizes." << endl;
       exit (EXIT_CODE);
@@ -100,44 +139,65 @@ template<class T, class TO> bool
   //////////////////////////////////////////////////////////////////////////////
 
   //////////////////////////////////////////////////////////////////////////////
-  // Fill the payload with the objects from the collection which pass all cuts.
-  // If the collection could not be retrieved, the payload remains empty. If the
-  // cut decisions could not be retrieved, no objects are cut.
+  // Fill the selection with the indices of the objects from the collection
+  // which pass all cuts. If the collection could not be retrieved, the
+  // selection remains empty. If the cut decisions, or their metadata, could
+  // not be retrieved, no objects are cut.
   //////////////////////////////////////////////////////////////////////////////
-  pl_  = auto_ptr<vector<T> >  (new vector<T>  ());
-  plO_ = auto_ptr<vector<TO> > (new vector<TO> ());
-  if (collection.isValid () && collectionOrig.isValid())
+  auto_ptr<vector<unsigned> > selection (new vector<unsigned> ());
+  if (collection.isValid () && (!copyObjects_ || collectionOrig.isValid ()))
     {
-      auto objOrig = collectionOrig->begin();  
-      for (auto object = collection->begin (); object != collection->end (); object++, objOrig++)
+      int collectionId = (cutDecisions.isValid () && cutDecisions->metadata ? cutDecisions->metadata->getCollectionId (collectionToFilter_) : -1);
+      for (unsigned iObject = 0; iObject < collection->size (); iObject++)
         {
-          unsigned iObject = object - collection->begin ();
           bool passes = true;
 
-          if (cutDecisions.isValid ())
+          if (collectionId >= 0)
             {
-              for (int iCut = cutDecisions->cumulativeObjectFlags.size () - 1; iCut >= 0; iCut--)
+              // The flags for a collection can be missing for the last cuts
+              // if the CutCalculator stopped early, in which case those cuts
+              // are skipped.
+              const ObjectFlags &flags = cutDecisions->cumulativeObjectFlags;
+              for (int iCut = flags.size () - 1; iCut >= 0; iCut--)
                 {
-                  if (cutDecisions->cumulativeObjectFlags.at (iCut).at (collectionToFilter_).at (iObject).second)
+                  if (iObject >= flags.nObjects (iCut, collectionId))
+                    continue;
+                  if (flags.isValid (iCut, collectionId, iObject))
                     {
-                      passes = cutDecisions->cumulativeObjectFlags.at (iCut).at (collectionToFilter_).at (iObject).first;
+                      passes = flags.passes (iCut, collectionId, iObject);
                       break;
                     }
                 }
             }
           if (passes)
-            {
-              pl_ ->push_back (*object);
-              plO_->push_back (*objOrig);
-            }
+            selection->push_back (iObject);
         }
     }
   //////////////////////////////////////////////////////////////////////////////
 
-  event.put (pl_,  collection_.instance ());
-  event.put (plO_, ORIGINAL_FORMAT);  
-  pl_.reset ();
-  plO_.reset ();
+  //////////////////////////////////////////////////////////////////////////////
+  // If requested, fill the payload with copies of the selected objects.
+  //////////////////////////////////////////////////////////////////////////////
+  if (copyObjects_)
+    {
+      pl_  = auto_ptr<vector<T> >  (new vector<T>  ());
+      plO_ = auto_ptr<vector<TO> > (new vector<TO> ());
+      pl_ ->reserve (selection->size ());
+      plO_->reserve (selection->size ());
+      for (const auto &iObject : *selection)
+        {
+          pl_ ->push_back ((*collection)[iObject]);
+          plO_->push_back ((*collectionOrig)[iObject]);
+        }
+
+      event.put (pl_,  collection_.instance ());
+      event.put (plO_, ORIGINAL_FORMAT);  
+      pl_.reset ();
+      plO_.reset ();
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  event.put (selection, SELECTION);
   firstEvent_ = false;
 
   // Return the global decision for the event. If the cut decisions could not
@@ -0,0 +1,59 @@
+#ifndef OUTPUT_SINK
+#define OUTPUT_SINK
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/*
+An OutputSink writes records, e.g., the information printed for one event, to a
+file or to standard error from a background thread, so that the module
+producing them does not have to wait for the output, nor keep everything in
+memory until the end of the job.
+
+The records are held in a ring buffer with a fixed number of slots until the
+writer thread gets to them. If the buffer is full, write blocks until a slot is
+free, so the memory used never grows beyond the records in the buffer. The
+records are written in the order they were given to write, and the destructor
+waits until all of them have been written.
+*/
+
+class OutputSink
+{
+  public:
+    // Writes to the given file, or to standard error if the name is empty,
+    // holding up to the given number of records at a time.
+    OutputSink (const string &fileName, unsigned capacity);
+    ~OutputSink ();
+
+    void write (string &record);
+
+  private:
+    void drain ();
+
+    ofstream        file_;
+    ostream         *out_;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // The ring buffer, whose records run from slot first_ to slot
+    // (first_ + size_ - 1) % slots_.size (), and the variables used to
+    // synchronize it with the writer thread.
+    ////////////////////////////////////////////////////////////////////////////
+    vector<string>      slots_;
+    unsigned            first_;
+    unsigned            size_;
+    bool                done_;
+    mutex               mutex_;
+    condition_variable  notEmpty_;
+    condition_variable  notFull_;
+    ////////////////////////////////////////////////////////////////////////////
+
+    thread writer_;
+};
+
+#endif
@@ -16,6 +16,8 @@
 #include "TGraphAsymmErrors.h"
 #include "TFile.h"
 
+#include "OSUT3Analysis/AnaTools/interface/BinnedLookup.h"
+
 using namespace std;
 
 
@@ -39,9 +41,17 @@ class MuonSFWeight
       MuonSFWeight (const string &, const string &);
       ~MuonSFWeight ();
       double at (const double &, const double &, const int &shiftUpDown = 0);
+      void at (const vector<double> &, const vector<double> &, vector<double> &, const int &shiftUpDown = 0);
 
     private:
-      TH2 *muonSFWeight_;
+      BinnedLookup2D muonSFWeight_;
+
+      // Points used in place of those outside of the range of the histogram,
+      // which only depend on its binning.
+      double etaMax_;
+      double etaOutOfRange_;
+      double ptOutOfRange_;
+      double ptOutOfRangeBarrel_;
   };
 
 
@@ -53,12 +63,15 @@ class ElectronSFWeight
       ElectronSFWeight (const string &, const string &, const string &sfFile = "", const string &dataOverMC = "");
       ~ElectronSFWeight ();
       double at (const double &, const double &, const int &shiftUpDown = 0);
+      void at (const vector<double> &, const vector<double> &, vector<double> &, const int &shiftUpDown = 0);
 
     private:
       string cmsswRelease_;
       string id_;
 
-      TH2F *electronSFWeight_;
+      bool hasSFWeight_;
+      bool etaOnYAxis_;
+      BinnedLookup2D electronSFWeight_;
   };
 
 
@@ -71,7 +84,7 @@ class TriggerMetSFWeight
       double at (const double &Met, const int &shiftUpDown = 0);
 
     private:
-      TH1F *triggerMetSFWeight_;
+      BinnedLookup1D triggerMetSFWeight_;
   };
 
 class TrackNMissOutSFWeight
@@ -83,7 +96,7 @@ class TrackNMissOutSFWeight
       double at (const double &NMissOut, const int &shiftUpDown = 0);
 
     private:
-      TH1F *trackNMissOutSFWeight_;
+      BinnedLookup1D trackNMissOutSFWeight_;
   };
 
 class EcaloVarySFWeight
@@ -95,7 +108,7 @@ class EcaloVarySFWeight
   double at (const double &EcaloVary, const int &shiftUpDown = 0);
 
  private:
-  TH1F *EcaloVarySFWeight_;
+  BinnedLookup1D EcaloVarySFWeight_;
 };
 
 
@@ -109,7 +122,7 @@ class IsrVarySFWeight
       double at (const double &ptSusy, const int &shiftUpDown = 0);
 
     private:
-      TH1F *isrVarySFWeight_;
+      BinnedLookup1D isrVarySFWeight_;
   };
 
 class MuonCutWeight
@@ -121,7 +134,7 @@ class MuonCutWeight
       double at (const double &pt);
 
     private:
-      TH1F *muonCutWeight_;
+      BinnedLookup1D muonCutWeight_;
   };
 
 
@@ -134,7 +147,7 @@ class ElectronCutWeight
       double at (const double &d0);
 
     private:
-      TH1F *electronCutWeight_;
+      BinnedLookup1D electronCutWeight_;
   };
 
 
@@ -147,7 +160,7 @@ class RecoElectronWeight
       double at (const double &d0);
 
     private:
-      TH1F *recoElectronWeight_;
+      BinnedLookup1D recoElectronWeight_;
   };
 
 
@@ -160,7 +173,7 @@ class RecoMuonWeight
       double at (const double &d0);
 
     private:
-      TH1F *recoMuonWeight_;
+      BinnedLookup1D recoMuonWeight_;
   };
 
 
@@ -0,0 +1,96 @@
+#ifndef VALUE_CACHE
+#define VALUE_CACHE
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DataFormats/Provenance/interface/EventID.h"
+
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
+
+/*
+A ValueCache holds the values computed by every ValueLookupTree in the job for
+the current event, so that an expression which appears in several places, e.g.,
+in a cut in each channel, in a histogram, and in a value to print, is only
+evaluated once per event.
+
+Values are stored under a key which is the canonical form of the compiled
+expression, i.e., its list of instructions, together with the address and size
+of each input collection. Expressions which are written differently but compile
+to the same instructions, e.g., "muon.pt" and "pt" with muons as the only input
+collection, therefore share the same entry, while the same expression applied to
+collections produced by different modules does not. Two kinds of values are
+stored:
+
+   values:   the results of an entire expression, as returned by
+             ValueLookupTree::evaluateSparse
+   columns:  the values of a member or of a top-level conjunct for every object
+             in a collection, as used in the columnar mode of ValueLookupTree
+
+The cache is cleared whenever a new event is seen by
+anatools::getRequiredCollections. There is one cache per stream, which should
+be retrieved with ValueCache::get (), given the index of the stream, i.e.,
+edm::StreamID::value (). A stream only processes one event at a time, but the
+modules on different paths of a stream, e.g., the cut calculators of two
+channels, may process that event on different threads at the same time. Every
+method therefore locks the cache, and values are always returned by copy, so
+that nothing refers into the cache once the lock is released. The numbers of
+hits and misses of all the caches are printed at the end of the job.
+*/
+
+class ValueCache
+{
+  public:
+    ~ValueCache ();
+
+    // Returns the cache of the given stream, creating it the first time it is
+    // requested.
+    static ValueCache &get (const unsigned stream);
+
+    // Clears the cache if the given event is not the one currently cached.
+    void setEvent (const edm::EventID &);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Methods for retrieving and storing the values of an entire expression.
+    // getValues returns false if the key is not found.
+    ////////////////////////////////////////////////////////////////////////////
+    bool getValues (const string &key, vector<Leaf> &values, vector<unsigned> &indices);
+    void putValues (const string &key, const vector<Leaf> &values, const vector<unsigned> &indices);
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Methods for retrieving and storing a column of values. getColumn returns
+    // false if the key is not found.
+    ////////////////////////////////////////////////////////////////////////////
+    bool getColumn (const string &key, vector<double> &column);
+    void putColumn (const string &key, const vector<double> &column);
+    ////////////////////////////////////////////////////////////////////////////
+
+    // The maximum number of streams for which caches can be created.
+    static const unsigned MAX_STREAMS = 256;
+
+  private:
+    ValueCache ();
+
+    // Serializes the modules of the stream which use the cache concurrently.
+    mutex         mutex_;
+
+    edm::EventID  event_;
+    bool          hasEvent_;
+
+    unordered_map<string, pair<vector<Leaf>, vector<unsigned> > >  values_;
+    unordered_map<string, vector<double> >                         columns_;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Statistics which are printed at the end of the job.
+    ////////////////////////////////////////////////////////////////////////////
+    unsigned long long  valueHits_;
+    unsigned long long  valueMisses_;
+    unsigned long long  columnHits_;
+    unsigned long long  columnMisses_;
+    ////////////////////////////////////////////////////////////////////////////
+};
+
+#endif
@@ -6,6 +6,8 @@
 #include <unordered_set>
 
 #include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
+#include "OSUT3Analysis/AnaTools/interface/MemberAccessor.h"
 
 /*
 A ValueLookupTree object contains all the information needed to
@@ -85,6 +87,79 @@ This will be converted to the following, by the prunedCommas() and prunedParenth
 
 typedef unordered_multimap<string, DressedObject> ObjMap;
 
+/*
+After it is pruned, the tree is compiled into a flat list of instructions in
+postfix order, which are executed by a simple stack machine. The last example
+above, "invMass (muon, muon) < 0", becomes:
+
+   LOAD_MEMBER    slot 0, energy
+   LOAD_MEMBER    slot 0, px
+   LOAD_MEMBER    slot 0, py
+   LOAD_MEMBER    slot 0, pz
+   LOAD_MEMBER    slot 1, energy
+   ...
+   INV_MASS       2
+   PUSH_CONSTANT  0
+   LESS
+
+where the slot is the index of the input collection from which the object is
+taken. All the operators, constants, and member accessors are resolved when
+the tree is compiled, so evaluating an expression involves no string
+comparisons and no heap allocation. The recursive tree walker is kept as a
+reference, and is also used for any expression which cannot be compiled.
+
+If there is only one input collection, e.g., "abs (eta) < 2.5 && pt > 20",
+the program is instead executed one instruction at a time for all the objects
+in the collection. Each member which is used is first gathered into a
+contiguous column of doubles, and each instruction is then a simple loop over
+columns, which the compiler can vectorize. A cut then yields a column of zeros
+and ones, one per object.
+
+Variables added to the objects of a collection by a VariableProducer are
+looked up like members prefixed with "uservariable.", e.g.,
+"muon.uservariable.isoCorr > 0.1". Each is given an index when the tree is
+compiled, the array of values for each index is found once per event, and the
+value for an object is then simply the element at the index of the object in
+its collection. Event variables, e.g., "puScalingFactor" with "eventvariables"
+as the input collection, are likewise given an index. The producer and
+position of each are found once per run, from the names the producers put in
+the run, and the value of each is then found once per event.
+
+The tree and its compiled program are fixed once the constructor returns.
+Everything which changes from one event to the next, i.e., the collections,
+the values, and the scratch space of the stack machine, belongs to the object
+as well, so a ValueLookupTree must only be evaluated by one thread at a time.
+This is the case for the trees of stream modules, since the framework creates
+a separate instance of such a module, with its own trees, for each stream. The
+state shared between trees is safe to use concurrently: the MemberAccessor
+objects are never modified once resolved, and each ValueCache, which is shared
+by the modules of one stream, some of which may run at the same time, is
+locked whenever it is used.
+*/
+
+enum Opcode
+{
+  PUSH_CONSTANT, LOAD_MEMBER, LOAD_EVENTVARIABLE, LOAD_USERVARIABLE, NUMBER,
+  OR, AND, EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL,
+  PLUS, MINUS, MULTIPLY, DIVIDE, MODULO, UNARY_PLUS, NEGATE, NOT,
+  ATAN2, LDEXP, POW, HYPOT, FMOD, REMAINDER, COPYSIGN, NEXTAFTER, FDIM, FMAX, FMIN,
+  COS, SIN, TAN, ACOS, ASIN, ATAN, COSH, SINH, TANH, ACOSH, ASINH, ATANH,
+  EXP, LOG, LOG10, EXP2, EXPM1, ILOGB, LOG1P, LOG2, LOGB, SQRT, CBRT,
+  ERF, ERFC, TGAMMA, LGAMMA, CEIL, FLOOR, TRUNC, ROUND, RINT, NEARBYINT, FABS,
+  DELTA_PHI, DELTA_R, INV_MASS
+};
+
+struct Instruction
+{
+  Opcode                opcode;
+  double                constant;   // value pushed by PUSH_CONSTANT
+  unsigned              slot;       // index of the input collection for lookups
+  unsigned              nOperands;  // number of objects for INV_MASS
+  unsigned              column;     // index of the gathered member, for LOAD_MEMBER in columnar mode, or of the event or user variable, for LOAD_EVENTVARIABLE and LOAD_USERVARIABLE
+  const MemberAccessor  *accessor;  // for LOAD_MEMBER
+  string                name;       // collection for NUMBER, variable for LOAD_EVENTVARIABLE and LOAD_USERVARIABLE
+};
+
 class ValueLookupTree
 {
   public:
@@ -113,11 +188,37 @@ class ValueLookupTree
     // expression.  The evaluate() function returns values for each of the 
     // objects in the event; that is why it returns a vector.  
     // FIXME:  Check whether evaluate() should return vector<Leaf> or vector<double>.
+    //
+    // For more than one input collection, most combinations of objects are
+    // never evaluated: those which are not unique, in the sense described in
+    // getLocalIndex(), and those rejected early, as described in compile().
+    // evaluateSparse() returns only the values which were evaluated, with the
+    // global index of each given by getEvaluatedIndices(), and
+    // getDefaultValue() gives the value of any other combination.
+    // evaluate() returns the same values for every combination.
     ////////////////////////////////////////////////////////////////////////////
     void insert (const string &);
     const vector<Leaf> &evaluate ();
+    const vector<Leaf> &evaluateSparse ();
+    const vector<unsigned> &getEvaluatedIndices () const;
+    unsigned getNumberOfCombinations () const;
+    double getDefaultValue (const unsigned globalIndex) const;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Methods for choosing between the compiled instructions and the recursive
+    // tree walker. isCompiled() returns false if the expression could not be
+    // compiled, in which case the tree walker is always used.
+    ////////////////////////////////////////////////////////////////////////////
+    void setUseTreeWalker (const bool);
+    bool isCompiled () const;
+    ////////////////////////////////////////////////////////////////////////////
+
+    // Gives the tree the module label, kind, and name under which its
+    // statistics are reported by the Instrumentation, and starts collecting
+    // them if the instrumentation is enabled.
+    void setInstrumentationLabel (const string &module, const string &kind, const string &name);
+
     ////////////////////////////////////////////////////////////////////////////
     // Methods for retrieving various information about a collection.
     ////////////////////////////////////////////////////////////////////////////
@@ -141,6 +242,14 @@ class ValueLookupTree
     void pruneDots_ (Node * const) const;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Methods for binding each member lookup in the tree to a MemberAccessor,
+    // so that no lookups by name are needed when the tree is evaluated.
+    ////////////////////////////////////////////////////////////////////////////
+    void bindAccessors (Node * const);
+    const MemberAccessor *getAccessor (const string &collection, const string &variable);
+    ////////////////////////////////////////////////////////////////////////////
+
     ////////////////////////////////////////////////////////////////////////////
     // Recursive methods for inserting an expression into the tree and then
     // evaluating it.
@@ -149,6 +258,41 @@ class ValueLookupTree
     Leaf evaluate_ (const Node * const, const ObjMap &);
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Methods for compiling the tree into a list of instructions and then
+    // executing them for the objects in objects_.
+    ////////////////////////////////////////////////////////////////////////////
+    bool compile ();
+    bool compile_ (const Node * const, const ObjMap &, unsigned &);
+    bool compileConjuncts (const Node * const, const ObjMap &, unsigned &, vector<pair<unsigned, unsigned> > &);
+    bool compileLookup (const string &collection, const string &variable, const MemberAccessor *, const bool iterateObj, const ObjMap &, unsigned &);
+    bool emit (const Instruction &, const unsigned nOperands, unsigned &);
+    void evaluateCompiled ();
+    void evaluateColumnar ();
+    void evaluateTreeWalker ();
+    double execute (const unsigned first, const unsigned last);
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Methods which return the keys used for the ValueCache: a canonical form
+    // of a range of instructions, and a string identifying the input
+    // collections in the current event.
+    ////////////////////////////////////////////////////////////////////////////
+    string getInstructionsKey (const unsigned first, const unsigned last) const;
+    string getCollectionsKey () const;
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Methods for iterating over the unique combinations of objects which are
+    // not rejected early. nextCombination() sets localIndices_ to the next
+    // such combination, or to the first one if the argument is true, and
+    // returns false when there are no more.
+    ////////////////////////////////////////////////////////////////////////////
+    void rejectObjects ();
+    bool nextCombination (const bool first);
+    unsigned getGlobalIndex () const;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Mainly for debugging:
     string printNode(Node* node) const;
     string printValue(Node* node) const;
@@ -161,6 +305,36 @@ class ValueLookupTree
     // i is the local index
     ////////////////////////////////////////////////////////////////////////////
     void *getObject (const string &name, const unsigned i);
+    void *getCollectionData (const string &name, size_t &stride);
+    template<class T> void *getCollectionData (const edm::Handle<vector<T> > &, size_t &) const;
+    const vector<unsigned> *getSelection (const string &name) const;
+    char *getObjectAddress (const unsigned j, const unsigned i) const;
+    unsigned getObjectIndex (const unsigned j) const;
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Methods for user variables, i.e., "muon.uservariable.isoCorr". The first
+    // returns the index of the named variable of the given collection in
+    // userVariables_, adding it if necessary, and the second returns the
+    // values of the variable with the given index, with one element per
+    // object, or NULL if no VariableProducer has filled it in this event.
+    ////////////////////////////////////////////////////////////////////////////
+    unsigned getUserVariableIndex (const string &collection, const string &name);
+    const vector<double> *getUserVariable (const unsigned i);
+    static bool isUserVariable (const string &variable, string &name);
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Methods for event variables. The first finds the producer and position
+    // of each variable in eventVariables_ when a new run starts, the second
+    // returns the index of the named variable in eventVariables_, adding it if
+    // necessary, and the third returns the value of the variable with the
+    // given index, or NULL if no EventVariableProducer has set it in this
+    // event.
+    ////////////////////////////////////////////////////////////////////////////
+    void resolveEventVariables ();
+    unsigned getEventVariableIndex (const string &name);
+    const double *getEventVariable (const unsigned i) const;
     ////////////////////////////////////////////////////////////////////////////
 
     // Returns the C++ type associated with the collection named in the first
@@ -190,10 +364,6 @@ class ValueLookupTree
     bool vetoMatch (const string &, const string &, const size_t, const vector<string> &) const;
     ////////////////////////////////////////////////////////////////////////////
 
-    // To avoid double counting. For a given set of objects, returns true only
-    // if they are all unique and in a specific order.
-    bool isUniqueCase (const ObjMap &, const unordered_set<string> &) const;
-
     ////////////////////////////////////////////////////////////////////////////
     // Methods for inserting different types of operators into the tree.
     ////////////////////////////////////////////////////////////////////////////
@@ -206,7 +376,8 @@ class ValueLookupTree
     ////////////////////////////////////////////////////////////////////////////
     // Methods for retrieving values from objects.
     ////////////////////////////////////////////////////////////////////////////
-    double valueLookup (const string &collection, const ObjMap &objs, const string &variable, const bool iterateObj = true);
+    double valueLookup (const string &collection, const ObjMap &objs, const string &variable, const bool iterateObj = true, const MemberAccessor *accessor = NULL);
+    const DressedObject &getDressedObject (const string &collection, const ObjMap &objs, const bool iterateObj);
     ////////////////////////////////////////////////////////////////////////////
 
     Node            *root_;
@@ -216,14 +387,98 @@ class ValueLookupTree
     Collections                                    *handles_;
     unordered_map<string, ObjMap::const_iterator>  objIterators_;  // defined for each collection
     unordered_map<string, bool>                    shouldIterate_; // defined for each collection 
-    vector<Leaf>                                   values_;
+    vector<Leaf>                                   values_;          // values of the combinations which were evaluated
+    vector<unsigned>                               evaluatedIndices_; // global index of each element of values_
+    vector<Leaf>                                   denseValues_;     // values of every combination, filled only if needed
+    bool                                           isEvaluated_;
+    bool                                           hasDenseValues_;
     vector<unsigned>                               collectionSizes_; // vector index corresponds to collection index
     vector<unsigned>                               nCombinations_;   // vector index corresponds to collection index
     // nCombinations[i] specifies the number of combinations that can be formed from objects 
     // in collections i to N, where N is the number of collections 
 
-    vector<void *> uservariablesToDelete_;
-    vector<void *> eventvariablesToDelete_;
+    unordered_map<string, unordered_map<string, const MemberAccessor *> >  accessors_;  // indexed by collection, then by variable
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Compiled form of the tree, and the scratch space used when executing it.
+    ////////////////////////////////////////////////////////////////////////////
+    static const unsigned MAX_STACK_SIZE = 64;
+
+    vector<Instruction>  program_;
+    bool                 isCompiled_;
+    bool                 useTreeWalker_;
+    unsigned             stackSize_;              // maximum depth of the stack needed by program_
+    vector<bool>         isRepeatedCollection_;   // whether each input collection is the same as the previous one
+    vector<char *>       collectionData_;         // address of the first object in each input collection
+    vector<size_t>       collectionStrides_;      // size of the objects in each input collection
+    vector<const vector<unsigned> *>  collectionSelections_;  // indices of the selected objects in each input collection, or NULL if all are used
+    vector<void *>       objects_;                // objects currently being evaluated, one per input collection
+
+    bool                             isColumnar_;        // whether program_ is executed a column at a time
+    vector<const MemberAccessor *>   columnAccessors_;   // distinct members gathered in columnar mode
+    vector<vector<double> >          memberColumns_;     // gathered values of each member, one column per accessor
+    vector<vector<double> >          stackColumns_;      // stack used in columnar mode, one column per depth
+
+    // A top-level conjunct of the expression which depends on the object from
+    // a single input collection, and the range of program_ which computes it.
+    struct RejectionFilter
+    {
+      unsigned  slot;
+      unsigned  first;
+      unsigned  last;
+    };
+
+    vector<RejectionFilter>              rejectionFilters_;
+    vector<pair<unsigned, unsigned> >    conjuncts_;      // range of program_ computing each top-level conjunct
+    vector<vector<bool> >                isAccepted_;     // whether each object passes the filters, one vector per input collection
+    vector<unsigned>                     localIndices_;   // combination currently being evaluated, one index per input collection
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Keys used to share values with other trees through the ValueCache.
+    ////////////////////////////////////////////////////////////////////////////
+    bool            isCacheable_;
+    string          programKey_;       // canonical form of program_
+    vector<string>  columnKeys_;       // one for each element of columnAccessors_
+    vector<string>  conjunctKeys_;     // one for each element of conjuncts_, in columnar mode only
+    string          collectionsKey_;   // identifies the input collections in the current event
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // The user variables looked up by program_, as pairs of the collection and
+    // the name of the variable, in the order of the column of each
+    // LOAD_USERVARIABLE, the producer and position at which each was last
+    // found, and their values in the current event.
+    ////////////////////////////////////////////////////////////////////////////
+    vector<pair<string, string> >    userVariables_;
+    vector<pair<int, unsigned> >     userVariableSlots_;
+    vector<const vector<double> *>   userVariableValues_;
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // The event variables looked up by program_, in the order of the column of
+    // each LOAD_EVENTVARIABLE, the producer and position of each in the current
+    // run, and their values in the current event. The run and the lists of
+    // names from which the positions were found are kept so that they are
+    // only found again when either changes.
+    ////////////////////////////////////////////////////////////////////////////
+    vector<string>                   eventVariables_;
+    vector<pair<int, unsigned> >     eventVariableSlots_;
+    vector<const double *>           eventVariableValues_;
+    unsigned                         eventVariablesRun_;
+    vector<const vector<string> *>   eventVariableNames_;
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Statistics which are added to the Instrumentation when the tree is
+    // destroyed, under the labels given to setInstrumentationLabel.
+    ////////////////////////////////////////////////////////////////////////////
+    bool             isInstrumented_;
+    EvaluationStats  stats_;
+    string           instrumentationModule_;
+    string           instrumentationKind_;
+    string           instrumentationName_;
+    ////////////////////////////////////////////////////////////////////////////
 
     const int                                      verbose_ = 0;  // verbosity levels:  0, 1, ... 
     // Typically you want to use verbosity of 1 when running over a single event.  
@@ -2,15 +2,31 @@
 
 #define VARIABLE_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
+#include <map>
+
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
 #include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
 
-class VariableProducer : public edm::EDProducer
+// Base class for producers of user-defined variables. This is a stream module,
+// so daughter classes must declare the collections they need in their
+// constructor, by adding them to objectsToGet_ and then calling
+// anatools::getCollectionTokens with tokens_, and retrieve them in
+// AddVariables with the version of anatools::getRequiredCollections which
+// takes tokens_.
+//
+// Each variable belongs to the objects of one collection. Daughter classes
+// should register each of their variables in their constructor, e.g.,
+// isoCorr_ = registerUserVar ("muons", "isoCorr"), and set it in AddVariables
+// with the ID which is returned, e.g., addUserVar (isoCorr_, x, handles_.muons,
+// muon) for each muon, after which it can be used in cuts and histograms as
+// "muon.uservariable.isoCorr". Variables which are not registered in the
+// constructor are registered the first time they are set by name instead.
+class VariableProducer : public edm::stream::EDProducer<>
   {
     public:
       VariableProducer (const edm::ParameterSet &);
@@ -26,62 +42,63 @@ class VariableProducer : public edm::EDProducer
 
       edm::ParameterSet collections_;
       Collections handles_;
+      CollectionTokens tokens_;
       unordered_set<string> objectsToGet_;
       auto_ptr<VariableProducerPayload> uservariables;
 
       // Methods
 
-      template<typename... Objects> void addUserVar (string varName, double value, Objects... objs);
-      void addUserVar (string varName, double value, ObjectList objects);
-      template<typename Object, typename... Objects> void addUserVar (string varName, double value, ObjectList objects, Object obj, Objects... objs);
+      // Registers the named variable of the named collection, e.g., "muons",
+      // returning its ID, which is its position in the payload of every event.
+      unsigned registerUserVar (const string &collection, const string &varName);
 
-    private:
+      // Sets the value of the variable with the given ID for the given object,
+      // which must be an element of the given collection, e.g., of
+      // handles_.muons.
+      template<class T> void addUserVar (unsigned id, double value, const edm::Handle<vector<T> > &collection, const T &object);
 
-      // Methods
+      // Sets the value of the named variable for the given object, which must
+      // be an element of the given collection, registering the variable if
+      // necessary.
+      template<class T> void addUserVar (const string &varName, double value, const edm::Handle<vector<T> > &collection, const T &object);
 
-      virtual void AddVariables(const edm::Event &);
-
-  };
+      // Sets the value of the variable with the given ID for the object with
+      // the given index in its collection, which has the given size.
+      void setUserVar (unsigned id, double value, unsigned size, unsigned index);
 
+    private:
 
-// Templated variadic functions are confusing!
-// Try these references:
-// https://www.ibm.com/developerworks/community/blogs/5894415f-be62-4bc0-81c5-3956e82276f3/entry/c_templates_what_is_a_variadic_template_function41?lang=en
-// http://en.cppreference.com/w/cpp/language/parameter_pack
+      // Variables
 
+      // ID of each variable, keyed by the name of its collection and its own
+      // name, and the collection and name with each ID.
+      map<pair<string, string>, unsigned> variableIndices_;
+      vector<string> variableCollections_;
+      vector<string> variableNames_;
 
-// This version of addUserVar(), with no argument for "hashes", 
-// should be called in MyVariableProducer.cc.
-template<typename... Objects> void VariableProducer::addUserVar (string varName, double value, Objects... objs) { 
-  ObjectList objects;
-  addUserVar(varName, value, objects, objs...);  // Now call the recursive function.
-}
+      // Methods
 
+      virtual void AddVariables(const edm::Event &);
 
-// This is the recursive version.
-template<typename Object, typename... Objects> void VariableProducer::addUserVar (string varName, double value, ObjectList objects, Object obj, Objects... objs) {
-  // "obj" is the first object in the list
-  // calculate it's type and hash
-  // and add them into the list to save
-  auto type = anatools::getObjectType(obj);
-  auto hash = anatools::getObjectHash(obj);
-  objects.insert(make_pair(type, hash));
+  };
 
-  // Recursively call itself until the size of objs is 0.
-  // Then the non-recursive function will be called once.
-  addUserVar(varName, value, objects, objs...);
+template<class T> void
+VariableProducer::addUserVar (unsigned id, double value, const edm::Handle<vector<T> > &collection, const T &object)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // The index of the object is found from its address, so it must be the
+  // element of the collection itself and not a copy. Otherwise, it is given an
+  // index beyond the end of the collection, which is an error.
+  //////////////////////////////////////////////////////////////////////////////
+  const bool isElement = collection.isValid () && &object >= collection->data () && &object < collection->data () + collection->size ();
+  setUserVar (id, value, (isElement ? collection->size () : 0), (isElement ? &object - collection->data () : 0));
+  //////////////////////////////////////////////////////////////////////////////
 }
 
-
-// This is the non-recursive version.
-void VariableProducer::addUserVar (string varName, double value, ObjectList objects) {
-  // Now there are no more objects to put into hashes, 
-  // so the new variable is created.
-  UserVariable userVar = {};
-  userVar.value = value;
-  userVar.objects = objects;
-  (*uservariables)[varName].push_back(userVar);  
+template<class T> void
+VariableProducer::addUserVar (const string &varName, double value, const edm::Handle<vector<T> > &collection, const T &object)
+{
+  addUserVar (registerUserVar (anatools::getObjectType (object) + "s", varName), value, collection, object);
 }
 
-
 #endif
@@ -6,35 +6,48 @@
 #include "FWCore/Common/interface/TriggerNames.h"
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 #include "OSUT3Analysis/AnaTools/interface/ValueLookupTree.h"
 #include "OSUT3Analysis/AnaTools/plugins/CutCalculator.h"
 
 #define EXIT_CODE 1
 
 CutCalculator::CutCalculator (const edm::ParameterSet &cfg) :
-  collections_  (cfg.getParameter<edm::ParameterSet>  ("collections")),
-  cuts_         (cfg.getParameter<edm::ParameterSet>  ("cuts")),
-  firstEvent_   (true)
+  CutCalculator (cfg, cfg.getParameter<edm::ParameterSet> ("cuts"))
 {
-  assert (strcmp (PROJECT_VERSION, SUPPORTED_VERSION) == 0);
-
   //////////////////////////////////////////////////////////////////////////////
   // Try to unpack the cuts ParameterSet and quit if there is a problem.
   //////////////////////////////////////////////////////////////////////////////
-  if (!unpackCuts ())
+  if (!unpackCuts (cuts_, metadata_))
     {
       clog << "ERROR: failed to interpret cuts PSet. Quitting..." << endl;
       exit (EXIT_CODE);
     }
+  internCollections (vector<Cuts *> (1, &metadata_.cuts));
+  metadata_.collections = collectionLabels_;
   //////////////////////////////////////////////////////////////////////////////
 
+  anatools::getCollectionTokens (objectsToGet_, collections_, tokens_, consumesCollector ());
   produces<CutCalculatorPayload> ("cutDecisions");
 }
 
+CutCalculator::CutCalculator (const edm::ParameterSet &cfg, const edm::ParameterSet &cuts) :
+  collections_    (cfg.getParameter<edm::ParameterSet>  ("collections")),
+  cuts_           (cuts),
+  useTreeWalker_  (cfg.getUntrackedParameter<bool>       ("useTreeWalker", false)),
+  earlyExit_      (cfg.getUntrackedParameter<bool>       ("earlyExit", false)),
+  firstEvent_     (true)
+{
+  assert (strcmp (PROJECT_VERSION, SUPPORTED_VERSION) == 0);
+
+  if (cfg.getUntrackedParameter<string> ("instrumentationFile", "") != "")
+    Instrumentation::enable (cfg.getUntrackedParameter<string> ("instrumentationFile"));
+}
+
 CutCalculator::~CutCalculator ()
 {
 
-   for (auto &cut : unpackedCuts_)
+   for (auto &cut : metadata_.cuts)
      {
        if (cut.valueLookupTree)
          delete cut.valueLookupTree;
@@ -46,14 +59,15 @@ CutCalculator::~CutCalculator ()
 void
 CutCalculator::produce (edm::Event &event, const edm::EventSetup &setup)
 {
-  anatools::getRequiredCollections (objectsToGet_, collections_, handles_, event);
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+  anatools::getRequiredCollections (tokens_, handles_, event);
 
   //////////////////////////////////////////////////////////////////////////////
   // Set all the private variables in the ValueLookup object before using it,
   // and parse the cut strings in the unpacked cuts into ValueLookupTree
   // objects.
   //////////////////////////////////////////////////////////////////////////////
-  if (!initializeValueLookupForest (unpackedCuts_, &handles_))
+  if (!initializeValueLookupForest (metadata_.cuts, &handles_))
     {
       clog << "ERROR: failed to parse all cut strings. Quitting..." << endl;
       exit (EXIT_CODE);
@@ -62,20 +76,27 @@ CutCalculator::produce (edm::Event &event, const edm::EventSetup &setup)
 
   //////////////////////////////////////////////////////////////////////////////
   // Create the payload for this EDProducer and initialize some of its members.
+  // The cuts and triggers are not copied into it, but stored once in the
+  // metadata which it points to.
   //////////////////////////////////////////////////////////////////////////////
   pl_ = auto_ptr<CutCalculatorPayload> (new CutCalculatorPayload);
   pl_->isValid = true;
-  pl_->cuts = unpackedCuts_;
-  pl_->triggers = unpackedTriggers_;
-  pl_->triggersToVeto = unpackedTriggersToVeto_;
-  pl_->triggerFilters = unpackedTriggerFilters_;
+  pl_->metadata = &metadata_;
+  pl_->cumulativeObjectFlags = pl_->individualObjectFlags = ObjectFlags (collectionLabels_.size ());
   //////////////////////////////////////////////////////////////////////////////
 
+  // Decide whether the event passes the triggers specified by the user and
+  // store the decision in the payload.
+  evaluateTriggers (event);
+  evaluateTriggerFilters (event);
+
   // Loop over cuts to set flags for each object indicating whether it passed
-  // the cut.
-  for (unsigned currentCutIndex = 0; pl_->isValid && currentCutIndex != pl_->cuts.size (); currentCutIndex++)
+  // the cut. In the early-exit mode, the loop stops as soon as the event is
+  // known to fail.
+  bool eventCanPass = !earlyExit_ || (pl_->triggerDecision && pl_->triggerFilterDecision);
+  for (unsigned currentCutIndex = 0; pl_->isValid && eventCanPass && currentCutIndex != metadata_.cuts.size (); currentCutIndex++)
     {
-      Cut currentCut = pl_->cuts.at (currentCutIndex);
+      const Cut &currentCut = metadata_.cuts.at (currentCutIndex);
 
       // Sets the flags for the current cut only for the objects which are
       // being cut on.
@@ -84,6 +105,9 @@ CutCalculator::produce (edm::Event &event, const edm::EventSetup &setup)
       // Updates the flags for other objects based on those for the objects
       // which are being cut on.
       updateCrossTalk (currentCut, currentCutIndex);
+
+      if (earlyExit_)
+        eventCanPass = getCutDecisions (currentCut, currentCutIndex).first;
     }
 
   //////////////////////////////////////////////////////////////////////////////
@@ -96,10 +120,6 @@ CutCalculator::produce (edm::Event &event, const edm::EventSetup &setup)
     }
   //////////////////////////////////////////////////////////////////////////////
 
-  // Decide whether the event passes the triggers specified by the user and
-  // store the decision in the payload.
-  evaluateTriggers (event);
-  evaluateTriggerFilters (event);
   setEventFlags ();
 
   event.put (pl_, "cutDecisions");
@@ -111,34 +131,45 @@ bool
 CutCalculator::setObjectFlags (const Cut &currentCut, unsigned currentCutIndex) const
 {
   ////////////////////////////////////////////////////////////////////////////////
-  // Prepare the flag maps for the new cut by increasing the size of the vector
-  // and adding the input label as a key to the map.
+  // Prepare the flags for the new cut by increasing the number of cuts if
+  // necessary and adding flags for the input collection.
   ////////////////////////////////////////////////////////////////////////////////
-  string inputType = currentCut.inputLabel;
-  if (currentCutIndex >= pl_->individualObjectFlags.size ())
-    pl_->individualObjectFlags.resize (currentCutIndex + 1);
-  if (currentCutIndex >= pl_->cumulativeObjectFlags.size ())
-    pl_->cumulativeObjectFlags.resize (currentCutIndex + 1);
-  pl_->individualObjectFlags.at (currentCutIndex)[inputType];
-  pl_->cumulativeObjectFlags.at (currentCutIndex)[inputType];
+  ObjectFlags &individualObjectFlags = pl_->individualObjectFlags,
+              &cumulativeObjectFlags = pl_->cumulativeObjectFlags;
+  unsigned inputType = currentCut.inputLabelId;
+  if (currentCutIndex >= individualObjectFlags.size ())
+    individualObjectFlags.resize (currentCutIndex + 1);
+  if (currentCutIndex >= cumulativeObjectFlags.size ())
+    cumulativeObjectFlags.resize (currentCutIndex + 1);
   ////////////////////////////////////////////////////////////////////////////////
 
   ////////////////////////////////////////////////////////////////////////////////
-  // Set the flags for this cut, but only for the objects being cut on.
+  // Set the flags for this cut, but only for the objects being cut on. Only
+  // some combinations of objects are evaluated, and the rest take their
+  // default values, so that there is still one flag per global index.
   ////////////////////////////////////////////////////////////////////////////////
-  for (auto cutDecision = currentCut.valueLookupTree->evaluate ().begin (); cutDecision != currentCut.valueLookupTree->evaluate ().end (); cutDecision++)
+  const vector<Leaf> &cutDecisions = currentCut.valueLookupTree->evaluateSparse ();
+  const vector<unsigned> &evaluatedIndices = currentCut.valueLookupTree->getEvaluatedIndices ();
+  unsigned nObjects = currentCut.valueLookupTree->getNumberOfCombinations ();
+  bool hasPreviousFlags = (currentCutIndex > 0 && cumulativeObjectFlags.has (currentCutIndex - 1, inputType));
+  individualObjectFlags.add (currentCutIndex, inputType, nObjects);
+  cumulativeObjectFlags.add (currentCutIndex, inputType, nObjects);
+  for (unsigned object = 0, iDecision = 0; object < nObjects; object++)
     {
-      unsigned object = (cutDecision - currentCut.valueLookupTree->evaluate ().begin ());
-      double value = boost::get<double> (*cutDecision);
+      double value;
+      if (iDecision < evaluatedIndices.size () && evaluatedIndices.at (iDecision) == object)
+        value = boost::get<double> (cutDecisions.at (iDecision++));
+      else
+        value = currentCut.valueLookupTree->getDefaultValue (object);
       pair<bool, bool> flag = make_pair (value, !IS_INVALID(value));
 
       if (currentCut.isVeto)
         flag.first = !flag.first;
 
-      pl_->individualObjectFlags.at (currentCutIndex).at (inputType).push_back (flag);
-      if (currentCutIndex > 0 && pl_->cumulativeObjectFlags.at (currentCutIndex - 1).count (inputType))
-        flag.first = flag.first && pl_->cumulativeObjectFlags.at (currentCutIndex - 1).at (inputType).at (object).first;
-      pl_->cumulativeObjectFlags.at (currentCutIndex).at (inputType).push_back (flag);
+      individualObjectFlags.set (currentCutIndex, inputType, object, flag);
+      if (hasPreviousFlags)
+        flag.first = flag.first && cumulativeObjectFlags.passes (currentCutIndex - 1, inputType, object);
+      cumulativeObjectFlags.set (currentCutIndex, inputType, object, flag);
     }
   ////////////////////////////////////////////////////////////////////////////////
 
@@ -153,14 +184,19 @@ CutCalculator::setObjectFlags (const Cut &currentCut, unsigned currentCutIndex)
     {
       vector<pair<unsigned, double> > indicesToArbitrate;
       indicesToArbitrate.clear ();
-      for (auto arbitrationValue = currentCut.arbitrationTree->evaluate ().begin (); arbitrationValue != currentCut.arbitrationTree->evaluate ().end (); arbitrationValue++)
+      const vector<Leaf> &arbitrationValues = currentCut.arbitrationTree->evaluateSparse ();
+      const vector<unsigned> &arbitrationIndices = currentCut.arbitrationTree->getEvaluatedIndices ();
+      for (unsigned object = 0, iValue = 0; object < currentCut.arbitrationTree->getNumberOfCombinations (); object++)
         {
-          unsigned object = (arbitrationValue - currentCut.arbitrationTree->evaluate ().begin ());
-          double value = boost::get<double> (*arbitrationValue);
+          double value;
+          if (iValue < arbitrationIndices.size () && arbitrationIndices.at (iValue) == object)
+            value = boost::get<double> (arbitrationValues.at (iValue++));
+          else
+            value = currentCut.arbitrationTree->getDefaultValue (object);
           pair<bool, bool> flag = make_pair (value, !IS_INVALID(value));
 
-          if (!pl_->cumulativeObjectFlags.at (currentCutIndex).at (inputType).at (object).first
-           || !pl_->cumulativeObjectFlags.at (currentCutIndex).at (inputType).at (object).second
+          if (!cumulativeObjectFlags.passes (currentCutIndex, inputType, object)
+           || !cumulativeObjectFlags.isValid (currentCutIndex, inputType, object)
            || !flag.second)
             continue;
           indicesToArbitrate.push_back (make_pair (object, value));
@@ -173,8 +209,8 @@ CutCalculator::setObjectFlags (const Cut &currentCut, unsigned currentCutIndex)
       bool isChosen = true;
       for (const auto &index : indicesToArbitrate)
         {
-          pl_->individualObjectFlags.at (currentCutIndex).at (inputType).at (index.first).first = isChosen;
-          pl_->cumulativeObjectFlags.at (currentCutIndex).at (inputType).at (index.first).first = isChosen;
+          individualObjectFlags.setPasses (currentCutIndex, inputType, index.first, isChosen);
+          cumulativeObjectFlags.setPasses (currentCutIndex, inputType, index.first, isChosen);
           isChosen = false;
         }
     }
@@ -188,42 +224,45 @@ CutCalculator::updateCrossTalk (const Cut &currentCut, unsigned currentCutIndex)
 {
   // Propagate forward any collections which have flags set for the previous
   // cut.
-  string inputType = currentCut.inputLabel;
-  vector<string> singleObjects = anatools::getSingleObjects (inputType);
+  ObjectFlags &flags = pl_->cumulativeObjectFlags;
+  unsigned inputType = currentCut.inputLabelId;
+  const vector<string> &singleObjects = currentCut.singleObjects;
   if (currentCutIndex > 0)
     {
-      for (const auto &collection : pl_->cumulativeObjectFlags.at (currentCutIndex - 1))
+      for (unsigned collection = 0; collection < flags.nCollections (); collection++)
         {
-          if (collection.first == inputType)
+          if (collection == inputType || !flags.has (currentCutIndex - 1, collection))
             continue;
-          pl_->cumulativeObjectFlags.at (currentCutIndex)[collection.first] = pl_->cumulativeObjectFlags.at (currentCutIndex - 1).at (collection.first);
+          flags.copy (currentCutIndex - 1, currentCutIndex, collection);
+          const string &collectionLabel = collectionLabels_.at (collection);
           unordered_map<unsigned, bool> otherCumulativeFlags;
           for (auto singleObject = singleObjects.begin (); singleObject != singleObjects.end (); singleObject++)
             {
-              for (auto flag = pl_->cumulativeObjectFlags.at (currentCutIndex).at (inputType).begin (); flag != pl_->cumulativeObjectFlags.at (currentCutIndex).at (inputType).end (); flag++)
+              for (unsigned iFlag = 0; iFlag < flags.nObjects (currentCutIndex, inputType); iFlag++)
                 {
-                  unsigned iFlag = flag - pl_->cumulativeObjectFlags.at (currentCutIndex).at (inputType).begin ();
                   unsigned localIndex = currentCut.valueLookupTree->getLocalIndex (iFlag, singleObject - singleObjects.begin ());
-                  set<unsigned> globalIndices = currentCut.valueLookupTree->getGlobalIndices (localIndex, *singleObject, collection.first);
+                  set<unsigned> globalIndices = currentCut.valueLookupTree->getGlobalIndices (localIndex, *singleObject, collectionLabel);
                   if (!globalIndices.size ())
                     break;
-                  pair<bool, bool> currentFlag = pl_->cumulativeObjectFlags.at (currentCutIndex).at (inputType).at (iFlag), otherFlag;
+                  pair<bool, bool> currentFlag = flags.get (currentCutIndex, inputType, iFlag), otherFlag;
                   bool cumulativeFlag = false;
                   for (const auto &globalIndex : globalIndices)
                     {
-                      otherFlag = pl_->cumulativeObjectFlags.at (currentCutIndex).at (collection.first).at (globalIndex);
+                      otherFlag = flags.get (currentCutIndex, collection, globalIndex);
                       otherFlag.second && (cumulativeFlag = cumulativeFlag || otherFlag.first);
                       if (!otherCumulativeFlags.count (globalIndex))
                         otherCumulativeFlags[globalIndex] = false;
                       currentFlag.second && (otherCumulativeFlags.at (globalIndex) = otherCumulativeFlags.at (globalIndex) || currentFlag.first);
                     }
-                  currentFlag.second && (pl_->cumulativeObjectFlags.at (currentCutIndex).at (inputType).at (iFlag).first = currentFlag.first && cumulativeFlag);
+                  if (currentFlag.second)
+                    flags.setPasses (currentCutIndex, inputType, iFlag, currentFlag.first && cumulativeFlag);
                 }
             }
           for (const auto &flag : otherCumulativeFlags)
             {
-              pair<bool, bool> otherFlag = pl_->cumulativeObjectFlags.at (currentCutIndex).at (collection.first).at (flag.first);
-              otherFlag.second && (pl_->cumulativeObjectFlags.at (currentCutIndex).at (collection.first).at (flag.first).first = otherFlag.first && flag.second);
+              pair<bool, bool> otherFlag = flags.get (currentCutIndex, collection, flag.first);
+              if (otherFlag.second)
+                flags.setPasses (currentCutIndex, collection, flag.first, otherFlag.first && flag.second);
             }
         }
     }
@@ -233,15 +272,17 @@ CutCalculator::updateCrossTalk (const Cut &currentCut, unsigned currentCutIndex)
   // the flags for these collections now.
   if (singleObjects.size () > 1)
     {
-      for (auto singleObject = singleObjects.begin (); singleObject != singleObjects.end (); singleObject++)
+      for (unsigned iSingleObject = 0; iSingleObject < singleObjects.size (); iSingleObject++)
         {
-          if (pl_->cumulativeObjectFlags.at (currentCutIndex).count (*singleObject))
+          unsigned singleObject = currentCut.singleObjectIds.at (iSingleObject);
+          if (flags.has (currentCutIndex, singleObject))
             continue;
-          pl_->cumulativeObjectFlags.at (currentCutIndex)[*singleObject] = vector<pair<bool, bool> > (currentCut.valueLookupTree->getCollectionSize (*singleObject), make_pair (false, true));
-          for (auto flag = pl_->cumulativeObjectFlags.at (currentCutIndex).at (inputType).begin (); flag != pl_->cumulativeObjectFlags.at (currentCutIndex).at (inputType).end (); flag++)
+          flags.add (currentCutIndex, singleObject, currentCut.valueLookupTree->getCollectionSize (singleObjects.at (iSingleObject)), make_pair (false, true));
+          for (unsigned iFlag = 0; iFlag < flags.nObjects (currentCutIndex, inputType); iFlag++)
             {
-              unsigned localIndex = currentCut.valueLookupTree->getLocalIndex (flag - pl_->cumulativeObjectFlags.at (currentCutIndex).at (inputType).begin (), singleObject - singleObjects.begin ());
-              flag->second && (pl_->cumulativeObjectFlags.at (currentCutIndex).at (*singleObject).at (localIndex).first = pl_->cumulativeObjectFlags.at (currentCutIndex).at (*singleObject).at (localIndex).first || flag->first);
+              unsigned localIndex = currentCut.valueLookupTree->getLocalIndex (iFlag, iSingleObject);
+              if (flags.isValid (currentCutIndex, inputType, iFlag) && flags.passes (currentCutIndex, inputType, iFlag))
+                flags.setPasses (currentCutIndex, singleObject, localIndex, true);
             }
         }
     }
@@ -250,56 +291,59 @@ CutCalculator::updateCrossTalk (const Cut &currentCut, unsigned currentCutIndex)
   // but not any previous cuts.
   if (currentCutIndex > 0)
     {
-      for (const auto &collection : pl_->cumulativeObjectFlags.at (currentCutIndex))
+      for (unsigned collection = 0; collection < flags.nCollections (); collection++)
         {
-          if (pl_->cumulativeObjectFlags.at (currentCutIndex - 1).count (collection.first))
+          if (!flags.has (currentCutIndex, collection) || flags.has (currentCutIndex - 1, collection))
             continue;
-          singleObjects = anatools::getSingleObjects (inputType);
+          const string &collectionLabel = collectionLabels_.at (collection);
+          unsigned nObjects = flags.nObjects (currentCutIndex, collection);
           for (unsigned i = 0; i < currentCutIndex; i++)
             {
-              vector<pair<bool, bool> > cumulativeObjectFlags (collection.second.size (), make_pair (true, true));
-              for (const auto &singleObject : singleObjects)
+              vector<pair<bool, bool> > cumulativeObjectFlags (nObjects, make_pair (true, true));
+              for (unsigned iSingleObject = 0; iSingleObject < singleObjects.size (); iSingleObject++)
                 {
-                  if (!pl_->cumulativeObjectFlags.at (i).count (singleObject))
+                  unsigned singleObject = currentCut.singleObjectIds.at (iSingleObject);
+                  if (!flags.has (i, singleObject))
                     continue;
-                  for (auto flag = pl_->cumulativeObjectFlags.at (i).at (singleObject).begin (); flag != pl_->cumulativeObjectFlags.at (i).at (singleObject).end (); flag++)
+                  for (unsigned localIndex = 0; localIndex < flags.nObjects (i, singleObject); localIndex++)
                     {
-                      unsigned localIndex = flag - pl_->cumulativeObjectFlags.at (i).at (singleObject).begin ();
-                      set<unsigned> globalIndices = currentCut.valueLookupTree->getGlobalIndices (localIndex, singleObject, collection.first);
+                      set<unsigned> globalIndices = currentCut.valueLookupTree->getGlobalIndices (localIndex, singleObjects.at (iSingleObject), collectionLabel);
                       for (const auto &globalIndex : globalIndices)
                         {
-                          cumulativeObjectFlags.at (globalIndex).second = pl_->cumulativeObjectFlags.at (currentCutIndex).at (collection.first).at (globalIndex).second;
-                          cumulativeObjectFlags.at (globalIndex).second && (cumulativeObjectFlags.at (globalIndex).first = cumulativeObjectFlags.at (globalIndex).first && pl_->cumulativeObjectFlags.at (i).at (singleObject).at (localIndex).first);
+                          cumulativeObjectFlags.at (globalIndex).second = flags.isValid (currentCutIndex, collection, globalIndex);
+                          cumulativeObjectFlags.at (globalIndex).second && (cumulativeObjectFlags.at (globalIndex).first = cumulativeObjectFlags.at (globalIndex).first && flags.passes (i, singleObject, localIndex));
                         }
                     }
                 }
-              pl_->cumulativeObjectFlags.at (i)[collection.first] = cumulativeObjectFlags;
+              flags.add (i, collection, nObjects);
+              for (unsigned object = 0; object < nObjects; object++)
+                flags.set (i, collection, object, cumulativeObjectFlags.at (object));
             }
         }
     }
 }
 
 bool
-CutCalculator::unpackCuts ()
+CutCalculator::unpackCuts (const edm::ParameterSet &cutsPSet, CutCalculatorMetadata &metadata)
 {
   //////////////////////////////////////////////////////////////////////////////
   // If triggers are given, retrieve them.
   //////////////////////////////////////////////////////////////////////////////
-  if (cuts_.exists ("triggers"))
+  if (cutsPSet.exists ("triggers"))
     {
-      unpackedTriggers_ = cuts_.getParameter<vector<string> > ("triggers");
+      metadata.triggers = cutsPSet.getParameter<vector<string> > ("triggers");
       objectsToGet_.insert ("triggers");
     }
   else
     clog << "WARNING: no triggers have been specified." << endl;
-  if (cuts_.exists ("triggersToVeto"))
+  if (cutsPSet.exists ("triggersToVeto"))
     {
-      unpackedTriggersToVeto_ = cuts_.getParameter<vector<string> > ("triggersToVeto");
+      metadata.triggersToVeto = cutsPSet.getParameter<vector<string> > ("triggersToVeto");
       objectsToGet_.insert ("triggers");
     }
-  if (cuts_.exists ("triggerFilters"))
+  if (cutsPSet.exists ("triggerFilters"))
     {
-      unpackedTriggerFilters_ = cuts_.getParameter<vector<string> > ("triggerFilters");
+      metadata.triggerFilters = cutsPSet.getParameter<vector<string> > ("triggerFilters");
       objectsToGet_.insert ("triggers");
       objectsToGet_.insert ("trigobjs");
     }
@@ -307,7 +351,7 @@ CutCalculator::unpackCuts ()
 
   // Retrieve the cuts and clear the vector in which they will be stored after
   // parsing.
-  edm::VParameterSet cuts = cuts_.getParameter<edm::VParameterSet> ("cuts");
+  edm::VParameterSet cuts = cutsPSet.getParameter<edm::VParameterSet> ("cuts");
 
   // Loop over the cuts, parsing each one and storing it in a vector.
   for (unsigned currentCut = 0; currentCut != cuts.size (); currentCut++)
@@ -332,6 +376,8 @@ CutCalculator::unpackCuts ()
       // operator.
       //////////////////////////////////////////////////////////////////////////
       tempCut.cutString = cuts.at (currentCut).getParameter<string> ("cutString");
+      if (anatools::usesUserVariables (tempCut.cutString))
+        objectsToGet_.insert ("uservariables");
       //////////////////////////////////////////////////////////////////////////
 
       //////////////////////////////////////////////////////////////////////////
@@ -387,12 +433,50 @@ CutCalculator::unpackCuts ()
       // initialize the valueLookupTree pointers to be NULL.
       tempCut.valueLookupTree = NULL;
       tempCut.arbitrationTree = NULL;
-      unpackedCuts_.push_back (tempCut);
+      metadata.cuts.push_back (tempCut);
     }
 
   return true;
 }
 
+void
+CutCalculator::internCollections (const vector<Cuts *> &cutsToIntern)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Find every collection for which flags can be set, i.e., the input
+  // collection of each cut and the single collections of which it is composed.
+  //////////////////////////////////////////////////////////////////////////////
+  set<string> collections;
+  for (const auto &cuts : cutsToIntern)
+    {
+      for (auto &cut : *cuts)
+        {
+          cut.singleObjects = anatools::getSingleObjects (cut.inputLabel);
+          collections.insert (cut.inputLabel);
+          collections.insert (cut.singleObjects.begin (), cut.singleObjects.end ());
+        }
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Assign the IDs in alphabetical order, so that looping over the IDs visits
+  // the collections in the same order as looping over a map of their labels,
+  // and store them in the cuts.
+  //////////////////////////////////////////////////////////////////////////////
+  collectionLabels_.assign (collections.begin (), collections.end ());
+  for (const auto &cuts : cutsToIntern)
+    {
+      for (auto &cut : *cuts)
+        {
+          cut.inputLabelId = lower_bound (collectionLabels_.begin (), collectionLabels_.end (), cut.inputLabel) - collectionLabels_.begin ();
+          cut.singleObjectIds.clear ();
+          for (const auto &singleObject : cut.singleObjects)
+            cut.singleObjectIds.push_back (lower_bound (collectionLabels_.begin (), collectionLabels_.end (), singleObject) - collectionLabels_.begin ());
+        }
+    }
+  //////////////////////////////////////////////////////////////////////////////
+}
+
 bool
 CutCalculator::evaluateComparison (int testValue, const string &comparison, int cutValue) const
 {
@@ -435,15 +519,15 @@ CutCalculator::splitString (const string &inputString) const
 }
 
 bool
-CutCalculator::evaluateTriggers (const edm::Event &event) const
+CutCalculator::evaluateTriggers (const edm::Event &event)
 {
   //////////////////////////////////////////////////////////////////////////////
   // Initialize the flags for each trigger which is required and each trigger
   // which is to be vetoed, as well as the event-wide flags for each of these.
   //////////////////////////////////////////////////////////////////////////////
-  bool triggerDecision = !pl_->triggers.size (), vetoTriggerDecision = true;
-  pl_->triggerFlags.resize (pl_->triggers.size (), false);
-  pl_->vetoTriggerFlags.resize (pl_->triggersToVeto.size (), true);
+  bool triggerDecision = !pl_->metadata->triggers.size (), vetoTriggerDecision = true;
+  pl_->triggerFlags.resize (pl_->metadata->triggers.size (), false);
+  pl_->vetoTriggerFlags.resize (pl_->metadata->triggersToVeto.size (), true);
   //////////////////////////////////////////////////////////////////////////////
 
   if (handles_.triggers.isValid ())
@@ -453,23 +537,15 @@ CutCalculator::evaluateTriggers (const edm::Event &event) const
         {
           string name = trigger.name;
           bool pass = trigger.pass;
-#elif DATA_FORMAT == MINI_AOD || DATA_FORMAT == AOD || DATA_FORMAT == MINI_AOD_CUSTOM 
-      const edm::TriggerNames &triggerNames = event.triggerNames (*handles_.triggers);
-      for (unsigned i = 0; i < triggerNames.size (); i++)
-        {
-          string name = triggerNames.triggerName (i);
-          bool pass = handles_.triggers->accept (i);
-#else
-  #error "Data format is not valid."
-#endif
+
           //////////////////////////////////////////////////////////////////////////
           // If the current trigger matches one of the triggers to veto, record its
           // decision. If any of these triggers is true, set the event-wide flag to
           // false;
           //////////////////////////////////////////////////////////////////////////
-          for (unsigned triggerIndex = 0; triggerIndex != pl_->triggersToVeto.size (); triggerIndex++)
+          for (unsigned triggerIndex = 0; triggerIndex != pl_->metadata->triggersToVeto.size (); triggerIndex++)
             {
-              if (name.find (pl_->triggersToVeto.at (triggerIndex)) == 0)
+              if (name.find (pl_->metadata->triggersToVeto.at (triggerIndex)) == 0)
                 {
                   vetoTriggerDecision = vetoTriggerDecision && !pass;
                   pl_->vetoTriggerFlags.at (triggerIndex) = pass;
@@ -482,9 +558,9 @@ CutCalculator::evaluateTriggers (const edm::Event &event) const
           // decision. If any of these triggers is true, set the event-wide flag to
           // true.
           //////////////////////////////////////////////////////////////////////////
-          for (unsigned triggerIndex = 0; triggerIndex != pl_->triggers.size (); triggerIndex++)
+          for (unsigned triggerIndex = 0; triggerIndex != pl_->metadata->triggers.size (); triggerIndex++)
             {
-              if (name.find (pl_->triggers.at (triggerIndex)) == 0)
+              if (name.find (pl_->metadata->triggers.at (triggerIndex)) == 0)
                 {
                   triggerDecision = triggerDecision || pass;
                   pl_->triggerFlags.at (triggerIndex) = pass;
@@ -492,6 +568,36 @@ CutCalculator::evaluateTriggers (const edm::Event &event) const
             }
           //////////////////////////////////////////////////////////////////////////
         }
+#elif DATA_FORMAT == MINI_AOD || DATA_FORMAT == AOD || DATA_FORMAT == MINI_AOD_CUSTOM 
+      //////////////////////////////////////////////////////////////////////////
+      // The trigger paths matching each trigger are found once per menu, so
+      // only their decisions are looked at here. As when looping over all the
+      // paths, the flag of each trigger is the decision of the last path which
+      // matches it.
+      //////////////////////////////////////////////////////////////////////////
+      const TriggerIndices &indices = getTriggerIndices (event.triggerNames (*handles_.triggers));
+      for (unsigned triggerIndex = 0; triggerIndex != indices.triggersToVeto.size (); triggerIndex++)
+        {
+          for (const auto &i : indices.triggersToVeto.at (triggerIndex))
+            {
+              bool pass = handles_.triggers->accept (i);
+              vetoTriggerDecision = vetoTriggerDecision && !pass;
+              pl_->vetoTriggerFlags.at (triggerIndex) = pass;
+            }
+        }
+      for (unsigned triggerIndex = 0; triggerIndex != indices.triggers.size (); triggerIndex++)
+        {
+          for (const auto &i : indices.triggers.at (triggerIndex))
+            {
+              bool pass = handles_.triggers->accept (i);
+              triggerDecision = triggerDecision || pass;
+              pl_->triggerFlags.at (triggerIndex) = pass;
+            }
+        }
+      //////////////////////////////////////////////////////////////////////////
+#else
+  #error "Data format is not valid."
+#endif
     }
 
   // Store the logical AND of the two event-wide flags as the event-wide
@@ -500,29 +606,47 @@ CutCalculator::evaluateTriggers (const edm::Event &event) const
 }
 
 bool
-CutCalculator::evaluateTriggerFilters (const edm::Event &event) const
+CutCalculator::evaluateTriggerFilters (const edm::Event &event)
 {
-  bool triggerFilterDecision = !pl_->triggerFilters.size ();
-  pl_->triggerFilterFlags.resize (pl_->triggerFilters.size (), false);
+  bool triggerFilterDecision = !pl_->metadata->triggerFilters.size ();
+  pl_->triggerFilterFlags.resize (pl_->metadata->triggerFilters.size (), false);
 
-  if (handles_.triggers.isValid () && handles_.trigobjs.isValid ())
+  if (pl_->metadata->triggerFilters.size () && handles_.triggers.isValid () && handles_.trigobjs.isValid ())
     {
+#if DATA_FORMAT == MINI_AOD || DATA_FORMAT == MINI_AOD_CUSTOM  
       const edm::TriggerNames &triggerNames = event.triggerNames (*handles_.triggers);
-      for (unsigned i = 0; i < pl_->triggerFilters.size (); i++)
+      const TriggerIndices &indices = getTriggerIndices (triggerNames);
+
+      //////////////////////////////////////////////////////////////////////////
+      // The trigger objects are unpacked once per event, however many filters
+      // and channels there are, recording which of the filters in
+      // triggerFilterIds_ any of them passed. This is redone if a channel
+      // seen for the first time has added filters.
+      //////////////////////////////////////////////////////////////////////////
+      if (!(firedTriggerFiltersEvent_ == event.id ())
+       || firedTriggerFiltersProduct_ != handles_.trigobjs.product ()
+       || firedTriggerFilters_.size () != triggerFilterIds_.size ())
         {
-#if DATA_FORMAT == MINI_AOD || DATA_FORMAT == MINI_AOD_CUSTOM  
+          firedTriggerFilters_.assign (triggerFilterIds_.size (), false);
           for (auto trigobj : *handles_.trigobjs)
             {
               trigobj.unpackPathNames (triggerNames);
               for (const auto &filter : trigobj.filterLabels ())
                 {
-                  pl_->triggerFilterFlags.at (i) = (pl_->triggerFilters.at (i) == filter);
-                  if (pl_->triggerFilterFlags.at (i))
-                    break;
+                  auto id = triggerFilterIds_.find (filter);
+                  if (id != triggerFilterIds_.end ())
+                    firedTriggerFilters_.at (id->second) = true;
                 }
-              if (pl_->triggerFilterFlags.at (i))
-                break;
             }
+          firedTriggerFiltersEvent_ = event.id ();
+          firedTriggerFiltersProduct_ = handles_.trigobjs.product ();
+        }
+      //////////////////////////////////////////////////////////////////////////
+#endif
+      for (unsigned i = 0; i < pl_->metadata->triggerFilters.size (); i++)
+        {
+#if DATA_FORMAT == MINI_AOD || DATA_FORMAT == MINI_AOD_CUSTOM  
+          pl_->triggerFilterFlags.at (i) = firedTriggerFilters_.at (indices.triggerFilters.at (i));
 #endif
           triggerFilterDecision = triggerFilterDecision || pl_->triggerFilterFlags.at (i);
         }
@@ -531,82 +655,143 @@ CutCalculator::evaluateTriggerFilters (const edm::Event &event) const
   return (pl_->triggerFilterDecision = triggerFilterDecision);
 }
 
-bool
-CutCalculator::setEventFlags () const
+CutCalculator::TriggerIndices &
+CutCalculator::getTriggerIndices (const edm::TriggerNames &triggerNames)
 {
-  pl_->cutsDecision = true;
+  const CutCalculatorMetadata &metadata = *pl_->metadata;
+  TriggerIndices &indices = triggerIndices_[&metadata];
 
-  // Loop over the cuts, storing the event-wide decision for each in the
-  // payload.
-  for (unsigned currentCutIndex = 0; currentCutIndex != pl_->cuts.size (); currentCutIndex++)
+  //////////////////////////////////////////////////////////////////////////////
+  // The trigger filters do not depend on the menu, so they are only given IDs
+  // the first time the metadata is seen.
+  //////////////////////////////////////////////////////////////////////////////
+  if (!indices.isBuilt)
     {
-      Cut currentCut = pl_->cuts.at (currentCutIndex);
-      int numberPassing = 0;
-      int numberPassingPrev = 0;
-      int numberPassingIndividual = 0;
-
-      //////////////////////////////////////////////////////////////////////////
-      // Count the number of objects passing the current cut and all previous
-      // cuts in the collection on which the cut acts.
-      //////////////////////////////////////////////////////////////////////////
-      for (const auto &flag : pl_->cumulativeObjectFlags.at (currentCutIndex).at (currentCut.inputLabel))
-        {
-          if (flag.second && flag.first)
-            numberPassing++;
-        }
-      //////////////////////////////////////////////////////////////////////////
-
-      //////////////////////////////////////////////////////////////////////////
-      // Count the number of objects passing the current cut independently.
-      //////////////////////////////////////////////////////////////////////////
-      for (const auto &flag : pl_->individualObjectFlags.at (currentCutIndex).at (currentCut.inputLabel))
+      for (const auto &filter : metadata.triggerFilters)
         {
-          if (flag.second && flag.first)
-            numberPassingIndividual++;
+          auto id = triggerFilterIds_.insert (make_pair (filter, (unsigned) triggerFilterIds_.size ())).first;
+          indices.triggerFilters.push_back (id->second);
         }
-      //////////////////////////////////////////////////////////////////////////
+    }
+  //////////////////////////////////////////////////////////////////////////////
 
-      //////////////////////////////////////////////////////////////////////////
-      // Decide if the event passes this cut. If the cut is a veto, we have to
-      // test the number of objects which failed this cut but which passed all
-      // previous cuts. Remember, the object flags are inverted in the case of a
-      // veto.
-      //////////////////////////////////////////////////////////////////////////
-      bool cutDecision;
-      bool cutDecisionIndividual;
-      if (!currentCut.isVeto)
-	{
-        cutDecision = evaluateComparison (numberPassing, currentCut.eventComparativeOperator, currentCut.numberRequired);
-        cutDecisionIndividual = evaluateComparison (numberPassingIndividual, currentCut.eventComparativeOperator, currentCut.numberRequired);
-	}
-      else
+  //////////////////////////////////////////////////////////////////////////////
+  // Match the prefix of each trigger and each trigger to veto against the
+  // names of all the paths, which only change with the menu.
+  //////////////////////////////////////////////////////////////////////////////
+  if (!indices.isBuilt || !(indices.menu == triggerNames.parameterSetID ()))
+    {
+      indices.triggers.assign (metadata.triggers.size (), vector<unsigned> ());
+      indices.triggersToVeto.assign (metadata.triggersToVeto.size (), vector<unsigned> ());
+      for (unsigned i = 0; i < triggerNames.size (); i++)
         {
-          if (currentCutIndex > 0)
+          const string &name = triggerNames.triggerName (i);
+          for (unsigned triggerIndex = 0; triggerIndex != metadata.triggersToVeto.size (); triggerIndex++)
             {
-              for (const auto &flag : pl_->cumulativeObjectFlags.at (currentCutIndex - 1).at (currentCut.inputLabel))
-                (flag.second && flag.first) && numberPassingPrev++;
+              if (name.find (metadata.triggersToVeto.at (triggerIndex)) == 0)
+                indices.triggersToVeto.at (triggerIndex).push_back (i);
+            }
+          for (unsigned triggerIndex = 0; triggerIndex != metadata.triggers.size (); triggerIndex++)
+            {
+              if (name.find (metadata.triggers.at (triggerIndex)) == 0)
+                indices.triggers.at (triggerIndex).push_back (i);
             }
-          int numberFailCut = numberPassingPrev - numberPassing;
-          cutDecision = evaluateComparison (numberFailCut, currentCut.eventComparativeOperator, currentCut.numberRequired);
-	  cutDecisionIndividual = evaluateComparison (numberPassingIndividual, currentCut.eventComparativeOperator, currentCut.numberRequired);
         }
-      //////////////////////////////////////////////////////////////////////////
+      indices.menu = triggerNames.parameterSetID ();
+      indices.isBuilt = true;
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  return indices;
+}
+
+bool
+CutCalculator::setEventFlags () const
+{
+  // Loop over the cuts, storing the event-wide decision for each in the
+  // payload. Cuts which were not evaluated because of an early exit fail.
+  const Cuts &cuts = pl_->metadata->cuts;
+  for (unsigned currentCutIndex = 0; currentCutIndex != cuts.size (); currentCutIndex++)
+    {
+      pair<bool, bool> cutDecisions (false, false);
+      if (currentCutIndex < pl_->cumulativeObjectFlags.size ())
+        cutDecisions = getCutDecisions (cuts.at (currentCutIndex), currentCutIndex);
 
       //////////////////////////////////////////////////////////////////////////
       // Store the decision for this cut in the payload and update the global
       // cut decision flag.
       //////////////////////////////////////////////////////////////////////////
-      pl_->cumulativeEventFlags.push_back (cutDecision);
-      pl_->cutsDecision = pl_->cutsDecision && cutDecision;
-      pl_->individualEventFlags.push_back (cutDecisionIndividual);
+      pl_->cumulativeEventFlags.push_back (cutDecisions.first);
+      pl_->individualEventFlags.push_back (cutDecisions.second);
       //////////////////////////////////////////////////////////////////////////
     }
+  pl_->cutsDecision = (find (pl_->cumulativeEventFlags.begin (), pl_->cumulativeEventFlags.end (), false) == pl_->cumulativeEventFlags.end ());
 
   // Store the logical AND of the trigger decision and the global cut decision
   // as the global event decision in the payload and return it.
   return (pl_->eventDecision = (pl_->triggerDecision && pl_->triggerFilterDecision && pl_->cutsDecision));
 }
 
+pair<bool, bool>
+CutCalculator::getCutDecisions (const Cut &currentCut, unsigned currentCutIndex) const
+{
+  const ObjectFlags &cumulativeObjectFlags = pl_->cumulativeObjectFlags,
+                    &individualObjectFlags = pl_->individualObjectFlags;
+  unsigned inputType = currentCut.inputLabelId;
+  int numberPassing = 0;
+  int numberPassingPrev = 0;
+  int numberPassingIndividual = 0;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Count the number of objects passing the current cut and all previous cuts
+  // in the collection on which the cut acts.
+  //////////////////////////////////////////////////////////////////////////////
+  for (unsigned object = 0; object < cumulativeObjectFlags.nObjects (currentCutIndex, inputType); object++)
+    {
+      if (cumulativeObjectFlags.isValid (currentCutIndex, inputType, object) && cumulativeObjectFlags.passes (currentCutIndex, inputType, object))
+        numberPassing++;
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Count the number of objects passing the current cut independently.
+  //////////////////////////////////////////////////////////////////////////////
+  for (unsigned object = 0; object < individualObjectFlags.nObjects (currentCutIndex, inputType); object++)
+    {
+      if (individualObjectFlags.isValid (currentCutIndex, inputType, object) && individualObjectFlags.passes (currentCutIndex, inputType, object))
+        numberPassingIndividual++;
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Decide if the event passes this cut. If the cut is a veto, we have to test
+  // the number of objects which failed this cut but which passed all previous
+  // cuts. Remember, the object flags are inverted in the case of a veto. The
+  // cumulative decision is returned first, followed by the individual one.
+  //////////////////////////////////////////////////////////////////////////////
+  bool cutDecision;
+  bool cutDecisionIndividual;
+  if (!currentCut.isVeto)
+    {
+      cutDecision = evaluateComparison (numberPassing, currentCut.eventComparativeOperator, currentCut.numberRequired);
+      cutDecisionIndividual = evaluateComparison (numberPassingIndividual, currentCut.eventComparativeOperator, currentCut.numberRequired);
+    }
+  else
+    {
+      if (currentCutIndex > 0)
+        {
+          for (unsigned object = 0; object < cumulativeObjectFlags.nObjects (currentCutIndex - 1, inputType); object++)
+            (cumulativeObjectFlags.isValid (currentCutIndex - 1, inputType, object) && cumulativeObjectFlags.passes (currentCutIndex - 1, inputType, object)) && numberPassingPrev++;
+        }
+      int numberFailCut = numberPassingPrev - numberPassing;
+      cutDecision = evaluateComparison (numberFailCut, currentCut.eventComparativeOperator, currentCut.numberRequired);
+      cutDecisionIndividual = evaluateComparison (numberPassingIndividual, currentCut.eventComparativeOperator, currentCut.numberRequired);
+    }
+
+  return make_pair (cutDecision, cutDecisionIndividual);
+  //////////////////////////////////////////////////////////////////////////////
+}
+
 bool
 CutCalculator::initializeValueLookupForest (Cuts &cuts, Collections * const handles)
 {
@@ -619,8 +804,14 @@ CutCalculator::initializeValueLookupForest (Cuts &cuts, Collections * const hand
       if (firstEvent_)
         {
           cut.valueLookupTree = new ValueLookupTree (cut);
+          cut.valueLookupTree->setUseTreeWalker (useTreeWalker_);
+          cut.valueLookupTree->setInstrumentationLabel (moduleDescription ().moduleLabel (), "cut", cut.name);
           if (cut.arbitration != "")
-            cut.arbitrationTree = new ValueLookupTree (cut.arbitration != "random" ? cut.arbitration : "0.0", cut.inputCollections);
+            {
+              cut.arbitrationTree = new ValueLookupTree (cut.arbitration != "random" ? cut.arbitration : "0.0", cut.inputCollections);
+              cut.arbitrationTree->setUseTreeWalker (useTreeWalker_);
+              cut.arbitrationTree->setInstrumentationLabel (moduleDescription ().moduleLabel (), "arbitration", cut.name);
+            }
           if (!cut.valueLookupTree->isValid ())
             return false;
         }
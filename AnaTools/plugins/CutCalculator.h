@@ -1,18 +1,32 @@
 #ifndef CUT_CALCULATOR
 #define CUT_CALCULATOR
 
+#include <unordered_map>
 #include <unordered_set>
 
-#include "FWCore/Framework/interface/EDProducer.h"
+#include "DataFormats/Provenance/interface/EventID.h"
+#include "DataFormats/Provenance/interface/ParameterSetID.h"
+#include "FWCore/Common/interface/TriggerNames.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
 #include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 
 // Declaration of the CutCalculator EDProducer which produces various flags
 // indicating whether the event and each object passed the user-defined cuts.
-class CutCalculator : public edm::EDProducer
+//
+// If the untracked parameter earlyExit is true, no further cuts are evaluated
+// once the event is known to fail, either because of the triggers or because
+// of a cut. The remaining cuts are then given event flags of false and no
+// object flags, which is enough for the cumulative cut flow and for the
+// object selectors, but not for the noncumulative flags printed by the
+// InfoPrinter or for N-1 studies, so the default is to evaluate every cut.
+//
+// This is a stream module, so there is one instance, with its own
+// ValueLookupTree objects and handles, for each stream.
+class CutCalculator : public edm::stream::EDProducer<>
 {
   public:
     CutCalculator (const edm::ParameterSet &);
@@ -20,46 +34,90 @@ class CutCalculator : public edm::EDProducer
 
     void produce (edm::Event &, const edm::EventSetup &);
 
-  private:
+  protected:
+    // Constructor for derived classes, which is given the cuts ParameterSet
+    // explicitly and neither unpacks it nor declares any products.
+    CutCalculator (const edm::ParameterSet &, const edm::ParameterSet &);
+
     ////////////////////////////////////////////////////////////////////////////
-    // Private methods used in calculating the cut decisions.
+    // Methods used in calculating the cut decisions, which act on the payload
+    // pointed to by pl_.
     ////////////////////////////////////////////////////////////////////////////
     bool setObjectFlags (const Cut &, unsigned) const;
     void updateCrossTalk (const Cut &, unsigned) const;
-    bool unpackCuts ();
+    bool unpackCuts (const edm::ParameterSet &, CutCalculatorMetadata &);
+    void internCollections (const vector<Cuts *> &);
     void getTwoObjs (string, string &, string &);
     bool evaluateComparison (int, const string &, int) const;
     string getObjToGet (string);
     vector<string> splitString (const string &) const;
-    bool evaluateTriggers (const edm::Event &) const;
-    bool evaluateTriggerFilters (const edm::Event &) const;
+    bool evaluateTriggers (const edm::Event &);
+    bool evaluateTriggerFilters (const edm::Event &);
     bool setEventFlags () const;
+    pair<bool, bool> getCutDecisions (const Cut &, unsigned) const;
     ////////////////////////////////////////////////////////////////////////////
 
     ////////////////////////////////////////////////////////////////////////////
-    // Private variables initialized by the constructor.
+    // Variables initialized by the constructor.
     ////////////////////////////////////////////////////////////////////////////
     edm::ParameterSet  collections_;
     edm::ParameterSet  cuts_;
+    bool               useTreeWalker_;
+    bool               earlyExit_;
     bool               firstEvent_;
     ////////////////////////////////////////////////////////////////////////////
 
     ////////////////////////////////////////////////////////////////////////////
-    // Private variables set after unpacking the cuts ParameterSet.
+    // Variables set after unpacking the cuts ParameterSet.
     ////////////////////////////////////////////////////////////////////////////
     unordered_set<string>  objectsToGet_;
-    Cuts                   unpackedCuts_;
-    vector<string>         unpackedTriggersToVeto_;
-    vector<string>         unpackedTriggers_;
-    vector<string>         unpackedTriggerFilters_;
+    CutCalculatorMetadata  metadata_;
     ////////////////////////////////////////////////////////////////////////////
 
-    // Object collections which can be gotten from the event.
-    Collections handles_;
+    // Labels of the collections used by the cuts, indexed by the IDs used in
+    // the ObjectFlags.
+    vector<string>  collectionLabels_;
+
+    // Object collections which can be gotten from the event, and the tokens
+    // for getting them.
+    Collections       handles_;
+    CollectionTokens  tokens_;
 
     // Payload for this EDProducer.
     auto_ptr<CutCalculatorPayload>  pl_;
 
+    ////////////////////////////////////////////////////////////////////////////
+    // For the triggers in some metadata, the indices of the trigger paths in
+    // the menu with the given ID which match each trigger and each trigger to
+    // veto, and the ID of each trigger filter in triggerFilterIds_. These are
+    // kept for the metadata of each channel, and are only updated when the
+    // menu changes.
+    ////////////////////////////////////////////////////////////////////////////
+    struct TriggerIndices
+    {
+      bool                       isBuilt = false;
+      edm::ParameterSetID        menu;
+      vector<vector<unsigned> >  triggers;
+      vector<vector<unsigned> >  triggersToVeto;
+      vector<unsigned>           triggerFilters;
+    };
+
+    unordered_map<const CutCalculatorMetadata *, TriggerIndices>  triggerIndices_;
+
+    TriggerIndices &getTriggerIndices (const edm::TriggerNames &);
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // The ID of each trigger filter used by any of the channels, and whether
+    // it was passed by any trigger object in the event given by the last two
+    // variables, so that the trigger objects are only unpacked once per event.
+    ////////////////////////////////////////////////////////////////////////////
+    unordered_map<string, unsigned>  triggerFilterIds_;
+    vector<bool>                     firedTriggerFilters_;
+    edm::EventID                     firedTriggerFiltersEvent_;
+    const void                       *firedTriggerFiltersProduct_ = NULL;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Function for initializing the ValueLookupTree objects, one for each cut.
     bool initializeValueLookupForest (Cuts &, Collections * const);
 };
@@ -83,11 +83,18 @@ CutFlowPlotter::analyze (const edm::Event &event, const edm::EventSetup &setup)
 {
   //////////////////////////////////////////////////////////////////////////////
   // Try to retrieve the cut decisions from the event and print a warning if
-  // there is a problem.
+  // there is a problem. The metadata, which gives the cuts, is transient, so
+  // cut decisions without it are skipped, as if they were missing.
   //////////////////////////////////////////////////////////////////////////////
   event.getByLabel (cutDecisions_, cutDecisions);
   if (collections_.exists ("generatorweights"))
     event.getByLabel (collections_.getParameter<edm::InputTag> ("generatorweights"), generatorweights);
+  if (cutDecisions.isValid () && !cutDecisions->metadata)
+    {
+      if (firstEvent_)
+        clog << "ERROR: the cut decisions have no metadata, as is the case when they are read from a file, so they are skipped." << endl;
+      cutDecisions.clear ();
+    }
   if (firstEvent_ && !cutDecisions.isValid ())
     clog << "WARNING: failed to retrieve cut decisions from the event." << endl;
   if (firstEvent_ && !generatorweights.isValid ())
@@ -126,9 +133,9 @@ CutFlowPlotter::initializeCutFlow ()
   // If triggers have been specified, add a special bin for the trigger
   // decision.
   //////////////////////////////////////////////////////////////////////////////
-  unsigned nCuts = cutDecisions->cuts.size ();
-  cutDecisions->triggers.size () && nCuts++;
-  cutDecisions->triggerFilters.size () && nCuts++;
+  unsigned nCuts = cutDecisions->metadata->cuts.size ();
+  cutDecisions->metadata->triggers.size () && nCuts++;
+  cutDecisions->metadata->triggerFilters.size () && nCuts++;
   oneDHists_.at ("cutFlow")->SetBins    (nCuts + 1,  0.0,  nCuts + 1);
   oneDHists_.at ("selection")->SetBins  (nCuts + 1,  0.0,  nCuts + 1);
   //  oneDHists_.at ("minusOne")->SetBins   (nCuts + 1,  0.0,  nCuts + 1);
@@ -138,21 +145,21 @@ CutFlowPlotter::initializeCutFlow ()
   // Set the bin labels for the rest of the bins according to the name of the
   // cut. The special bin for the trigger decision is simply labeled "trigger".
   //////////////////////////////////////////////////////////////////////////////
-  if (cutDecisions->triggers.size ())
+  if (cutDecisions->metadata->triggers.size ())
     {
       oneDHists_.at ("cutFlow")->GetXaxis    ()->SetBinLabel  (bin,  "trigger");
       oneDHists_.at ("selection")->GetXaxis  ()->SetBinLabel  (bin,  "trigger");
       //      oneDHists_.at ("minusOne")->GetXaxis   ()->SetBinLabel  (bin,  "trigger");
       bin++;
     }
-  if (cutDecisions->triggerFilters.size ())
+  if (cutDecisions->metadata->triggerFilters.size ())
     {
       oneDHists_.at ("cutFlow")->GetXaxis    ()->SetBinLabel  (bin,  "trigger filter");
       oneDHists_.at ("selection")->GetXaxis  ()->SetBinLabel  (bin,  "trigger filter");
       //      oneDHists_.at ("minusOne")->GetXaxis   ()->SetBinLabel  (bin,  "trigger filter");
       bin++;
     }
-  for (vector<Cut>::const_iterator cut = cutDecisions->cuts.begin (); cut != cutDecisions->cuts.end (); cut++, bin++)
+  for (vector<Cut>::const_iterator cut = cutDecisions->metadata->cuts.begin (); cut != cutDecisions->metadata->cuts.end (); cut++, bin++)
     {
       oneDHists_.at ("cutFlow")->GetXaxis    ()->SetBinLabel  (bin,  cut->name.c_str  ());
       oneDHists_.at ("selection")->GetXaxis  ()->SetBinLabel  (bin,  cut->name.c_str  ());
@@ -186,7 +193,7 @@ CutFlowPlotter::fillCutFlow (double w)
   // Fill the rest of the bins according to the flags in the cut decisions
   // object.
   //////////////////////////////////////////////////////////////////////////////
-  if (cutDecisions->triggers.size ())
+  if (cutDecisions->metadata->triggers.size ())
     {
       passes = passes && cutDecisions->triggerDecision;
       if (cutDecisions->triggerDecision)
@@ -195,7 +202,7 @@ CutFlowPlotter::fillCutFlow (double w)
         oneDHists_.at ("cutFlow")->Fill    (bin,  w);
       bin++;
     }
-  if (cutDecisions->triggerFilters.size ())
+  if (cutDecisions->metadata->triggerFilters.size ())
     {
       passes = passes && cutDecisions->triggerFilterDecision;
       if (cutDecisions->triggerFilterDecision)
@@ -1,7 +1,9 @@
+#include <cmath>
 #include <iomanip>
 #include <iostream>
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 #include "OSUT3Analysis/AnaTools/interface/ValueLookupTree.h"
 #include "OSUT3Analysis/AnaTools/plugins/InfoPrinter.h"
 
@@ -24,6 +26,10 @@ InfoPrinter::InfoPrinter (const edm::ParameterSet &cfg) :
   printVetoTriggerFlags_       (cfg.getParameter<bool>                   ("printVetoTriggerFlags")),
   printAllTriggers_            (cfg.getParameter<bool>                   ("printAllTriggers")),
   valuesToPrint_               (cfg.getParameter<edm::VParameterSet>     ("valuesToPrint")),
+  useTreeWalker_               (cfg.getUntrackedParameter<bool>          ("useTreeWalker", false)),
+  outputFile_                  (cfg.getUntrackedParameter<string>        ("outputFile", "")),
+  printJson_                   (cfg.getUntrackedParameter<string>        ("outputFormat", "text") == "json"),
+  outputBufferSize_            (cfg.getUntrackedParameter<unsigned>      ("outputBufferSize", 1000)),
   firstEvent_ (true),
   counter_ (0),
   sw_ (new TStopwatch)
@@ -33,7 +39,13 @@ InfoPrinter::InfoPrinter (const edm::ParameterSet &cfg) :
   // Start the timer.
   sw_->Start ();
 
+  if (cfg.getUntrackedParameter<string> ("instrumentationFile", "") != "")
+    Instrumentation::enable (cfg.getUntrackedParameter<string> ("instrumentationFile"));
+
   unpackValuesToPrint ();
+  anatools::getCollectionTokens (objectsToGet_, collections_, tokens_, consumesCollector ());
+
+  sink_ = new OutputSink (outputFile_, outputBufferSize_);
 }
 
 InfoPrinter::~InfoPrinter ()
@@ -44,9 +56,18 @@ InfoPrinter::~InfoPrinter ()
   //////////////////////////////////////////////////////////////////////////////
   sw_->Stop ();
   outputTime ();
-  clog << ss_.str ();
+  if (printJson_)
+    clog << ss_.str ();
+  else
+    {
+      string record = ss_.str ();
+      sink_->write (record);
+    }
   //////////////////////////////////////////////////////////////////////////////
 
+  // Wait for everything to be written before the sink is destroyed.
+  delete sink_;
+
   for (auto &value : valuesToPrint)
     delete value.valueLookupTree;
   delete sw_;
@@ -58,7 +79,7 @@ InfoPrinter::analyze (const edm::Event &event, const edm::EventSetup &setup)
   counter_++;
 
 
-  anatools::getRequiredCollections (objectsToGet_, collections_, handles_, event);
+  anatools::getRequiredCollections (tokens_, handles_, event);
 
   //////////////////////////////////////////////////////////////////////////////
   // Get the cut decisions out of the event.
@@ -66,6 +87,8 @@ InfoPrinter::analyze (const edm::Event &event, const edm::EventSetup &setup)
   event.getByLabel (cutDecisions_, cutDecisions);
   if (firstEvent_ && !cutDecisions.isValid ())
     clog << "WARNING: failed to retrieve cut decisions from the event." << endl;
+  if (firstEvent_ && cutDecisions.isValid () && !cutDecisions->metadata)
+    clog << "ERROR: the cut decisions have no metadata, as is the case when they are read from a file, so the flags will not be printed." << endl;
   //////////////////////////////////////////////////////////////////////////////
 
   //////////////////////////////////////////////////////////////////////////////
@@ -82,8 +105,8 @@ InfoPrinter::analyze (const edm::Event &event, const edm::EventSetup &setup)
 
   //////////////////////////////////////////////////////////////////////////////
   // For each type of information requested by the user, and for each event
-  // requested, print that information to the stringstream which is printed in
-  // the destructor.
+  // requested, print that information to the stringstream, which is then
+  // handed to the sink to be written in the background.
   //////////////////////////////////////////////////////////////////////////////
   maxCutWidth_ = maxTriggerWidth_ = maxVetoTriggerWidth_ = maxValueWidth_ = maxAllTriggerWidth_ = 0;
 
@@ -94,7 +117,9 @@ InfoPrinter::analyze (const edm::Event &event, const edm::EventSetup &setup)
 	printEvent = true;
     }
   
-  if (printEvent)
+  if (printEvent && printJson_)
+    printJson (event);
+  else if (printEvent)
     {
       ss_ << endl << "================================================================================" << endl;
       ss_ << "\033[1;36minfo for " << event.id () << " (record " << counter_ << ")\033[0m" << endl;
@@ -111,6 +136,12 @@ InfoPrinter::analyze (const edm::Event &event, const edm::EventSetup &setup)
       printAllTriggers_            &&  printAllTriggers            (event);
       ss_ << "================================================================================" << endl;
     }
+  if (printEvent)
+    {
+      string record = ss_.str ();
+      sink_->write (record);
+      ss_.str ("");
+    }
   //////////////////////////////////////////////////////////////////////////////
 
   firstEvent_ = false;
@@ -169,17 +200,17 @@ InfoPrinter::printTriggerDecision ()
 bool
 InfoPrinter::printCumulativeEventFlags ()
 {
-  if (!cutDecisions.isValid ())
+  if (!cutDecisions.isValid () || !cutDecisions->metadata)
     return false;
 
   ss_ << endl;
-  !maxCutWidth_ && (maxCutWidth_ = getMaxWidth (cutDecisions->cuts));
+  !maxCutWidth_ && (maxCutWidth_ = getMaxWidth (cutDecisions->metadata->cuts));
   ss_ << "--------------------------------------------------------------------------------" << endl;
   ss_ << "\033[1;35mcumulative event flags" << "\033[0m" << endl;
   ss_ << "--------------------------------------------------------------------------------" << endl;
   for (auto flag = cutDecisions->cumulativeEventFlags.begin (); flag != cutDecisions->cumulativeEventFlags.end (); flag++)
     {
-      ss_ << "\033[1;34m" << setw (maxCutWidth_) << left << cutDecisions->cuts.at (flag - cutDecisions->cumulativeEventFlags.begin ()).name << "\033[0m";
+      ss_ << "\033[1;34m" << setw (maxCutWidth_) << left << cutDecisions->metadata->cuts.at (flag - cutDecisions->cumulativeEventFlags.begin ()).name << "\033[0m";
       if (*flag)
         ss_ << "\033[1;32mtrue\033[0m" << endl;
       else
@@ -191,17 +222,17 @@ InfoPrinter::printCumulativeEventFlags ()
 bool
 InfoPrinter::printIndividualEventFlags ()
 {
-  if (!cutDecisions.isValid ())
+  if (!cutDecisions.isValid () || !cutDecisions->metadata)
     return false;
 
   ss_ << endl;
-  !maxCutWidth_ && (maxCutWidth_ = getMaxWidth (cutDecisions->cuts));
+  !maxCutWidth_ && (maxCutWidth_ = getMaxWidth (cutDecisions->metadata->cuts));
   ss_ << "--------------------------------------------------------------------------------" << endl;
   ss_ << "\033[1;35mindividual event flags" << "\033[0m" << endl;
   ss_ << "--------------------------------------------------------------------------------" << endl;
   for (auto flag = cutDecisions->individualEventFlags.begin (); flag != cutDecisions->individualEventFlags.end (); flag++)
     {
-      ss_ << "\033[1;34m" << setw (maxCutWidth_) << left << cutDecisions->cuts.at (flag - cutDecisions->individualEventFlags.begin ()).name << "\033[0m";
+      ss_ << "\033[1;34m" << setw (maxCutWidth_) << left << cutDecisions->metadata->cuts.at (flag - cutDecisions->individualEventFlags.begin ()).name << "\033[0m";
       if (*flag)
         ss_ << "\033[1;32mtrue\033[0m" << endl;
       else
@@ -213,34 +244,39 @@ InfoPrinter::printIndividualEventFlags ()
 bool
 InfoPrinter::printCumulativeObjectFlags ()
 {
-  if (!cutDecisions.isValid ())
+  if (!cutDecisions.isValid () || !cutDecisions->metadata)
     return false;
 
   ss_ << endl;
   if (!cutDecisions->cumulativeObjectFlags.size ())
     return true;
-  vector<string> collections;
-  for (const auto &collection : cutDecisions->cumulativeObjectFlags.at (0))
-    collections.push_back (collection.first);
-  sort (collections.begin (), collections.end ());
-  !maxCutWidth_ && (maxCutWidth_ = getMaxWidth (cutDecisions->cuts));
+  const ObjectFlags &flags = cutDecisions->cumulativeObjectFlags;
+  const CutCalculatorMetadata &metadata = *cutDecisions->metadata;
+  vector<unsigned> collections;
+  for (unsigned collection = 0; collection < flags.nCollections (); collection++)
+    {
+      if (flags.has (0, collection))
+        collections.push_back (collection);
+    }
+  !maxCutWidth_ && (maxCutWidth_ = getMaxWidth (metadata.cuts));
   for (auto collection = collections.begin (); collection != collections.end (); collection++)
     {
       if (collection != collections.begin ())
         ss_ << endl;
       ss_ << "--------------------------------------------------------------------------------" << endl;
-      ss_ << "\033[1;35mcumulative object flags for " << *collection << "\033[0m" << endl;
+      ss_ << "\033[1;35mcumulative object flags for " << metadata.collections.at (*collection) << "\033[0m" << endl;
       ss_ << "--------------------------------------------------------------------------------" << endl;
-      for (auto cut = cutDecisions->cumulativeObjectFlags.begin (); cut != cutDecisions->cumulativeObjectFlags.end (); cut++)
+      for (unsigned cut = 0; cut < flags.size (); cut++)
         {
-          ss_ << "\033[1;34m" << setw (maxCutWidth_) << left << cutDecisions->cuts.at (cut - cutDecisions->cumulativeObjectFlags.begin ()).name << "\033[0m";
-          for (auto flag = cut->at (*collection).begin (); flag != cut->at (*collection).end (); flag++)
+          ss_ << "\033[1;34m" << setw (maxCutWidth_) << left << metadata.cuts.at (cut).name << "\033[0m";
+          for (unsigned object = 0; object < flags.nObjects (cut, *collection); object++)
             {
-              if (flag != cut->at (*collection).begin ())
+              pair<bool, bool> flag = flags.get (cut, *collection, object);
+              if (object)
                 ss_ << ", ";
-              if (flag->second)
+              if (flag.second)
                 {
-                  if (flag->first)
+                  if (flag.first)
                     ss_ << "\033[1;32m1\033[0m";
                   else
                     ss_ << "\033[1;31m0\033[0m";
@@ -259,34 +295,39 @@ InfoPrinter::printCumulativeObjectFlags ()
 bool
 InfoPrinter::printIndividualObjectFlags ()
 {
-  if (!cutDecisions.isValid ())
+  if (!cutDecisions.isValid () || !cutDecisions->metadata)
     return false;
 
   ss_ << endl;
   if (!cutDecisions->individualObjectFlags.size ())
     return true;
-  vector<string> collections;
-  for (const auto &collection : cutDecisions->individualObjectFlags.at (0))
-    collections.push_back (collection.first);
-  sort (collections.begin (), collections.end ());
-  !maxCutWidth_ && (maxCutWidth_ = getMaxWidth (cutDecisions->cuts));
+  const ObjectFlags &flags = cutDecisions->individualObjectFlags;
+  const CutCalculatorMetadata &metadata = *cutDecisions->metadata;
+  vector<unsigned> collections;
+  for (unsigned collection = 0; collection < flags.nCollections (); collection++)
+    {
+      if (flags.has (0, collection))
+        collections.push_back (collection);
+    }
+  !maxCutWidth_ && (maxCutWidth_ = getMaxWidth (metadata.cuts));
   for (auto collection = collections.begin (); collection != collections.end (); collection++)
     {
       if (collection != collections.begin ())
         ss_ << endl;
       ss_ << "--------------------------------------------------------------------------------" << endl;
-      ss_ << "\033[1;35mindividual object flags for " << *collection << "\033[0m" << endl;
+      ss_ << "\033[1;35mindividual object flags for " << metadata.collections.at (*collection) << "\033[0m" << endl;
       ss_ << "--------------------------------------------------------------------------------" << endl;
-      for (auto cut = cutDecisions->individualObjectFlags.begin (); cut != cutDecisions->individualObjectFlags.end (); cut++)
+      for (unsigned cut = 0; cut < flags.size (); cut++)
         {
-          ss_ << "\033[1;34m" << setw (maxCutWidth_) << left << cutDecisions->cuts.at (cut - cutDecisions->individualObjectFlags.begin ()).name << "\033[0m";
-          for (auto flag = cut->at (*collection).begin (); flag != cut->at (*collection).end (); flag++)
+          ss_ << "\033[1;34m" << setw (maxCutWidth_) << left << metadata.cuts.at (cut).name << "\033[0m";
+          for (unsigned object = 0; object < flags.nObjects (cut, *collection); object++)
             {
-              if (flag != cut->at (*collection).begin ())
+              pair<bool, bool> flag = flags.get (cut, *collection, object);
+              if (object)
                 ss_ << ", ";
-              if (flag->second)
+              if (flag.second)
                 {
-                  if (flag->first)
+                  if (flag.first)
                     ss_ << "\033[1;32m1\033[0m";
                   else
                     ss_ << "\033[1;31m0\033[0m";
@@ -305,14 +346,14 @@ InfoPrinter::printIndividualObjectFlags ()
 bool
 InfoPrinter::printTriggerFlags ()
 {
-  if (!cutDecisions.isValid ())
+  if (!cutDecisions.isValid () || !cutDecisions->metadata)
     return false;
 
   ss_ << endl;
-  !maxTriggerWidth_ && (maxTriggerWidth_ = getMaxWidth (cutDecisions->triggers));
+  !maxTriggerWidth_ && (maxTriggerWidth_ = getMaxWidth (cutDecisions->metadata->triggers));
   for (auto flag = cutDecisions->triggerFlags.begin (); flag != cutDecisions->triggerFlags.end (); flag++)
     {
-      ss_ << "\033[1;34m" << setw (maxTriggerWidth_) << left << cutDecisions->triggers.at (flag - cutDecisions->triggerFlags.begin ()) << "\033[0m";
+      ss_ << "\033[1;34m" << setw (maxTriggerWidth_) << left << cutDecisions->metadata->triggers.at (flag - cutDecisions->triggerFlags.begin ()) << "\033[0m";
       if (*flag)
         ss_ << "\033[1;32mtrue\033[0m" << endl;
       else
@@ -324,14 +365,14 @@ InfoPrinter::printTriggerFlags ()
 bool
 InfoPrinter::printVetoTriggerFlags ()
 {
-  if (!cutDecisions.isValid ())
+  if (!cutDecisions.isValid () || !cutDecisions->metadata)
     return false;
 
   ss_ << endl;
-  !maxVetoTriggerWidth_ && (maxVetoTriggerWidth_ = getMaxWidth (cutDecisions->triggersToVeto));
+  !maxVetoTriggerWidth_ && (maxVetoTriggerWidth_ = getMaxWidth (cutDecisions->metadata->triggersToVeto));
   for (auto flag = cutDecisions->vetoTriggerFlags.begin (); flag != cutDecisions->vetoTriggerFlags.end (); flag++)
     {
-      ss_ << "\033[1;34m" << setw (maxVetoTriggerWidth_) << left << cutDecisions->triggersToVeto.at (flag - cutDecisions->vetoTriggerFlags.begin ()) << "\033[0m";
+      ss_ << "\033[1;34m" << setw (maxVetoTriggerWidth_) << left << cutDecisions->metadata->triggersToVeto.at (flag - cutDecisions->vetoTriggerFlags.begin ()) << "\033[0m";
       if (*flag)
         ss_ << "\033[1;32mtrue\033[0m" << endl;
       else
@@ -384,7 +425,30 @@ InfoPrinter::printAllTriggers (const edm::Event &event)
     ss_ << "\033[1;31mERROR\033[0m" << " [InfoPrinter::printAllTriggers]:  Invalid prescales handle." << endl;  
     return false; 
   } 
-    
+  getAllTriggers (event, triggers);
+  !maxAllTriggerWidth_ && (maxAllTriggerWidth_ = getMaxWidth (triggers));
+  for (const auto &trigger : triggers)
+    {
+      ss_ << "\033[1;34m" << setw (maxAllTriggerWidth_) << left << trigger.first << "\033[0m";
+      if (trigger.second.first)
+        ss_ << "\033[1;32maccept\033[0m  ";
+      else
+        ss_ << "\033[1;31mreject\033[0m  ";
+      if (trigger.second.second == 1)
+        ss_ << "\033[1;33m" << trigger.second.second << "\033[0m" << endl;
+      else
+        ss_ << "\033[2;33m" << trigger.second.second << "\033[0m" << endl;
+    }
+
+  return true;
+}
+
+bool
+InfoPrinter::getAllTriggers (const edm::Event &event, map<string, pair<bool, unsigned> > &triggers)
+{
+  if (!handles_.triggers.isValid () || !handles_.prescales.isValid ())
+    return false;
+
 #if DATA_FORMAT == BEAN
   for (const auto &trigger : *handles_.triggers)
     {
@@ -403,21 +467,150 @@ InfoPrinter::printAllTriggers (const edm::Event &event)
 #endif
       triggers[name] = make_pair (pass, prescale);
     }
-  !maxAllTriggerWidth_ && (maxAllTriggerWidth_ = getMaxWidth (triggers));
-  for (const auto &trigger : triggers)
+
+  return true;
+}
+
+void
+InfoPrinter::printJson (const edm::Event &event)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Each event is printed as a single JSON object on one line, with a member
+  // for each type of information requested by the user. Invalid values are
+  // printed as null.
+  //////////////////////////////////////////////////////////////////////////////
+  ss_ << "{\"run\": " << event.id ().run () << ", \"lumi\": " << event.id ().luminosityBlock () << ", \"event\": " << event.id ().event () << ", \"record\": " << counter_;
+  if (valuesToPrint.size ())
     {
-      ss_ << "\033[1;34m" << setw (maxAllTriggerWidth_) << left << trigger.first << "\033[0m";
-      if (trigger.second.first)
-        ss_ << "\033[1;32maccept\033[0m  ";
-      else
-        ss_ << "\033[1;31mreject\033[0m  ";
-      if (trigger.second.second == 1)
-        ss_ << "\033[1;33m" << trigger.second.second << "\033[0m" << endl;
-      else
-        ss_ << "\033[2;33m" << trigger.second.second << "\033[0m" << endl;
+      ss_ << ", \"valuesToPrint\": {";
+      for (auto valueToPrint = valuesToPrint.begin (); valueToPrint != valuesToPrint.end (); valueToPrint++)
+        {
+          if (valueToPrint != valuesToPrint.begin ())
+            ss_ << ", ";
+          ss_ << anatools::jsonString (valueToPrint->inputLabel + ": " + valueToPrint->valueToPrint) << ": [";
+          for (auto value = valueToPrint->valueLookupTree->evaluate ().begin (); value != valueToPrint->valueLookupTree->evaluate ().end (); value++)
+            {
+              if (value != valueToPrint->valueLookupTree->evaluate ().begin ())
+                ss_ << ", ";
+              double v = boost::get<double> (*value);
+              if (!IS_INVALID(v) && std::isfinite (v))
+                ss_ << v;
+              else
+                ss_ << "null";
+            }
+          ss_ << "]";
+        }
+      ss_ << "}";
     }
+  if (cutDecisions.isValid ())
+    {
+      // The flags are labeled with the names in the metadata, which is missing
+      // if the cut decisions were read from a file.
+      if (cutDecisions->metadata)
+        {
+          const CutCalculatorMetadata &metadata = *cutDecisions->metadata;
+          if (printIndividualObjectFlags_)
+            printJsonObjectFlags ("individualObjectFlags", cutDecisions->individualObjectFlags);
+          if (printCumulativeObjectFlags_)
+            printJsonObjectFlags ("cumulativeObjectFlags", cutDecisions->cumulativeObjectFlags);
+          if (printTriggerFlags_)
+            printJsonFlags ("triggerFlags", cutDecisions->triggerFlags, metadata.triggers);
+          if (printVetoTriggerFlags_)
+            printJsonFlags ("vetoTriggerFlags", cutDecisions->vetoTriggerFlags, metadata.triggersToVeto);
+          if (printCumulativeEventFlags_)
+            printJsonFlags ("cumulativeEventFlags", cutDecisions->cumulativeEventFlags, metadata.cuts);
+          if (printIndividualEventFlags_)
+            printJsonFlags ("individualEventFlags", cutDecisions->individualEventFlags, metadata.cuts);
+        }
+      if (printTriggerDecision_)
+        ss_ << ", \"triggerDecision\": " << (cutDecisions->triggerDecision ? "true" : "false");
+      if (printCutDecision_)
+        ss_ << ", \"cutDecision\": " << (cutDecisions->cutDecision ? "true" : "false");
+      if (printEventDecision_)
+        ss_ << ", \"eventDecision\": " << (cutDecisions->eventDecision ? "true" : "false");
+    }
+  map<string, pair<bool, unsigned> > triggers;
+  if (printAllTriggers_ && getAllTriggers (event, triggers))
+    {
+      ss_ << ", \"allTriggers\": {";
+      for (auto trigger = triggers.begin (); trigger != triggers.end (); trigger++)
+        {
+          if (trigger != triggers.begin ())
+            ss_ << ", ";
+          ss_ << anatools::jsonString (trigger->first) << ": {\"accept\": " << (trigger->second.first ? "true" : "false") << ", \"prescale\": " << trigger->second.second << "}";
+        }
+      ss_ << "}";
+    }
+  ss_ << "}" << endl;
+  //////////////////////////////////////////////////////////////////////////////
+}
 
-  return true;
+void
+InfoPrinter::printJsonFlags (const string &key, const vector<bool> &flags, const vector<string> &names)
+{
+  ss_ << ", " << anatools::jsonString (key) << ": {";
+  for (unsigned i = 0; i < flags.size () && i < names.size (); i++)
+    {
+      if (i)
+        ss_ << ", ";
+      ss_ << anatools::jsonString (names.at (i)) << ": " << (flags.at (i) ? "true" : "false");
+    }
+  ss_ << "}";
+}
+
+void
+InfoPrinter::printJsonFlags (const string &key, const vector<bool> &flags, const Cuts &cuts)
+{
+  ss_ << ", " << anatools::jsonString (key) << ": {";
+  for (unsigned i = 0; i < flags.size () && i < cuts.size (); i++)
+    {
+      if (i)
+        ss_ << ", ";
+      ss_ << anatools::jsonString (cuts.at (i).name) << ": " << (flags.at (i) ? "true" : "false");
+    }
+  ss_ << "}";
+}
+
+void
+InfoPrinter::printJsonObjectFlags (const string &key, const ObjectFlags &flags)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // The flags for each collection are printed as an object with a list of
+  // flags for each cut, as in the tables, where 1 and 0 are true and false and
+  // null is a flag which was not set.
+  //////////////////////////////////////////////////////////////////////////////
+  const CutCalculatorMetadata &metadata = *cutDecisions->metadata;
+  bool first = true;
+  ss_ << ", " << anatools::jsonString (key) << ": {";
+  for (unsigned collection = 0; flags.size () && collection < flags.nCollections (); collection++)
+    {
+      if (!flags.has (0, collection))
+        continue;
+      if (!first)
+        ss_ << ", ";
+      first = false;
+      ss_ << anatools::jsonString (metadata.collections.at (collection)) << ": {";
+      for (unsigned cut = 0; cut < flags.size (); cut++)
+        {
+          if (cut)
+            ss_ << ", ";
+          ss_ << anatools::jsonString (metadata.cuts.at (cut).name) << ": [";
+          for (unsigned object = 0; object < flags.nObjects (cut, collection); object++)
+            {
+              pair<bool, bool> flag = flags.get (cut, collection, object);
+              if (object)
+                ss_ << ", ";
+              if (flag.second)
+                ss_ << (flag.first ? "1" : "0");
+              else
+                ss_ << "null";
+            }
+          ss_ << "]";
+        }
+      ss_ << "}";
+    }
+  ss_ << "}";
+  //////////////////////////////////////////////////////////////////////////////
 }
 
 unsigned
@@ -574,6 +767,8 @@ InfoPrinter::unpackValuesToPrint ()
       valuesToPrint.back ().valueToPrint = value.getParameter<string> ("valueToPrint");
 
       objectsToGet_.insert (valuesToPrint.back ().inputCollections.begin (), valuesToPrint.back ().inputCollections.end ());
+      if (anatools::usesUserVariables (valuesToPrint.back ().valueToPrint))
+        objectsToGet_.insert ("uservariables");
     }
   if (printAllTriggers_)
     {
@@ -590,6 +785,8 @@ InfoPrinter::initializeValueLookupForest (ValuesToPrint &values, Collections * c
       if (firstEvent_)
         {
           value.valueLookupTree = new ValueLookupTree (value);
+          value.valueLookupTree->setUseTreeWalker (useTreeWalker_);
+          value.valueLookupTree->setInstrumentationLabel (moduleDescription ().moduleLabel (), "value to print", value.inputLabel + ": " + value.valueToPrint);
           if (!value.valueLookupTree->isValid ())
             return false;
         }
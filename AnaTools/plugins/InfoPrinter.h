@@ -16,6 +16,7 @@
 #include "TStopwatch.h"
 
 #include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
+#include "OSUT3Analysis/AnaTools/interface/OutputSink.h"
 
 class InfoPrinter : public edm::EDAnalyzer
 {
@@ -44,6 +45,18 @@ class InfoPrinter : public edm::EDAnalyzer
     bool printAllTriggers (const edm::Event &);
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Private methods for printing the same information as a single line of
+    // JSON instead of as tables.
+    ////////////////////////////////////////////////////////////////////////////
+    void printJson (const edm::Event &);
+    void printJsonFlags (const string &, const vector<bool> &, const vector<string> &);
+    void printJsonFlags (const string &, const vector<bool> &, const Cuts &);
+    void printJsonObjectFlags (const string &, const ObjectFlags &);
+    ////////////////////////////////////////////////////////////////////////////
+
+    bool getAllTriggers (const edm::Event &, map<string, pair<bool, unsigned> > &);
+
     ////////////////////////////////////////////////////////////////////////////
     // Private methods for calculating how wide a column in a table needs to
     // be.
@@ -81,20 +94,29 @@ class InfoPrinter : public edm::EDAnalyzer
     bool                  printVetoTriggerFlags_;
     bool                  printAllTriggers_;
     edm::VParameterSet    valuesToPrint_;
+    bool                  useTreeWalker_;
+    string                outputFile_;
+    bool                  printJson_;
+    unsigned              outputBufferSize_;
     bool                  firstEvent_;
     unsigned              counter_;
     ////////////////////////////////////////////////////////////////////////////
 
     // Object collections which can be gotten from the event.
     Collections handles_;
+    CollectionTokens tokens_;
 
     // Stopwatch for timing the code.
     TStopwatch *sw_;
 
-    // Stringstream which holds all the information to be printed until the
-    // destructor is called, where it is printed to the screen.
+    // Stringstream which holds the information to be printed for the current
+    // event until it is handed to the sink at the end of analyze.
     stringstream ss_;
 
+    // Sink which writes the information printed for each event in the
+    // background.
+    OutputSink *sink_;
+
     // Cut decisions which are gotten from the event.
     edm::Handle<CutCalculatorPayload> cutDecisions;
 
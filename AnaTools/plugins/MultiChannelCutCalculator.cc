@@ -0,0 +1,328 @@
+#include <cctype>
+#include <iostream>
+#include <set>
+
+#include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
+#include "OSUT3Analysis/AnaTools/interface/ValueLookupTree.h"
+#include "OSUT3Analysis/AnaTools/plugins/MultiChannelCutCalculator.h"
+
+#define EXIT_CODE 1
+
+MultiChannelCutCalculator::MultiChannelCutCalculator (const edm::ParameterSet &cfg) :
+  CutCalculator (cfg, edm::ParameterSet ())
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // The root node of the tree of cuts does not correspond to any cut. It holds
+  // the channels which have no cuts at all.
+  //////////////////////////////////////////////////////////////////////////////
+  nodes_.resize (1);
+  nodes_.at (0).cut.valueLookupTree = NULL;
+  nodes_.at (0).cut.arbitrationTree = NULL;
+  nodes_.at (0).uniqueCut = 0;
+  //////////////////////////////////////////////////////////////////////////////
+
+  set<string> instanceLabels;
+  for (const auto &channelPSet : cfg.getParameter<edm::VParameterSet> ("channels"))
+    {
+      Channel channel;
+      channel.name = channelPSet.getParameter<string> ("name");
+      for (const auto &c : channel.name)
+        {
+          if (isalnum (c))
+            channel.instanceLabel += c;
+        }
+
+      ////////////////////////////////////////////////////////////////////////////
+      // Try to unpack the cuts for this channel and quit if there is a problem.
+      ////////////////////////////////////////////////////////////////////////////
+      if (!unpackCuts (channelPSet, channel.metadata))
+        {
+          clog << "ERROR: failed to interpret cuts PSet for channel \"" << channel.name << "\". Quitting..." << endl;
+          exit (EXIT_CODE);
+        }
+      if (!instanceLabels.insert (channel.instanceLabel).second)
+        {
+          clog << "ERROR: channel \"" << channel.name << "\" does not have a unique name. Quitting..." << endl;
+          exit (EXIT_CODE);
+        }
+      ////////////////////////////////////////////////////////////////////////////
+
+      produces<CutCalculatorPayload> (channel.instanceLabel);
+      channels_.push_back (channel);
+    }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // The collections of all the channels share a single set of IDs, since the
+  // object flags for the nodes of the tree are shared between the channels.
+  //////////////////////////////////////////////////////////////////////////////
+  vector<Cuts *> channelCuts;
+  for (auto &channel : channels_)
+    channelCuts.push_back (&channel.metadata.cuts);
+  internCollections (channelCuts);
+  //////////////////////////////////////////////////////////////////////////////
+
+  anatools::getCollectionTokens (objectsToGet_, collections_, tokens_, consumesCollector ());
+
+  for (unsigned iChannel = 0; iChannel < channels_.size (); iChannel++)
+    {
+      Channel &channel = channels_.at (iChannel);
+      channel.metadata.collections = collectionLabels_;
+
+      ////////////////////////////////////////////////////////////////////////////
+      // Walk down the tree of cuts, adding nodes for any cuts which do not
+      // match those of the channels which have already been added.
+      ////////////////////////////////////////////////////////////////////////////
+      unsigned node = 0;
+      nodes_.at (node).subtreeChannels.push_back (iChannel);
+      for (const auto &cut : channel.metadata.cuts)
+        {
+          channel.nodes.push_back (node = addNode (node, cut));
+          nodes_.at (node).subtreeChannels.push_back (iChannel);
+        }
+      nodes_.at (node).channels.push_back (iChannel);
+      ////////////////////////////////////////////////////////////////////////////
+    }
+  triggerDecisions_.resize (channels_.size ());
+  channelCanPass_.resize (channels_.size ());
+}
+
+MultiChannelCutCalculator::~MultiChannelCutCalculator ()
+{
+  // Only the unique cuts own their ValueLookupTree objects. The cuts of the
+  // nodes and of the channels merely point to them.
+  for (auto &cut : uniqueCuts_)
+    {
+      if (cut.valueLookupTree)
+        delete cut.valueLookupTree;
+      if (cut.arbitrationTree)
+        delete cut.arbitrationTree;
+    }
+}
+
+void
+MultiChannelCutCalculator::produce (edm::Event &event, const edm::EventSetup &setup)
+{
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+  anatools::getRequiredCollections (tokens_, handles_, event);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Parse the unique cut strings into ValueLookupTree objects on the first
+  // event, and give the new objects to the cuts in each node and each channel.
+  //////////////////////////////////////////////////////////////////////////////
+  if (!initializeValueLookupForest (uniqueCuts_, &handles_))
+    {
+      clog << "ERROR: failed to parse all cut strings. Quitting..." << endl;
+      exit (EXIT_CODE);
+    }
+  if (firstEvent_)
+    {
+      for (auto node = nodes_.begin () + 1; node != nodes_.end (); node++)
+        {
+          node->cut.valueLookupTree = uniqueCuts_.at (node->uniqueCut).valueLookupTree;
+          node->cut.arbitrationTree = uniqueCuts_.at (node->uniqueCut).arbitrationTree;
+        }
+      for (auto &channel : channels_)
+        {
+          for (unsigned i = 0; i < channel.metadata.cuts.size (); i++)
+            {
+              channel.metadata.cuts.at (i).valueLookupTree = nodes_.at (channel.nodes.at (i)).cut.valueLookupTree;
+              channel.metadata.cuts.at (i).arbitrationTree = nodes_.at (channel.nodes.at (i)).cut.arbitrationTree;
+            }
+        }
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  // The triggers are evaluated first, since in the early-exit mode a channel
+  // failing them needs none of its cuts evaluated.
+  evaluateChannelTriggers (event);
+
+  // The payload which holds the object flags while walking the tree of cuts.
+  pl_ = auto_ptr<CutCalculatorPayload> (new CutCalculatorPayload);
+  pl_->isValid = true;
+  pl_->cumulativeObjectFlags = pl_->individualObjectFlags = ObjectFlags (collectionLabels_.size ());
+
+  evaluateNode (event, 0, 0);
+
+  pl_.reset ();
+  firstEvent_ = false;
+}
+
+unsigned
+MultiChannelCutCalculator::addUniqueCut (const Cut &cut)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Cuts on the same collections with the same cut string and arbitration set
+  // identical flags, up to a possible veto, so they share a ValueLookupTree.
+  //////////////////////////////////////////////////////////////////////////////
+  for (unsigned i = 0; i < uniqueCuts_.size (); i++)
+    {
+      const Cut &uniqueCut = uniqueCuts_.at (i);
+      if (uniqueCut.inputLabel == cut.inputLabel
+       && uniqueCut.cutString == cut.cutString
+       && uniqueCut.arbitration == cut.arbitration)
+        return i;
+    }
+  uniqueCuts_.push_back (cut);
+  return uniqueCuts_.size () - 1;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+unsigned
+MultiChannelCutCalculator::addNode (unsigned parent, const Cut &cut)
+{
+  unsigned uniqueCut = addUniqueCut (cut);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Reuse an existing child of the parent node if it has the same cut. The
+  // number of objects required does not affect the object flags, so it can
+  // differ between the channels sharing a node.
+  //////////////////////////////////////////////////////////////////////////////
+  for (const auto &child : nodes_.at (parent).children)
+    {
+      if (nodes_.at (child).uniqueCut == uniqueCut && nodes_.at (child).cut.isVeto == cut.isVeto)
+        return child;
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  CutNode node;
+  node.cut = cut;
+  node.uniqueCut = uniqueCut;
+  nodes_.push_back (node);
+  nodes_.at (parent).children.push_back (nodes_.size () - 1);
+  return nodes_.size () - 1;
+}
+
+void
+MultiChannelCutCalculator::evaluateChannelTriggers (const edm::Event &event)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Evaluate the triggers and trigger filters for each channel in its own
+  // payload, which is kept until the payload for the channel is put into the
+  // event.
+  //////////////////////////////////////////////////////////////////////////////
+  for (unsigned iChannel = 0; iChannel < channels_.size (); iChannel++)
+    {
+      const Channel &channel = channels_.at (iChannel);
+      pl_ = auto_ptr<CutCalculatorPayload> (new CutCalculatorPayload);
+      pl_->metadata = &channel.metadata;
+
+      evaluateTriggers (event);
+      evaluateTriggerFilters (event);
+
+      channelCanPass_.at (iChannel) = !earlyExit_ || (pl_->triggerDecision && pl_->triggerFilterDecision);
+      triggerDecisions_.at (iChannel) = *pl_;
+    }
+  pl_.reset ();
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+void
+MultiChannelCutCalculator::evaluateNode (edm::Event &event, unsigned iNode, unsigned depth)
+{
+  // The object flags for every cut up to and including this node are now set,
+  // so the payloads for the channels ending here can be put into the event.
+  for (const auto &channel : nodes_.at (iNode).channels)
+    putPayload (event, channel);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Set the flags for each child node in turn. Since updateCrossTalk can add
+  // flags for earlier cuts, the flags for this node are saved beforehand and
+  // restored before moving on to the next child.
+  //////////////////////////////////////////////////////////////////////////////
+  const vector<unsigned> &children = nodes_.at (iNode).children;
+  ObjectFlags cumulativeObjectFlags, individualObjectFlags;
+  if (children.size () > 1)
+    {
+      cumulativeObjectFlags = pl_->cumulativeObjectFlags;
+      individualObjectFlags = pl_->individualObjectFlags;
+    }
+  for (auto child = children.begin (); child != children.end (); child++)
+    {
+      if (child != children.begin ())
+        {
+          pl_->cumulativeObjectFlags = cumulativeObjectFlags;
+          pl_->individualObjectFlags = individualObjectFlags;
+        }
+
+      ////////////////////////////////////////////////////////////////////////////
+      // In the early-exit mode, if every channel below the child node is
+      // already known to fail, their payloads are put into the event with the
+      // flags as they are, and the cuts below are never evaluated.
+      ////////////////////////////////////////////////////////////////////////////
+      if (!canPass (*child))
+        {
+          for (const auto &channel : nodes_.at (*child).subtreeChannels)
+            putPayload (event, channel);
+          continue;
+        }
+      ////////////////////////////////////////////////////////////////////////////
+
+      const Cut &currentCut = nodes_.at (*child).cut;
+      if (!(pl_->isValid = setObjectFlags (currentCut, depth)))
+        {
+          clog << "ERROR: failed to set flags. Quitting..." <<  endl;
+          exit (EXIT_CODE);
+        }
+      updateCrossTalk (currentCut, depth);
+
+      ////////////////////////////////////////////////////////////////////////////
+      // In the early-exit mode, record which of the channels below the child
+      // node fail its cut. Each channel has its own number required.
+      ////////////////////////////////////////////////////////////////////////////
+      if (earlyExit_)
+        {
+          for (const auto &channel : nodes_.at (*child).subtreeChannels)
+            {
+              if (channelCanPass_.at (channel) && !getCutDecisions (channels_.at (channel).metadata.cuts.at (depth), depth).first)
+                channelCanPass_.at (channel) = false;
+            }
+        }
+      ////////////////////////////////////////////////////////////////////////////
+
+      evaluateNode (event, *child, depth + 1);
+    }
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+bool
+MultiChannelCutCalculator::canPass (unsigned iNode) const
+{
+  // Returns true unless every channel passing through the given node is known
+  // to fail.
+  for (const auto &channel : nodes_.at (iNode).subtreeChannels)
+    {
+      if (channelCanPass_.at (channel))
+        return true;
+    }
+  return false;
+}
+
+void
+MultiChannelCutCalculator::putPayload (edm::Event &event, unsigned iChannel)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Copy the object flags into a new payload for this channel, together with
+  // its trigger decisions, and set the event flags for it exactly as the
+  // CutCalculator does. The payload holding the flags is restored afterward.
+  //////////////////////////////////////////////////////////////////////////////
+  const Channel &channel = channels_.at (iChannel);
+  const CutCalculatorPayload &triggerDecisions = triggerDecisions_.at (iChannel);
+  auto_ptr<CutCalculatorPayload> flags = pl_;
+  pl_ = auto_ptr<CutCalculatorPayload> (new CutCalculatorPayload (*flags));
+  pl_->metadata = &channel.metadata;
+  pl_->triggerFlags = triggerDecisions.triggerFlags;
+  pl_->vetoTriggerFlags = triggerDecisions.vetoTriggerFlags;
+  pl_->triggerFilterFlags = triggerDecisions.triggerFilterFlags;
+  pl_->triggerDecision = triggerDecisions.triggerDecision;
+  pl_->triggerFilterDecision = triggerDecisions.triggerFilterDecision;
+
+  setEventFlags ();
+
+  event.put (pl_, channel.instanceLabel);
+  pl_ = flags;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+#include "FWCore/Framework/interface/MakerMacros.h"
+DEFINE_FWK_MODULE(MultiChannelCutCalculator);
@@ -0,0 +1,77 @@
+#ifndef MULTI_CHANNEL_CUT_CALCULATOR
+#define MULTI_CHANNEL_CUT_CALCULATOR
+
+#include "OSUT3Analysis/AnaTools/plugins/CutCalculator.h"
+
+// Declaration of the MultiChannelCutCalculator EDProducer which produces the
+// same payload as the CutCalculator, but for several channels at once. The
+// cuts of all the channels are arranged in a tree, in which channels whose
+// first N cuts are identical share the first N nodes. The flags for each node
+// are calculated once per event, and each unique cut string is only parsed
+// into a single ValueLookupTree, no matter how many channels use it. One
+// payload is put into the event for each channel, with the channel name,
+// stripped of any non-alphanumeric characters, as the product instance label.
+//
+// In the early-exit mode, the walk down the tree stops at a node once every
+// channel below it is known to fail, so channels sharing a failing prefix of
+// cuts stop being evaluated together.
+class MultiChannelCutCalculator : public CutCalculator
+{
+  public:
+    MultiChannelCutCalculator (const edm::ParameterSet &);
+    ~MultiChannelCutCalculator ();
+
+    void produce (edm::Event &, const edm::EventSetup &);
+
+  private:
+    ////////////////////////////////////////////////////////////////////////////
+    // A channel, with its cuts and triggers unpacked into the metadata its
+    // payloads point to, and the nodes in the tree of cuts which correspond to
+    // its cuts.
+    ////////////////////////////////////////////////////////////////////////////
+    struct Channel
+    {
+      string                 name;
+      string                 instanceLabel;
+      CutCalculatorMetadata  metadata;
+      vector<unsigned>       nodes;
+    };
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // A node in the tree of cuts. The cut is an index in uniqueCuts_, which
+    // holds the unique cuts, and the node also records whether the cut is a
+    // veto. The channels are those whose last cut corresponds to this node,
+    // while subtreeChannels are all those which pass through it.
+    ////////////////////////////////////////////////////////////////////////////
+    struct CutNode
+    {
+      Cut               cut;
+      unsigned          uniqueCut;
+      vector<unsigned>  children;
+      vector<unsigned>  channels;
+      vector<unsigned>  subtreeChannels;
+    };
+    ////////////////////////////////////////////////////////////////////////////
+
+    unsigned addUniqueCut (const Cut &);
+    unsigned addNode (unsigned, const Cut &);
+    void evaluateChannelTriggers (const edm::Event &);
+    void evaluateNode (edm::Event &, unsigned, unsigned);
+    bool canPass (unsigned) const;
+    void putPayload (edm::Event &, unsigned);
+
+    vector<Channel>  channels_;
+    vector<CutNode>  nodes_;
+    Cuts             uniqueCuts_;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Per-event results for each channel: the trigger decisions, and whether
+    // the channel can still pass given the cuts evaluated so far.
+    ////////////////////////////////////////////////////////////////////////////
+    vector<CutCalculatorPayload>  triggerDecisions_;
+    vector<bool>                  channelCanPass_;
+    ////////////////////////////////////////////////////////////////////////////
+};
+
+#endif
@@ -1,63 +1,62 @@
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
 #include "OSUT3Analysis/AnaTools/plugins/PUScalingFactorProducer.h"
 
-PUScalingFactorProducer::PUScalingFactorProducer(const edm::ParameterSet &cfg) :
-   EventVariableProducer(cfg),
+PUScalingFactorProducer::PUScalingFactorProducer(const edm::ParameterSet &cfg, const Cache *cache) :
+   EventVariableProducerBase(cfg, cache),
    PU_               (cfg.getParameter<string>("PU")),
    dataset_          (cfg.getParameter<string>("dataset")),
-   type_             (cfg.getParameter<string>("type"))
+   dataHistogram_    (cfg.exists ("dataHistogram") ? cfg.getParameter<string>("dataHistogram") : "MuonEG_2015D"),
+   type_             (cfg.getParameter<string>("type")),
+   puWeight_         (cache->data ())
 {
+  puScalingFactor_ = registerEventVar ("puScalingFactor");
+#if DATA_FORMAT == MINI_AOD_CUSTOM || DATA_FORMAT == MINI_AOD
+  if(type_.find("MC") < type_.length())
+    {
+      objectsToGet_.insert ("pileupinfos");
+      if (collections_.exists ("pileupinfos"))
+        pileupInfosToken_ = anatools::consumeCollection<vector<PileupSummaryInfo> > (collections_.getParameter<edm::InputTag> ("pileupinfos"), consumesCollector (), true);
+    }
+#endif
 }
 
 PUScalingFactorProducer::~PUScalingFactorProducer() {}
 
+unique_ptr<PUScalingFactorProducer::Cache>
+PUScalingFactorProducer::initializeGlobalCache (const edm::ParameterSet &cfg)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // The pileup file is only opened for MC, so the cache is left empty for data
+  // and for formats without pileup summaries.
+  //////////////////////////////////////////////////////////////////////////////
+#if DATA_FORMAT == MINI_AOD_CUSTOM || DATA_FORMAT == MINI_AOD
+  string type = cfg.getParameter<string>("type");
+  if(type.find("MC") < type.length())
+    return unique_ptr<Cache> (new Cache (new PUWeight (cfg.getParameter<string>("PU"),
+                                                       cfg.exists ("dataHistogram") ? cfg.getParameter<string>("dataHistogram") : "MuonEG_2015D",
+                                                       cfg.getParameter<string>("dataset"))));
+#endif
+  return unique_ptr<Cache> (new Cache (new PUWeight));
+  //////////////////////////////////////////////////////////////////////////////
+}
+
 void
 PUScalingFactorProducer::AddVariables (const edm::Event &event) {
 #if DATA_FORMAT == MINI_AOD_CUSTOM || DATA_FORMAT == MINI_AOD
-  TFile *fin = TFile::Open (PU_.c_str ());
-  if (!fin || fin->IsZombie()) {
-    clog << "ERROR [PUScalingFactorProducer]: Could not find file: " << PU_
-	 << "; will cause a seg fault." << endl;
-    exit(1);
-  }  
-  TH1D *mc;
-  TH1D *puWeight;
-  fin->GetObject(dataset_.c_str(), mc);  
-  fin->GetObject("MuonEG_2015D", puWeight);
-  if (!mc) {
-    clog << "ERROR [PUScalingFactorProducer]: Could not find histogram: " << dataset_ << "; will cause a seg fault." << endl;
-    exit(1);
-  }
-  if (!puWeight) {
-    clog << "ERROR [PUScalingFactorProducer]: Could not find histogram: MuonEG_2015D, will cause a seg fault." << endl;
-    exit(1);
-  }
-  mc->SetDirectory (0);
-  puWeight->SetDirectory (0);
-  mc->Scale (puWeight->Integral () / mc->Integral ());
-  TH1D *trimmedMC = new TH1D ("bla", "bla", puWeight->GetNbinsX(), 0, puWeight->GetNbinsX());
-  for (int bin = 1; bin <= puWeight->GetNbinsX(); bin++)
-    trimmedMC->SetBinContent (bin, mc->GetBinContent (bin));
-  puWeight->Divide (trimmedMC);
-  delete fin;
-  delete mc;
-  delete trimmedMC;
   if(type_.find("MC") < type_.length())
     {
-      objectsToGet_.insert ("pileupinfos");
       getOriginalCollections (objectsToGet_, collections_, handles_, event);
       double numTruePV = 0;
       for (const auto &pv1 : *handles_.pileupinfos) {
       if(pv1.getBunchCrossing() == 0)
         numTruePV = pv1.getTrueNumInteractions();
       }
-      (*eventvariables)["puScalingFactor"] = puWeight->GetBinContent(puWeight->FindBin(numTruePV));
+      setEventVar (puScalingFactor_, puWeight_->at (numTruePV));
     }
   else
-    (*eventvariables)["puScalingFactor"] = 1;
-  delete puWeight; 
+    setEventVar (puScalingFactor_, 1);
 #else
-    (*eventvariables)["puScalingFactor"] = 1; 
+    setEventVar (puScalingFactor_, 1); 
 # endif
 }  
 
@@ -69,7 +68,8 @@ PUScalingFactorProducer::getOriginalCollections (const unordered_set<string> &ob
   // Retrieve each object collection which we need and print a warning if it is
   // missing.
   //////////////////////////////////////////////////////////////////////////////
-  if  (VEC_CONTAINS  (objectsToGet,  "pileupinfos")    &&  collections.exists  ("pileupinfos"))    anatools::getCollection  (collections.getParameter<edm::InputTag>  ("pileupinfos"),    handles.pileupinfos,    event);
+  if (pileupInfosToken_.required)
+    anatools::getCollection (pileupInfosToken_, handles.pileupinfos, event);
 }
 
 #include "FWCore/Framework/interface/MakerMacros.h"
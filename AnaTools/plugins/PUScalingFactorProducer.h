@@ -4,6 +4,7 @@
 #include "OSUT3Analysis/AnaTools/interface/EventVariableProducer.h"
 #include "OSUT3Analysis/AnaTools/interface/DataFormat.h"
 #include "OSUT3Analysis/AnaTools/interface/ValueLookupTree.h"
+#include "OSUT3Analysis/AnaTools/interface/PUWeight.h"
 #include "DataFormats/Math/interface/deltaR.h"
 #include <string>
 #include "TH1D.h"
@@ -13,10 +14,13 @@ struct OriginalCollections
   edm::Handle<vector<PileupSummaryInfo>>    pileupinfos;
 };
 
-class PUScalingFactorProducer : public EventVariableProducer
+// The pileup weights are read from the file once per job, by
+// initializeGlobalCache, and shared by the instances in all streams.
+class PUScalingFactorProducer : public EventVariableProducerBase<PUWeight>
   {
     public:
-        PUScalingFactorProducer (const edm::ParameterSet &);
+        PUScalingFactorProducer (const edm::ParameterSet &, const Cache *);
+        static unique_ptr<Cache> initializeGlobalCache (const edm::ParameterSet &);
         void getOriginalCollections (const unordered_set<string> &objectsToGet, const edm::ParameterSet &collections, OriginalCollections &handles, const edm::Event &event);
         bool passCleaning (double eta, double phi, OriginalCollections &handles);
 	~PUScalingFactorProducer ();
@@ -25,7 +29,17 @@ class PUScalingFactorProducer : public EventVariableProducer
     private:
         string PU_;             
         string dataset_; 
+        string dataHistogram_; 
         string type_; 
         void AddVariables(const edm::Event &);
+
+        // Pileup weights, shared by all streams.
+        const PUWeight * const puWeight_;
+
+        // ID of the scaling factor in the payload.
+        unsigned puScalingFactor_;
+
+        // Token for the pileup summaries, which is only initialized for MC.
+        CollectionToken<vector<PileupSummaryInfo> > pileupInfosToken_;
 };
 #endif
@@ -1,4 +1,5 @@
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 #include "OSUT3Analysis/AnaTools/interface/ValueLookupTree.h"
 #include "OSUT3Analysis/AnaTools/plugins/Plotter.h"
 
@@ -10,17 +11,18 @@
 //   2. names of miniAOD collections to be used
 // It outputs a root file with corresponding histograms
 
-Plotter::Plotter (const edm::ParameterSet &cfg) :
+Plotter::Plotter (const edm::ParameterSet &cfg, const PlotterCache *cache) :
 
   // In the constructor, we parse the input histogram definitions
-  // We create the appropriate directory structure in the output file
-  // Then we book the TH1/TH2 objects in these directories
+  // The histograms themselves are booked once, by initializeGlobalCache, and
+  // each stream fills its own buffers with the same binning
 
   /// Retrieve parameters from the configuration file.
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections")),
   weightDefs_ (cfg.getParameter<vector<edm::ParameterSet> >("weights")),
   histogramSets_ (cfg.getParameter<vector<edm::ParameterSet> >("histogramSets")),
   verbose_ (cfg.getParameter<int> ("verbose")),
+  useTreeWalker_ (cfg.getUntrackedParameter<bool> ("useTreeWalker", false)),
   firstEvent_ (true)
 
 {
@@ -28,54 +30,22 @@ Plotter::Plotter (const edm::ParameterSet &cfg) :
 
   if (verbose_) clog << "Beginning Plotter::Plotter constructor." << endl;
 
-  TH1::SetDefaultSumw2();
-
-  /////////////////////////////////////
-  // parse the histogram definitions //
-  /////////////////////////////////////
-
-  // loop over each histogram set the user has included
-  for(unsigned histoSet = 0; histoSet != histogramSets_.size(); histoSet++){
+  if (cfg.getUntrackedParameter<string> ("instrumentationFile", "") != "")
+    Instrumentation::enable (cfg.getUntrackedParameter<string> ("instrumentationFile"));
 
-    vector<string> inputCollection = histogramSets_.at(histoSet).getParameter<vector<string> > ("inputCollection");
-    string catInputCollection = anatools::concatenateInputCollection (inputCollection);
-
-    objectsToGet_.insert (inputCollection.begin (), inputCollection.end ());
-    objectsToGet_.insert ("generatorweights");
-
-    // get the appropriate directory name
-    string directoryName = getDirectoryName(catInputCollection);
-
-    // import all the histogram definitions for the current set
-    vector<edm::ParameterSet> histogramList (histogramSets_.at(histoSet).getParameter<vector<edm::ParameterSet> >("histograms"));
-
-    // loop over each histogram
-    vector<edm::ParameterSet>::const_iterator histogram;
-    for(histogram = histogramList.begin(); histogram != histogramList.end(); ++histogram){
-
-      // parse the definition to get the relevant info
-      HistoDef histoDefinition = parseHistoDef(*histogram,inputCollection,catInputCollection,directoryName);
-
-      // check whether a histogram of the same name / directory already exists; if not, add to the master list
-      bool alreadyExists = false;
-      for (vector<HistoDef>::iterator h = histogramDefinitions.begin(); h != histogramDefinitions.end(); ++h)
-        if (h->name      == histoDefinition.name &&
-            h->directory == histoDefinition.directory) { alreadyExists = true; break; }
-      if (alreadyExists) cerr << "WARNING:  Found duplicate histogram in directory " << histoDefinition.directory
-                              << " with name " << histoDefinition.name
-                              << "; will only keep the first instance." << endl;
-      else histogramDefinitions.push_back(histoDefinition);
-
-    } // end loop on histograms in the set
-
-  } // end loop on histogram sets
+  parseHistogramSets (histogramSets_, histogramDefinitions, objectsToGet_, false);
 
   // loop over each parsed histogram configuration
-  vector<HistoDef>::iterator histogram;
-  for(histogram = histogramDefinitions.begin(); histogram != histogramDefinitions.end(); ++histogram){
+  for(unsigned i = 0; i != histogramDefinitions.size(); i++){
 
-    // book a TH1/TH2 in the appropriate folder
-    bookHistogram(*histogram);
+    // the histograms are parsed in the same order as in initializeGlobalCache,
+    // so each definition has the histogram with the same index
+    HistoDef &histogram = histogramDefinitions.at(i);
+    histogram.histogram = cache->histograms.at(i);
+
+    // the fills go into a buffer with the same binning, which belongs to this
+    // stream and is merged into the shared one in endStream
+    histogram.buffer = histogram.histogram ? new HistogramBuffer(*histogram.histogram) : NULL;
 
   } // end loop on parsed histograms
 
@@ -90,6 +60,7 @@ Plotter::Plotter (const edm::ParameterSet &cfg) :
       objectsToGet_.insert(*inputCollection);
     }
     string inputVariable = weightDefs_.at(weightDef).getParameter<string> ("inputVariable");
+    if(anatools::usesUserVariables(inputVariable)) objectsToGet_.insert("uservariables");
     Weight weight;
     weight.inputCollections = inputCollections;
     weight.inputVariable = inputVariable;
@@ -97,6 +68,9 @@ Plotter::Plotter (const edm::ParameterSet &cfg) :
     weight.product = 1.0;
     weights.push_back(weight);
   }
+
+  // declare the collections which are retrieved for each event
+  anatools::getCollectionTokens (objectsToGet_, collections_, tokens_, consumesCollector ());
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -108,7 +82,7 @@ void
 Plotter::analyze (const edm::Event &event, const edm::EventSetup &setup)
 {
   // get the required collections from the event
-  anatools::getRequiredCollections (objectsToGet_, collections_, handles_, event);
+  anatools::getRequiredCollections (tokens_, handles_, event);
 
   if (!initializeValueLookupForest (histogramDefinitions, &handles_))
     {
@@ -135,23 +109,86 @@ Plotter::analyze (const edm::Event &event, const edm::EventSetup &setup)
       }
     }
 
+  // the event weight is the same for every histogram and every value
+  double eventWeight = 1.0;
+  if (handles_.generatorweights.isValid ())
+    eventWeight *= anatools::getGeneratorWeight (*handles_.generatorweights);
+  for (vector<Weight>::iterator sf = weights.begin (); sf != weights.end (); sf++)
+    eventWeight *= sf->product;
+
   // now we'll loop over the histograms, filling each one as we go
 
   vector<HistoDef>::iterator histogram;
   for(histogram = histogramDefinitions.begin(); histogram != histogramDefinitions.end(); ++histogram)
-    fillHistogram (*histogram);
+    fillHistogram (*histogram, eventWeight);
 
   firstEvent_ = false;
 }
 
 ////////////////////////////////////////////////////////////////////////
 
+// the histograms are booked only once, with the TFileService, and shared by
+// the instances in all streams
+unique_ptr<PlotterCache>
+Plotter::initializeGlobalCache (const edm::ParameterSet &cfg)
+{
+  unique_ptr<PlotterCache> cache (new PlotterCache);
+  vector<HistoDef> histogramDefinitions;
+  unordered_set<string> objectsToGet;
+
+  TH1::SetDefaultSumw2();
+
+  parseHistogramSets (cfg.getParameter<vector<edm::ParameterSet> >("histogramSets"), histogramDefinitions, objectsToGet, true);
+  for (const auto &histogram : histogramDefinitions)
+    {
+      // book a TH1/TH2 in the appropriate folder, along with a buffer with the
+      // same binning to which the buffers of the streams are added
+      cache->histograms.push_back (bookHistogram (histogram));
+      cache->buffers.push_back (cache->histograms.back () ? HistogramBuffer (*cache->histograms.back ()) : HistogramBuffer ());
+    }
+
+  return cache;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// at the end of each stream, the contents of its buffers are added to the
+// shared ones, which the streams can do in any order
+void
+Plotter::endStream ()
+{
+  lock_guard<mutex> lock (globalCache ()->mutex_);
+  for (unsigned i = 0; i < histogramDefinitions.size (); i++)
+    {
+      if (histogramDefinitions.at (i).buffer)
+        histogramDefinitions.at (i).buffer->mergeInto (globalCache ()->buffers.at (i));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// at the end of the job, the sums of the buffers of all the streams are added
+// to the booked histograms, before the TFileService writes them out
+void
+Plotter::globalEndJob (const PlotterCache *cache)
+{
+  for (unsigned i = 0; i < cache->histograms.size (); i++)
+    {
+      if (cache->histograms.at (i))
+        cache->buffers.at (i).mergeInto (*cache->histograms.at (i));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+
 Plotter::~Plotter ()
 {
   for (auto &histogram : histogramDefinitions)
     {
       for (auto &valueLookupTree : histogram.valueLookupTrees)
         delete valueLookupTree;
+      if (histogram.buffer)
+        delete histogram.buffer;
     }
   
   for (auto &weight : weights)
@@ -163,6 +200,53 @@ Plotter::~Plotter ()
 
 ////////////////////////////////////////////////////////////////////////
 
+// parses every histogram in the given histogram sets, in order, adding the
+// collections which are needed to fill them to objectsToGet; duplicates are
+// only reported if printWarnings is true, so that they are reported once
+void Plotter::parseHistogramSets(const vector<edm::ParameterSet> &histogramSets, vector<HistoDef> &histogramDefinitions, unordered_set<string> &objectsToGet, const bool printWarnings){
+
+  // loop over each histogram set the user has included
+  for(unsigned histoSet = 0; histoSet != histogramSets.size(); histoSet++){
+
+    vector<string> inputCollection = histogramSets.at(histoSet).getParameter<vector<string> > ("inputCollection");
+    string catInputCollection = anatools::concatenateInputCollection (inputCollection);
+
+    objectsToGet.insert (inputCollection.begin (), inputCollection.end ());
+    objectsToGet.insert ("generatorweights");
+
+    // get the appropriate directory name
+    string directoryName = getDirectoryName(catInputCollection);
+
+    // import all the histogram definitions for the current set
+    vector<edm::ParameterSet> histogramList (histogramSets.at(histoSet).getParameter<vector<edm::ParameterSet> >("histograms"));
+
+    // loop over each histogram
+    vector<edm::ParameterSet>::const_iterator histogram;
+    for(histogram = histogramList.begin(); histogram != histogramList.end(); ++histogram){
+
+      // parse the definition to get the relevant info
+      HistoDef histoDefinition = parseHistoDef(*histogram,inputCollection,catInputCollection,directoryName);
+      for(vector<string>::const_iterator inputVariable = histoDefinition.inputVariables.begin(); inputVariable != histoDefinition.inputVariables.end(); ++inputVariable)
+        if(anatools::usesUserVariables(*inputVariable)) objectsToGet.insert("uservariables");
+
+      // check whether a histogram of the same name / directory already exists; if not, add to the master list
+      bool alreadyExists = false;
+      for (vector<HistoDef>::iterator h = histogramDefinitions.begin(); h != histogramDefinitions.end(); ++h)
+        if (h->name      == histoDefinition.name &&
+            h->directory == histoDefinition.directory) { alreadyExists = true; break; }
+      if (alreadyExists && printWarnings) cerr << "WARNING:  Found duplicate histogram in directory " << histoDefinition.directory
+                              << " with name " << histoDefinition.name
+                              << "; will only keep the first instance." << endl;
+      else if (!alreadyExists) histogramDefinitions.push_back(histoDefinition);
+
+    } // end loop on histograms in the set
+
+  } // end loop on histogram sets
+
+}
+
+////////////////////////////////////////////////////////////////////////
+
 // function to convert an input collection into a directory name
 string Plotter::getDirectoryName(string inputName){
 
@@ -195,6 +279,8 @@ HistoDef Plotter::parseHistoDef(const edm::ParameterSet &definition, const vecto
   parsedDef.hasVariableBinsY = parsedDef.binsY.size() > 3;
   parsedDef.inputVariables = definition.getParameter<vector<string> >("inputVariables");
   parsedDef.dimensions = parsedDef.inputVariables.size();
+  parsedDef.histogram = NULL;
+  parsedDef.buffer = NULL;
 
   // for 1D histograms, set the appropriate y-axis label
   parsedDef.title = setYaxisLabel(parsedDef);
@@ -206,7 +292,8 @@ HistoDef Plotter::parseHistoDef(const edm::ParameterSet &definition, const vecto
 ////////////////////////////////////////////////////////////////////////
 
 // book TH1 or TH2 in appropriate directory with correct bin options
-void Plotter::bookHistogram(const HistoDef definition){
+// returns the booked histogram, or NULL if it could not be booked
+TH1 *Plotter::bookHistogram(const HistoDef definition){
 
   // check for valid bins
   bool hasValidBinsX = definition.binsX.size() >= 3;
@@ -220,89 +307,91 @@ void Plotter::bookHistogram(const HistoDef definition){
   if(!hasValidBinsX || !hasValidBinsY){
     cout << "ERROR - invalid histogram bins for histogram " << definition.name
          << " in directory " << definition.directory <<  endl;
-    return;
+    return NULL;
   }
 
-  TFileDirectory subdir = fs_->mkdir(definition.directory);
+  edm::Service<TFileService> fs;
+  TFileDirectory subdir = fs->mkdir(definition.directory);
 
   // book 1D histogram
   if(definition.dimensions == 1){
     // equal X bins
     if(!definition.hasVariableBinsX){
-      subdir.make<TH1D>(TString(definition.name),
-                        TString(definition.title),
-                        definition.binsX.at(0),
-                        definition.binsX.at(1),
-                        definition.binsX.at(2));
+      return subdir.make<TH1D>(TString(definition.name),
+                               TString(definition.title),
+                               definition.binsX.at(0),
+                               definition.binsX.at(1),
+                               definition.binsX.at(2));
     }
     // variable X bins
     else{
-      subdir.make<TH1D>(TString(definition.name),
-                        TString(definition.title),
-                        definition.binsX.size() - 1,
-                        definition.binsX.data());
+      return subdir.make<TH1D>(TString(definition.name),
+                               TString(definition.title),
+                               definition.binsX.size() - 1,
+                               definition.binsX.data());
     }
   }
   // book 2D histogram
   else if(definition.dimensions == 2){
     // equal X bins and equal Y bins
     if(!definition.hasVariableBinsX && !definition.hasVariableBinsY){
-      subdir.make<TH2D>(TString(definition.name),
-                        TString(definition.title),
-                        definition.binsX.at(0),
-                        definition.binsX.at(1),
-                        definition.binsX.at(2),
-                        definition.binsY.at(0),
-                        definition.binsY.at(1),
-                        definition.binsY.at(2));
+      return subdir.make<TH2D>(TString(definition.name),
+                               TString(definition.title),
+                               definition.binsX.at(0),
+                               definition.binsX.at(1),
+                               definition.binsX.at(2),
+                               definition.binsY.at(0),
+                               definition.binsY.at(1),
+                               definition.binsY.at(2));
     }
     // variable X bins and equal Y bins
     else if(definition.hasVariableBinsX && !definition.hasVariableBinsY){
-      subdir.make<TH2D>(TString(definition.name),
-                        TString(definition.title),
-                        definition.binsX.size() - 1,
-                        definition.binsX.data(),
-                        definition.binsY.at(0),
-                        definition.binsY.at(1),
-                        definition.binsY.at(2));
+      return subdir.make<TH2D>(TString(definition.name),
+                               TString(definition.title),
+                               definition.binsX.size() - 1,
+                               definition.binsX.data(),
+                               definition.binsY.at(0),
+                               definition.binsY.at(1),
+                               definition.binsY.at(2));
     }
     // equal X bins and variable Y bins
     else if(!definition.hasVariableBinsX && definition.hasVariableBinsY){
-      subdir.make<TH2D>(TString(definition.name),
-                        TString(definition.title),
-                        definition.binsX.at(0),
-                        definition.binsX.at(1),
-                        definition.binsX.at(2),
-                        definition.binsY.size() - 1,
-                        definition.binsY.data());
+      return subdir.make<TH2D>(TString(definition.name),
+                               TString(definition.title),
+                               definition.binsX.at(0),
+                               definition.binsX.at(1),
+                               definition.binsX.at(2),
+                               definition.binsY.size() - 1,
+                               definition.binsY.data());
     }
     // variable X bins and variable Y bins
     else if(definition.hasVariableBinsX && definition.hasVariableBinsY){
-      subdir.make<TH2D>(TString(definition.name),
-                        TString(definition.title),
-                        definition.binsX.size() - 1,
-                        definition.binsX.data(),
-                        definition.binsY.size() - 1,
-                        definition.binsY.data());
+      return subdir.make<TH2D>(TString(definition.name),
+                               TString(definition.title),
+                               definition.binsX.size() - 1,
+                               definition.binsX.data(),
+                               definition.binsY.size() - 1,
+                               definition.binsY.data());
     }
   }
   else{
     cout << "WARNING - invalid histogram dimension" << endl;
-    return;
+    return NULL;
   }
 
+  return NULL;
 }
 
 ////////////////////////////////////////////////////////////////////////
 
 // fill TH1 or TH2 using one collection
-void Plotter::fillHistogram(const HistoDef &definition){
+void Plotter::fillHistogram(const HistoDef &definition, double eventWeight){
 
  if(definition.dimensions == 1){
-   fill1DHistogram(definition);
+   fill1DHistogram(definition, eventWeight);
   }
   else if(definition.dimensions == 2){
-    fill2DHistogram(definition);
+    fill2DHistogram(definition, eventWeight);
   }
   else{
     cout << "WARNING - Histogram dimension error" << endl;
@@ -313,9 +402,14 @@ void Plotter::fillHistogram(const HistoDef &definition){
 ////////////////////////////////////////////////////////////////////////
 
 // fill TH1 using one collection
-void Plotter::fill1DHistogram(const HistoDef &definition){
+void Plotter::fill1DHistogram(const HistoDef &definition, double eventWeight){
 
-  TH1D *histogram = fs_->getObject<TH1D>(definition.name, definition.directory);
+  HistogramBuffer *histogram = definition.buffer;
+  if (!histogram) {
+    clog << "ERROR [Plotter::fill1DHistogram]:  Could not find histogram with name " << definition.name
+	 << " in directory " << definition.directory << endl;
+    return;
+  }
 
   // loop over objects in input collection and fill histogram
   for(vector<Leaf>::const_iterator leaf = definition.valueLookupTrees.at (0)->evaluate ().begin (); leaf != definition.valueLookupTrees.at (0)->evaluate ().end (); leaf++){
@@ -326,11 +420,8 @@ void Plotter::fill1DHistogram(const HistoDef &definition){
     if(definition.hasVariableBinsX){
       weight /= getBinSize(histogram,value);
     }
-    if (handles_.generatorweights.isValid ())
-      weight *= anatools::getGeneratorWeight (*handles_.generatorweights);
-    for (vector<Weight>::iterator sf = weights.begin (); sf != weights.end (); sf++)
-      weight *= sf->product;
-    histogram->Fill(value, weight);
+    weight *= eventWeight;
+    histogram->fill(value, weight);
     if (verbose_) clog << "Filled histogram " << definition.name << " with value=" << value << ", weight=" << weight << endl;
 
   }
@@ -340,11 +431,13 @@ void Plotter::fill1DHistogram(const HistoDef &definition){
 ////////////////////////////////////////////////////////////////////////
 
 // fill TH2 using one collection
-void Plotter::fill2DHistogram(const HistoDef &definition){
+void Plotter::fill2DHistogram(const HistoDef &definition, double eventWeight){
 
-  double weight = 1.0;
-  for (vector<Weight>::iterator sf = weights.begin (); sf != weights.end (); sf++)
-    weight *= sf->product;
+  if (!definition.buffer) {
+    clog << "ERROR [Plotter::fill2DHistogram]:  Could not find histogram with name " << definition.name
+	 << " in directory " << definition.directory << endl;
+    return;
+  }
 
   if (definition.inputCollections.size() == 1) {
     // If there is only one input collection, then fill the 2D histogram once per object.
@@ -356,7 +449,7 @@ void Plotter::fill2DHistogram(const HistoDef &definition){
 	 leafX++, leafY++) {
       double valueX = boost::get<double> (*leafX),
 	valueY = boost::get<double> (*leafY);
-      fill2DHistogram(definition, valueX, valueY, weight);
+      fill2DHistogram(definition, valueX, valueY, eventWeight);
     }
 
   } else {
@@ -366,7 +459,7 @@ void Plotter::fill2DHistogram(const HistoDef &definition){
       for(vector<Leaf>::const_iterator leafY = definition.valueLookupTrees.at (1)->evaluate ().begin (); leafY != definition.valueLookupTrees.at (1)->evaluate ().end (); leafY++){
 	double valueX = boost::get<double> (*leafX),
 	  valueY = boost::get<double> (*leafY);
-	fill2DHistogram(definition, valueX, valueY, weight);
+	fill2DHistogram(definition, valueX, valueY, eventWeight);
       }
     }
   }
@@ -377,12 +470,7 @@ void Plotter::fill2DHistogram(const HistoDef &definition){
 
 void Plotter::fill2DHistogram(const HistoDef & definition, double valueX, double valueY, double weight) {
 
-  TH2D *histogram = fs_->getObject<TH2D>(definition.name, definition.directory);
-  if (!histogram) {
-    clog << "ERROR [Plotter::fill2DHistogram]:  Could not find histogram with name " << definition.name
-	 << " in directory " << definition.directory << endl;
-    return;
-  }
+  HistogramBuffer *histogram = definition.buffer;
   if(IS_INVALID(valueX) || IS_INVALID(valueY))
     return;
   if(definition.hasVariableBinsX){
@@ -391,9 +479,7 @@ void Plotter::fill2DHistogram(const HistoDef & definition, double valueX, double
   if(definition.hasVariableBinsY){
     weight /= getBinSize(histogram,valueX,valueY).second;
   }
-  if (handles_.generatorweights.isValid ())
-    weight *= anatools::getGeneratorWeight (*handles_.generatorweights);
-  histogram->Fill(valueX, valueY, weight);
+  histogram->fill(valueX, valueY, weight);
   if (verbose_) clog << "Filled histogram " << definition.name << " with valueX=" << valueX << ", valueY=" << valueY << ", weight=" << weight << endl;
 
 }
@@ -401,23 +487,24 @@ void Plotter::fill2DHistogram(const HistoDef & definition, double valueX, double
 
 ////////////////////////////////////////////////////////////////////////
 
-double Plotter::getBinSize(TH1D *histogram,
+double Plotter::getBinSize(const HistogramBuffer *histogram,
                            const double value){
 
-  int binIndex = histogram->FindBin(value);
-  double binSize = histogram->GetBinWidth(binIndex);
+  int binIndex = histogram->xAxis().findBin(value);
+  double binSize = histogram->xAxis().binWidth(binIndex);
 
   return binSize;
 
 }
 
-pair<double,double>  Plotter::getBinSize(TH2D *histogram,
+pair<double,double>  Plotter::getBinSize(const HistogramBuffer *histogram,
                                          const double valueX,
                                          const double valueY){
 
-  int binIndex = histogram->FindBin(valueX, valueY);
-  double binSizeX = histogram->GetXaxis()->GetBinWidth(binIndex);
-  double binSizeY = histogram->GetYaxis()->GetBinWidth(binIndex);
+  // each axis is given its own bin number, rather than the global bin number
+  // of the TH2
+  double binSizeX = histogram->xAxis().binWidth(histogram->xAxis().findBin(valueX));
+  double binSizeY = histogram->yAxis().binWidth(histogram->yAxis().findBin(valueY));
 
   return make_pair(binSizeX, binSizeY);
 
@@ -502,7 +589,11 @@ Plotter::initializeValueLookupForest (vector<HistoDef> &histograms, Collections
       if (firstEvent_)
         {
           for (vector<string>::const_iterator inputVariable = histogram->inputVariables.begin (); inputVariable != histogram->inputVariables.end (); inputVariable++)
-            histogram->valueLookupTrees.push_back (new ValueLookupTree (*inputVariable, histogram->inputCollections));
+            {
+              histogram->valueLookupTrees.push_back (new ValueLookupTree (*inputVariable, histogram->inputCollections));
+              histogram->valueLookupTrees.back ()->setUseTreeWalker (useTreeWalker_);
+              histogram->valueLookupTrees.back ()->setInstrumentationLabel (moduleDescription ().moduleLabel (), "histogram", histogram->directory + "/" + histogram->name + ": " + *inputVariable);
+            }
           if (!histogram->valueLookupTrees.back ()->isValid ())
             return false;
         }
@@ -527,6 +618,8 @@ Plotter::initializeValueLookupForest (vector<Weight> &weights, Collections *hand
       if (firstEvent_)
         {
 	  weight->valueLookupTree = new ValueLookupTree (weight->inputVariable, weight->inputCollections);
+	  weight->valueLookupTree->setUseTreeWalker (useTreeWalker_);
+	  weight->valueLookupTree->setInstrumentationLabel (moduleDescription ().moduleLabel (), "weight", weight->inputVariable);
 	  if (!weight->valueLookupTree->isValid ())
 	    return false;
         }
@@ -1,27 +1,45 @@
 #ifndef PLOTTER
 #define PLOTTER
 
+#include <mutex>
 #include <unordered_set>
 
-#include "FWCore/Framework/interface/EDAnalyzer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDAnalyzer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "FWCore/ServiceRegistry/interface/Service.h"
 #include "CommonTools/UtilAlgos/interface/TFileService.h"
 
 #include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
+#include "OSUT3Analysis/AnaTools/interface/HistogramBuffer.h"
 
 #include "TH1.h"
 #include "TH2.h"
 
-class Plotter : public edm::EDAnalyzer
+// Shared by the instances of a Plotter in all streams. It holds the histograms
+// booked with the TFileService, in the order of the histogram definitions, and
+// a buffer for each, to which the buffers of each stream are added when the
+// stream ends. The sums are added into the histograms at the end of the job.
+struct PlotterCache
+{
+  vector<TH1 *> histograms;
+  mutable vector<HistogramBuffer> buffers;
+  mutable mutex mutex_;
+};
+
+class Plotter : public edm::stream::EDAnalyzer<edm::GlobalCache<PlotterCache> >
 {
     public:
 
-      Plotter (const edm::ParameterSet &);
+      Plotter (const edm::ParameterSet &, const PlotterCache *);
       ~Plotter ();
+
+      static unique_ptr<PlotterCache> initializeGlobalCache (const edm::ParameterSet &);
+      static void globalEndJob (const PlotterCache *);
+
       void analyze(const edm::Event&, const edm::EventSetup&);
+      void endStream();
 
     private:
 
@@ -29,16 +47,16 @@ class Plotter : public edm::EDAnalyzer
       vector<edm::ParameterSet> weightDefs_;
       vector<edm::ParameterSet> histogramSets_;
       int verbose_;
+      bool useTreeWalker_;
       bool firstEvent_;
 
       //Collections
       Collections handles_;
+      CollectionTokens tokens_;
 
       bool initializeValueLookupForest (vector<HistoDef> &, Collections *);
       bool initializeValueLookupForest (vector<Weight> &, Collections *);
 
-      edm::Service<TFileService> fs_;
-
       unordered_set<string> objectsToGet_;
 
       vector<TFileDirectory> subDirs;
@@ -47,24 +65,25 @@ class Plotter : public edm::EDAnalyzer
 
       vector<Weight> weights;
 
-      string getDirectoryName(const string);
+      static void parseHistogramSets(const vector<edm::ParameterSet> &, vector<HistoDef> &, unordered_set<string> &, const bool);
+      static string getDirectoryName(const string);
       vector<string> getInputTypes(const string);
       string fixOrdering(const string);
-      HistoDef parseHistoDef(const edm::ParameterSet &, const vector<string> &, const string &, const string &);
-      void bookHistogram(const HistoDef);
+      static HistoDef parseHistoDef(const edm::ParameterSet &, const vector<string> &, const string &, const string &);
+      static TH1 *bookHistogram(const HistoDef);
       pair<string,string> getVariableAndFunction(const string);
 
       template <class InputCollection> void fillHistogram(const HistoDef, const InputCollection);
       template <class InputCollection1, class InputCollection2> void fillHistogram(const HistoDef, const InputCollection1, const InputCollection2);
 
-      void fillHistogram(const HistoDef &);
-      void fill1DHistogram(const HistoDef &);
-      void fill2DHistogram(const HistoDef &);
-      void fill2DHistogram(const HistoDef & definition, double valueX, double valueY, double weight); 
+      void fillHistogram(const HistoDef &, double);
+      void fill1DHistogram(const HistoDef &, double);
+      void fill2DHistogram(const HistoDef &, double);
+      void fill2DHistogram(const HistoDef & definition, double valueX, double valueY, double weight);
 
-      double getBinSize(TH1D *, const double);
-      pair<double,double> getBinSize(TH2D *, const double, const double);
-      string setYaxisLabel(const HistoDef);
+      double getBinSize(const HistogramBuffer *, const double);
+      pair<double,double> getBinSize(const HistogramBuffer *, const double, const double);
+      static string setYaxisLabel(const HistoDef);
 
 
 
@@ -2,7 +2,8 @@
 
 TriggerEfficiencyAnalyzer::TriggerEfficiencyAnalyzer (const edm::ParameterSet &cfg) :
   Trigger_ (cfg.getParameter<edm::InputTag> ("Trigger")),
-  triggers_  (cfg.getParameter<vector<edm::ParameterSet> >("triggers"))
+  triggers_  (cfg.getParameter<vector<edm::ParameterSet> >("triggers")),
+  hasTriggerPathIndices_ (false)
 {
 
   timer = new TStopwatch();
@@ -38,6 +39,7 @@ TriggerEfficiencyAnalyzer::TriggerEfficiencyAnalyzer (const edm::ParameterSet &c
     TriggerHistEffMap  [*triggerType]->GetXaxis()->SetBinLabel (nTriggers+2,"OR of All Triggers");
     effName.ReplaceAll("Eff", " trigger efficiency");
     TriggerHistEffMap  [*triggerType]->SetTitle(effName);
+    triggerHistograms_.push_back(TriggerHistogramMap[*triggerType]);
   }
 
 }
@@ -75,43 +77,54 @@ TriggerEfficiencyAnalyzer::analyze (const edm::Event &event, const edm::EventSet
   event.getByLabel (Trigger_ , TriggerCollection);
   const edm::TriggerNames &triggerNames = event.triggerNames(*TriggerCollection);
 
-  //initialize maps
-  for(std::vector<string>::const_iterator triggerType = TriggerTypes.begin(); triggerType != TriggerTypes.end(); triggerType++){
-    InclusiveORMap[*triggerType] = false;
-  }
+  //the trigger names are only matched against the paths when the menu changes
+  if (!hasTriggerPathIndices_ || !(triggerMenu_ == triggerNames.parameterSetID()))
+    findTriggerPathIndices(triggerNames);
 
-  int nEvts = 0;
-  //fill denominator bin for all trigger types that match generated final state
-  for(std::vector<string>::const_iterator triggerType = TriggerTypes.begin(); triggerType != TriggerTypes.end(); triggerType++) {
-    TriggerHistogramMap[*triggerType]->Fill(0) ;
-    nEvts++;
-  }
+  for (uint iType=0; iType<TriggerTypes.size(); iType++) {
+    TH1D* h = triggerHistograms_.at(iType);
 
+    //fill denominator bin
+    h->Fill(0);
 
-  //loop over all trigger paths in the event
-  for (unsigned triggerIndex = 0; triggerIndex < triggerNames.size (); triggerIndex++){
-    string name = triggerNames.triggerName(triggerIndex);
-    bool pass = TriggerCollection->accept(triggerIndex);
-    if(pass != 1) continue;
-
-    //loop over the different types of triggers of interest
-    for(std::vector<string>::const_iterator triggerType = TriggerTypes.begin(); triggerType != TriggerTypes.end(); triggerType++){
-      //loop over the different trigger names as specified by the user
-      for(std::vector<string>::const_iterator triggerName = TriggerNameMap[*triggerType].begin(); triggerName != TriggerNameMap[*triggerType].end(); triggerName++){
-        if(name.find(*triggerName)!=std::string::npos){
-	  //	  cout << name << "  " << *triggerName << " " << name.find(*triggerName) << endl;
-          TriggerHistogramMap[*triggerType]->Fill(triggerName-TriggerNameMap[*triggerType].begin()+1);
-          InclusiveORMap[*triggerType] = true;
+    //fill the bin of each trigger name once for each passing path which contains it
+    bool inclusiveOR = false;
+    const vector<vector<unsigned> > &pathIndices = triggerPathIndices_.at(iType);
+    for (uint iTrig=0; iTrig<pathIndices.size(); iTrig++) {
+      for (uint iPath=0; iPath<pathIndices.at(iTrig).size(); iPath++) {
+        if (TriggerCollection->accept(pathIndices.at(iTrig).at(iPath))) {
+          h->Fill(iTrig+1);
+          inclusiveOR = true;
         }
       }
     }
+
+    //fill final bin if any triggers were passed
+    if (inclusiveOR) h->Fill(pathIndices.size()+1);
   }
-  //fill final bin if any triggers were passed
-  for(std::vector<string>::const_iterator triggerType = TriggerTypes.begin(); triggerType != TriggerTypes.end(); triggerType++)
-    if(InclusiveORMap[*triggerType]) TriggerHistogramMap[*triggerType]->Fill(TriggerNameMap[*triggerType].size()+1);
 
 } // void TriggerEfficiencyAnalyzer::analyze (const edm::Event &event, const edm::EventSetup &setup)
 
+void
+TriggerEfficiencyAnalyzer::findTriggerPathIndices (const edm::TriggerNames &triggerNames)
+{
+
+  triggerPathIndices_.assign(TriggerTypes.size(), vector<vector<unsigned> > ());
+  for (uint iType=0; iType<TriggerTypes.size(); iType++) {
+    const vector<string> &names = TriggerNameMap[TriggerTypes.at(iType)];
+    triggerPathIndices_.at(iType).resize(names.size());
+    for (unsigned triggerIndex = 0; triggerIndex < triggerNames.size (); triggerIndex++){
+      const string &name = triggerNames.triggerName(triggerIndex);
+      for (uint iTrig=0; iTrig<names.size(); iTrig++)
+        if (name.find(names.at(iTrig))!=std::string::npos)
+          triggerPathIndices_.at(iType).at(iTrig).push_back(triggerIndex);
+    }
+  }
+  triggerMenu_ = triggerNames.parameterSetID();
+  hasTriggerPathIndices_ = true;
+
+}
+
 
 DEFINE_FWK_MODULE(TriggerEfficiencyAnalyzer);
 
@@ -18,6 +18,7 @@
 #include "FWCore/Framework/interface/MakerMacros.h"
 
 #include "DataFormats/Common/interface/TriggerResults.h"
+#include "DataFormats/Provenance/interface/ParameterSetID.h"
 #include "FWCore/Common/interface/TriggerNames.h"
 
 using namespace std;
@@ -32,7 +33,6 @@ class TriggerEfficiencyAnalyzer : public edm::EDAnalyzer
       std::map< string, std::vector<string> > TriggerNameMap;
       std::map< string, TH1D* > TriggerHistogramMap;
       std::map< string, TH1D* > TriggerHistEffMap;
-      std::map< string, bool > InclusiveORMap;
 
       void analyze (const edm::Event &, const edm::EventSetup &);
       const edm::Service<TFileService> fs;
@@ -43,6 +43,18 @@ class TriggerEfficiencyAnalyzer : public edm::EDAnalyzer
       vector<edm::ParameterSet> triggers_;
       TStopwatch* timer;
 
+      // The histogram of each trigger type, in the order of TriggerTypes.
+      vector<TH1D*> triggerHistograms_;
+
+      // Indices of the trigger paths whose names contain each trigger name,
+      // for each trigger type, in the menu with the given ID. These are only
+      // found again when the menu changes.
+      edm::ParameterSetID triggerMenu_;
+      bool hasTriggerPathIndices_;
+      vector<vector<vector<unsigned> > > triggerPathIndices_;
+
+      void findTriggerPathIndices (const edm::TriggerNames &);
+
   };
 
 #endif
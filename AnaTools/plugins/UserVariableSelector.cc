@@ -0,0 +1,70 @@
+#include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/plugins/UserVariableSelector.h"
+
+UserVariableSelector::UserVariableSelector (const edm::ParameterSet &cfg) :
+  collections_ (cfg.getParameter<edm::ParameterSet> ("collections"))
+{
+  assert (strcmp (PROJECT_VERSION, SUPPORTED_VERSION) == 0);
+
+  // The selections are always consumed along with the payloads.
+  objectsToGet_.insert ("uservariables");
+  anatools::getCollectionTokens (objectsToGet_, collections_, tokens_, consumesCollector ());
+
+  produces<VariableProducerPayload> ("uservariables");
+}
+
+UserVariableSelector::~UserVariableSelector ()
+{
+}
+
+void
+UserVariableSelector::produce (edm::Event &event, const edm::EventSetup &setup)
+{
+  anatools::getRequiredCollections (tokens_, handles_, event);
+
+  pl_ = auto_ptr<VariableProducerPayload> (new VariableProducerPayload);
+#if IS_VALID(uservariables)
+  //////////////////////////////////////////////////////////////////////////////
+  // Each variable is copied in the order in which the payloads and their
+  // variables are given, so a variable which appears in more than one payload
+  // is found in the same one as before. For the variables of a collection
+  // with a selection, element i of the new values is the value for the object
+  // with index selection[i] in the unfiltered collection. Variables of the
+  // other collections are copied as they are.
+  //////////////////////////////////////////////////////////////////////////////
+  for (const auto &handle : handles_.uservariables)
+    {
+      if (!handle.isValid ())
+        continue;
+      const VariableProducerPayload &payload = *handle;
+      for (unsigned i = 0; i < payload.names.size (); i++)
+        {
+          const vector<double> &values = payload.values.at (i);
+          auto selection = handles_.selections.find (payload.collections.at (i));
+
+          pl_->collections.push_back (payload.collections.at (i));
+          pl_->names.push_back (payload.names.at (i));
+          pl_->values.push_back (vector<double> ());
+          if (selection == handles_.selections.end () || !selection->second.isValid ())
+            {
+              pl_->values.back () = values;
+              continue;
+            }
+          if (values.empty ())
+            continue;
+
+          vector<double> &selectedValues = pl_->values.back ();
+          selectedValues.reserve (selection->second->size ());
+          for (const auto &iObject : *selection->second)
+            selectedValues.push_back (iObject < values.size () ? values[iObject] : INVALID_VALUE);
+        }
+    }
+  //////////////////////////////////////////////////////////////////////////////
+#endif
+
+  event.put (pl_, "uservariables");
+  pl_.reset ();
+}
+
+#include "FWCore/Framework/interface/MakerMacros.h"
+DEFINE_FWK_MODULE(UserVariableSelector);
@@ -0,0 +1,44 @@
+#ifndef USER_VARIABLE_SELECTOR
+#define USER_VARIABLE_SELECTOR
+
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
+
+// Merges the payloads of all the VariableProducers into one, in which the
+// values of the variables of each filtered collection are only kept for the
+// selected objects, in the order of the selection. The indices of the objects
+// in the payload then match the filtered copies of the collections written to
+// a skim by the object selectors.
+class UserVariableSelector : public edm::stream::EDProducer<>
+{
+  public:
+    UserVariableSelector (const edm::ParameterSet &);
+    ~UserVariableSelector ();
+
+    void produce (edm::Event &, const edm::EventSetup &);
+
+  private:
+    ////////////////////////////////////////////////////////////////////////////
+    // Private variables initialized by the constructor.
+    ////////////////////////////////////////////////////////////////////////////
+    edm::ParameterSet      collections_;
+    unordered_set<string>  objectsToGet_;
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the payloads and the selections, and the handles to which
+    // they are retrieved.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionTokens  tokens_;
+    Collections       handles_;
+    ////////////////////////////////////////////////////////////////////////////
+
+    // Payload for this EDProducer.
+    auto_ptr<VariableProducerPayload> pl_;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include <algorithm>
+
+#include "OSUT3Analysis/AnaTools/interface/BinnedLookup.h"
+
+BinnedAxis::BinnedAxis () :
+  nBins_       (0),
+  min_         (0.0),
+  max_         (0.0),
+  fixedWidth_  (true),
+  policy_      (USE_OVERFLOW)
+{
+}
+
+BinnedAxis::BinnedAxis (const TAxis &axis, OutOfRangePolicy policy) :
+  nBins_       (axis.GetNbins ()),
+  min_         (axis.GetXmin ()),
+  max_         (axis.GetXmax ()),
+  fixedWidth_  (!axis.GetXbins ()->GetSize ()),
+  policy_      (policy)
+{
+  if (!fixedWidth_)
+    edges_.assign (axis.GetXbins ()->GetArray (), axis.GetXbins ()->GetArray () + nBins_ + 1);
+}
+
+int
+BinnedAxis::findBin (double x) const
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // The bin is found the same way as in TAxis::FindFixBin, so that the results
+  // are identical to those from the histogram, even for values on a bin edge.
+  //////////////////////////////////////////////////////////////////////////////
+  int bin;
+  if (x < min_)
+    bin = 0;
+  else if (!(x < max_))
+    bin = nBins_ + 1;
+  else if (fixedWidth_)
+    bin = 1 + int (nBins_ * (x - min_) / (max_ - min_));
+  else
+    bin = upper_bound (edges_.begin (), edges_.end (), x) - edges_.begin ();
+  //////////////////////////////////////////////////////////////////////////////
+
+  if (policy_ == CLAMP)
+    bin = max (min (bin, nBins_), 1);
+  return bin;
+}
+
+int
+BinnedAxis::nBins () const
+{
+  return nBins_;
+}
+
+double
+BinnedAxis::binLowEdge (int bin) const
+{
+  // As in TAxis::GetBinLowEdge, including for bins outside of the axis.
+  if (!fixedWidth_ && bin > 0 && bin <= nBins_ + 1)
+    return edges_[bin - 1];
+  return min_ + (bin - 1) * ((max_ - min_) / nBins_);
+}
+
+double
+BinnedAxis::binUpEdge (int bin) const
+{
+  // As in TAxis::GetBinUpEdge, including for bins outside of the axis.
+  if (!fixedWidth_ && bin > 0 && bin <= nBins_)
+    return edges_[bin];
+  return min_ + bin * ((max_ - min_) / nBins_);
+}
+
+double
+BinnedAxis::binWidth (int bin) const
+{
+  // As in TAxis::GetBinWidth, which uses the first or last bin for bins
+  // outside of the axis.
+  if (nBins_ <= 0)
+    return 0.0;
+  if (fixedWidth_)
+    return (max_ - min_) / nBins_;
+  bin = max (min (bin, nBins_), 1);
+  return edges_[bin] - edges_[bin - 1];
+}
+
+BinnedLookup1D::BinnedLookup1D ()
+{
+}
+
+BinnedLookup1D::BinnedLookup1D (const TH1 &h, BinnedAxis::OutOfRangePolicy policy) :
+  axis_ (*h.GetXaxis (), policy)
+{
+  for (int bin = 0; bin <= axis_.nBins () + 1; bin++)
+    {
+      values_.push_back (h.GetBinContent (bin));
+      errors_.push_back (h.GetBinError (bin));
+    }
+}
+
+void
+BinnedLookup1D::at (const vector<double> &x, vector<double> &values, vector<double> *errors) const
+{
+  values.resize (x.size ());
+  if (errors)
+    errors->resize (x.size ());
+  for (unsigned i = 0; i < x.size (); i++)
+    {
+      int bin = findBin (x[i]);
+      values[i] = values_[bin];
+      if (errors)
+        (*errors)[i] = errors_[bin];
+    }
+}
+
+BinnedLookup2D::BinnedLookup2D ()
+{
+}
+
+BinnedLookup2D::BinnedLookup2D (const TH2 &h, BinnedAxis::OutOfRangePolicy policy) :
+  xAxis_ (*h.GetXaxis (), policy),
+  yAxis_ (*h.GetYaxis (), policy)
+{
+  for (int bin = 0; bin < (xAxis_.nBins () + 2) * (yAxis_.nBins () + 2); bin++)
+    {
+      values_.push_back (h.GetBinContent (bin));
+      errors_.push_back (h.GetBinError (bin));
+    }
+}
+
+void
+BinnedLookup2D::at (const vector<double> &x, const vector<double> &y, vector<double> &values, vector<double> *errors) const
+{
+  values.resize (x.size ());
+  if (errors)
+    errors->resize (x.size ());
+  for (unsigned i = 0; i < x.size (); i++)
+    {
+      int bin = findBin (x[i], y.at (i));
+      values[i] = values_[bin];
+      if (errors)
+        (*errors)[i] = errors_[bin];
+    }
+}
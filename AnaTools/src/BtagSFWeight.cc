@@ -8,12 +8,69 @@ bool BtagSFWeight::filter(int t, int minTags)
 
 
 double BtagSFWeight::weight(vector<double> jets, int minTags)
+{
+  // Probability distribution of the number of tagged jets, built up one jet at
+  // a time, where the last bin holds the probability of at least minTags
+  // tagged jets. This is O(njets * minTags) instead of summing over all
+  // 2^njets tag configurations.
+  if(minTags < 0)
+    minTags = 0;
+  vector<double> p(minTags + 1, 0.);
+  p[0] = 1.;
+  for(unsigned j=0;j<jets.size();j++){
+    p[minTags] += (minTags > 0 ? p[minTags - 1] * jets[j] : 0.);
+    for(int k=minTags-1;k>0;k--)
+      p[k] = p[k] * (1. - jets[j]) + p[k - 1] * jets[j];
+    if(minTags > 0)
+      p[0] *= (1. - jets[j]);
+  }
+
+  double pMC = p[minTags];
+  if( pMC > 0)
+      return pMC;
+  else{
+     pMC = 1;
+     return pMC;
+     }
+}
+
+vector<double> BtagSFWeight::weight(const vector<vector<double> > &jets, int minTags)
+{
+  // Same as above, with the distribution for every set of probabilities
+  // updated in the same pass over the jets.
+  if(minTags < 0)
+    minTags = 0;
+  unsigned nSets = (jets.empty() ? 0 : jets[0].size());
+  vector<vector<double> > p(nSets, vector<double> (minTags + 1, 0.));
+  for(unsigned s=0;s<nSets;s++)
+    p[s][0] = 1.;
+  for(unsigned j=0;j<jets.size();j++){
+    for(unsigned s=0;s<nSets;s++){
+      double e = jets[j].at(s);
+      vector<double> &ps = p[s];
+      ps[minTags] += (minTags > 0 ? ps[minTags - 1] * e : 0.);
+      for(int k=minTags-1;k>0;k--)
+        ps[k] = ps[k] * (1. - e) + ps[k - 1] * e;
+      if(minTags > 0)
+        ps[0] *= (1. - e);
+    }
+  }
+
+  vector<double> pMC(nSets, 1.);
+  for(unsigned s=0;s<nSets;s++){
+    if(p[s][minTags] > 0)
+      pMC[s] = p[s][minTags];
+  }
+  return pMC;
+}
+
+double BtagSFWeight::weightBruteForce(const vector<double> &jets, int minTags)
 {
   int njets=jets.size();
-  int comb= 1 << njets;
-  float pMC=0;
-  for(int i=0;i < comb; i++){
-    float mc=1.;
+  long comb= 1L << njets;
+  double pMC=0;
+  for(long i=0;i < comb; i++){
+    double mc=1.;
     int ntagged=0;
     for(int j=0;j<njets;j++){
       bool tagged = ((i >> j) & 0x1) == 1;
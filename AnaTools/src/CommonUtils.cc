@@ -1,4 +1,9 @@
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/ValueCache.h"
 
 /**
  * Splits the concatenated object label into a vector of individual labels.
@@ -121,6 +126,49 @@ anatools::trim (string &s)
   return ltrim (rtrim (s));
 }
 
+/**
+ * Quotes a string for JSON output without modifying the original string.
+ *
+ * @param  s string to quote
+ * @return string in double quotes, with the characters which are not allowed
+ *         inside of a string in JSON escaped
+ */
+string
+anatools::jsonString (const string &s)
+{
+  stringstream quoted;
+  quoted << "\"";
+  for (const auto &c : s)
+    {
+      if (c == '"' || c == '\\')
+        quoted << '\\' << c;
+      else if (c == '\n')
+        quoted << "\\n";
+      else if (c == '\t')
+        quoted << "\\t";
+      else if ((unsigned char) c < 0x20)
+        quoted << "\\u" << hex << setw (4) << setfill ('0') << (int) c << dec;
+      else
+        quoted << c;
+    }
+  quoted << "\"";
+
+  return quoted.str ();
+}
+
+/**
+ * Checks whether an expression looks up any user variables, which are filled
+ * by the VariableProducers and are not an input collection of the expression.
+ *
+ * @param  expression cut string, histogram variable, etc., to check
+ * @return true if the expression contains "uservariable."
+ */
+bool
+anatools::usesUserVariables (const string &expression)
+{
+  return (expression.find ("uservariable.") != string::npos);
+}
+
 /**
  * Returns whether the first members of the tuples are in ascending order.
  *
@@ -175,6 +223,72 @@ anatools::collectionIndexAscending (pair<string, DressedObject> a, pair<string,
   return (a.second.collectionIndex < b.second.collectionIndex);
 }
 
+namespace
+{
+  // Whether the first call to getRequiredCollections has yet to be made. This
+  // is shared by all the modules, which may be running concurrently.
+  atomic<bool> firstEvent (true);
+
+  // Declares a collection as being consumed and stores the token for it.
+  template <class T> void
+  getCollectionToken (const edm::InputTag &label, CollectionToken<T> &token, edm::ConsumesCollector &iC)
+  {
+    token = anatools::consumeCollection<T> (label, edm::ConsumesCollector (iC));
+  }
+
+  // Prints an INFO message for each collection which was not retrieved.
+  void
+  printMissingCollections (const Collections &handles)
+  {
+    clog << "Will print any collections not retrieved.  These INFO messages may be safely ignored." << endl;
+    if (!handles.beamspots.isValid ())
+      clog << "INFO: did not retrieve beamspots collection from the event." << endl;
+    if (!handles.bxlumis.isValid ())
+      clog << "INFO: did not retrieve bxlumis collection from the event." << endl;
+    if (!handles.electrons.isValid ())
+      clog << "INFO: did not retrieve electrons collection from the event." << endl;
+    if (!handles.events.isValid ())
+      clog << "INFO: did not retrieve events collection from the event." << endl;
+    if (!handles.genjets.isValid ())
+      clog << "INFO: did not retrieve genjets collection from the event." << endl;
+    if (!handles.jets.isValid ())
+      clog << "INFO: did not retrieve jets collection from the event." << endl;
+    if (!handles.bjets.isValid ())
+      clog << "INFO: did not retrieve bjets collection from the event." << endl;
+    if (!handles.basicjets.isValid ())
+      clog << "INFO: did not retrieve basicjets collection from the event." << endl;
+    if (!handles.generatorweights.isValid ())
+      clog << "INFO: did not retrieve generatorweights collection from the event." << endl;
+    if (!handles.mcparticles.isValid ())
+      clog << "INFO: did not retrieve mcparticles collection from the event." << endl;
+    if (!handles.mets.isValid ())
+      clog << "INFO: did not retrieve mets collection from the event." << endl;
+    if (!handles.muons.isValid ())
+      clog << "INFO: did not retrieve muons collection from the event." << endl;
+    if (!handles.photons.isValid ())
+      clog << "INFO: did not retrieve photons collection from the event." << endl;
+    if (!handles.primaryvertexs.isValid ())
+      clog << "INFO: did not retrieve primaryvertexs collection from the event." << endl;
+    if (!handles.prescales.isValid ())
+      clog << "INFO: did not retrieve prescales collection from the event." << endl;
+    if (!handles.superclusters.isValid ())
+      clog << "INFO: did not retrieve superclusters collection from the event." << endl;
+    if (!handles.taus.isValid ())
+      clog << "INFO: did not retrieve taus collection from the event." << endl;
+    if (!handles.tracks.isValid ())
+      clog << "INFO: did not retrieve tracks collection from the event." << endl;
+    if (!handles.pileupinfos.isValid ())
+      clog << "INFO: did not retrieve pileupinfos collection from the event." << endl;
+    if (!handles.triggers.isValid ())
+      clog << "INFO: did not retrieve triggers collection from the event." << endl;
+    if (!handles.trigobjs.isValid ())
+      clog << "INFO: did not retrieve trigobjs collection from the event." << endl;
+    for (const auto &selection : handles.selections)
+      if (!selection.second.isValid ())
+        clog << "INFO: did not retrieve selection of " << selection.first << " collection from the event." << endl;
+  }
+}
+
 /**
  * Retrieves all required collections from the event.
  *
@@ -189,7 +303,10 @@ anatools::collectionIndexAscending (pair<string, DressedObject> a, pair<string,
 void
 anatools::getRequiredCollections (const unordered_set<string> &objectsToGet, const edm::ParameterSet &collections, Collections &handles, const edm::Event &event)
 {
-  static bool firstEvent = true;
+  // Values cached by ValueLookupTree objects are only valid for one event.
+  handles.stream = event.streamID ().value ();
+  handles.run = event.id ().run ();
+  ValueCache::get (handles.stream).setEvent (event.id ());
 
   //////////////////////////////////////////////////////////////////////////////
   // Retrieve each object collection which we need and print a warning if it is
@@ -228,63 +345,165 @@ anatools::getRequiredCollections (const unordered_set<string> &objectsToGet, con
   if  (VEC_CONTAINS  (objectsToGet,  "eventvariables")   &&  collections.exists  ("eventvariables"))
     {
       handles.eventvariables.clear ();
+      handles.eventvariableNames.clear ();
       for (const auto &collection : collections.getParameter<vector<edm::InputTag> >  ("eventvariables"))
         {
           handles.eventvariables.resize (handles.eventvariables.size () + 1);
           getCollection (collection, handles.eventvariables.back (), event);
+          handles.eventvariableNames.resize (handles.eventvariableNames.size () + 1);
+          event.getRun ().getByLabel (collection, handles.eventvariableNames.back ());
         }
     }
+  if  (collections.exists  ("selections"))
+    {
+      const edm::ParameterSet &selections = collections.getParameter<edm::ParameterSet> ("selections");
+      for (const auto &name : selections.getParameterNamesForType<edm::InputTag> ())
+        if (VEC_CONTAINS (objectsToGet, name))
+          event.getByLabel (selections.getParameter<edm::InputTag> (name), handles.selections[name]);
+    }
 
 
 
 
-  if (firstEvent)
-    clog << "Will print any collections not retrieved.  These INFO messages may be safely ignored." << endl;
-  if (firstEvent && !handles.beamspots.isValid ())
-    clog << "INFO: did not retrieve beamspots collection from the event." << endl;
-  if (firstEvent && !handles.bxlumis.isValid ())
-    clog << "INFO: did not retrieve bxlumis collection from the event." << endl;
-  if (firstEvent && !handles.electrons.isValid ())
-    clog << "INFO: did not retrieve electrons collection from the event." << endl;
-  if (firstEvent && !handles.events.isValid ())
-    clog << "INFO: did not retrieve events collection from the event." << endl;
-  if (firstEvent && !handles.genjets.isValid ())
-    clog << "INFO: did not retrieve genjets collection from the event." << endl;
-  if (firstEvent && !handles.jets.isValid ())
-    clog << "INFO: did not retrieve jets collection from the event." << endl;
-  if (firstEvent && !handles.bjets.isValid ())
-    clog << "INFO: did not retrieve bjets collection from the event." << endl;
-  if (firstEvent && !handles.basicjets.isValid ())
-    clog << "INFO: did not retrieve basicjets collection from the event." << endl;
-  if (firstEvent && !handles.generatorweights.isValid ())
-    clog << "INFO: did not retrieve generatorweights collection from the event." << endl;
-  if (firstEvent && !handles.mcparticles.isValid ())
-    clog << "INFO: did not retrieve mcparticles collection from the event." << endl;
-  if (firstEvent && !handles.mets.isValid ())
-    clog << "INFO: did not retrieve mets collection from the event." << endl;
-  if (firstEvent && !handles.muons.isValid ())
-    clog << "INFO: did not retrieve muons collection from the event." << endl;
-  if (firstEvent && !handles.photons.isValid ())
-    clog << "INFO: did not retrieve photons collection from the event." << endl;
-  if (firstEvent && !handles.primaryvertexs.isValid ())
-    clog << "INFO: did not retrieve primaryvertexs collection from the event." << endl;
-  if (firstEvent && !handles.prescales.isValid ())
-    clog << "INFO: did not retrieve prescales collection from the event." << endl;
-  if (firstEvent && !handles.superclusters.isValid ())
-    clog << "INFO: did not retrieve superclusters collection from the event." << endl;
-  if (firstEvent && !handles.taus.isValid ())
-    clog << "INFO: did not retrieve taus collection from the event." << endl;
-  if (firstEvent && !handles.tracks.isValid ())
-    clog << "INFO: did not retrieve tracks collection from the event." << endl;
-  if (firstEvent && !handles.pileupinfos.isValid ())
-    clog << "INFO: did not retrieve pileupinfos collection from the event." << endl;
-  if (firstEvent && !handles.triggers.isValid ())
-    clog << "INFO: did not retrieve triggers collection from the event." << endl;
-  if (firstEvent && !handles.trigobjs.isValid ())
-    clog << "INFO: did not retrieve trigobjs collection from the event." << endl;
+  if (firstEvent.exchange (false))
+    printMissingCollections (handles);
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+/**
+ * Declares all required collections as being consumed by a module.
+ *
+ * @param  objectsToGet set of strings specifying which collections are
+ *         required
+ * @param  collections edm::ParameterSet giving the input tags for the
+ *         collections
+ * @param  tokens structure containing the tokens in which to store the result
+ *         for each collection
+ * @param  iC edm::ConsumesCollector of the module
+ */
+void
+anatools::getCollectionTokens (const unordered_set<string> &objectsToGet, const edm::ParameterSet &collections, CollectionTokens &tokens, edm::ConsumesCollector &&iC)
+{
+  if  (VEC_CONTAINS  (objectsToGet,  "beamspots")         &&  collections.exists  ("beamspots"))          getCollectionToken  (collections.getParameter<edm::InputTag>  ("beamspots"),          tokens.beamspots,          iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "bxlumis")           &&  collections.exists  ("bxlumis"))            getCollectionToken  (collections.getParameter<edm::InputTag>  ("bxlumis"),            tokens.bxlumis,            iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "electrons")         &&  collections.exists  ("electrons"))          getCollectionToken  (collections.getParameter<edm::InputTag>  ("electrons"),          tokens.electrons,          iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "events")            &&  collections.exists  ("events"))             getCollectionToken  (collections.getParameter<edm::InputTag>  ("events"),             tokens.events,             iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "genjets")           &&  collections.exists  ("genjets"))            getCollectionToken  (collections.getParameter<edm::InputTag>  ("genjets"),            tokens.genjets,            iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "jets")              &&  collections.exists  ("jets"))               getCollectionToken  (collections.getParameter<edm::InputTag>  ("jets"),               tokens.jets,               iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "bjets")             &&  collections.exists  ("bjets"))              getCollectionToken  (collections.getParameter<edm::InputTag>  ("bjets"),              tokens.bjets,              iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "basicjets")         &&  collections.exists  ("basicjets"))          getCollectionToken  (collections.getParameter<edm::InputTag>  ("basicjets"),          tokens.basicjets,          iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "generatorweights")  &&  collections.exists  ("generatorweights"))   getCollectionToken  (collections.getParameter<edm::InputTag>  ("generatorweights"),   tokens.generatorweights,   iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "mcparticles")       &&  collections.exists  ("mcparticles"))        getCollectionToken  (collections.getParameter<edm::InputTag>  ("mcparticles"),        tokens.mcparticles,        iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "mets")              &&  collections.exists  ("mets"))               getCollectionToken  (collections.getParameter<edm::InputTag>  ("mets"),               tokens.mets,               iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "muons")             &&  collections.exists  ("muons"))              getCollectionToken  (collections.getParameter<edm::InputTag>  ("muons"),              tokens.muons,              iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "photons")           &&  collections.exists  ("photons"))            getCollectionToken  (collections.getParameter<edm::InputTag>  ("photons"),            tokens.photons,            iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "prescales")         &&  collections.exists  ("prescales"))          getCollectionToken  (collections.getParameter<edm::InputTag>  ("prescales"),          tokens.prescales,          iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "primaryvertexs")    &&  collections.exists  ("primaryvertexs"))     getCollectionToken  (collections.getParameter<edm::InputTag>  ("primaryvertexs"),     tokens.primaryvertexs,     iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "superclusters")     &&  collections.exists  ("superclusters"))      getCollectionToken  (collections.getParameter<edm::InputTag>  ("superclusters"),      tokens.superclusters,      iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "taus")              &&  collections.exists  ("taus"))               getCollectionToken  (collections.getParameter<edm::InputTag>  ("taus"),               tokens.taus,               iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "tracks")            &&  collections.exists  ("tracks"))             getCollectionToken  (collections.getParameter<edm::InputTag>  ("tracks"),             tokens.tracks,             iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "pileupinfos")       &&  collections.exists  ("pileupinfos"))        getCollectionToken  (collections.getParameter<edm::InputTag>  ("pileupinfos"),        tokens.pileupinfos,        iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "triggers")          &&  collections.exists  ("triggers"))           getCollectionToken  (collections.getParameter<edm::InputTag>  ("triggers"),           tokens.triggers,           iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "trigobjs")          &&  collections.exists  ("trigobjs"))           getCollectionToken  (collections.getParameter<edm::InputTag>  ("trigobjs"),           tokens.trigobjs,           iC);
+  if  (VEC_CONTAINS  (objectsToGet,  "uservariables")     &&  collections.exists  ("uservariables"))
+    {
+      tokens.uservariables.clear ();
+      for (const auto &collection : collections.getParameter<vector<edm::InputTag> >  ("uservariables"))
+        {
+          tokens.uservariables.resize (tokens.uservariables.size () + 1);
+          getCollectionToken (collection, tokens.uservariables.back (), iC);
+        }
+    }
+  if  (VEC_CONTAINS  (objectsToGet,  "eventvariables")   &&  collections.exists  ("eventvariables"))
+    {
+      tokens.eventvariables.clear ();
+      tokens.eventvariableNames.clear ();
+      for (const auto &collection : collections.getParameter<vector<edm::InputTag> >  ("eventvariables"))
+        {
+          tokens.eventvariables.resize (tokens.eventvariables.size () + 1);
+          getCollectionToken (collection, tokens.eventvariables.back (), iC);
+          tokens.eventvariableNames.push_back (iC.consumes<vector<string>, edm::InRun> (collection));
+        }
+    }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Collections given with a selection are read through the indices of the
+  // selected objects, which are declared here for each such collection which
+  // is required. Unlike the collections, the selections are never searched
+  // for by type, since any vector of indices would match.
   //////////////////////////////////////////////////////////////////////////////
+  tokens.selections.clear ();
+  if  (collections.exists  ("selections"))
+    {
+      const edm::ParameterSet &selections = collections.getParameter<edm::ParameterSet> ("selections");
+      for (const auto &name : selections.getParameterNamesForType<edm::InputTag> ())
+        if (VEC_CONTAINS (objectsToGet, name))
+          tokens.selections[name] = iC.consumes<vector<unsigned> > (selections.getParameter<edm::InputTag> (name));
+    }
+  //////////////////////////////////////////////////////////////////////////////
+}
 
-  firstEvent = false;
+/**
+ * Retrieves all required collections from the event, using the tokens from
+ * getCollectionTokens.
+ *
+ * Which collections are required, and their labels, were already taken from
+ * the configuration by getCollectionTokens, so this only looks at the tokens.
+ *
+ * @param  tokens structure containing the tokens for the collections, in
+ *         which the result of any search by type is remembered
+ * @param  handles structure containing the edm::Handle objects in which the
+ *         collections are to be stored
+ * @param  event edm::Event from which to get the collections
+ */
+void
+anatools::getRequiredCollections (CollectionTokens &tokens, Collections &handles, const edm::Event &event)
+{
+  // Values cached by ValueLookupTree objects are only valid for one event.
+  handles.stream = event.streamID ().value ();
+  handles.run = event.id ().run ();
+  ValueCache::get (handles.stream).setEvent (event.id ());
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Retrieve each object collection which we need and print a warning if it is
+  // missing.
+  //////////////////////////////////////////////////////////////////////////////
+  if  (tokens.beamspots.required)         getCollection  (tokens.beamspots,           handles.beamspots,          event);
+  if  (tokens.bxlumis.required)           getCollection  (tokens.bxlumis,             handles.bxlumis,            event);
+  if  (tokens.electrons.required)         getCollection  (tokens.electrons,           handles.electrons,          event);
+  if  (tokens.events.required)            getCollection  (tokens.events,              handles.events,             event);
+  if  (tokens.genjets.required)           getCollection  (tokens.genjets,             handles.genjets,            event);
+  if  (tokens.jets.required)              getCollection  (tokens.jets,                handles.jets,               event);
+  if  (tokens.bjets.required)             getCollection  (tokens.bjets,               handles.bjets,              event);
+  if  (tokens.basicjets.required)         getCollection  (tokens.basicjets,           handles.basicjets,          event);
+  if  (tokens.generatorweights.required)  getCollection  (tokens.generatorweights,    handles.generatorweights,   event);
+  if  (tokens.mcparticles.required)       getCollection  (tokens.mcparticles,         handles.mcparticles,        event);
+  if  (tokens.mets.required)              getCollection  (tokens.mets,                handles.mets,               event);
+  if  (tokens.muons.required)             getCollection  (tokens.muons,               handles.muons,              event);
+  if  (tokens.photons.required)           getCollection  (tokens.photons,             handles.photons,            event);
+  if  (tokens.prescales.required)         getCollection  (tokens.prescales,           handles.prescales,          event);
+  if  (tokens.primaryvertexs.required)    getCollection  (tokens.primaryvertexs,      handles.primaryvertexs,     event);
+  if  (tokens.superclusters.required)     getCollection  (tokens.superclusters,       handles.superclusters,      event);
+  if  (tokens.taus.required)              getCollection  (tokens.taus,                handles.taus,               event);
+  if  (tokens.tracks.required)            getCollection  (tokens.tracks,              handles.tracks,             event);
+  if  (tokens.pileupinfos.required)       getCollection  (tokens.pileupinfos,         handles.pileupinfos,        event);
+  if  (tokens.triggers.required)          getCollection  (tokens.triggers,            handles.triggers,           event);
+  if  (tokens.trigobjs.required)          getCollection  (tokens.trigobjs,            handles.trigobjs,           event);
+  handles.uservariables.resize (tokens.uservariables.size ());
+  for (unsigned i = 0; i < tokens.uservariables.size (); i++)
+    getCollection (tokens.uservariables.at (i), handles.uservariables.at (i), event);
+  handles.eventvariables.resize (tokens.eventvariables.size ());
+  for (unsigned i = 0; i < tokens.eventvariables.size (); i++)
+    getCollection (tokens.eventvariables.at (i), handles.eventvariables.at (i), event);
+  handles.eventvariableNames.resize (tokens.eventvariableNames.size ());
+  for (unsigned i = 0; i < tokens.eventvariableNames.size (); i++)
+    event.getRun ().getByToken (tokens.eventvariableNames.at (i), handles.eventvariableNames.at (i));
+  for (const auto &selection : tokens.selections)
+    event.getByToken (selection.second, handles.selections[selection.first]);
+
+  if (firstEvent.exchange (false))
+    printMissingCollections (handles);
+  //////////////////////////////////////////////////////////////////////////////
 }
 
 #ifdef ROOT6
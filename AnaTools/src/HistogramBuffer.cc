@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <iostream>
+
+#include "TArrayD.h"
+
+#include "OSUT3Analysis/AnaTools/interface/HistogramBuffer.h"
+
+#define EXIT_CODE 5
+
+HistogramBuffer::HistogramBuffer () :
+  nBinsX_    (0),
+  entries_   (0.0),
+  weighted_  (false),
+  stats_     (7, 0.0)
+{
+}
+
+HistogramBuffer::HistogramBuffer (const TH1 &h) :
+  xAxis_     (*h.GetXaxis (), BinnedAxis::USE_OVERFLOW),
+  yAxis_     (*h.GetYaxis (), BinnedAxis::USE_OVERFLOW),
+  nBinsX_    (xAxis_.nBins () + 2),
+  entries_   (0.0),
+  weighted_  (false),
+  stats_     (7, 0.0)
+{
+  // A TH1 still has a y-axis with a single bin, so the underflow and overflow
+  // in y are just unused.
+  sumw_.resize (nBinsX_ * (h.GetDimension () > 1 ? yAxis_.nBins () + 2 : 1), 0.0);
+  sumw2_.resize (sumw_.size (), 0.0);
+}
+
+void
+HistogramBuffer::fill (double x, double w)
+{
+  int bin = xAxis_.findBin (x);
+
+  entries_++;
+  sumw_[bin] += w;
+  sumw2_[bin] += w * w;
+  weighted_ = weighted_ || w != 1.0;
+  if (bin == 0 || bin > xAxis_.nBins ())
+    return;
+
+  stats_[0] += w;
+  stats_[1] += w * w;
+  stats_[2] += w * x;
+  stats_[3] += w * x * x;
+}
+
+void
+HistogramBuffer::fill (double x, double y, double w)
+{
+  int binX = xAxis_.findBin (x),
+      binY = yAxis_.findBin (y),
+      bin = binX + nBinsX_ * binY;
+
+  entries_++;
+  sumw_[bin] += w;
+  sumw2_[bin] += w * w;
+  weighted_ = weighted_ || w != 1.0;
+  if (binX == 0 || binX > xAxis_.nBins () || binY == 0 || binY > yAxis_.nBins ())
+    return;
+
+  stats_[0] += w;
+  stats_[1] += w * w;
+  stats_[2] += w * x;
+  stats_[3] += w * x * x;
+  stats_[4] += w * y;
+  stats_[5] += w * y * y;
+  stats_[6] += w * x * y;
+}
+
+void
+HistogramBuffer::mergeInto (TH1 &h)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // The statistics are retrieved before touching the bins, since TH1::GetStats
+  // recomputes them from the bins under some conditions.
+  //////////////////////////////////////////////////////////////////////////////
+  double stats[TH1::kNstat] = {0.0};
+  h.GetStats (stats);
+  for (unsigned i = 0; i < stats_.size () && i < (unsigned) TH1::kNstat; i++)
+    stats[i] += stats_[i];
+  //////////////////////////////////////////////////////////////////////////////
+
+  //////////////////////////////////////////////////////////////////////////////
+  // As in TH1::Fill, the sums of squared weights are only needed if there are
+  // weights other than one.
+  //////////////////////////////////////////////////////////////////////////////
+  if (weighted_ && !h.GetSumw2N ())
+    h.Sumw2 ();
+  TArrayD *sumw2 = h.GetSumw2N () ? h.GetSumw2 () : NULL;
+  for (unsigned bin = 0; bin < sumw_.size (); bin++)
+    {
+      if (!sumw_[bin] && !sumw2_[bin])
+        continue;
+      h.AddBinContent (bin, sumw_[bin]);
+      if (sumw2)
+        (*sumw2)[bin] += sumw2_[bin];
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  h.PutStats (stats);
+  h.SetEntries (h.GetEntries () + entries_);
+
+  clear ();
+}
+
+void
+HistogramBuffer::mergeInto (HistogramBuffer &buffer)
+{
+  if (buffer.sumw_.size () != sumw_.size ())
+    {
+      clog << "ERROR [HistogramBuffer::mergeInto]: the buffers have " << sumw_.size () << " and " << buffer.sumw_.size () << " bins." << endl;
+      exit (EXIT_CODE);
+    }
+
+  for (unsigned bin = 0; bin < sumw_.size (); bin++)
+    {
+      buffer.sumw_[bin] += sumw_[bin];
+      buffer.sumw2_[bin] += sumw2_[bin];
+    }
+  for (unsigned i = 0; i < stats_.size (); i++)
+    buffer.stats_[i] += stats_[i];
+  buffer.entries_ += entries_;
+  buffer.weighted_ = buffer.weighted_ || weighted_;
+
+  clear ();
+}
+
+void
+HistogramBuffer::clear ()
+{
+  fill_n (sumw_.begin (), sumw_.size (), 0.0);
+  fill_n (sumw2_.begin (), sumw2_.size (), 0.0);
+  fill_n (stats_.begin (), stats_.size (), 0.0);
+  entries_ = 0.0;
+  weighted_ = false;
+}
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
+
+namespace
+{
+  struct ProducerStats
+  {
+    unsigned long long  calls;
+    double              seconds;
+  };
+
+  typedef tuple<string, string, string>         ExpressionKey;  // module, kind, and name
+  typedef unordered_map<string, ProducerStats>  ProducerStatsMap;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // The statistics of the expressions are added once per ValueLookupTree, when
+  // it is destroyed, so they are simply kept behind a mutex. The producers are
+  // timed for every event, so each thread adds them to its own map instead,
+  // and the maps of all the threads are summed when the job ends.
+  //////////////////////////////////////////////////////////////////////////////
+  atomic<bool>                         enabled (false);
+  mutex                                instrumentationMutex;
+  string                               outputFile;
+  map<ExpressionKey, EvaluationStats>  expressions;
+  vector<ProducerStatsMap *>           threadProducerStats;
+
+  ProducerStatsMap &
+  getThreadProducerStats ()
+  {
+    static thread_local ProducerStatsMap *stats = NULL;
+    if (!stats)
+      {
+        stats = new ProducerStatsMap;
+        lock_guard<mutex> lock (instrumentationMutex);
+        threadProducerStats.push_back (stats);
+      }
+    return *stats;
+  }
+  //////////////////////////////////////////////////////////////////////////////
+
+  struct InstrumentationSummary
+  {
+    ~InstrumentationSummary ()
+    {
+      if (!enabled)
+        return;
+
+      ////////////////////////////////////////////////////////////////////////////
+      // Sum the producers over all the threads, and sort both the expressions
+      // and the producers by the time spent in them.
+      ////////////////////////////////////////////////////////////////////////////
+      map<string, ProducerStats> producers;
+      for (auto &stats : threadProducerStats)
+        {
+          for (const auto &producer : *stats)
+            {
+              ProducerStats &total = producers.insert (make_pair (producer.first, ProducerStats ())).first->second;
+              total.calls += producer.second.calls;
+              total.seconds += producer.second.seconds;
+            }
+          delete stats;
+        }
+      threadProducerStats.clear ();
+
+      vector<pair<ExpressionKey, EvaluationStats> > sortedExpressions (expressions.begin (), expressions.end ());
+      vector<pair<string, ProducerStats> > sortedProducers (producers.begin (), producers.end ());
+      stable_sort (sortedExpressions.begin (), sortedExpressions.end (), [] (const pair<ExpressionKey, EvaluationStats> &a, const pair<ExpressionKey, EvaluationStats> &b) { return a.second.seconds > b.second.seconds; });
+      stable_sort (sortedProducers.begin (), sortedProducers.end (), [] (const pair<string, ProducerStats> &a, const pair<string, ProducerStats> &b) { return a.second.seconds > b.second.seconds; });
+      ////////////////////////////////////////////////////////////////////////////
+
+      ////////////////////////////////////////////////////////////////////////////
+      // Print the table.
+      ////////////////////////////////////////////////////////////////////////////
+      clog << "=============================================" << endl;
+      clog << "Instrumentation summary:" << endl;
+      clog << "  producers:" << endl;
+      clog << "    " << setw (12) << right << "time [s]" << setw (12) << "calls" << "  module" << endl;
+      for (const auto &producer : sortedProducers)
+        clog << "    " << setw (12) << right << fixed << setprecision (3) << producer.second.seconds << setw (12) << producer.second.calls << "  " << producer.first << endl;
+      clog << "  expressions:" << endl;
+      clog << "    " << setw (12) << right << "time [s]" << setw (14) << "evaluations" << setw (14) << "combinations" << setw (14) << "lookups" << setw (12) << "invalid" << setw (12) << "cached" << "  module: kind \"name\"" << endl;
+      for (const auto &expression : sortedExpressions)
+        {
+          const EvaluationStats &stats = expression.second;
+          clog << "    " << setw (12) << right << fixed << setprecision (3) << stats.seconds << setw (14) << stats.evaluations << setw (14) << stats.combinations << setw (14) << stats.memberLookups << setw (12) << stats.invalidValues << setw (12) << stats.cacheHits
+               << "  " << get<0> (expression.first) << ": " << get<1> (expression.first) << " \"" << get<2> (expression.first) << "\"" << endl;
+        }
+      clog << "=============================================" << endl;
+      clog.unsetf (ios::fixed);
+      clog << setprecision (6);
+      ////////////////////////////////////////////////////////////////////////////
+
+      ////////////////////////////////////////////////////////////////////////////
+      // Write the same statistics to the JSON file.
+      ////////////////////////////////////////////////////////////////////////////
+      ofstream fout (outputFile.c_str ());
+      if (!fout.is_open ())
+        {
+          clog << "ERROR [Instrumentation]: Could not open file: " << outputFile << endl;
+          return;
+        }
+      fout << setprecision (9);
+      fout << "{" << endl << "  \"producers\": [";
+      for (auto producer = sortedProducers.begin (); producer != sortedProducers.end (); producer++)
+        {
+          fout << (producer != sortedProducers.begin () ? "," : "") << endl;
+          fout << "    {\"module\": " << anatools::jsonString (producer->first) << ", \"calls\": " << producer->second.calls << ", \"seconds\": " << producer->second.seconds << "}";
+        }
+      fout << endl << "  ]," << endl << "  \"expressions\": [";
+      for (auto expression = sortedExpressions.begin (); expression != sortedExpressions.end (); expression++)
+        {
+          const EvaluationStats &stats = expression->second;
+          fout << (expression != sortedExpressions.begin () ? "," : "") << endl;
+          fout << "    {\"module\": " << anatools::jsonString (get<0> (expression->first))
+               << ", \"kind\": " << anatools::jsonString (get<1> (expression->first))
+               << ", \"name\": " << anatools::jsonString (get<2> (expression->first))
+               << ", \"evaluations\": " << stats.evaluations
+               << ", \"combinations\": " << stats.combinations
+               << ", \"memberLookups\": " << stats.memberLookups
+               << ", \"invalidValues\": " << stats.invalidValues
+               << ", \"cacheHits\": " << stats.cacheHits
+               << ", \"seconds\": " << stats.seconds << "}";
+        }
+      fout << endl << "  ]" << endl << "}" << endl;
+      fout.close ();
+      ////////////////////////////////////////////////////////////////////////////
+    }
+  } summary;
+}
+
+EvaluationStats::EvaluationStats () :
+  evaluations    (0),
+  combinations   (0),
+  memberLookups  (0),
+  invalidValues  (0),
+  cacheHits      (0),
+  seconds        (0.0)
+{
+}
+
+EvaluationStats &
+EvaluationStats::operator+= (const EvaluationStats &stats)
+{
+  evaluations += stats.evaluations;
+  combinations += stats.combinations;
+  memberLookups += stats.memberLookups;
+  invalidValues += stats.invalidValues;
+  cacheHits += stats.cacheHits;
+  seconds += stats.seconds;
+  return *this;
+}
+
+void
+Instrumentation::enable (const string &fileName)
+{
+  lock_guard<mutex> lock (instrumentationMutex);
+  if (enabled && fileName != outputFile)
+    clog << "WARNING [Instrumentation]: already writing to " << outputFile << ", ignoring " << fileName << endl;
+  else
+    outputFile = fileName;
+  enabled = true;
+}
+
+bool
+Instrumentation::isEnabled ()
+{
+  return enabled;
+}
+
+void
+Instrumentation::addExpression (const string &module, const string &kind, const string &name, const EvaluationStats &stats)
+{
+  if (!enabled || !stats.evaluations)
+    return;
+
+  lock_guard<mutex> lock (instrumentationMutex);
+  expressions[ExpressionKey (module, kind, name)] += stats;
+}
+
+void
+Instrumentation::addProducerCall (const string &module, const double seconds)
+{
+  ProducerStatsMap &stats = getThreadProducerStats ();
+  ProducerStats &producer = stats.insert (make_pair (module, ProducerStats ())).first->second;
+  producer.calls++;
+  producer.seconds += seconds;
+}
+
+Instrumentation::Timer::Timer (const string &module) :
+  isEnabled_ (enabled)
+{
+  if (!isEnabled_)
+    return;
+  module_ = module;
+  start_ = chrono::steady_clock::now ();
+}
+
+Instrumentation::Timer::~Timer ()
+{
+  if (isEnabled_)
+    addProducerCall (module_, chrono::duration<double> (chrono::steady_clock::now () - start_).count ());
+}
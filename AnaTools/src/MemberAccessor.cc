@@ -0,0 +1,519 @@
+#include <iostream>
+#include <mutex>
+
+#include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/MemberAccessor.h"
+
+#ifdef ROOT6
+  #include "TBaseClass.h"
+  #include "TDictionary.h"
+
+  #include "FWCore/Utilities/interface/BaseWithDict.h"
+  #include "FWCore/Utilities/interface/MemberWithDict.h"
+  #include "FWCore/Utilities/interface/ObjectWithDict.h"
+#else
+  #include "Reflex/Base.h"
+  #include "Reflex/Object.h"
+#endif
+
+MemberAccessor::MemberAccessor (const string &type, const string &member) :
+  type_ (type),
+  member_ (member),
+  isResolved_ (false)
+{
+#ifdef ROOT6
+  edm::TypeWithDict t = edm::TypeWithDict::byName (type_);
+#else
+  Reflex::Type t = Reflex::Type::ByName (type_);
+#endif
+
+  try
+    {
+      isResolved_ = resolve (t, member_) && steps_.size () <= MAX_STEPS;
+    }
+  catch (...)
+    {
+      isResolved_ = false;
+    }
+  if (!isResolved_)
+    steps_.clear ();
+}
+
+MemberAccessor::~MemberAccessor ()
+{
+}
+
+/**
+ * Returns the accessor for a given type and member.
+ *
+ * Each (type, member) pair is only resolved the first time it is requested,
+ * after which the same accessor is returned for the rest of the job. The
+ * accessors themselves are never modified once resolved, so they may be used
+ * from any thread.
+ *
+ * @param  type string giving the type of the object
+ * @param  member string giving the member, data or function, to evaluate
+ * @return accessor for the member of the given type
+ */
+const MemberAccessor &
+MemberAccessor::get (const string &type, const string &member)
+{
+  static unordered_map<string, unordered_map<string, MemberAccessor *> > accessors;
+  static mutex accessorsMutex;
+
+  // The accessors are shared by the modules of every stream, which may
+  // request them concurrently.
+  lock_guard<mutex> lock (accessorsMutex);
+  unordered_map<string, MemberAccessor *> &accessorsOfType = accessors[type];
+  auto accessor = accessorsOfType.find (member);
+  if (accessor == accessorsOfType.end ())
+    accessor = accessorsOfType.insert (make_pair (member, new MemberAccessor (type, member))).first;
+
+  return *accessor->second;
+}
+
+bool
+MemberAccessor::isResolved () const
+{
+  return isResolved_;
+}
+
+const string &
+MemberAccessor::type () const
+{
+  return type_;
+}
+
+const string &
+MemberAccessor::member () const
+{
+  return member_;
+}
+
+/**
+ * Returns the value of the member for a given object.
+ *
+ * The pre-resolved steps are applied in order to the address of the object.
+ * Any temporary objects returned by function members along the way are
+ * destroyed before returning.
+ *
+ * @param  obj void pointer to the object
+ * @return value of the member of the given object
+ */
+double
+MemberAccessor::operator() (const void * const obj) const
+{
+  if (!isResolved_)
+    return anatools::getMember (type_, obj, member_);
+
+#ifdef ROOT6
+  edm::ObjectWithDict temporaries[MAX_STEPS];
+#else
+  Reflex::Object temporaries[MAX_STEPS];
+#endif
+  void *pointers[MAX_STEPS];
+  unsigned nTemporaries = 0;
+  const char *address = (const char *) obj;
+  double value = INVALID_VALUE;
+
+  try
+    {
+      for (unsigned i = 0; i < steps_.size () && address; i++)
+        {
+          const Step &step = steps_.at (i);
+          const bool isLastStep = (i + 1 == steps_.size ());
+
+          if (step.stepType == DATA_MEMBER)
+            {
+              address += step.offset;
+              if (isLastStep)
+                value = toDouble (step.valueType, address);
+            }
+          else if (step.stepType == DEREFERENCE)
+            address = (const char *) *((void * const *) address);
+          else if (isLastStep)
+            value = invoke (step, address);
+          else if (step.isPointer)
+            {
+#ifdef ROOT6
+              edm::ObjectWithDict ret (step.returnType, &pointers[i]);
+              step.function.invoke (edm::ObjectWithDict (step.scope, (void *) address), &ret);
+#else
+              Reflex::Object ret (step.returnType, &pointers[i]);
+              step.function.Invoke (Reflex::Object (step.scope, (void *) address), &ret);
+#endif
+              address = (const char *) &pointers[i];
+            }
+          else
+            {
+              // The function member constructs the object it returns in the
+              // storage it is given, so the storage must not already hold an
+              // object, which would never be destroyed.
+#ifdef ROOT6
+              void *storage = ::operator new (step.returnType.size ());
+              edm::ObjectWithDict ret (step.returnType, storage);
+              try
+                {
+                  step.function.invoke (edm::ObjectWithDict (step.scope, (void *) address), &ret);
+                }
+              catch (...)
+                {
+                  ::operator delete (storage);
+                  throw;
+                }
+#else
+              void *storage = step.returnType.Allocate ();
+              Reflex::Object ret (step.returnType, storage);
+              try
+                {
+                  step.function.Invoke (Reflex::Object (step.scope, (void *) address), &ret);
+                }
+              catch (...)
+                {
+                  step.returnType.Deallocate (storage);
+                  throw;
+                }
+#endif
+              temporaries[nTemporaries++] = ret;
+              address = (const char *) storage;
+            }
+        }
+    }
+  catch (...)
+    {
+      clog << "WARNING: unable to access member \"" << member_ << "\" from \"" << type_ << "\"" << endl;
+      value = INVALID_VALUE;
+    }
+
+  for (unsigned i = 0; i < nTemporaries; i++)
+    {
+#ifdef ROOT6
+      temporaries[i].destruct (false);
+      ::operator delete (temporaries[i].address ());
+#else
+      temporaries[i].Destruct ();
+#endif
+    }
+
+  return value;
+}
+
+#ifdef ROOT6
+/**
+ * Appends the steps needed to reach a member, possibly a dotted path, of an
+ * object of the given type.
+ *
+ * @param  t type of the object
+ * @param  member string giving the member, data or function, to resolve
+ * @return boolean representing whether the member could be resolved
+ */
+bool
+MemberAccessor::resolve (const edm::TypeWithDict &t, const string &member)
+{
+  if (!t || t.isReference ())
+    return false;
+
+  const size_t nSteps = steps_.size ();
+  if (t.isPointer ())
+    {
+      Step step;
+      step.stepType = DEREFERENCE;
+      step.offset = 0;
+      step.valueType = NO_VALUE;
+      step.isPointer = false;
+      steps_.push_back (step);
+      if (resolve (t.toType (), member))
+        return true;
+      steps_.resize (nSteps);
+      return false;
+    }
+
+  size_t dot = member.find ('.');
+  if (dot != string::npos)
+    {
+      const string first = member.substr (0, dot),
+                   rest = member.substr (dot + 1);
+      edm::TypeWithDict subType;
+      if (resolveSingle (t, first, subType))
+        {
+          if (resolve (subType, rest))
+            return true;
+          if (resolve (subType, (first == "operator->" ? "" : "operator->.") + rest))
+            return true;
+        }
+      steps_.resize (nSteps);
+      return false;
+    }
+
+  edm::TypeWithDict memberType;
+  if (resolveSingle (t, member, memberType) && steps_.back ().valueType != NO_VALUE)
+    return true;
+  steps_.resize (nSteps);
+  return false;
+}
+
+/**
+ * Appends the steps needed to reach a single member, i.e., one without any
+ * dots, of an object of the given type, searching the non-virtual base classes
+ * if necessary. The offset of a virtual base is only known from the object
+ * itself, so a member found only in one is left to anatools::getMember.
+ *
+ * @param  t type of the object
+ * @param  member string giving the member, data or function, to resolve
+ * @param  memberType type in which the type of the member is stored
+ * @return boolean representing whether the member could be resolved
+ */
+bool
+MemberAccessor::resolveSingle (const edm::TypeWithDict &t, const string &member, edm::TypeWithDict &memberType)
+{
+  const edm::MemberWithDict &dataMember = t.dataMemberByName (member);
+  const edm::FunctionWithDict &functionMember = t.functionMemberByName (member);
+  Step step;
+
+  step.offset = 0;
+  step.valueType = NO_VALUE;
+  step.isPointer = false;
+  if (dataMember)
+    {
+      memberType = dataMember.typeOf ();
+      if (memberType.isReference ())
+        return false;
+      step.stepType = DATA_MEMBER;
+      step.offset = dataMember.offset ();
+      step.valueType = getValueType (memberType.name ());
+      steps_.push_back (step);
+      return true;
+    }
+  if (functionMember)
+    {
+      memberType = functionMember.finalReturnType ();
+      if (memberType.isReference ())
+        return false;
+      step.stepType = FUNCTION_MEMBER;
+      step.valueType = getValueType (memberType.name ());
+      step.isPointer = memberType.isPointer ();
+      step.scope = t;
+      step.returnType = memberType;
+      step.function = functionMember;
+      steps_.push_back (step);
+      return true;
+    }
+
+  for (const auto &bi : edm::TypeBases (t))
+    {
+      if (((TBaseClass *) bi)->Property () & kIsVirtualBase)
+        continue;
+      edm::BaseWithDict baseClass (bi);
+      const size_t nSteps = steps_.size ();
+
+      step.stepType = DATA_MEMBER;
+      step.offset = baseClass.offset ();
+      steps_.push_back (step);
+      if (resolveSingle (baseClass.typeOf (), member, memberType))
+        return true;
+      steps_.resize (nSteps);
+    }
+
+  return false;
+}
+
+template<class T> double
+MemberAccessor::invoke (const Step &step, const void * const address) const
+{
+  T value;
+  edm::ObjectWithDict ret (step.returnType, &value);
+  step.function.invoke (edm::ObjectWithDict (step.scope, (void *) address), &ret);
+  return value;
+}
+#else
+/**
+ * Appends the steps needed to reach a member, possibly a dotted path, of an
+ * object of the given type.
+ *
+ * Mirrors anatools::getMember: pointers are dereferenced, and if the rest of a
+ * dotted path cannot be found in the intermediate type, it is looked for
+ * behind its operator->, as is needed for edm::Ref.
+ *
+ * @param  t Reflex::Type corresponding to the type of the object
+ * @param  member string giving the member, data or function, to resolve
+ * @return boolean representing whether the member could be resolved
+ */
+bool
+MemberAccessor::resolve (const Reflex::Type &t, const string &member)
+{
+  if (!t || t.IsReference ())
+    return false;
+
+  const size_t nSteps = steps_.size ();
+  if (t.IsPointer ())
+    {
+      string typeName = t.Name (Reflex::FINAL | Reflex::SCOPED);
+      size_t asterisk = typeName.rfind ('*');
+      Step step;
+      step.stepType = DEREFERENCE;
+      step.offset = 0;
+      step.valueType = NO_VALUE;
+      step.isPointer = false;
+      steps_.push_back (step);
+      if (resolve (Reflex::Type::ByName (typeName.substr (0, asterisk) + typeName.substr (asterisk + 1)), member))
+        return true;
+      steps_.resize (nSteps);
+      return false;
+    }
+
+  size_t dot = member.find ('.');
+  if (dot != string::npos)
+    {
+      const string first = member.substr (0, dot),
+                   rest = member.substr (dot + 1);
+      Reflex::Type subType;
+      if (resolveSingle (t, first, subType))
+        {
+          if (resolve (subType, rest))
+            return true;
+          if (resolve (subType, (first == "operator->" ? "" : "operator->.") + rest))
+            return true;
+        }
+      steps_.resize (nSteps);
+      return false;
+    }
+
+  Reflex::Type memberType;
+  if (resolveSingle (t, member, memberType) && steps_.back ().valueType != NO_VALUE)
+    return true;
+  steps_.resize (nSteps);
+  return false;
+}
+
+/**
+ * Appends the steps needed to reach a single member, i.e., one without any
+ * dots, of an object of the given type, searching the non-virtual base classes
+ * if necessary.
+ *
+ * @param  t Reflex::Type corresponding to the type of the object
+ * @param  member string giving the member, data or function, to resolve
+ * @param  memberType Reflex::Type in which the type of the member is stored
+ * @return boolean representing whether the member could be resolved
+ */
+bool
+MemberAccessor::resolveSingle (const Reflex::Type &t, const string &member, Reflex::Type &memberType)
+{
+  Reflex::Member dataMember = t.DataMemberByName (member),
+                 functionMember = t.FunctionMemberByName (member);
+  Step step;
+
+  step.offset = 0;
+  step.valueType = NO_VALUE;
+  step.isPointer = false;
+  if (dataMember)
+    {
+      memberType = dataMember.TypeOf ();
+      if (memberType.IsReference ())
+        return false;
+      step.stepType = DATA_MEMBER;
+      step.offset = dataMember.Offset ();
+      step.valueType = getValueType (memberType.Name (Reflex::FINAL | Reflex::SCOPED));
+      steps_.push_back (step);
+      return true;
+    }
+  if (functionMember)
+    {
+      memberType = functionMember.TypeOf ().ReturnType ();
+      if (memberType.IsReference ())
+        return false;
+      step.stepType = FUNCTION_MEMBER;
+      step.valueType = getValueType (memberType.Name (Reflex::FINAL | Reflex::SCOPED));
+      step.isPointer = memberType.IsPointer ();
+      step.scope = t;
+      step.returnType = memberType;
+      step.function = functionMember;
+      steps_.push_back (step);
+      return true;
+    }
+
+  for (auto bi = t.Base_Begin (); bi != t.Base_End (); bi++)
+    {
+      if (bi->IsVirtual ())
+        continue;
+      const size_t nSteps = steps_.size ();
+
+      step.stepType = DATA_MEMBER;
+      step.offset = bi->Offset ();
+      steps_.push_back (step);
+      if (resolveSingle (bi->ToType (), member, memberType))
+        return true;
+      steps_.resize (nSteps);
+    }
+
+  return false;
+}
+
+template<class T> double
+MemberAccessor::invoke (const Step &step, const void * const address) const
+{
+  T value;
+  Reflex::Object ret (step.returnType, &value);
+  step.function.Invoke (Reflex::Object (step.scope, (void *) address), &ret);
+  return value;
+}
+#endif
+
+MemberAccessor::ValueType
+MemberAccessor::getValueType (const string &typeName) const
+{
+  if (typeName == "float")
+    return FLOAT;
+  else if (typeName == "double")
+    return DOUBLE;
+  else if (typeName == "long double")
+    return LONG_DOUBLE;
+  else if (typeName == "char")
+    return CHAR;
+  else if (typeName == "int")
+    return INT;
+  else if (typeName == "unsigned" || typeName == "unsigned int")
+    return UNSIGNED_INT;
+  else if (typeName == "bool")
+    return BOOL;
+  else if (typeName == "unsigned short int")
+    return UNSIGNED_SHORT_INT;
+  else if (typeName == "unsigned long int")
+    return UNSIGNED_LONG_INT;
+  return NO_VALUE;
+}
+
+double
+MemberAccessor::toDouble (const ValueType valueType, const void * const address) const
+{
+  switch (valueType)
+    {
+      case FLOAT:               return *((const float *) address);
+      case DOUBLE:              return *((const double *) address);
+      case LONG_DOUBLE:         return *((const long double *) address);
+      case CHAR:                return *((const char *) address);
+      case INT:                 return *((const int *) address);
+      case UNSIGNED_INT:        return *((const unsigned int *) address);
+      case BOOL:                return *((const bool *) address);
+      case UNSIGNED_SHORT_INT:  return *((const unsigned short int *) address);
+      case UNSIGNED_LONG_INT:   return *((const unsigned long int *) address);
+      default:                  return INVALID_VALUE;
+    }
+}
+
+double
+MemberAccessor::invoke (const Step &step, const void * const address) const
+{
+  switch (step.valueType)
+    {
+      case FLOAT:               return invoke<float> (step, address);
+      case DOUBLE:              return invoke<double> (step, address);
+      case LONG_DOUBLE:         return invoke<long double> (step, address);
+      case CHAR:                return invoke<char> (step, address);
+      case INT:                 return invoke<int> (step, address);
+      case UNSIGNED_INT:        return invoke<unsigned int> (step, address);
+      case BOOL:                return invoke<bool> (step, address);
+      case UNSIGNED_SHORT_INT:  return invoke<unsigned short int> (step, address);
+      case UNSIGNED_LONG_INT:   return invoke<unsigned long int> (step, address);
+      default:                  return INVALID_VALUE;
+    }
+}
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "OSUT3Analysis/AnaTools/interface/ObjectFlags.h"
+
+#define BITS_PER_WORD 64
+
+ObjectFlags::ObjectFlags () :
+  nCollections_ (0)
+{
+}
+
+ObjectFlags::ObjectFlags (unsigned nCollections) :
+  nCollections_ (nCollections)
+{
+}
+
+unsigned
+ObjectFlags::size () const
+{
+  return (nCollections_ ? offsets_.size () / nCollections_ : 0);
+}
+
+void
+ObjectFlags::resize (unsigned nCuts)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // The words belonging to dropped cuts are only reclaimed when all the flags
+  // are dropped, since the words of the remaining cuts may come after them.
+  //////////////////////////////////////////////////////////////////////////////
+  offsets_.resize (nCuts * nCollections_, -1);
+  nObjects_.resize (nCuts * nCollections_, 0);
+  if (!nCuts)
+    bits_.clear ();
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+unsigned
+ObjectFlags::nCollections () const
+{
+  return nCollections_;
+}
+
+bool
+ObjectFlags::has (unsigned cut, unsigned collection) const
+{
+  return (cut < size () && collection < nCollections_ && offsets_[cut * nCollections_ + collection] >= 0);
+}
+
+unsigned
+ObjectFlags::nObjects (unsigned cut, unsigned collection) const
+{
+  return (has (cut, collection) ? nObjects_[cut * nCollections_ + collection] : 0);
+}
+
+void
+ObjectFlags::add (unsigned cut, unsigned collection, unsigned nObjects, const pair<bool, bool> &flag)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // New words are always appended to the end of bits_, with the words for
+  // whether each object passes followed by those for whether each flag is
+  // valid.
+  //////////////////////////////////////////////////////////////////////////////
+  unsigned nWords = (nObjects + BITS_PER_WORD - 1) / BITS_PER_WORD;
+  unsigned index = cut * nCollections_ + collection;
+  offsets_.at (index) = bits_.size ();
+  nObjects_.at (index) = nObjects;
+  bits_.resize (bits_.size () + nWords, flag.first ? ~0ULL : 0ULL);
+  bits_.resize (bits_.size () + nWords, flag.second ? ~0ULL : 0ULL);
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+void
+ObjectFlags::copy (unsigned fromCut, unsigned toCut, unsigned collection)
+{
+  unsigned fromOffset = getOffset (fromCut, collection),
+           nObjects = nObjects_[fromCut * nCollections_ + collection],
+           nWords = 2 * ((nObjects + BITS_PER_WORD - 1) / BITS_PER_WORD);
+
+  // The words are copied after adding the new ones, since adding them can
+  // reallocate bits_.
+  add (toCut, collection, nObjects);
+  copy_n (bits_.begin () + fromOffset, nWords, bits_.end () - nWords);
+}
+
+pair<bool, bool>
+ObjectFlags::get (unsigned cut, unsigned collection, unsigned object) const
+{
+  return make_pair (passes (cut, collection, object), isValid (cut, collection, object));
+}
+
+bool
+ObjectFlags::passes (unsigned cut, unsigned collection, unsigned object) const
+{
+  return getBit (getOffset (cut, collection), object);
+}
+
+bool
+ObjectFlags::isValid (unsigned cut, unsigned collection, unsigned object) const
+{
+  unsigned index = cut * nCollections_ + collection;
+  return getBit (getOffset (cut, collection) + (nObjects_[index] + BITS_PER_WORD - 1) / BITS_PER_WORD, object);
+}
+
+void
+ObjectFlags::set (unsigned cut, unsigned collection, unsigned object, const pair<bool, bool> &flag)
+{
+  unsigned index = cut * nCollections_ + collection, offset = getOffset (cut, collection);
+  setBit (offset, object, flag.first);
+  setBit (offset + (nObjects_[index] + BITS_PER_WORD - 1) / BITS_PER_WORD, object, flag.second);
+}
+
+void
+ObjectFlags::setPasses (unsigned cut, unsigned collection, unsigned object, bool passes)
+{
+  setBit (getOffset (cut, collection), object, passes);
+}
+
+unsigned
+ObjectFlags::getOffset (unsigned cut, unsigned collection) const
+{
+  if (!has (cut, collection))
+    throw out_of_range ("ObjectFlags: no flags for the given cut and collection");
+  return offsets_[cut * nCollections_ + collection];
+}
+
+void
+ObjectFlags::setBit (unsigned word, unsigned object, bool value)
+{
+  unsigned long long mask = 1ULL << (object % BITS_PER_WORD);
+  if (value)
+    bits_[word + object / BITS_PER_WORD] |= mask;
+  else
+    bits_[word + object / BITS_PER_WORD] &= ~mask;
+}
+
+bool
+ObjectFlags::getBit (unsigned word, unsigned object) const
+{
+  return (bits_[word + object / BITS_PER_WORD] >> (object % BITS_PER_WORD)) & 1ULL;
+}
@@ -1,25 +1,11 @@
 #include "OSUT3Analysis/AnaTools/interface/ObjectSelector.h"
 
 // The object selector for beamspots is a special case because beamspots are
-// not stored in a vector.
+// not stored in a vector. The constructor is the same as for the other
+// collections, since the types of the products are given by
+// ObjectSelectorProduct.
 
 #if IS_VALID(beamspots)
-  template<>
-  ObjectSelector<osu::Beamspot, TYPE(beamspots)>::ObjectSelector (const edm::ParameterSet &cfg) :
-    collections_         (cfg.getParameter<edm::ParameterSet>  ("collections")),
-    collectionToFilter_  (cfg.getParameter<string>             ("collectionToFilter")),
-    cutDecisions_        (cfg.getParameter<edm::InputTag>      ("cutDecisions")),
-    firstEvent_          (true)
-  {
-    assert (strcmp (PROJECT_VERSION, SUPPORTED_VERSION) == 0);
-
-    // Retrieve the InputTag for the collection which is to be filtered.
-    collection_ = collections_.getParameter<edm::InputTag> (collectionToFilter_);
-
-    produces<osu::Beamspot> (collection_.instance ());
-    produces<TYPE(beamspots)> (ORIGINAL_FORMAT);
-  }
-
   template<> bool
   ObjectSelector<osu::Beamspot, TYPE(beamspots)>::filter (edm::Event &event, const edm::EventSetup &setup)
   {
@@ -29,52 +15,69 @@
     //////////////////////////////////////////////////////////////////////////////
     edm::Handle<osu::Beamspot> collection;
     edm::Handle<TYPE(beamspots)> collectionOrig;
-    anatools::getCollection (collection_, collection,     event);
-    anatools::getCollection (collection_, collectionOrig, event);
-    event.getByLabel (cutDecisions_, cutDecisions);  
+    anatools::getCollection (collectionToken_,     collection,     event);
+    if (copyObjects_)
+      anatools::getCollection (collectionOrigToken_, collectionOrig, event);
+    event.getByToken (cutDecisionsToken_, cutDecisions);
     if (firstEvent_ && !collection.isValid ())
       clog << "WARNING: failed to retrieve requested collection from the event." << endl;
-    if (firstEvent_ && !collectionOrig.isValid ())
+    if (firstEvent_ && copyObjects_ && !collectionOrig.isValid ())
       clog << "WARNING: failed to retrieve original collection from the event." << endl;
     if (firstEvent_ && !cutDecisions.isValid ())
       clog << "WARNING: failed to retrieve cut decisions from the event." << endl;
+    if (firstEvent_ && cutDecisions.isValid () && !cutDecisions->metadata)
+      clog << "ERROR: the cut decisions have no metadata, as is the case when they are read from a file, so the beamspot is not cut." << endl;
     //////////////////////////////////////////////////////////////////////////////
 
     //////////////////////////////////////////////////////////////////////////////
-    // Fill the payload with the objects from the collection which pass all cuts.
-    // If the collection could not be retrieved, the payload remains empty. If the
-    // cut decisions could not be retrieved, no objects are cut.
+    // Fill the selection with the index of the beamspot, which is always zero,
+    // if it passes all cuts, and, if requested, fill the payload with a copy of
+    // it. If the collection could not be retrieved, the payload remains a
+    // default-constructed beamspot and the selection remains empty. If the cut
+    // decisions, or their metadata, could not be retrieved, the beamspot is not
+    // cut.
     //////////////////////////////////////////////////////////////////////////////
+    auto_ptr<vector<unsigned> > selection (new vector<unsigned> ());
     auto_ptr<osu::Beamspot> pl_ = auto_ptr<osu::Beamspot> (new osu::Beamspot ());
     auto_ptr<TYPE(beamspots)> plO_ = auto_ptr<TYPE(beamspots)> (new TYPE(beamspots) ());
-    if (collection.isValid () && collectionOrig.isValid())
+    if (collection.isValid () && (!copyObjects_ || collectionOrig.isValid ()))
       {
-        const osu::Beamspot * const object = &(*collection);
-        const TYPE(beamspots) * const objOrig = &(*collectionOrig);
         unsigned iObject = 0;
         bool passes = true;
 
-        if (cutDecisions.isValid ())
+        int collectionId = (cutDecisions.isValid () && cutDecisions->metadata ? cutDecisions->metadata->getCollectionId (collectionToFilter_) : -1);
+        if (collectionId >= 0)
           {
-            for (int iCut = cutDecisions->cumulativeObjectFlags.size () - 1; iCut >= 0; iCut--)
+            const ObjectFlags &flags = cutDecisions->cumulativeObjectFlags;
+            for (int iCut = flags.size () - 1; iCut >= 0; iCut--)
               {
-                if (cutDecisions->cumulativeObjectFlags.at (iCut).at (collectionToFilter_).at (iObject).second)
+                if (iObject >= flags.nObjects (iCut, collectionId))
+                  continue;
+                if (flags.isValid (iCut, collectionId, iObject))
                   {
-                    passes = cutDecisions->cumulativeObjectFlags.at (iCut).at (collectionToFilter_).at (iObject).first;
+                    passes = flags.passes (iCut, collectionId, iObject);
                     break;
                   }
               }
           }
         if (passes)
           {
-            *pl_ = *object;
-            *plO_ = *objOrig;
+            selection->push_back (iObject);
+            if (copyObjects_)
+              {
+                *pl_ = *collection;
+                *plO_ = *collectionOrig;
+              }
           }
       }
     //////////////////////////////////////////////////////////////////////////////
 
-    event.put (pl_,  collection_.instance ());
-    event.put (plO_, ORIGINAL_FORMAT);  
+    if (copyObjects_)
+      {
+        event.put (pl_,  collection_.instance ());
+        event.put (plO_, ORIGINAL_FORMAT);  
+      }
+    event.put (selection, SELECTION);
     pl_.reset ();
     plO_.reset ();
     firstEvent_ = false;
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include "OSUT3Analysis/AnaTools/interface/OutputSink.h"
+
+#define EXIT_CODE 4
+
+OutputSink::OutputSink (const string &fileName, unsigned capacity) :
+  out_    (&cerr),
+  slots_  (max (capacity, 1u)),
+  first_  (0),
+  size_   (0),
+  done_   (false)
+{
+  if (fileName != "")
+    {
+      file_.open (fileName.c_str ());
+      if (!file_.is_open ())
+        {
+          clog << "ERROR [OutputSink]: Could not open file: " << fileName << endl;
+          exit (EXIT_CODE);
+        }
+      out_ = &file_;
+    }
+
+  writer_ = thread (&OutputSink::drain, this);
+}
+
+OutputSink::~OutputSink ()
+{
+  {
+    lock_guard<mutex> lock (mutex_);
+    done_ = true;
+  }
+  notEmpty_.notify_one ();
+  writer_.join ();
+  out_->flush ();
+}
+
+void
+OutputSink::write (string &record)
+{
+  {
+    unique_lock<mutex> lock (mutex_);
+    notFull_.wait (lock, [this] { return size_ < slots_.size (); });
+
+    // The record is swapped into the slot, which leaves the caller with the
+    // string the slot held before, so that its storage can be reused.
+    slots_[(first_ + size_) % slots_.size ()].swap (record);
+    size_++;
+  }
+  record.clear ();
+  notEmpty_.notify_one ();
+}
+
+void
+OutputSink::drain ()
+{
+  string record;
+  while (true)
+    {
+      //////////////////////////////////////////////////////////////////////////
+      // Take the oldest record out of the buffer, and write it without holding
+      // the lock, so that the producer can keep adding records in the meantime.
+      //////////////////////////////////////////////////////////////////////////
+      {
+        unique_lock<mutex> lock (mutex_);
+        notEmpty_.wait (lock, [this] { return size_ || done_; });
+        if (!size_)
+          break;
+        record.swap (slots_[first_]);
+        first_ = (first_ + 1) % slots_.size ();
+        size_--;
+      }
+      notFull_.notify_one ();
+
+      (*out_) << record;
+      record.clear ();
+      //////////////////////////////////////////////////////////////////////////
+    }
+  out_->flush ();
+}
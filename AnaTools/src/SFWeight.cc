@@ -31,11 +31,17 @@ MuonSFWeight::MuonSFWeight (const string &sfFile, const string &dataOverMC)
 {
   TFile *fin = TFile::Open (sfFile.c_str ());
   TH2F* SF_Combined_TOT = (TH2F *) fin->Get(dataOverMC.c_str ());
-  muonSFWeight_ = (TH2F*)SF_Combined_TOT->Clone();
-  muonSFWeight_->GetEntries();// to avoid the crashing warning
+  muonSFWeight_ = BinnedLookup2D (*SF_Combined_TOT);
   delete SF_Combined_TOT;
   fin->Close ();
   delete fin;
+
+  // to give a non null SF for muons being out of eta and/or pt range of the input histo
+  const BinnedAxis &etaAxis = muonSFWeight_.xAxis (), &ptAxis = muonSFWeight_.yAxis ();
+  etaMax_ = etaAxis.binUpEdge (etaAxis.nBins ());
+  etaOutOfRange_ = (etaAxis.binUpEdge (etaAxis.nBins ()) + etaAxis.binUpEdge (etaAxis.nBins () - 1)) / 2;
+  ptOutOfRange_ = (ptAxis.binUpEdge (ptAxis.nBins () - 1) + ptAxis.binUpEdge (ptAxis.nBins () - 2)) / 2;
+  ptOutOfRangeBarrel_ = (ptAxis.binUpEdge (ptAxis.nBins ()) + ptAxis.binUpEdge (ptAxis.nBins () - 1)) / 2;
  }
 
 
@@ -45,30 +51,38 @@ MuonSFWeight::at(const double &eta, const double &pt, const int &shiftUpDown)
   double pt_hist= pt;
   double eta_hist= eta;
   // to give a non null SF for muons being out of eta and/or pt range of the input histo
-  if (pt > 300 && abs(eta) < muonSFWeight_->GetXaxis()->GetBinUpEdge(muonSFWeight_->GetXaxis()->GetLast()) )
+  if (pt > 300 && abs(eta) < etaMax_)
     {
-      pt_hist =( muonSFWeight_->GetYaxis()->GetBinUpEdge(muonSFWeight_->GetYaxis()->GetNbins() - 1) + muonSFWeight_->GetYaxis()->GetBinUpEdge(muonSFWeight_->GetYaxis()->GetNbins() - 2))/2;
+      pt_hist = ptOutOfRange_;
       if (pt > 300 && abs(eta) < 0.9)
         {
-          pt_hist =( muonSFWeight_->GetYaxis()->GetBinUpEdge(muonSFWeight_->GetYaxis()->GetNbins()) + muonSFWeight_->GetYaxis()->GetBinUpEdge(muonSFWeight_->GetYaxis()->GetNbins() - 1))/2;
+          pt_hist = ptOutOfRangeBarrel_;
         }
     }
-  else if (pt < 300 && abs(eta) > muonSFWeight_->GetXaxis()->GetBinUpEdge(muonSFWeight_->GetXaxis()->GetLast()))
+  else if (pt < 300 && abs(eta) > etaMax_)
     {
-      eta_hist =(muonSFWeight_->GetXaxis()->GetBinUpEdge(muonSFWeight_->GetXaxis()->GetLast()) + muonSFWeight_->GetXaxis()->GetBinUpEdge(muonSFWeight_->GetXaxis()->GetNbins() - 1))/2;
+      eta_hist = etaOutOfRange_;
     }
-  else if (pt > 300 && abs(eta) > muonSFWeight_->GetXaxis()->GetBinUpEdge(muonSFWeight_->GetXaxis()->GetLast()))
+  else if (pt > 300 && abs(eta) > etaMax_)
     {
-      pt_hist =( muonSFWeight_->GetYaxis()->GetBinUpEdge(muonSFWeight_->GetYaxis()->GetNbins() - 1) + muonSFWeight_->GetYaxis()->GetBinUpEdge(muonSFWeight_->GetYaxis()->GetNbins() - 2))/2;
-      eta_hist =(muonSFWeight_->GetXaxis()->GetBinUpEdge(muonSFWeight_->GetXaxis()->GetLast()) + muonSFWeight_->GetXaxis()->GetBinUpEdge(muonSFWeight_->GetXaxis()->GetNbins() - 1))/2;
+      pt_hist = ptOutOfRange_;
+      eta_hist = etaOutOfRange_;
     }
 
-  return muonSFWeight_->GetBinContent(muonSFWeight_->FindBin(abs(eta_hist),pt_hist)) + shiftUpDown * muonSFWeight_->GetBinError(muonSFWeight_->FindBin(abs(eta_hist),pt_hist));
+  int bin = muonSFWeight_.findBin(abs(eta_hist),pt_hist);
+  return muonSFWeight_.value(bin) + shiftUpDown * muonSFWeight_.error(bin);
+}
+
+void
+MuonSFWeight::at(const vector<double> &eta, const vector<double> &pt, vector<double> &scaleFactors, const int &shiftUpDown)
+{
+  scaleFactors.resize (eta.size ());
+  for (unsigned i = 0; i < eta.size (); i++)
+    scaleFactors[i] = at (eta[i], pt.at (i), shiftUpDown);
 }
 
 MuonSFWeight::~MuonSFWeight ()
 {
-  delete muonSFWeight_;
 }
 
 
@@ -76,15 +90,20 @@ MuonSFWeight::~MuonSFWeight ()
 ElectronSFWeight::ElectronSFWeight (const string &cmsswRelease, const string &id, const string &sfFile, const string &dataOverMC) :
   cmsswRelease_ (cmsswRelease),
   id_ (id),
-  electronSFWeight_ (NULL)
+  hasSFWeight_ (false),
+  etaOnYAxis_ (false)
 {
   ifstream finStream (sfFile);
   if (!finStream)
     return;
   finStream.close ();
   TFile *fin = TFile::Open (sfFile.c_str ());
-  electronSFWeight_ = (TH2F *) fin->Get (dataOverMC.c_str ());
-  electronSFWeight_->SetDirectory (0);
+  TH2F *dataOverMCHist = (TH2F *) fin->Get (dataOverMC.c_str ());
+  dataOverMCHist->SetDirectory (0);
+  electronSFWeight_ = BinnedLookup2D (*dataOverMCHist, BinnedAxis::CLAMP);
+  etaOnYAxis_ = strcasestr (dataOverMCHist->GetYaxis ()->GetTitle (), "eta");
+  hasSFWeight_ = true;
+  delete dataOverMCHist;
   fin->Close ();
   delete fin;
 }
@@ -94,23 +113,19 @@ ElectronSFWeight::at (const double &eta, const double &pt, const int &shiftUpDow
 {
   double scaleFactor = 1.0, minus = 0.0, plus = 0.0;
 
-  if (electronSFWeight_)
+  if (hasSFWeight_)
     {
       double x = eta, y = pt;
-      if (strcasestr (electronSFWeight_->GetYaxis ()->GetTitle (), "eta"))
+      if (etaOnYAxis_)
         {
           x = pt;
           y = eta;
         }
-      int xBin = electronSFWeight_->GetXaxis ()->FindBin (x),
-          yBin = electronSFWeight_->GetYaxis ()->FindBin (y);
-      xBin = min (xBin, electronSFWeight_->GetXaxis ()->GetNbins ());
-      xBin = max (xBin, 1);
-      yBin = min (yBin, electronSFWeight_->GetYaxis ()->GetNbins ());
-      yBin = max (yBin, 1);
-
-      scaleFactor = electronSFWeight_->GetBinContent (xBin, yBin);
-      minus = plus = electronSFWeight_->GetBinError (xBin, yBin);
+      // The lookup clamps the bins to the range of the histogram.
+      int bin = electronSFWeight_.findBin (x, y);
+
+      scaleFactor = electronSFWeight_.value (bin);
+      minus = plus = electronSFWeight_.error (bin);
     }
   else if (cmsswRelease_ == "53X")
     {
@@ -360,23 +375,28 @@ ElectronSFWeight::at (const double &eta, const double &pt, const int &shiftUpDow
   return scaleFactor + shiftUpDown * error;
 }
 
+void
+ElectronSFWeight::at (const vector<double> &eta, const vector<double> &pt, vector<double> &scaleFactors, const int &shiftUpDown)
+{
+  scaleFactors.resize (eta.size ());
+  for (unsigned i = 0; i < eta.size (); i++)
+    scaleFactors[i] = at (eta[i], pt.at (i), shiftUpDown);
+}
+
 ElectronSFWeight::~ElectronSFWeight ()
 {
-  if (electronSFWeight_)
-    delete electronSFWeight_;
 }
 
 double
 TriggerMetSFWeight::at(const double &Met, const int &shiftUpDown)
 {
-  int bin = triggerMetSFWeight_->FindBin(Met);
-  return 1.0 + triggerMetSFWeight_->GetBinContent(bin) + shiftUpDown * triggerMetSFWeight_->GetBinError(bin);\
+  int bin = triggerMetSFWeight_.findBin(Met);
+  return 1.0 + triggerMetSFWeight_.value(bin) + shiftUpDown * triggerMetSFWeight_.error(bin);\
   // Add 1.0 because the histogram bin content is (data-MC)/MC
 }
 
 TriggerMetSFWeight::~TriggerMetSFWeight ()
 {
-  delete triggerMetSFWeight_;
 }
 
 TriggerMetSFWeight::TriggerMetSFWeight (const string &sfFile, const string &dataOverMC)
@@ -384,8 +404,7 @@ TriggerMetSFWeight::TriggerMetSFWeight (const string &sfFile, const string &data
   TFile *fin = TFile::Open (sfFile.c_str ());
   TH1F* dataOverMCHist = (TH1F *) fin->Get(dataOverMC.c_str ());
   if (!dataOverMCHist) cout << "Fatal Error [TriggerMetSFWeight::TriggerMetSFWeight]:  could not find histogram " << dataOverMC << " in " << sfFile << endl;
-  triggerMetSFWeight_ = (TH1F*)  dataOverMCHist->Clone();
-  triggerMetSFWeight_->GetEntries();// to avoid the crashing warning
+  triggerMetSFWeight_ = BinnedLookup1D (*dataOverMCHist);
   delete dataOverMCHist;
   fin->Close ();
   delete fin;
@@ -395,13 +414,12 @@ TriggerMetSFWeight::TriggerMetSFWeight (const string &sfFile, const string &data
 double
 TrackNMissOutSFWeight::at(const double &NMissOut, const int &shiftUpDown)
 {
-  int bin = trackNMissOutSFWeight_->FindBin(NMissOut);
-  return 1.0 + trackNMissOutSFWeight_->GetBinContent(bin) + shiftUpDown * trackNMissOutSFWeight_->GetBinError(bin);  // Add 1.0 because the histogram bin content is (data-MC)/MC
+  int bin = trackNMissOutSFWeight_.findBin(NMissOut);
+  return 1.0 + trackNMissOutSFWeight_.value(bin) + shiftUpDown * trackNMissOutSFWeight_.error(bin);  // Add 1.0 because the histogram bin content is (data-MC)/MC
 }
 
 TrackNMissOutSFWeight::~TrackNMissOutSFWeight ()
 {
-  delete trackNMissOutSFWeight_;
 }
 
 
@@ -412,8 +430,7 @@ TrackNMissOutSFWeight::TrackNMissOutSFWeight (const string &sfFile, const string
   TFile *fin = TFile::Open (sfFile.c_str ());
   TH1F* dataOverMCHist = (TH1F *) fin->Get(dataOverMC.c_str ());
   if (!dataOverMCHist) cout << "Fatal Error [TrackNMissOutSFWeight::TrackNMissOutSFWeight]:  could not find histogram " << dataOverMC << " in " << sfFile << endl;
-  trackNMissOutSFWeight_ = (TH1F*)  dataOverMCHist->Clone();
-  trackNMissOutSFWeight_->GetEntries();  // to avoid the crashing warning
+  trackNMissOutSFWeight_ = BinnedLookup1D (*dataOverMCHist);
   delete dataOverMCHist;
   fin->Close ();
   delete fin;
@@ -423,13 +440,12 @@ TrackNMissOutSFWeight::TrackNMissOutSFWeight (const string &sfFile, const string
 double
 EcaloVarySFWeight::at(const double &EcaloVary, const int &shiftUpDown)
 {
-  int bin = EcaloVarySFWeight_->FindBin(EcaloVary);
-  return 1.0 + EcaloVarySFWeight_->GetBinContent(bin) + shiftUpDown * EcaloVarySFWeight_->GetBinError(bin);  // Add 1.0 because the histogram bin content is (data-MC)/MC
+  int bin = EcaloVarySFWeight_.findBin(EcaloVary);
+  return 1.0 + EcaloVarySFWeight_.value(bin) + shiftUpDown * EcaloVarySFWeight_.error(bin);  // Add 1.0 because the histogram bin content is (data-MC)/MC
 }
 
 EcaloVarySFWeight::~EcaloVarySFWeight ()
 {
-  delete EcaloVarySFWeight_;
 }
 
 EcaloVarySFWeight::EcaloVarySFWeight (const string &sfFile, const string &dataOverMC)
@@ -437,8 +453,7 @@ EcaloVarySFWeight::EcaloVarySFWeight (const string &sfFile, const string &dataOv
   TFile *fin = TFile::Open (sfFile.c_str ());
   TH1F* dataOverMCHist = (TH1F *) fin->Get(dataOverMC.c_str ());
   if (!dataOverMCHist) cout << "Fatal Error [EcaloVarySFWeight::EcaloVarySFWeight]:  could not find histogram " << dataOverMC << " in " << sfFile << endl;
-  EcaloVarySFWeight_ = (TH1F*)  dataOverMCHist->Clone();
-  EcaloVarySFWeight_->GetEntries();  // to avoid the crashing warning
+  EcaloVarySFWeight_ = BinnedLookup1D (*dataOverMCHist);
   delete dataOverMCHist;
   fin->Close ();
   delete fin;
@@ -450,10 +465,9 @@ IsrVarySFWeight::IsrVarySFWeight (const string &sfFile, const string &dataOverMC
   TFile *fin = TFile::Open (sfFile.c_str ());
   TH1F* dataOverMCHist = (TH1F *) fin->Get(dataOverMC.c_str ());
   if (!dataOverMCHist) cout << "Fatal Error [IsrVarySFWeight::IsrVarySFWeight]:  could not find histogram " << dataOverMC << " in " << sfFile << endl;
-  isrVarySFWeight_ = (TH1F*)  dataOverMCHist->Clone();
-  isrVarySFWeight_->GetEntries();// to avoid the crashing warning
+  isrVarySFWeight_ = BinnedLookup1D (*dataOverMCHist);
+  clog << "Will use hist " << dataOverMCHist->GetName() << " from file " << sfFile << " to do ISR reweighting." << endl;
   delete dataOverMCHist;
-  clog << "Will use hist " << isrVarySFWeight_->GetName() << " from file " << sfFile << " to do ISR reweighting." << endl;
   fin->Close ();
   delete fin;
  }
@@ -461,13 +475,12 @@ IsrVarySFWeight::IsrVarySFWeight (const string &sfFile, const string &dataOverMC
 double
 IsrVarySFWeight::at(const double &ptSusy, const int &shiftUpDown)
 {
-  int bin = isrVarySFWeight_->FindBin(ptSusy);
-  return 1.0 + isrVarySFWeight_->GetBinContent(bin) + shiftUpDown * isrVarySFWeight_->GetBinError(bin);  // Add 1.0 because the histogram bin content is (data-MC)/MC
+  int bin = isrVarySFWeight_.findBin(ptSusy);
+  return 1.0 + isrVarySFWeight_.value(bin) + shiftUpDown * isrVarySFWeight_.error(bin);  // Add 1.0 because the histogram bin content is (data-MC)/MC
 }
 
 IsrVarySFWeight::~IsrVarySFWeight ()
 {
-  delete isrVarySFWeight_;
 }
 
 
@@ -479,8 +492,7 @@ MuonCutWeight::MuonCutWeight (const string &sfFile, const string &dataOverMC)
   TFile *fin = TFile::Open (sfFile.c_str ());
   TH1F* dataOverMCHist = (TH1F *) fin->Get(dataOverMC.c_str ());
   if (!dataOverMCHist) cout << "Fatal Error [MuonCutWeight::MuonCutWeight]:  could not find histogram " << dataOverMC << " in " << sfFile << endl;
-  muonCutWeight_ = (TH1F*)  dataOverMCHist->Clone();
-  muonCutWeight_->GetEntries();  // to avoid the crashing warning
+  muonCutWeight_ = BinnedLookup1D (*dataOverMCHist);
   delete dataOverMCHist;
   fin->Close ();
   delete fin;
@@ -490,13 +502,12 @@ MuonCutWeight::MuonCutWeight (const string &sfFile, const string &dataOverMC)
 double
 MuonCutWeight::at(const double &pt)
 {
-  int bin = muonCutWeight_->FindBin(pt);
-  return  muonCutWeight_->GetBinContent(bin);
+  int bin = muonCutWeight_.findBin(pt);
+  return  muonCutWeight_.value(bin);
 }
 
 MuonCutWeight::~MuonCutWeight ()
 {
-  delete muonCutWeight_;
 }
 
 
@@ -506,8 +517,7 @@ ElectronCutWeight::ElectronCutWeight (const string &sfFile, const string &dataOv
   TFile *fin = TFile::Open (sfFile.c_str ());
   TH1F* dataOverMCHist = (TH1F *) fin->Get(dataOverMC.c_str ());
   if (!dataOverMCHist) cout << "Fatal Error [ElectronCutWeight::ElectronCutWeight]:  could not find histogram " << dataOverMC << " in " << sfFile << endl;
-  electronCutWeight_ = (TH1F*)  dataOverMCHist->Clone();
-  electronCutWeight_->GetEntries();  // to avoid the crashing warning
+  electronCutWeight_ = BinnedLookup1D (*dataOverMCHist);
   delete dataOverMCHist;
   fin->Close ();
   delete fin;
@@ -517,13 +527,12 @@ ElectronCutWeight::ElectronCutWeight (const string &sfFile, const string &dataOv
 double
 ElectronCutWeight::at(const double &pt)
 {
-  int bin = electronCutWeight_->FindBin(pt);
-  return  electronCutWeight_->GetBinContent(bin);
+  int bin = electronCutWeight_.findBin(pt);
+  return  electronCutWeight_.value(bin);
 }
 
 ElectronCutWeight::~ElectronCutWeight ()
 {
-  delete electronCutWeight_;
 }
 
 // RecoElectronWeight
@@ -532,8 +541,7 @@ RecoElectronWeight::RecoElectronWeight (const string &sfFile, const string &data
   TFile *fin = TFile::Open (sfFile.c_str ());
   TH1F* dataOverMCHist = (TH1F *) fin->Get(dataOverMC.c_str ());
   if (!dataOverMCHist) cout << "Fatal Error [RecoElectronWeight::RecoElectronWeight]:  could not find histogram " << dataOverMC << " in " << sfFile << endl;
-  recoElectronWeight_ = (TH1F*)  dataOverMCHist->Clone();
-  recoElectronWeight_->GetEntries();
+  recoElectronWeight_ = BinnedLookup1D (*dataOverMCHist);
   delete dataOverMCHist;
   fin->Close ();
   delete fin;
@@ -543,13 +551,12 @@ RecoElectronWeight::RecoElectronWeight (const string &sfFile, const string &data
 double
 RecoElectronWeight::at(const double &d0)
 {
-  int bin = recoElectronWeight_->FindBin(d0);
-  return recoElectronWeight_->GetBinContent(bin);
+  int bin = recoElectronWeight_.findBin(d0);
+  return recoElectronWeight_.value(bin);
 }
 
 RecoElectronWeight::~RecoElectronWeight ()
 {
-  delete recoElectronWeight_;
 }
 
 // RecoMuonWeight
@@ -558,8 +565,7 @@ RecoMuonWeight::RecoMuonWeight (const string &sfFile, const string &dataOverMC)
   TFile *fin = TFile::Open (sfFile.c_str ());
   TH1F* dataOverMCHist = (TH1F *) fin->Get(dataOverMC.c_str ());
   if (!dataOverMCHist) cout << "Fatal Error [RecoMuonWeight::RecoMuonWeight]:  could not find histogram " << dataOverMC << " in " << sfFile << endl;
-  recoMuonWeight_ = (TH1F*)  dataOverMCHist->Clone();
-  recoMuonWeight_->GetEntries();  // to avoid the crashing warning
+  recoMuonWeight_ = BinnedLookup1D (*dataOverMCHist);
   delete dataOverMCHist;
   fin->Close ();
   delete fin;
@@ -569,13 +575,12 @@ RecoMuonWeight::RecoMuonWeight (const string &sfFile, const string &dataOverMC)
 double
 RecoMuonWeight::at(const double &d0)
 {
-  int bin = recoMuonWeight_->FindBin(d0);
-  return  recoMuonWeight_->GetBinContent(bin);
+  int bin = recoMuonWeight_.findBin(d0);
+  return  recoMuonWeight_.value(bin);
 }
 
 RecoMuonWeight::~RecoMuonWeight ()
 {
-  delete recoMuonWeight_;
 }
 
 
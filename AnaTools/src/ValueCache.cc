@@ -0,0 +1,158 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+
+#include "OSUT3Analysis/AnaTools/interface/ValueCache.h"
+
+#define EXIT_CODE 4
+
+namespace
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // The cache of each stream, indexed by the stream, which is created the
+  // first time it is requested. Being static, the pointers start out NULL.
+  //////////////////////////////////////////////////////////////////////////////
+  atomic<ValueCache *>  caches[ValueCache::MAX_STREAMS];
+  //////////////////////////////////////////////////////////////////////////////
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Statistics summed over the caches of all the streams, which are printed
+  // when the job ends.
+  //////////////////////////////////////////////////////////////////////////////
+  atomic<unsigned long long>  totalValueHits (0);
+  atomic<unsigned long long>  totalValueMisses (0);
+  atomic<unsigned long long>  totalColumnHits (0);
+  atomic<unsigned long long>  totalColumnMisses (0);
+
+  struct ValueCacheSummary
+  {
+    ~ValueCacheSummary ()
+    {
+      // Deleting each cache adds its statistics to the totals.
+      for (unsigned i = 0; i < ValueCache::MAX_STREAMS; i++)
+        delete caches[i].exchange (NULL);
+
+      if (totalValueHits + totalValueMisses + totalColumnHits + totalColumnMisses == 0)
+        return;
+
+      clog << "=============================================" << endl;
+      clog << "ValueCache summary:" << endl;
+      clog << "  expression values:  " << totalValueHits << " hits, " << totalValueMisses << " misses" << endl;
+      clog << "  columns:            " << totalColumnHits << " hits, " << totalColumnMisses << " misses" << endl;
+      clog << "=============================================" << endl;
+    }
+  } summary;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+ValueCache::ValueCache () :
+  hasEvent_ (false),
+  valueHits_ (0),
+  valueMisses_ (0),
+  columnHits_ (0),
+  columnMisses_ (0)
+{
+}
+
+ValueCache::~ValueCache ()
+{
+  totalValueHits += valueHits_;
+  totalValueMisses += valueMisses_;
+  totalColumnHits += columnHits_;
+  totalColumnMisses += columnMisses_;
+}
+
+ValueCache &
+ValueCache::get (const unsigned stream)
+{
+  if (stream >= MAX_STREAMS)
+    {
+      clog << "ERROR: no ValueCache can be created for stream " << stream << ", since at most " << MAX_STREAMS << " streams are supported." << endl;
+      exit (EXIT_CODE);
+    }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // The cache of a stream is only used by the modules of that stream, which
+  // lock it themselves. It is created with a compare-and-swap, so that only
+  // one cache is ever kept for each stream, even if several of its modules ask
+  // for it at the same time.
+  //////////////////////////////////////////////////////////////////////////////
+  ValueCache *cache = caches[stream].load ();
+  if (!cache)
+    {
+      ValueCache *newCache = new ValueCache ();
+      if (caches[stream].compare_exchange_strong (cache, newCache))
+        cache = newCache;
+      else
+        delete newCache;
+    }
+  return *cache;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+void
+ValueCache::setEvent (const edm::EventID &event)
+{
+  lock_guard<mutex> lock (mutex_);
+  if (hasEvent_ && event == event_)
+    return;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // The keys contain the addresses of the collections, which are only
+  // meaningful within a single event, so everything is cleared.
+  //////////////////////////////////////////////////////////////////////////////
+  event_ = event;
+  hasEvent_ = true;
+  values_.clear ();
+  columns_.clear ();
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+bool
+ValueCache::getValues (const string &key, vector<Leaf> &values, vector<unsigned> &indices)
+{
+  lock_guard<mutex> lock (mutex_);
+  auto entry = values_.find (key);
+  if (entry == values_.end ())
+    {
+      valueMisses_++;
+      return false;
+    }
+
+  valueHits_++;
+  values = entry->second.first;
+  indices = entry->second.second;
+  return true;
+}
+
+void
+ValueCache::putValues (const string &key, const vector<Leaf> &values, const vector<unsigned> &indices)
+{
+  lock_guard<mutex> lock (mutex_);
+  if (hasEvent_)
+    values_[key] = make_pair (values, indices);
+}
+
+bool
+ValueCache::getColumn (const string &key, vector<double> &column)
+{
+  lock_guard<mutex> lock (mutex_);
+  auto entry = columns_.find (key);
+  if (entry == columns_.end ())
+    {
+      columnMisses_++;
+      return false;
+    }
+
+  columnHits_++;
+  column = entry->second;
+  return true;
+}
+
+void
+ValueCache::putColumn (const string &key, const vector<double> &column)
+{
+  lock_guard<mutex> lock (mutex_);
+  if (hasEvent_)
+    columns_[key] = column;
+}
@@ -1,56 +1,103 @@
 #include <iostream>
 #include <algorithm>
+#include <numeric>
+#include <sstream>
 
 #include "DataFormats/Math/interface/deltaR.h"
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/ValueCache.h"
 #include "OSUT3Analysis/AnaTools/interface/ValueLookupTree.h"
 
 ValueLookupTree::ValueLookupTree () :
   root_ (NULL),
-  evaluationError_ (false)
+  evaluationError_ (false),
+  isEvaluated_ (false),
+  hasDenseValues_ (false),
+  isCompiled_ (false),
+  useTreeWalker_ (false),
+  stackSize_ (0),
+  isColumnar_ (false),
+  isCacheable_ (false),
+  eventVariablesRun_ (0),
+  isInstrumented_ (false)
 {
 }
 
 ValueLookupTree::ValueLookupTree (const Cut &cut) :
   root_ (insert_ (cut.cutString, NULL)),
   inputCollections_ (cut.inputCollections),
-  evaluationError_ (false)
+  evaluationError_ (false),
+  isEvaluated_ (false),
+  hasDenseValues_ (false),
+  isCompiled_ (false),
+  useTreeWalker_ (false),
+  stackSize_ (0),
+  isColumnar_ (false),
+  isCacheable_ (false),
+  eventVariablesRun_ (0),
+  isInstrumented_ (false)
 {
   pruneCommas (root_);
   pruneParentheses (root_);
   pruneDots (root_);
 
   sort (inputCollections_.begin (), inputCollections_.end ());
+  bindAccessors (root_);
+  isCompiled_ = compile ();
 }
 
 ValueLookupTree::ValueLookupTree (const ValueToPrint &value) :
   root_ (insert_ (value.valueToPrint, NULL)),
   inputCollections_ (value.inputCollections),
-  evaluationError_ (false)
+  evaluationError_ (false),
+  isEvaluated_ (false),
+  hasDenseValues_ (false),
+  isCompiled_ (false),
+  useTreeWalker_ (false),
+  stackSize_ (0),
+  isColumnar_ (false),
+  isCacheable_ (false),
+  eventVariablesRun_ (0),
+  isInstrumented_ (false)
 {
   pruneCommas (root_);
   pruneParentheses (root_);
   pruneDots (root_);
 
   sort (inputCollections_.begin (), inputCollections_.end ());
+  bindAccessors (root_);
+  isCompiled_ = compile ();
 }
 
 ValueLookupTree::ValueLookupTree (const string &expression, const vector<string> &inputCollections) :
   root_ (insert_ (expression, NULL)),
   inputCollections_ (inputCollections),
-  evaluationError_ (false)
+  evaluationError_ (false),
+  isEvaluated_ (false),
+  hasDenseValues_ (false),
+  isCompiled_ (false),
+  useTreeWalker_ (false),
+  stackSize_ (0),
+  isColumnar_ (false),
+  isCacheable_ (false),
+  eventVariablesRun_ (0),
+  isInstrumented_ (false)
 {
   pruneCommas (root_);
   pruneParentheses (root_);
   pruneDots (root_);
 
   sort (inputCollections_.begin (), inputCollections_.end ());
+  bindAccessors (root_);
+  isCompiled_ = compile ();
 }
 
 ValueLookupTree::~ValueLookupTree ()
 {
   destroy (root_);
+  if (isInstrumented_)
+    Instrumentation::addExpression (instrumentationModule_, instrumentationKind_, instrumentationName_, stats_);
 }
 
 const Collections * const
@@ -66,8 +113,12 @@ ValueLookupTree::setCollections (Collections * const handles)
   //////////////////////////////////////////////////////////////////////////////
   handles_ = handles;
   values_.clear ();
+  evaluatedIndices_.clear ();
+  denseValues_.clear ();
+  isEvaluated_ = hasDenseValues_ = false;
   nCombinations_.clear ();
   collectionSizes_.clear ();
+  isRepeatedCollection_.clear ();
   nCombinations_.assign (inputCollections_.size (), 1);
   for (auto collection = inputCollections_.begin (); collection != inputCollections_.end (); collection++)
     {
@@ -75,7 +126,9 @@ ValueLookupTree::setCollections (Collections * const handles)
       for (unsigned i = 0; i < (collection - inputCollections_.begin () + 1); i++)
         nCombinations_[i] *= currentSize;
       collectionSizes_.push_back (currentSize);
+      isRepeatedCollection_.push_back (collection != inputCollections_.begin () && *collection == *(collection - 1));
     }
+  localIndices_.assign (inputCollections_.size (), 0);
   //////////////////////////////////////////////////////////////////////////////
 
   return handles_;
@@ -97,62 +150,176 @@ void
 ValueLookupTree::insert (const string &cut)
 {
   root_ = insert_ (cut, NULL);
+  isCompiled_ = false;
+}
+
+void
+ValueLookupTree::setUseTreeWalker (const bool useTreeWalker)
+{
+  useTreeWalker_ = useTreeWalker;
+}
+
+bool
+ValueLookupTree::isCompiled () const
+{
+  return isCompiled_;
+}
+
+void
+ValueLookupTree::setInstrumentationLabel (const string &module, const string &kind, const string &name)
+{
+  isInstrumented_ = Instrumentation::isEnabled ();
+  instrumentationModule_ = module;
+  instrumentationKind_ = kind;
+  instrumentationName_ = name;
 }
 
 const vector<Leaf> &
 ValueLookupTree::evaluate ()
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Returns the expression stored in the tree evaluated for every combination
+  // of objects. If some combinations were not evaluated, their default values
+  // are filled in the first time this method is called for an event.
+  //////////////////////////////////////////////////////////////////////////////
+  evaluateSparse ();
+  if (evaluatedIndices_.size () == getNumberOfCombinations ())
+    return values_;
+
+  if (!hasDenseValues_)
+    {
+      denseValues_.clear ();
+      denseValues_.reserve (getNumberOfCombinations ());
+      for (unsigned i = 0, j = 0; i < getNumberOfCombinations (); i++)
+        {
+          if (j < evaluatedIndices_.size () && evaluatedIndices_.at (j) == i)
+            denseValues_.push_back (values_.at (j++));
+          else
+            denseValues_.push_back (getDefaultValue (i));
+        }
+      hasDenseValues_ = true;
+    }
+
+  return denseValues_;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+const vector<Leaf> &
+ValueLookupTree::evaluateSparse ()
 {
   //////////////////////////////////////////////////////////////////////////////
   // The values_ vector contains the expression stored in the tree evaluated
-  // for each object. If it is empty when this method is called, it is filled.
-  // Then the method returns it as a reference.
+  // for each combination of objects which is unique and is not rejected
+  // early. If it has not been filled for this event when this method is
+  // called, it is filled. Then the method returns it as a reference.
   //////////////////////////////////////////////////////////////////////////////
-  if (!values_.size ())
+  if (!isEvaluated_)
     {
+      chrono::steady_clock::time_point start;
+      if (isInstrumented_)
+        start = chrono::steady_clock::now ();
+      bool isCached = false;
+
       evaluationError_ = false;
-      uservariablesToDelete_.clear ();
-      eventvariablesToDelete_.clear ();
-      for (unsigned i = 0; i < nCombinations_.at (0); i++)
+      resolveEventVariables ();
+      if (isCompiled_ && !useTreeWalker_)
         {
-          objIterators_.clear ();
-          shouldIterate_.clear ();
-          ObjMap objs;
-          unordered_set<string> keys;
-          for (auto collection = inputCollections_.begin (); collection != inputCollections_.end (); collection++)
+          //////////////////////////////////////////////////////////////////////
+          // Compiled expressions are looked up in the cache shared by all the
+          // trees in the job before they are evaluated.
+          //////////////////////////////////////////////////////////////////////
+          for (unsigned j = 0; j < inputCollections_.size (); j++)
+            {
+              collectionData_.at (j) = (char *) getCollectionData (inputCollections_.at (j), collectionStrides_.at (j));
+              collectionSelections_.at (j) = getSelection (inputCollections_.at (j));
+            }
+          userVariableValues_.resize (userVariables_.size ());
+          for (unsigned i = 0; i < userVariables_.size (); i++)
+            userVariableValues_.at (i) = getUserVariable (i);
+          eventVariableValues_.resize (eventVariables_.size ());
+          for (unsigned i = 0; i < eventVariables_.size (); i++)
+            eventVariableValues_.at (i) = getEventVariable (i);
+          string key;
+          if (isCacheable_)
+            {
+              collectionsKey_ = getCollectionsKey ();
+              key = programKey_ + collectionsKey_;
+            }
+          isCached = isCacheable_ && ValueCache::get (handles_->stream).getValues (key, values_, evaluatedIndices_);
+          if (!isCached)
             {
-              unsigned j = collection - inputCollections_.begin (),
-                       localIndex = getLocalIndex (i, j);
-              objs.insert ({*collection, {j, localIndex, getObject (*collection, localIndex)}});
-              keys.insert (*collection);
+              if (isColumnar_)
+                evaluateColumnar ();
+              else
+                evaluateCompiled ();
+              if (isCacheable_)
+                ValueCache::get (handles_->stream).putValues (key, values_, evaluatedIndices_);
             }
-          if (isUniqueCase (objs, keys)) { 
-            values_.push_back (evaluate_ (root_, objs));
-	    if (verbose_) { 
-	      cout << "ValueLookupTree::evaluate is adding the Leaf: " << endl;
-	      cout << "  " << evaluate_ (root_, objs) << endl;
-	      cout << "  printNode = " << endl;
-	      cout << "  " << printNode(root_) << endl;
-	      cout << "  printValue = " << endl;
-	      cout << "  " << printValue(root_) << endl;
-	    }
-
-	  } else
-            values_.push_back (INVALID_VALUE);
+          //////////////////////////////////////////////////////////////////////
         }
-#if IS_VALID(uservariables)
-      for (auto &uservariable : uservariablesToDelete_)
-        delete ((osu::Uservariable *) uservariable);
-#endif
-#if IS_VALID(eventvariables)
-      for (auto &eventvariable : eventvariablesToDelete_)
-        delete ((osu::Eventvariable *) eventvariable);
-#endif
+      else
+        evaluateTreeWalker ();
+      isEvaluated_ = true;
+
+      //////////////////////////////////////////////////////////////////////////
+      // Only the combinations which were actually evaluated are counted, not
+      // those whose values were found in the cache.
+      //////////////////////////////////////////////////////////////////////////
+      if (isInstrumented_)
+        {
+          stats_.evaluations++;
+          if (isCached)
+            stats_.cacheHits++;
+          else
+            stats_.combinations += evaluatedIndices_.size ();
+          for (const auto &value : values_)
+            {
+              const double * const v = boost::get<double> (&value);
+              if (v && IS_INVALID(*v))
+                stats_.invalidValues++;
+            }
+          stats_.seconds += chrono::duration<double> (chrono::steady_clock::now () - start).count ();
+        }
+      //////////////////////////////////////////////////////////////////////////
     }
 
   return values_;
   //////////////////////////////////////////////////////////////////////////////
 }
 
+const vector<unsigned> &
+ValueLookupTree::getEvaluatedIndices () const
+{
+  return evaluatedIndices_;
+}
+
+unsigned
+ValueLookupTree::getNumberOfCombinations () const
+{
+  return (nCombinations_.size () ? nCombinations_.at (0) : 0);
+}
+
+double
+ValueLookupTree::getDefaultValue (const unsigned globalIndex) const
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Returns the value of a combination which was not evaluated. Combinations
+  // which are not unique are invalid, as they always have been. Any other
+  // combination was rejected early because one of the top-level conjuncts of
+  // the expression is zero, so the value of the expression is zero.
+  //////////////////////////////////////////////////////////////////////////////
+  unsigned previousLocalIndex = 0;
+  for (unsigned j = 0; j < inputCollections_.size (); j++)
+    {
+      unsigned localIndex = getLocalIndex (globalIndex, j);
+      if (isRepeatedCollection_.at (j) && localIndex <= previousLocalIndex)
+        return INVALID_VALUE;
+      previousLocalIndex = localIndex;
+    }
+  return 0.0;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
 unsigned
 ValueLookupTree::getLocalIndex (unsigned globalIndex, unsigned collectionIndex) const
 {
@@ -168,7 +335,9 @@ ValueLookupTree::getLocalIndex (unsigned globalIndex, unsigned collectionIndex)
   // Global index:                 0  1  2  3  4  5  6  7  8
   // Local index for collection 0: 0  0  0  1  1  1  2  2  2
   // Local index for collection 1: 0  1  2  0  1  2  0  1  2 
-  // The function isUniqueCase() will return true only for global indices: 1, 2, 5. 
+  // To avoid double counting, only the unique combinations, i.e., those whose
+  // local indices are strictly increasing for repeated collections, are
+  // evaluated: global indices 1, 2, 5.
   //////////////////////////////////////////////////////////////////////////////
   if (collectionIndex + 1 != inputCollections_.size ())
     return ((globalIndex / nCombinations_.at (collectionIndex + 1)) % collectionSizes_.at (collectionIndex));
@@ -234,6 +403,11 @@ ValueLookupTree::getCollectionSize (const string &name) const
     exit(8);
   }
 
+  // A collection given as a selection has as many objects as were selected.
+  const vector<unsigned> *selection = getSelection (name);
+  if (selection)
+    return selection->size ();
+
   if (EQ_VALID(name,beamspots))
     return 1;
   else if (EQ_VALID(name,bxlumis))
@@ -272,19 +446,10 @@ ValueLookupTree::getCollectionSize (const string &name) const
     return handles_->pileupinfos->size ();
   else if (EQ_VALID(name,trigobjs))
     return handles_->trigobjs->size ();
-  else if (EQ_VALID(name,uservariables)){
-    // !!!
-    //    return handles_->uservariables[printValue(root_)].size ();
-    //    return handles_->uservariables["electronPt"].size ();
-    //cout << handles_->uservariables.at(printValue(root_)).size () << endl;
-    //    auto isFound = handles_->uservariables.size();
-    //    cout << printValue(root_) << endl;
-    //    cout << "\t" << isFound << endl;
-    return 1;  // FIXME
-  }
-  else if (EQ_VALID(name,eventvariables)){
-    return 1;  // FIXME
-  }
+  else if (EQ_VALID(name,uservariables))
+    return 1;  // user variables are only looked up as members of other collections
+  else if (EQ_VALID(name,eventvariables))
+    return 1;  // the variables of all the producers are taken as a single object
   return 0;
 }
 
@@ -314,6 +479,11 @@ bool
   else  if  (EQ_VALID(name,trigobjs))          isFound  =  handles_->trigobjs.isValid();
   else if (EQ_VALID(name,uservariables))       isFound = true; // This vector is always present, even if its size is 0.
   else if (EQ_VALID(name,eventvariables))      isFound = true; // This vector is always present, even if its size is 0.
+
+  // A collection given as a selection also needs the indices of the selected
+  // objects.
+  if (isFound && handles_->selections.count (name) && !handles_->selections.at (name).isValid ())
+    isFound = false;
   return isFound;
 
 }
@@ -452,6 +622,55 @@ ValueLookupTree::pruneDots_ (Node * const tree) const
   //////////////////////////////////////////////////////////////////////////////
 }
 
+void
+ValueLookupTree::bindAccessors (Node * const tree)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Recursively binds each member lookup in the tree to its accessor. These
+  // are the leaves whose values are evaluated with valueLookup, i.e., the
+  // second daughter of a dot with a collection on its left, and any other leaf
+  // which is neither a number nor a collection, in the case of a single input
+  // collection.
+  //////////////////////////////////////////////////////////////////////////////
+  if (!tree)
+    return;
+  for (const auto &branch : tree->branches)
+    bindAccessors (branch);
+
+  double value;
+  if (tree->value == "." && tree->branches.size () == 2 && !tree->branches.at (1)->branches.size ())
+    tree->branches.at (1)->accessor = getAccessor (tree->branches.at (0)->value + "s", tree->branches.at (1)->value);
+  else if (!tree->branches.size ()
+        && inputCollections_.size () == 1
+        && !isnumber (tree->value, value)
+        && !isCollection (tree->value + "s")
+        && !(tree->parent && tree->parent->value == "."))
+    tree->accessor = getAccessor (inputCollections_.at (0), tree->value);
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+const MemberAccessor *
+ValueLookupTree::getAccessor (const string &collection, const string &variable)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Returns the accessor for a variable of the given collection, caching it
+  // so that subsequent calls do not need to look up the type of the
+  // collection. User and event variables are not looked up with accessors, so
+  // NULL is returned for them.
+  //////////////////////////////////////////////////////////////////////////////
+  string name;
+  if (collection == "uservariables" || collection == "eventvariables" || isUserVariable (variable, name))
+    return NULL;
+
+  unordered_map<string, const MemberAccessor *> &accessorsOfCollection = accessors_[collection];
+  auto accessor = accessorsOfCollection.find (variable);
+  if (accessor == accessorsOfCollection.end ())
+    accessor = accessorsOfCollection.insert (make_pair (variable, &MemberAccessor::get (getCollectionType (collection), variable))).first;
+
+  return accessor->second;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
 Node *
 ValueLookupTree::insert_ (const string &cut, Node * const parent) const
 {
@@ -474,6 +693,7 @@ ValueLookupTree::insert_ (const string &cut, Node * const parent) const
   //////////////////////////////////////////////////////////////////////////////
   Node *tree = new Node;
   tree->parent = parent;
+  tree->accessor = NULL;
   if (!(insertBinaryInfixOperator  (cut,  tree,  {","})                           ||
         insertBinaryInfixOperator  (cut,  tree,  {"||", "|"})                     ||
         insertBinaryInfixOperator  (cut,  tree,  {"&&", "&"})                     ||
@@ -548,7 +768,13 @@ ValueLookupTree::evaluate_ (const Node * const tree, const ObjMap &objs)
   // The node is not a leaf and its value is an operator. First, evaluate its
   // daughters, then return the result of the operator acting on the daughters.
   //////////////////////////////////////////////////////////////////////////////
-  if (tree->branches.size ())
+  if (tree->value == "." && tree->branches.size () == 2 && !tree->branches.at (1)->branches.size ())
+    {
+      if (tree->branches.at (0)->value == "uservariable" && inputCollections_.size () == 1)
+        return valueLookup (inputCollections_.at (0), objs, "uservariable." + tree->branches.at (1)->value, true);
+      return valueLookup (tree->branches.at (0)->value + "s", objs, tree->branches.at (1)->value, true, tree->branches.at (1)->accessor);
+    }
+  else if (tree->branches.size ())
     {
       vector<Leaf> operands;
       for (const auto &branch : tree->branches)
@@ -583,7 +809,7 @@ ValueLookupTree::evaluate_ (const Node * const tree, const ObjMap &objs)
 			       << ", calling valueLookup for value: " << tree->value  
 			       << ", collection: " << inputCollections_.at (0)  
 			       << endl;
-            return valueLookup (inputCollections_.at (0), objs, tree->value);
+            return valueLookup (inputCollections_.at (0), objs, tree->value, true, tree->accessor);
 	  }
           clog << "ERROR: cannot infer ownership of \"" << tree->value << "\"" << endl;
           evaluationError_ = true;
@@ -743,8 +969,16 @@ ValueLookupTree::evaluateOperator (const string &op, const vector<Leaf> &operand
       else if (op == "abs" || op == "fabs")
         return (fabs (boost::get<double> (operands.at (0))));
       else if (op == "deltaPhi")
-        return deltaPhi (valueLookup (boost::get<string> (operands.at (0)) + "s", objs, "phi"),
-                         valueLookup (boost::get<string> (operands.at (1)) + "s", objs, "phi"));
+        {
+          double phi0, phi1;
+
+          // The lookups must be sequenced, since each one may move on to the
+          // next object in the collection.
+          phi0 = valueLookup (boost::get<string> (operands.at (0)) + "s", objs, "phi");
+          phi1 = valueLookup (boost::get<string> (operands.at (1)) + "s", objs, "phi");
+
+          return deltaPhi (phi0, phi1);
+        }
       else if (op == "deltaR")
         {
           double eta0, phi0, eta1, phi1;
@@ -790,9 +1024,948 @@ ValueLookupTree::evaluateOperator (const string &op, const vector<Leaf> &operand
   return INVALID_VALUE;
 }
 
+bool
+ValueLookupTree::compile ()
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Compiles the pruned tree into program_. The object iterators used by the
+  // tree walker are simulated with placeholder objects, so that each lookup is
+  // bound to the same input collection slot that valueLookup would use.
+  // Anything which the tree walker would not evaluate to a number, e.g., an
+  // unknown operator or a collection name used as a number, is not compiled,
+  // and the tree walker is used instead.
+  //////////////////////////////////////////////////////////////////////////////
+  program_.clear ();
+  stackSize_ = 0;
+  isColumnar_ = false;
+  isCacheable_ = false;
+  columnAccessors_.clear ();
+  userVariables_.clear ();
+  userVariableSlots_.clear ();
+  eventVariables_.clear ();
+  eventVariableSlots_.clear ();
+  if (!root_)
+    return false;
+
+  ObjMap objs;
+  for (auto collection = inputCollections_.begin (); collection != inputCollections_.end (); collection++)
+    {
+      unsigned j = collection - inputCollections_.begin ();
+      objs.insert ({*collection, {j, j, NULL}});
+    }
+  collectionData_.assign (inputCollections_.size (), NULL);
+  collectionStrides_.assign (inputCollections_.size (), 0);
+  collectionSelections_.assign (inputCollections_.size (), NULL);
+  objects_.assign (inputCollections_.size (), NULL);
+
+  objIterators_.clear ();
+  shouldIterate_.clear ();
+  unsigned depth = 0;
+  conjuncts_.clear ();
+  bool success = compileConjuncts (root_, objs, depth, conjuncts_) && depth == 1 && stackSize_ <= MAX_STACK_SIZE;
+  objIterators_.clear ();
+  shouldIterate_.clear ();
+
+  if (!success)
+    program_.clear ();
+  //////////////////////////////////////////////////////////////////////////////
+
+  //////////////////////////////////////////////////////////////////////////////
+  // With more than one input collection, any top-level conjunct, e.g.,
+  // "muon.pt > 25" in "muon.pt > 25 && invMass (muon, muon) > 70", which only
+  // looks at the object from one input collection is used to reject objects
+  // before the combinations are formed. A combination containing a rejected
+  // object is not evaluated, and its value is taken to be zero, even if
+  // another conjunct would have been invalid.
+  //////////////////////////////////////////////////////////////////////////////
+  rejectionFilters_.clear ();
+  if (success && inputCollections_.size () > 1 && conjuncts_.size () > 1)
+    {
+      for (const auto &conjunct : conjuncts_)
+        {
+          set<unsigned> slots;
+          for (unsigned i = conjunct.first; i < conjunct.second; i++)
+            {
+              if (program_.at (i).opcode == LOAD_MEMBER || program_.at (i).opcode == LOAD_EVENTVARIABLE || program_.at (i).opcode == LOAD_USERVARIABLE)
+                slots.insert (program_.at (i).slot);
+            }
+          if (slots.size () == 1)
+            rejectionFilters_.push_back ({*slots.begin (), conjunct.first, conjunct.second});
+        }
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  //////////////////////////////////////////////////////////////////////////////
+  // With a single input collection, every lookup is for the same object, so
+  // the program can be executed a column at a time. Each distinct member is
+  // assigned a column, so that it is only gathered once per event.
+  //////////////////////////////////////////////////////////////////////////////
+  if (success && inputCollections_.size () == 1)
+    {
+      isColumnar_ = true;
+      for (auto &instruction : program_)
+        {
+          if (instruction.opcode != LOAD_MEMBER)
+            continue;
+          auto column = find (columnAccessors_.begin (), columnAccessors_.end (), instruction.accessor);
+          instruction.column = column - columnAccessors_.begin ();
+          if (column == columnAccessors_.end ())
+            columnAccessors_.push_back (instruction.accessor);
+        }
+      memberColumns_.resize (columnAccessors_.size ());
+      stackColumns_.resize (stackSize_);
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Keys under which the values computed by this tree are stored in the
+  // ValueCache. Expressions involving user or event variables are not cached,
+  // and neither are those counting the objects in a collection which is not
+  // an input collection, since the key would not identify their values.
+  //////////////////////////////////////////////////////////////////////////////
+  isCacheable_ = success;
+  for (const auto &collection : inputCollections_)
+    isCacheable_ = isCacheable_ && collection != "uservariables" && collection != "eventvariables";
+  for (const auto &instruction : program_)
+    isCacheable_ = isCacheable_ && instruction.opcode != LOAD_USERVARIABLE && (instruction.opcode != NUMBER || find (inputCollections_.begin (), inputCollections_.end (), instruction.name) != inputCollections_.end ());
+
+  programKey_ = "";
+  columnKeys_.clear ();
+  conjunctKeys_.clear ();
+  if (isCacheable_)
+    {
+      programKey_ = getInstructionsKey (0, program_.size ());
+      for (const auto &accessor : columnAccessors_)
+        columnKeys_.push_back ("member " + accessor->type () + "::" + accessor->member () + ";");
+      if (isColumnar_ && conjuncts_.size () > 1)
+        {
+          for (const auto &conjunct : conjuncts_)
+            conjunctKeys_.push_back (getInstructionsKey (conjunct.first, conjunct.second));
+        }
+    }
+
+  return success;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+bool
+ValueLookupTree::compileConjuncts (const Node * const tree, const ObjMap &objs, unsigned &depth, vector<pair<unsigned, unsigned> > &conjuncts)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Compiles the tree exactly as compile_ does, but also records the range of
+  // program_ for each of the operands of the top-level logical ANDs.
+  //////////////////////////////////////////////////////////////////////////////
+  if (tree && (tree->value == "&&" || tree->value == "&") && tree->branches.size () == 2)
+    {
+      Instruction instruction = {AND, 0.0, 0, 0, 0, NULL, ""};
+      return compileConjuncts (tree->branches.at (0), objs, depth, conjuncts)
+          && compileConjuncts (tree->branches.at (1), objs, depth, conjuncts)
+          && emit (instruction, 2, depth);
+    }
+
+  unsigned first = program_.size ();
+  if (!compile_ (tree, objs, depth))
+    return false;
+  conjuncts.push_back (make_pair (first, (unsigned) program_.size ()));
+  return true;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+bool
+ValueLookupTree::compile_ (const Node * const tree, const ObjMap &objs, unsigned &depth)
+{
+  static const unordered_map<string, pair<Opcode, unsigned> > operators = {
+    {"||", {OR, 2}}, {"|", {OR, 2}}, {"&&", {AND, 2}}, {"&", {AND, 2}},
+    {"==", {EQUAL, 2}}, {"=", {EQUAL, 2}}, {"!=", {NOT_EQUAL, 2}},
+    {"<", {LESS, 2}}, {"<=", {LESS_EQUAL, 2}}, {">", {GREATER, 2}}, {">=", {GREATER_EQUAL, 2}},
+    {"*", {MULTIPLY, 2}}, {"/", {DIVIDE, 2}}, {"%", {MODULO, 2}}, {"!", {NOT, 1}},
+    {"atan2", {ATAN2, 2}}, {"ldexp", {LDEXP, 2}}, {"pow", {POW, 2}}, {"hypot", {HYPOT, 2}},
+    {"fmod", {FMOD, 2}}, {"remainder", {REMAINDER, 2}}, {"copysign", {COPYSIGN, 2}},
+    {"nextafter", {NEXTAFTER, 2}}, {"fdim", {FDIM, 2}},
+    {"fmax", {FMAX, 2}}, {"max", {FMAX, 2}}, {"fmin", {FMIN, 2}}, {"min", {FMIN, 2}},
+    {"cos", {COS, 1}}, {"sin", {SIN, 1}}, {"tan", {TAN, 1}},
+    {"acos", {ACOS, 1}}, {"asin", {ASIN, 1}}, {"atan", {ATAN, 1}},
+    {"cosh", {COSH, 1}}, {"sinh", {SINH, 1}}, {"tanh", {TANH, 1}},
+    {"acosh", {ACOSH, 1}}, {"asinh", {ASINH, 1}}, {"atanh", {ATANH, 1}},
+    {"exp", {EXP, 1}}, {"log", {LOG, 1}}, {"log10", {LOG10, 1}}, {"exp2", {EXP2, 1}},
+    {"expm1", {EXPM1, 1}}, {"ilogb", {ILOGB, 1}}, {"log1p", {LOG1P, 1}}, {"log2", {LOG2, 1}},
+    {"logb", {LOGB, 1}}, {"sqrt", {SQRT, 1}}, {"cbrt", {CBRT, 1}},
+    {"erf", {ERF, 1}}, {"erfc", {ERFC, 1}}, {"tgamma", {TGAMMA, 1}}, {"lgamma", {LGAMMA, 1}},
+    {"ceil", {CEIL, 1}}, {"floor", {FLOOR, 1}}, {"trunc", {TRUNC, 1}}, {"round", {ROUND, 1}},
+    {"rint", {RINT, 1}}, {"nearbyint", {NEARBYINT, 1}}, {"abs", {FABS, 1}}, {"fabs", {FABS, 1}}
+  };
+
+  Instruction instruction = {PUSH_CONSTANT, 0.0, 0, 0, 0, NULL, ""};
+  double value;
+
+  if (!tree)
+    return false;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Dots and leaves, which are either numbers or member lookups. Leaves which
+  // the tree walker would evaluate to strings cannot be used here.
+  //////////////////////////////////////////////////////////////////////////////
+  if (tree->value == "." && tree->branches.size () == 2 && !tree->branches.at (1)->branches.size ())
+    {
+      // With a single input collection, "uservariable.isoCorr" is a user
+      // variable of that collection.
+      if (tree->branches.at (0)->value == "uservariable" && inputCollections_.size () == 1)
+        return compileLookup (inputCollections_.at (0), "uservariable." + tree->branches.at (1)->value, NULL, true, objs, depth);
+      return compileLookup (tree->branches.at (0)->value + "s", tree->branches.at (1)->value, tree->branches.at (1)->accessor, true, objs, depth);
+    }
+  if (!tree->branches.size ())
+    {
+      if (isnumber (tree->value, value))
+        {
+          instruction.constant = value;
+          return emit (instruction, 0, depth);
+        }
+      if (isCollection (tree->value + "s") || (tree->parent && tree->parent->value == ".") || inputCollections_.size () != 1)
+        return false;
+      return compileLookup (inputCollections_.at (0), tree->value, tree->accessor, true, objs, depth);
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Operators whose operands are collections. The lookups are emitted in the
+  // same order, and with the same iteration, as in evaluateOperator.
+  //////////////////////////////////////////////////////////////////////////////
+  if (tree->value == "deltaPhi" || tree->value == "deltaR" || tree->value == "invMass" || tree->value == "number")
+    {
+      vector<string> collections;
+      for (const auto &branch : tree->branches)
+        {
+          if (!branch || branch->branches.size () || isnumber (branch->value, value) || !isCollection (branch->value + "s"))
+            return false;
+          collections.push_back (branch->value + "s");
+        }
+
+      if (tree->value == "number")
+        {
+          if (collections.size () != 1)
+            return false;
+          instruction.opcode = NUMBER;
+          instruction.name = collections.at (0);
+          return emit (instruction, 0, depth);
+        }
+      else if (tree->value == "deltaPhi")
+        {
+          if (collections.size () != 2
+           || !compileLookup (collections.at (0), "phi", NULL, true, objs, depth)
+           || !compileLookup (collections.at (1), "phi", NULL, true, objs, depth))
+            return false;
+          instruction.opcode = DELTA_PHI;
+          return emit (instruction, 2, depth);
+        }
+      else if (tree->value == "deltaR")
+        {
+          if (collections.size () != 2
+           || !compileLookup (collections.at (0), "eta", NULL, true,  objs, depth)
+           || !compileLookup (collections.at (0), "phi", NULL, false, objs, depth)
+           || !compileLookup (collections.at (1), "eta", NULL, true,  objs, depth)
+           || !compileLookup (collections.at (1), "phi", NULL, false, objs, depth))
+            return false;
+          instruction.opcode = DELTA_R;
+          return emit (instruction, 4, depth);
+        }
+      else
+        {
+          for (const auto &collection : collections)
+            {
+              if (!compileLookup (collection, "energy", NULL, true,  objs, depth)
+               || !compileLookup (collection, "px",     NULL, false, objs, depth)
+               || !compileLookup (collection, "py",     NULL, false, objs, depth)
+               || !compileLookup (collection, "pz",     NULL, false, objs, depth))
+                return false;
+            }
+          instruction.opcode = INV_MASS;
+          instruction.nOperands = collections.size ();
+          return emit (instruction, 4 * collections.size (), depth);
+        }
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  //////////////////////////////////////////////////////////////////////////////
+  // All other operators act on numbers, so their operands are compiled first.
+  // The number of operands must match exactly; otherwise the tree walker would
+  // either throw or silently ignore the extra operands.
+  //////////////////////////////////////////////////////////////////////////////
+  unsigned nOperands = tree->branches.size ();
+  if (tree->value == "+" || tree->value == "-")
+    {
+      if (nOperands == 1)
+        instruction.opcode = (tree->value == "+" ? UNARY_PLUS : NEGATE);
+      else if (nOperands == 2)
+        instruction.opcode = (tree->value == "+" ? PLUS : MINUS);
+      else
+        return false;
+    }
+  else
+    {
+      auto op = operators.find (tree->value);
+      if (op == operators.end () || op->second.second != nOperands)
+        return false;
+      instruction.opcode = op->second.first;
+    }
+
+  for (const auto &branch : tree->branches)
+    if (!compile_ (branch, objs, depth))
+      return false;
+  return emit (instruction, nOperands, depth);
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+bool
+ValueLookupTree::compileLookup (const string &collection, const string &variable, const MemberAccessor *accessor, const bool iterateObj, const ObjMap &objs, unsigned &depth)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Emits the instruction for looking up a variable in the given collection,
+  // advancing the placeholder object iterators exactly as valueLookup would.
+  // Fails if the lookup would run past the objects of this collection.
+  //////////////////////////////////////////////////////////////////////////////
+  auto range = objs.equal_range (collection);
+  if (range.first == range.second)
+    return false;
+  if (objIterators_.count (collection) && shouldIterate_.at (collection) && iterateObj && next (objIterators_.at (collection)) == range.second)
+    return false;
+
+  Instruction instruction = {PUSH_CONSTANT, 0.0, 0, 0, 0, NULL, ""};
+  instruction.slot = getDressedObject (collection, objs, iterateObj).collectionIndex;
+  string name;
+  if (collection == "uservariables")
+    instruction.constant = INVALID_VALUE;  // only accessible as members of other collections
+  else if (isUserVariable (variable, name))
+    {
+      //////////////////////////////////////////////////////////////////////////
+      // Each distinct user variable is given an index, which is the column of
+      // the instruction, so that its values are only found once per event.
+      //////////////////////////////////////////////////////////////////////////
+      auto userVariable = find (userVariables_.begin (), userVariables_.end (), make_pair (collection, name));
+      instruction.opcode = LOAD_USERVARIABLE;
+      instruction.column = userVariable - userVariables_.begin ();
+      instruction.name = name;
+      if (userVariable == userVariables_.end ())
+        {
+          userVariables_.push_back (make_pair (collection, name));
+          userVariableSlots_.push_back (make_pair (-1, 0));
+        }
+      //////////////////////////////////////////////////////////////////////////
+    }
+  else if (collection == "eventvariables")
+    {
+      // As for user variables, each distinct event variable is given an index.
+      auto eventVariable = find (eventVariables_.begin (), eventVariables_.end (), variable);
+      instruction.opcode = LOAD_EVENTVARIABLE;
+      instruction.column = eventVariable - eventVariables_.begin ();
+      instruction.name = variable;
+      if (eventVariable == eventVariables_.end ())
+        {
+          eventVariables_.push_back (variable);
+          eventVariableSlots_.push_back (make_pair (-1, 0));
+          eventVariableNames_.clear ();
+        }
+    }
+  else
+    {
+      instruction.opcode = LOAD_MEMBER;
+      instruction.accessor = (accessor ? accessor : getAccessor (collection, variable));
+    }
+
+  return emit (instruction, 0, depth);
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+bool
+ValueLookupTree::emit (const Instruction &instruction, const unsigned nOperands, unsigned &depth)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Appends an instruction which pops the given number of operands and pushes
+  // its result, keeping track of the maximum depth of the stack.
+  //////////////////////////////////////////////////////////////////////////////
+  if (depth < nOperands)
+    return false;
+  program_.push_back (instruction);
+  depth = depth - nOperands + 1;
+  stackSize_ = max (stackSize_, depth);
+  return true;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+string
+ValueLookupTree::getInstructionsKey (const unsigned first, const unsigned last) const
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Returns a canonical form of the instructions in the range [first, last),
+  // which is the same for any two expressions computing the same thing, e.g.,
+  // "abs (eta)" and "fabs (muon.eta)" with muons as the only input collection.
+  //////////////////////////////////////////////////////////////////////////////
+  stringstream key;
+  key.precision (17);
+  for (unsigned i = first; i < last; i++)
+    {
+      const Instruction &instruction = program_.at (i);
+      key << instruction.opcode;
+      if (instruction.opcode == PUSH_CONSTANT)
+        key << " " << instruction.constant;
+      else if (instruction.opcode == LOAD_MEMBER)
+        key << " " << instruction.slot << " " << instruction.accessor->type () << "::" << instruction.accessor->member ();
+      else if (instruction.opcode == LOAD_EVENTVARIABLE || instruction.opcode == LOAD_USERVARIABLE)
+        key << " " << instruction.slot << " " << instruction.name;
+      else if (instruction.opcode == NUMBER)
+        key << " " << instruction.name;
+      else if (instruction.opcode == INV_MASS)
+        key << " " << instruction.nOperands;
+      key << ";";
+    }
+  return key.str ();
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+string
+ValueLookupTree::getCollectionsKey () const
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Returns a string identifying the input collections in the current event,
+  // using the address of the first object and the size of each, and the
+  // address of the indices for a collection given as a selection.
+  //////////////////////////////////////////////////////////////////////////////
+  stringstream key;
+  for (unsigned j = 0; j < inputCollections_.size (); j++)
+    {
+      key << " " << inputCollections_.at (j) << "@" << (void *) collectionData_.at (j) << "/" << collectionSizes_.at (j);
+      if (collectionSelections_.at (j))
+        key << "[" << (const void *) collectionSelections_.at (j) << "]";
+    }
+  return key.str ();
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+void
+ValueLookupTree::evaluateTreeWalker ()
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Fills values_ by evaluating the tree recursively for each unique
+  // combination of objects.
+  //////////////////////////////////////////////////////////////////////////////
+  isAccepted_.assign (inputCollections_.size (), vector<bool> ());
+  for (bool first = true; nextCombination (first); first = false)
+    {
+      objIterators_.clear ();
+      shouldIterate_.clear ();
+      ObjMap objs;
+      for (auto collection = inputCollections_.begin (); collection != inputCollections_.end (); collection++)
+        {
+          unsigned j = collection - inputCollections_.begin (),
+                   localIndex = localIndices_.at (j);
+          objs.insert ({*collection, {j, localIndex, getObject (*collection, localIndex)}});
+        }
+      values_.push_back (evaluate_ (root_, objs));
+      evaluatedIndices_.push_back (getGlobalIndex ());
+      if (verbose_) { 
+        cout << "ValueLookupTree::evaluate is adding the Leaf: " << endl;
+        cout << "  " << values_.back () << endl;
+        cout << "  printNode = " << endl;
+        cout << "  " << printNode(root_) << endl;
+        cout << "  printValue = " << endl;
+        cout << "  " << printValue(root_) << endl;
+      }
+    }
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+void
+ValueLookupTree::evaluateCompiled ()
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Fills values_ by executing the compiled instructions for each unique
+  // combination of objects which is not rejected early. The address of each
+  // object is computed directly from the start of its collection, which has
+  // already been retrieved by evaluateSparse.
+  //////////////////////////////////////////////////////////////////////////////
+  rejectObjects ();
+
+  for (bool first = true; nextCombination (first); first = false)
+    {
+      for (unsigned j = 0; j < inputCollections_.size (); j++)
+        objects_.at (j) = getObjectAddress (j, localIndices_.at (j));
+      values_.push_back (execute (0, program_.size ()));
+      evaluatedIndices_.push_back (getGlobalIndex ());
+    }
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+void
+ValueLookupTree::rejectObjects ()
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Evaluates each rejection filter once for every object in its input
+  // collection. An object is rejected if any of its filters is exactly zero,
+  // in which case every combination containing it is zero as well.
+  //////////////////////////////////////////////////////////////////////////////
+  isAccepted_.assign (inputCollections_.size (), vector<bool> ());
+  for (const auto &filter : rejectionFilters_)
+    {
+      vector<bool> &isAccepted = isAccepted_.at (filter.slot);
+      isAccepted.resize (collectionSizes_.at (filter.slot), true);
+      for (unsigned i = 0; i < collectionSizes_.at (filter.slot); i++)
+        {
+          if (!isAccepted.at (i))
+            continue;
+          objects_.at (filter.slot) = getObjectAddress (filter.slot, i);
+          isAccepted.at (i) = (execute (filter.first, filter.last) != 0.0);
+        }
+    }
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+bool
+ValueLookupTree::nextCombination (const bool first)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Advances localIndices_ to the next combination in order of increasing
+  // global index. Rather than enumerating every combination, each index only
+  // runs over the objects which are accepted, and, for a repeated collection,
+  // starts just after the index of the previous collection. When an index
+  // runs past the end of its collection, the one before it is advanced.
+  //////////////////////////////////////////////////////////////////////////////
+  const int nCollections = inputCollections_.size ();
+  int j = (first ? 0 : nCollections - 1);
+  if (!nCollections)
+    return false;
+  if (first)
+    localIndices_.at (0) = 0;
+  else
+    localIndices_.at (j)++;
+
+  while (j >= 0)
+    {
+      const vector<bool> &isAccepted = isAccepted_.at (j);
+      unsigned &localIndex = localIndices_.at (j);
+      while (localIndex < collectionSizes_.at (j) && isAccepted.size () && !isAccepted.at (localIndex))
+        localIndex++;
+
+      if (localIndex >= collectionSizes_.at (j))
+        {
+          if (--j >= 0)
+            localIndices_.at (j)++;
+        }
+      else if (j + 1 == nCollections)
+        return true;
+      else
+        {
+          j++;
+          localIndices_.at (j) = (isRepeatedCollection_.at (j) ? localIndex + 1 : 0);
+        }
+    }
+
+  return false;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+unsigned
+ValueLookupTree::getGlobalIndex () const
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Returns the global index of the combination in localIndices_, i.e., the
+  // inverse of getLocalIndex().
+  //////////////////////////////////////////////////////////////////////////////
+  unsigned globalIndex = 0;
+  for (unsigned j = 0; j < inputCollections_.size (); j++)
+    globalIndex = globalIndex * collectionSizes_.at (j) + localIndices_.at (j);
+  return globalIndex;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+void
+ValueLookupTree::evaluateColumnar ()
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Fills values_ by executing the compiled instructions once for all the
+  // objects in the single input collection. Each member is first gathered
+  // into its own column, after which every instruction is a loop over the
+  // columns on top of the stack. Invalid values are propagated exactly as in
+  // execute, but without branching, so that the loops can be vectorized.
+  // The member columns, and the result of each top-level conjunct, are shared
+  // with other trees through the ValueCache.
+  //////////////////////////////////////////////////////////////////////////////
+#define UNARY(f)  for (unsigned i = 0; i < size; i++) { const double a = x[i]; x[i] = (IS_INVALID(a) ? INVALID_VALUE : (f)); }
+#define BINARY(f) for (unsigned i = 0; i < size; i++) { const double a = x[i], b = y[i]; x[i] = ((IS_INVALID(a) | IS_INVALID(b)) ? INVALID_VALUE : (f)); }
+
+  const unsigned size = nCombinations_.at (0);
+  const size_t stride = collectionStrides_.at (0);
+  char * const data = collectionData_.at (0);
+  const vector<unsigned> * const selection = collectionSelections_.at (0);
+  ValueCache &cache = ValueCache::get (handles_->stream);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Gather each member which is used into a contiguous column, unless it has
+  // already been gathered for this collection by another tree.
+  //////////////////////////////////////////////////////////////////////////////
+  for (unsigned column = 0; column < columnAccessors_.size (); column++)
+    {
+      const MemberAccessor &accessor = *columnAccessors_.at (column);
+      vector<double> &values = memberColumns_.at (column);
+      if (isCacheable_ && cache.getColumn (columnKeys_.at (column) + collectionsKey_, values))
+        continue;
+      values.resize (size);
+      if (isInstrumented_)
+        stats_.memberLookups += size;
+      for (unsigned i = 0; i < size; i++)
+        {
+          try
+            {
+              values[i] = accessor (data + (selection ? (*selection)[i] : i) * stride);
+            }
+          catch (...)
+            {
+              values[i] = INVALID_VALUE;
+            }
+        }
+      if (isCacheable_)
+        cache.putColumn (columnKeys_.at (column) + collectionsKey_, values);
+    }
+  for (auto &column : stackColumns_)
+    column.resize (size);
+  //////////////////////////////////////////////////////////////////////////////
+
+  unsigned n = 0, iConjunct = 0;
+  for (unsigned iInstruction = 0; iInstruction < program_.size (); iInstruction++)
+    {
+      const Instruction &instruction = program_[iInstruction];
+
+      //////////////////////////////////////////////////////////////////////////
+      // If this instruction begins a top-level conjunct whose result is
+      // already cached, the result is pushed and the conjunct is skipped.
+      //////////////////////////////////////////////////////////////////////////
+      if (iConjunct < conjunctKeys_.size () && conjuncts_.at (iConjunct).first == iInstruction)
+        {
+          if (cache.getColumn (conjunctKeys_.at (iConjunct) + collectionsKey_, stackColumns_[n]))
+            {
+              n++;
+              iInstruction = conjuncts_.at (iConjunct++).second - 1;
+              continue;
+            }
+        }
+      //////////////////////////////////////////////////////////////////////////
+
+      //////////////////////////////////////////////////////////////////////////
+      // x is the column on which the result of the instruction is stored, and
+      // y is the column above it, for instructions with two operands.
+      //////////////////////////////////////////////////////////////////////////
+      unsigned nOperands = 0;
+      switch (instruction.opcode)
+        {
+          case PUSH_CONSTANT: case LOAD_MEMBER: case LOAD_EVENTVARIABLE: case LOAD_USERVARIABLE: case NUMBER:
+            nOperands = 0;
+            break;
+          case DELTA_R:
+            nOperands = 4;
+            break;
+          case INV_MASS:
+            nOperands = 4 * instruction.nOperands;
+            break;
+          case UNARY_PLUS: case NEGATE: case NOT:
+          case COS: case SIN: case TAN: case ACOS: case ASIN: case ATAN:
+          case COSH: case SINH: case TANH: case ACOSH: case ASINH: case ATANH:
+          case EXP: case LOG: case LOG10: case EXP2: case EXPM1: case ILOGB: case LOG1P: case LOG2: case LOGB:
+          case SQRT: case CBRT: case ERF: case ERFC: case TGAMMA: case LGAMMA:
+          case CEIL: case FLOOR: case TRUNC: case ROUND: case RINT: case NEARBYINT: case FABS:
+            nOperands = 1;
+            break;
+          default:
+            nOperands = 2;
+            break;
+        }
+      n -= nOperands;
+      double * const x = stackColumns_[n].data ();
+      const double * const y = (n + 1 < stackColumns_.size () ? stackColumns_[n + 1].data () : NULL);
+      //////////////////////////////////////////////////////////////////////////
+
+      switch (instruction.opcode)
+        {
+          case PUSH_CONSTANT:
+            fill (x, x + size, instruction.constant);
+            break;
+          case LOAD_MEMBER:
+            copy (memberColumns_[instruction.column].begin (), memberColumns_[instruction.column].end (), x);
+            break;
+          case LOAD_EVENTVARIABLE:
+            fill (x, x + size, (eventVariableValues_[instruction.column] ? *eventVariableValues_[instruction.column] : INVALID_VALUE));
+            break;
+          case LOAD_USERVARIABLE:
+            {
+              const vector<double> * const values = userVariableValues_[instruction.column];
+              for (unsigned i = 0; i < size; i++)
+                {
+                  const unsigned index = (selection ? (*selection)[i] : i);
+                  x[i] = (values && index < values->size () ? (*values)[index] : INVALID_VALUE);
+                }
+            }
+            break;
+          case NUMBER:
+            fill (x, x + size, (double) getCollectionSize (instruction.name));
+            break;
+
+          case OR:             BINARY(a || b);                  break;
+          case AND:            BINARY(a && b);                  break;
+          case EQUAL:          BINARY(a == b);                  break;
+          case NOT_EQUAL:      BINARY(a != b);                  break;
+          case LESS:           BINARY(a < b);                   break;
+          case LESS_EQUAL:     BINARY(a <= b);                  break;
+          case GREATER:        BINARY(a > b);                   break;
+          case GREATER_EQUAL:  BINARY(a >= b);                  break;
+          case PLUS:           BINARY(a + b);                   break;
+          case MINUS:          BINARY(a - b);                   break;
+          case MULTIPLY:       BINARY(a * b);                   break;
+          case DIVIDE:         BINARY(a / b);                   break;
+          case MODULO:         BINARY((int) a % (int) b);       break;
+          case UNARY_PLUS:     UNARY(+a);                       break;
+          case NEGATE:         UNARY(-a);                       break;
+          case NOT:            UNARY(!a);                       break;
+          case ATAN2:          BINARY(atan2 (a, b));            break;
+          case LDEXP:          BINARY(ldexp (a, b));            break;
+          case POW:            BINARY(pow (a, b));              break;
+          case HYPOT:          BINARY(hypot (a, b));            break;
+          case FMOD:           BINARY(fmod (a, b));             break;
+          case REMAINDER:      BINARY(remainder (a, b));        break;
+          case COPYSIGN:       BINARY(copysign (a, b));         break;
+          case NEXTAFTER:      BINARY(nextafter (a, b));        break;
+          case FDIM:           BINARY(fdim (a, b));             break;
+          case FMAX:           BINARY(fmax (a, b));             break;
+          case FMIN:           BINARY(fmin (a, b));             break;
+          case COS:            UNARY(cos (a));                  break;
+          case SIN:            UNARY(sin (a));                  break;
+          case TAN:            UNARY(tan (a));                  break;
+          case ACOS:           UNARY(acos (a));                 break;
+          case ASIN:           UNARY(asin (a));                 break;
+          case ATAN:           UNARY(atan (a));                 break;
+          case COSH:           UNARY(cosh (a));                 break;
+          case SINH:           UNARY(sinh (a));                 break;
+          case TANH:           UNARY(tanh (a));                 break;
+          case ACOSH:          UNARY(acosh (a));                break;
+          case ASINH:          UNARY(asinh (a));                break;
+          case ATANH:          UNARY(atanh (a));                break;
+          case EXP:            UNARY(exp (a));                  break;
+          case LOG:            UNARY(log (a));                  break;
+          case LOG10:          UNARY(log10 (a));                break;
+          case EXP2:           UNARY(exp2 (a));                 break;
+          case EXPM1:          UNARY(expm1 (a));                break;
+          case ILOGB:          UNARY(ilogb (a));                break;
+          case LOG1P:          UNARY(log1p (a));                break;
+          case LOG2:           UNARY(log2 (a));                 break;
+          case LOGB:           UNARY(logb (a));                 break;
+          case SQRT:           UNARY(sqrt (a));                 break;
+          case CBRT:           UNARY(cbrt (a));                 break;
+          case ERF:            UNARY(erf (a));                  break;
+          case ERFC:           UNARY(erfc (a));                 break;
+          case TGAMMA:         UNARY(tgamma (a));               break;
+          case LGAMMA:         UNARY(lgamma (a));               break;
+          case CEIL:           UNARY(ceil (a));                 break;
+          case FLOOR:          UNARY(floor (a));                break;
+          case TRUNC:          UNARY(trunc (a));                break;
+          case ROUND:          UNARY(round (a));                break;
+          case RINT:           UNARY(rint (a));                 break;
+          case NEARBYINT:      UNARY(nearbyint (a));            break;
+          case FABS:           UNARY(fabs (a));                 break;
+
+          case DELTA_PHI:
+            for (unsigned i = 0; i < size; i++)
+              x[i] = deltaPhi (x[i], y[i]);
+            break;
+          case DELTA_R:
+            {
+              const double * const z = stackColumns_[n + 2].data (),
+                           * const w = stackColumns_[n + 3].data ();
+              for (unsigned i = 0; i < size; i++)
+                x[i] = deltaR (x[i], y[i], z[i], w[i]);
+            }
+            break;
+          case INV_MASS:
+            for (unsigned i = 0; i < size; i++)
+              {
+                double energy = 0.0, px = 0.0, py = 0.0, pz = 0.0;
+                for (unsigned j = n; j < n + 4 * instruction.nOperands; j += 4)
+                  {
+                    energy += stackColumns_[j][i];
+                    px += stackColumns_[j + 1][i];
+                    py += stackColumns_[j + 2][i];
+                    pz += stackColumns_[j + 3][i];
+                  }
+                x[i] = sqrt (energy * energy - px * px - py * py - pz * pz);
+              }
+            break;
+        }
+      n++;
+
+      if (iConjunct < conjunctKeys_.size () && conjuncts_.at (iConjunct).second == iInstruction + 1)
+        cache.putColumn (conjunctKeys_.at (iConjunct++) + collectionsKey_, stackColumns_[n - 1]);
+    }
+
+#undef UNARY
+#undef BINARY
+
+  values_.assign (stackColumns_.at (0).begin (), stackColumns_.at (0).end ());
+  evaluatedIndices_.resize (size);
+  iota (evaluatedIndices_.begin (), evaluatedIndices_.end (), 0);
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+double
+ValueLookupTree::execute (const unsigned first, const unsigned last)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Executes the compiled instructions in the range [first, last) for the
+  // objects in objects_, using a fixed-size stack. As in evaluateOperator, any operator acting on an
+  // invalid value returns an invalid value, with the exception of deltaPhi,
+  // deltaR, and invMass, whose operands are collections.
+  //////////////////////////////////////////////////////////////////////////////
+#define UNARY(f)  { const double a = stack[n - 1]; stack[n - 1] = (IS_INVALID(a) ? INVALID_VALUE : (f)); }
+#define BINARY(f) { const double a = stack[n - 2], b = stack[n - 1]; n--; stack[n - 1] = ((IS_INVALID(a) || IS_INVALID(b)) ? INVALID_VALUE : (f)); }
+
+  double stack[MAX_STACK_SIZE];
+  unsigned n = 0;
+
+  for (unsigned i = first; i < last; i++)
+    {
+      const Instruction &instruction = program_[i];
+      switch (instruction.opcode)
+        {
+          case PUSH_CONSTANT:
+            stack[n++] = instruction.constant;
+            break;
+          case LOAD_MEMBER:
+            {
+              double value;
+              if (isInstrumented_)
+                stats_.memberLookups++;
+              try
+                {
+                  value = (*instruction.accessor) (objects_[instruction.slot]);
+                }
+              catch (...)
+                {
+                  value = INVALID_VALUE;
+                }
+              stack[n++] = value;
+            }
+            break;
+          case LOAD_EVENTVARIABLE:
+            stack[n++] = (eventVariableValues_[instruction.column] ? *eventVariableValues_[instruction.column] : INVALID_VALUE);
+            break;
+          case LOAD_USERVARIABLE:
+            {
+              const vector<double> * const values = userVariableValues_[instruction.column];
+              const unsigned index = getObjectIndex (instruction.slot);
+              stack[n++] = (values && index < values->size () ? (*values)[index] : INVALID_VALUE);
+            }
+            break;
+          case NUMBER:
+            stack[n++] = getCollectionSize (instruction.name);
+            break;
+
+          case OR:             BINARY(a || b);                  break;
+          case AND:            BINARY(a && b);                  break;
+          case EQUAL:          BINARY(a == b);                  break;
+          case NOT_EQUAL:      BINARY(a != b);                  break;
+          case LESS:           BINARY(a < b);                   break;
+          case LESS_EQUAL:     BINARY(a <= b);                  break;
+          case GREATER:        BINARY(a > b);                   break;
+          case GREATER_EQUAL:  BINARY(a >= b);                  break;
+          case PLUS:           BINARY(a + b);                   break;
+          case MINUS:          BINARY(a - b);                   break;
+          case MULTIPLY:       BINARY(a * b);                   break;
+          case DIVIDE:         BINARY(a / b);                   break;
+          case MODULO:         BINARY((int) a % (int) b);       break;
+          case UNARY_PLUS:     UNARY(+a);                       break;
+          case NEGATE:         UNARY(-a);                       break;
+          case NOT:            UNARY(!a);                       break;
+          case ATAN2:          BINARY(atan2 (a, b));            break;
+          case LDEXP:          BINARY(ldexp (a, b));            break;
+          case POW:            BINARY(pow (a, b));              break;
+          case HYPOT:          BINARY(hypot (a, b));            break;
+          case FMOD:           BINARY(fmod (a, b));             break;
+          case REMAINDER:      BINARY(remainder (a, b));        break;
+          case COPYSIGN:       BINARY(copysign (a, b));         break;
+          case NEXTAFTER:      BINARY(nextafter (a, b));        break;
+          case FDIM:           BINARY(fdim (a, b));             break;
+          case FMAX:           BINARY(fmax (a, b));             break;
+          case FMIN:           BINARY(fmin (a, b));             break;
+          case COS:            UNARY(cos (a));                  break;
+          case SIN:            UNARY(sin (a));                  break;
+          case TAN:            UNARY(tan (a));                  break;
+          case ACOS:           UNARY(acos (a));                 break;
+          case ASIN:           UNARY(asin (a));                 break;
+          case ATAN:           UNARY(atan (a));                 break;
+          case COSH:           UNARY(cosh (a));                 break;
+          case SINH:           UNARY(sinh (a));                 break;
+          case TANH:           UNARY(tanh (a));                 break;
+          case ACOSH:          UNARY(acosh (a));                break;
+          case ASINH:          UNARY(asinh (a));                break;
+          case ATANH:          UNARY(atanh (a));                break;
+          case EXP:            UNARY(exp (a));                  break;
+          case LOG:            UNARY(log (a));                  break;
+          case LOG10:          UNARY(log10 (a));                break;
+          case EXP2:           UNARY(exp2 (a));                 break;
+          case EXPM1:          UNARY(expm1 (a));                break;
+          case ILOGB:          UNARY(ilogb (a));                break;
+          case LOG1P:          UNARY(log1p (a));                break;
+          case LOG2:           UNARY(log2 (a));                 break;
+          case LOGB:           UNARY(logb (a));                 break;
+          case SQRT:           UNARY(sqrt (a));                 break;
+          case CBRT:           UNARY(cbrt (a));                 break;
+          case ERF:            UNARY(erf (a));                  break;
+          case ERFC:           UNARY(erfc (a));                 break;
+          case TGAMMA:         UNARY(tgamma (a));               break;
+          case LGAMMA:         UNARY(lgamma (a));               break;
+          case CEIL:           UNARY(ceil (a));                 break;
+          case FLOOR:          UNARY(floor (a));                break;
+          case TRUNC:          UNARY(trunc (a));                break;
+          case ROUND:          UNARY(round (a));                break;
+          case RINT:           UNARY(rint (a));                 break;
+          case NEARBYINT:      UNARY(nearbyint (a));            break;
+          case FABS:           UNARY(fabs (a));                 break;
+
+          case DELTA_PHI:
+            stack[n - 2] = deltaPhi (stack[n - 2], stack[n - 1]);
+            n--;
+            break;
+          case DELTA_R:
+            stack[n - 4] = deltaR (stack[n - 4], stack[n - 3], stack[n - 2], stack[n - 1]);
+            n -= 3;
+            break;
+          case INV_MASS:
+            {
+              double energy = 0.0, px = 0.0, py = 0.0, pz = 0.0;
+              n -= 4 * instruction.nOperands;
+              for (unsigned j = n; j < n + 4 * instruction.nOperands; j += 4)
+                {
+                  energy += stack[j];
+                  px += stack[j + 1];
+                  py += stack[j + 2];
+                  pz += stack[j + 3];
+                }
+              stack[n++] = sqrt (energy * energy - px * px - py * py - pz * pz);
+            }
+            break;
+        }
+    }
+
+#undef UNARY
+#undef BINARY
+
+  return stack[0];
+  //////////////////////////////////////////////////////////////////////////////
+}
+
 void *
-ValueLookupTree::getObject (const string &name, const unsigned i)
+ValueLookupTree::getObject (const string &name, const unsigned localIndex)
 {
+  // For a collection given as a selection, the local index counts only the
+  // selected objects.
+  const vector<unsigned> *selection = getSelection (name);
+  const unsigned i = (selection ? selection->at (localIndex) : localIndex);
+
+
   if (EQ_VALID(name,beamspots))
     return ((void *) &(*handles_->beamspots));
   else if (EQ_VALID(name,bxlumis))
@@ -832,24 +2005,236 @@ ValueLookupTree::getObject (const string &name, const unsigned i)
   else if (EQ_VALID(name,trigobjs))
     return ((void *) &handles_->trigobjs->at (i));
   else if (EQ_VALID(name,uservariables))
+    return ((void *) &handles_->uservariables);
+  else if (EQ_VALID(name,eventvariables))
+    return ((void *) &handles_->eventvariables);
+  return NULL;
+}
+
+const vector<unsigned> *
+ValueLookupTree::getSelection (const string &name) const
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Returns the indices of the selected objects if the named collection is
+  // given as the unfiltered collection and a selection made by an
+  // ObjectSelector, or NULL if every object in the collection is used.
+  //////////////////////////////////////////////////////////////////////////////
+  const auto selection = handles_->selections.find (name);
+  if (selection == handles_->selections.end () || !selection->second.isValid ())
+    return NULL;
+  return selection->second.product ();
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+char *
+ValueLookupTree::getObjectAddress (const unsigned j, const unsigned i) const
+{
+  // Returns the address of the object with local index i in the j-th input
+  // collection, going through the indices of the selected objects if there
+  // are any.
+  const vector<unsigned> * const selection = collectionSelections_[j];
+  return collectionData_[j] + (selection ? (*selection)[i] : i) * collectionStrides_[j];
+}
+
+unsigned
+ValueLookupTree::getObjectIndex (const unsigned j) const
+{
+  // Returns the index, in the full collection, of the object currently being
+  // evaluated from the j-th input collection.
+  if (!collectionStrides_[j])
+    return 0;
+  return ((char *) objects_[j] - collectionData_[j]) / collectionStrides_[j];
+}
+
+unsigned
+ValueLookupTree::getUserVariableIndex (const string &collection, const string &name)
+{
+  // User variables used by the tree walker which were not found when the tree
+  // was compiled are added to the list.
+  auto userVariable = find (userVariables_.begin (), userVariables_.end (), make_pair (collection, name));
+  if (userVariable != userVariables_.end ())
+    return userVariable - userVariables_.begin ();
+  userVariables_.push_back (make_pair (collection, name));
+  userVariableSlots_.push_back (make_pair (-1, 0));
+  return userVariables_.size () - 1;
+}
+
+const vector<double> *
+ValueLookupTree::getUserVariable (const unsigned i)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // The VariableProducers register their variables in their constructors, so
+  // a variable is found at the same position of the same payload in every
+  // event, which is checked first. The payloads of all the VariableProducers
+  // are only searched if it is not there, and the position at which it is
+  // found is kept for the next event.
+  //////////////////////////////////////////////////////////////////////////////
+#if IS_VALID(uservariables)
+  const string &collection = userVariables_.at (i).first,
+               &name = userVariables_.at (i).second;
+  pair<int, unsigned> &slot = userVariableSlots_.at (i);
+  const vector<edm::Handle<TYPE(uservariables)> > &handles = handles_->uservariables;
+  if (slot.first >= 0 && (unsigned) slot.first < handles.size () && handles.at (slot.first).isValid ())
     {
-      //!!!
-      osu::Uservariable *obj = new osu::Uservariable ();
-      for (const auto &handle : handles_->uservariables)
-        obj->insert (handle->begin (), handle->end ());
-      uservariablesToDelete_.push_back (obj);
-      return obj;
+      const VariableProducerPayload &payload = *handles.at (slot.first);
+      if (slot.second < payload.names.size () && payload.names[slot.second] == name && payload.collections[slot.second] == collection)
+        return &payload.values.at (slot.second);
     }
-  else if (EQ_VALID(name,eventvariables))
+  for (unsigned j = 0; j < handles.size (); j++)
     {
-      //!!!
-      osu::Eventvariable *obj = new osu::Eventvariable ();
-      for (const auto &handle : handles_->eventvariables)
-        obj->insert (handle->begin (), handle->end ());
-      eventvariablesToDelete_.push_back (obj);
-      return obj;
+      if (!handles.at (j).isValid ())
+        continue;
+      const VariableProducerPayload &payload = *handles.at (j);
+      for (unsigned k = 0; k < payload.names.size (); k++)
+        {
+          if (payload.names.at (k) == name && payload.collections.at (k) == collection)
+            {
+              slot = make_pair ((int) j, k);
+              return &payload.values.at (k);
+            }
+        }
+    }
+#endif
+  return NULL;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+void
+ValueLookupTree::resolveEventVariables ()
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // The names of the event variables are put in the run by each
+  // EventVariableProducer, so the producer and position of each variable are
+  // only found again when the run or the products holding the names change.
+  // A variable which is not found is given a producer of -1.
+  //////////////////////////////////////////////////////////////////////////////
+#if IS_VALID(eventvariables)
+  const vector<edm::Handle<vector<string> > > &handles = handles_->eventvariableNames;
+  vector<const vector<string> *> names (handles.size (), NULL);
+  for (unsigned i = 0; i < handles.size (); i++)
+    names.at (i) = (handles.at (i).isValid () ? handles.at (i).product () : NULL);
+  if (handles_->run == eventVariablesRun_ && names == eventVariableNames_)
+    return;
+  eventVariablesRun_ = handles_->run;
+  eventVariableNames_ = names;
+
+  for (unsigned i = 0; i < eventVariables_.size (); i++)
+    {
+      pair<int, unsigned> &slot = eventVariableSlots_.at (i);
+      slot = make_pair (-1, 0);
+      for (unsigned j = 0; j < names.size () && slot.first < 0; j++)
+        {
+          if (!names.at (j))
+            continue;
+          auto name = find (names.at (j)->begin (), names.at (j)->end (), eventVariables_.at (i));
+          if (name != names.at (j)->end ())
+            slot = make_pair ((int) j, name - names.at (j)->begin ());
+        }
     }
+#endif
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+unsigned
+ValueLookupTree::getEventVariableIndex (const string &name)
+{
+  // Variables used by the tree walker which were not found when the tree was
+  // compiled are added to the list, and all the variables are resolved again.
+  auto eventVariable = find (eventVariables_.begin (), eventVariables_.end (), name);
+  if (eventVariable != eventVariables_.end ())
+    return eventVariable - eventVariables_.begin ();
+  eventVariables_.push_back (name);
+  eventVariableSlots_.push_back (make_pair (-1, 0));
+  eventVariableNames_.clear ();
+  resolveEventVariables ();
+  return eventVariables_.size () - 1;
+}
+
+const double *
+ValueLookupTree::getEventVariable (const unsigned i) const
+{
+#if IS_VALID(eventvariables)
+  const pair<int, unsigned> &slot = eventVariableSlots_.at (i);
+  if (slot.first < 0)
+    return NULL;
+  const edm::Handle<TYPE(eventvariables)> &handle = handles_->eventvariables.at (slot.first);
+  if (handle.isValid () && slot.second < handle->values.size ())
+    return &handle->values.at (slot.second);
+#endif
+  return NULL;
+}
+
+bool
+ValueLookupTree::isUserVariable (const string &variable, string &name)
+{
+  // Returns true if the variable is of the form "uservariable.<name>", in
+  // which case the second argument receives the name.
+  static const string prefix = "uservariable.";
+  if (variable.compare (0, prefix.size (), prefix))
+    return false;
+  name = variable.substr (prefix.size ());
+  return true;
+}
+
+template<class T> void *
+ValueLookupTree::getCollectionData (const edm::Handle<vector<T> > &handle, size_t &stride) const
+{
+  stride = sizeof (T);
+  return ((void *) handle->data ());
+}
+
+void *
+ValueLookupTree::getCollectionData (const string &name, size_t &stride)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Returns the address of the first object in the named collection and sets
+  // the second argument to the size of each object, so that the i-th object
+  // is at the returned address plus i times the stride. Collections which are
+  // a single object have a stride of zero.
+  //////////////////////////////////////////////////////////////////////////////
+  stride = 0;
+  if (EQ_VALID(name,beamspots))
+    return ((void *) &(*handles_->beamspots));
+  else if (EQ_VALID(name,bxlumis))
+    return getCollectionData (handles_->bxlumis, stride);
+  else if (EQ_VALID(name,electrons))
+    return getCollectionData (handles_->electrons, stride);
+  else if (EQ_VALID(name,events))
+    return getCollectionData (handles_->events, stride);
+  else if (EQ_VALID(name,genjets))
+    return getCollectionData (handles_->genjets, stride);
+  else if (EQ_VALID(name,generatorweights))
+    return ((void *) &(*handles_->generatorweights));
+  else if (EQ_VALID(name,jets))
+    return getCollectionData (handles_->jets, stride);
+  else if (EQ_VALID(name,bjets))
+    return getCollectionData (handles_->bjets, stride);
+  else if (EQ_VALID(name,basicjets))
+    return getCollectionData (handles_->basicjets, stride);
+  else if (EQ_VALID(name,mcparticles))
+    return getCollectionData (handles_->mcparticles, stride);
+  else if (EQ_VALID(name,mets))
+    return getCollectionData (handles_->mets, stride);
+  else if (EQ_VALID(name,muons))
+    return getCollectionData (handles_->muons, stride);
+  else if (EQ_VALID(name,photons))
+    return getCollectionData (handles_->photons, stride);
+  else if (EQ_VALID(name,primaryvertexs))
+    return getCollectionData (handles_->primaryvertexs, stride);
+  else if (EQ_VALID(name,superclusters))
+    return getCollectionData (handles_->superclusters, stride);
+  else if (EQ_VALID(name,taus))
+    return getCollectionData (handles_->taus, stride);
+  else if (EQ_VALID(name,tracks))
+    return getCollectionData (handles_->tracks, stride);
+  else if (EQ_VALID(name,pileupinfos))
+    return getCollectionData (handles_->pileupinfos, stride);
+  else if (EQ_VALID(name,trigobjs))
+    return getCollectionData (handles_->trigobjs, stride);
+  else if (EQ_VALID(name,uservariables) || EQ_VALID(name,eventvariables))
+    return getObject (name, 0);
   return NULL;
+  //////////////////////////////////////////////////////////////////////////////
 }
 
 string
@@ -1093,37 +2478,6 @@ ValueLookupTree::vetoMatch (const string &s, const string &target, const size_t
   return false;
 }
 
-bool
-ValueLookupTree::isUniqueCase (const ObjMap &objs, const unordered_set<string> &keys) const
-{
-  //////////////////////////////////////////////////////////////////////////////
-  // Returns true only if the given objects are unique and in a specific order.
-  // This is to avoid double counting.
-  //////////////////////////////////////////////////////////////////////////////
-  bool pass = true;
-
-  for (const auto &key : keys)
-    {
-      if (objs.count (key) <= 1)
-        continue;
-      else
-        {
-          auto range = objs.equal_range (key);
-          vector<pair<string, DressedObject> > objsOfThisType (range.first, range.second);
-          sort (objsOfThisType.begin (), objsOfThisType.end (), anatools::collectionIndexAscending);
-          int previousLocalIndex = -1;
-          for (const auto &obj : objsOfThisType)
-            {
-              pass = pass && ((int) obj.second.localIndex > previousLocalIndex);
-              previousLocalIndex = obj.second.localIndex;
-            }
-        }
-    }
-
-  return pass;
-  //////////////////////////////////////////////////////////////////////////////
-}
-
 bool
 ValueLookupTree::insertBinaryInfixOperator (const string &s, Node * const tree, const vector<string> &operators, const vector<string> &vetoOperators) const
 {
@@ -1264,28 +2618,56 @@ ValueLookupTree::insertParentheses (const string &s, Node * const tree) const
 }
 
 double
-ValueLookupTree::valueLookup (const string &collection, const ObjMap &objs, const string &variable, const bool iterateObj)
+ValueLookupTree::valueLookup (const string &collection, const ObjMap &objs, const string &variable, const bool iterateObj, const MemberAccessor *accessor)
 {
-  if (!objIterators_.count (collection))
-    {
-      auto range = objs.equal_range (collection);
-      objIterators_[collection] = range.first;
-      shouldIterate_[collection] = (objs.count (collection) > 1);
-    }
-  else if (shouldIterate_.at (collection) && iterateObj)
-    objIterators_.at (collection)++;
-  void *obj = objIterators_.at (collection)->second.addr;
+  const DressedObject &dressedObject = getDressedObject (collection, objs, iterateObj);
+  void *obj = dressedObject.addr;
+  string name;
 
   try
     {
       if (collection == "uservariables")
-        return 1; // FIXME
+        return INVALID_VALUE;  // only accessible as members of other collections
+      if (isUserVariable (variable, name))
+        {
+          const vector<unsigned> *selection = getSelection (collection);
+          const unsigned i = (selection ? selection->at (dressedObject.localIndex) : dressedObject.localIndex);
+          const vector<double> *values = getUserVariable (getUserVariableIndex (collection, name));
+          return (values && i < values->size () ? values->at (i) : INVALID_VALUE);
+        }
       if (collection == "eventvariables")
-        return (((EventVariableProducerPayload *) obj)->at (variable));
-      return anatools::getMember (getCollectionType (collection), obj, variable);
+        {
+          const double *value = getEventVariable (getEventVariableIndex (variable));
+          return (value ? *value : INVALID_VALUE);
+        }
+      if (!accessor)
+        accessor = getAccessor (collection, variable);
+      if (isInstrumented_)
+        stats_.memberLookups++;
+      return (*accessor) (obj);
     }
   catch (...)
     {
       return INVALID_VALUE;
     }
 }
+
+const DressedObject &
+ValueLookupTree::getDressedObject (const string &collection, const ObjMap &objs, const bool iterateObj)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Returns the object from the given collection to be used for the current
+  // lookup. If the collection appears more than once among the objects, each
+  // successive lookup with iterateObj set moves on to the next one.
+  //////////////////////////////////////////////////////////////////////////////
+  if (!objIterators_.count (collection))
+    {
+      auto range = objs.equal_range (collection);
+      objIterators_[collection] = range.first;
+      shouldIterate_[collection] = (objs.count (collection) > 1);
+    }
+  else if (shouldIterate_.at (collection) && iterateObj)
+    objIterators_.at (collection)++;
+  return objIterators_.at (collection)->second;
+  //////////////////////////////////////////////////////////////////////////////
+}
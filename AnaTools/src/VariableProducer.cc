@@ -1,5 +1,7 @@
 #include "OSUT3Analysis/AnaTools/interface/VariableProducer.h"
 
+#define EXIT_CODE 4
+
 VariableProducer::VariableProducer(const edm::ParameterSet &cfg) :
   collections_  (cfg.getParameter<edm::ParameterSet>  ("collections"))
 {
@@ -15,18 +17,71 @@ VariableProducer::~VariableProducer()
 void
 VariableProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
-
+  //////////////////////////////////////////////////////////////////////////////
+  // The payload starts with every variable registered, in the order of their
+  // IDs, and with no values.
+  //////////////////////////////////////////////////////////////////////////////
   uservariables = auto_ptr<VariableProducerPayload> (new VariableProducerPayload);
-
-  ////////////////////////////////////////////////////////////////////////
+  uservariables->collections = variableCollections_;
+  uservariables->names = variableNames_;
+  uservariables->values.resize (variableNames_.size ());
+  //////////////////////////////////////////////////////////////////////////////
 
   AddVariables(event);
 
   // store all of our calculated quantities in the event
   event.put (uservariables, "uservariables");
+  uservariables.reset ();
 }
 
 
 // implementation left up to the daughter class
 void
 VariableProducer::AddVariables (const edm::Event &event) {}
+
+unsigned
+VariableProducer::registerUserVar (const string &collection, const string &varName)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // A variable which is already registered keeps its ID. A variable which is
+  // registered while an event is being produced is also added to its payload.
+  //////////////////////////////////////////////////////////////////////////////
+  auto variable = variableIndices_.find (make_pair (collection, varName));
+  if (variable != variableIndices_.end ())
+    return variable->second;
+
+  unsigned id = variableNames_.size ();
+  variableIndices_[make_pair (collection, varName)] = id;
+  variableCollections_.push_back (collection);
+  variableNames_.push_back (varName);
+  if (uservariables.get ())
+    {
+      uservariables->collections.push_back (collection);
+      uservariables->names.push_back (varName);
+      uservariables->values.resize (variableNames_.size ());
+    }
+  return id;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+void
+VariableProducer::setUserVar (unsigned id, double value, unsigned size, unsigned index)
+{
+  if (id >= uservariables->values.size ())
+    {
+      clog << "ERROR [VariableProducer::setUserVar]: no user variable has been registered with ID " << id << "." << endl;
+      exit (EXIT_CODE);
+    }
+  if (index >= size)
+    {
+      clog << "ERROR [VariableProducer::setUserVar]: the object for variable \"" << variableNames_.at (id) << "\" is not an element of the " << variableCollections_.at (id) << " collection." << endl;
+      exit (EXIT_CODE);
+    }
+
+  // Store the value at the index of the object. Objects for which the
+  // variable is never set are left with INVALID_VALUE.
+  vector<double> &values = uservariables->values[id];
+  if (values.size () != size)
+    values.resize (size, INVALID_VALUE);
+  values[index] = value;
+}
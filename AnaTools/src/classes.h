@@ -51,8 +51,5 @@ namespace {
      edm::Wrapper<vector<bool> > booldummy1;
      vector<vector<bool> > booldummy2;
      edm::Wrapper<vector<vector<bool> > > booldummy3;
-
-     pair<const string, vector<UserVariable> > uservariabledummy0;
-     pair<const string, double > eventvariabledummy0;
    };
 }
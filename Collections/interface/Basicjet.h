@@ -14,6 +14,7 @@ namespace osu
         Basicjet (const TYPE(basicjets) &);
         Basicjet (const TYPE(basicjets) &, const edm::Handle<vector<osu::Mcparticle> > &);
         Basicjet (const TYPE(basicjets) &, const edm::Handle<vector<osu::Mcparticle> > &, const edm::ParameterSet &);
+        Basicjet (const TYPE(basicjets) &, const osu::GenParticleIndex &, const edm::ParameterSet &);
         ~Basicjet ();
     };
 }
@@ -14,6 +14,7 @@ namespace osu
         Bjet (const TYPE(bjets) &);
         Bjet (const TYPE(bjets) &, const edm::Handle<vector<osu::Mcparticle> > &);
         Bjet (const TYPE(bjets) &, const edm::Handle<vector<osu::Mcparticle> > &, const edm::ParameterSet &);
+        Bjet (const TYPE(bjets) &, const osu::GenParticleIndex &, const edm::ParameterSet &);
         ~Bjet ();
         const float pfCombinedSecondaryVertexV2BJetTags () const;
         const float pfCombinedInclusiveSecondaryVertexV2BJetTags () const;
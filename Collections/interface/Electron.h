@@ -14,6 +14,7 @@ namespace osu
         Electron (const TYPE(electrons) &);
         Electron (const TYPE(electrons) &, const edm::Handle<vector<osu::Mcparticle> > &);
         Electron (const TYPE(electrons) &, const edm::Handle<vector<osu::Mcparticle> > &, const edm::ParameterSet &);
+        Electron (const TYPE(electrons) &, const osu::GenParticleIndex &, const edm::ParameterSet &);
         const int missingInnerHits () const;
         const float AEff () const;
         const float rho() const;
@@ -28,6 +29,7 @@ namespace osu
         Electron (const TYPE(electrons) &);
         Electron (const TYPE(electrons) &, const edm::Handle<vector<osu::Mcparticle> > &);
         Electron (const TYPE(electrons) &, const edm::Handle<vector<osu::Mcparticle> > &, const edm::ParameterSet &);
+        Electron (const TYPE(electrons) &, const osu::GenParticleIndex &, const edm::ParameterSet &);
 #endif
         ~Electron ();
         
@@ -5,6 +5,7 @@
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/Collections/interface/GenParticleIndex.h"
 #include "OSUT3Analysis/Collections/interface/Mcparticle.h"
 
 namespace osu
@@ -56,6 +57,7 @@ namespace osu
         GenMatchable (const T &);
         GenMatchable (const T &, const edm::Handle<vector<osu::Mcparticle> > &);
         GenMatchable (const T &, const edm::Handle<vector<osu::Mcparticle> > &, const edm::ParameterSet &);
+        GenMatchable (const T &, const osu::GenParticleIndex &, const edm::ParameterSet &);
         ~GenMatchable ();
 
         const GenMatchedParticle genMatchedParticle () const;
@@ -74,6 +76,8 @@ namespace osu
         double maxDeltaR_;
 
         const GenMatchedParticle findGenMatchedParticle (const edm::Handle<vector<osu::Mcparticle> > &, GenMatchedParticle &, DRToGenMatchedParticle &, const bool = false);
+        const GenMatchedParticle findGenMatchedParticle (const osu::GenParticleIndex &, GenMatchedParticle &, DRToGenMatchedParticle &, const bool = false);
+        void matchParticle (const edm::Handle<vector<osu::Mcparticle> > &, unsigned, GenMatchedParticle &, DRToGenMatchedParticle &, const bool);
     };
 }
 
@@ -121,6 +125,18 @@ osu::GenMatchable<T, PdgId>::GenMatchable (const T &object, const edm::Handle<ve
     }
 }
 
+template<class T, int PdgId>
+osu::GenMatchable<T, PdgId>::GenMatchable (const T &object, const osu::GenParticleIndex &index, const edm::ParameterSet &cfg) :
+  GenMatchable<T, PdgId> (object)
+{
+  maxDeltaR_ = cfg.getParameter<double> ("maxDeltaRForGenMatching");
+  if (index.particles ().isValid ())
+    {
+      findGenMatchedParticle (index, genMatchedParticle_, dRToGenMatchedParticle_);
+      findGenMatchedParticle (index, genMatchedParticleOfSameType_, dRToGenMatchedParticleOfSameType_, true);
+    }
+}
+
 template<class T, int PdgId>
 osu::GenMatchable<T, PdgId>::~GenMatchable ()
 {
@@ -133,54 +149,83 @@ osu::GenMatchable<T, PdgId>::findGenMatchedParticle (const edm::Handle<vector<os
   dRToGenMatchedParticle.directPromptTauDecayProductFinalState = INVALID_VALUE;
   dRToGenMatchedParticle.hardProcessFinalState = INVALID_VALUE;
   dRToGenMatchedParticle.directHardProcessTauDecayProductFinalState = INVALID_VALUE;
-  for (vector<osu::Mcparticle>::const_iterator particle = particles->begin (); particle != particles->end (); particle++)
-    {
-      int pdgId = 0;
+  for (unsigned i = 0; i < particles->size (); i++)
+    matchParticle (particles, i, genMatchedParticle, dRToGenMatchedParticle, usePdgId);
+
+  return genMatchedParticle;
+}
+
+template<class T, int PdgId> const typename osu::GenMatchable<T, PdgId>::GenMatchedParticle
+osu::GenMatchable<T, PdgId>::findGenMatchedParticle (const osu::GenParticleIndex &index, osu::GenMatchable<T, PdgId>::GenMatchedParticle &genMatchedParticle, osu::GenMatchable<T, PdgId>::DRToGenMatchedParticle &dRToGenMatchedParticle, const bool usePdgId)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // The index can only be used if its cells are at least as wide as the
+  // maximum deltaR for this object. Otherwise every particle is checked.
+  //////////////////////////////////////////////////////////////////////////////
+  if (maxDeltaR_ < 0.0 || index.maxDeltaR () < maxDeltaR_)
+    return findGenMatchedParticle (index.particles (), genMatchedParticle, dRToGenMatchedParticle, usePdgId);
+  //////////////////////////////////////////////////////////////////////////////
+
+  dRToGenMatchedParticle.promptFinalState = INVALID_VALUE;
+  dRToGenMatchedParticle.directPromptTauDecayProductFinalState = INVALID_VALUE;
+  dRToGenMatchedParticle.hardProcessFinalState = INVALID_VALUE;
+  dRToGenMatchedParticle.directHardProcessTauDecayProductFinalState = INVALID_VALUE;
+
+  vector<unsigned> candidates;
+  index.candidates (this->eta (), this->phi (), usePdgId ? PdgId : 0, candidates);
+  for (unsigned i = 0; i < candidates.size (); i++)
+    matchParticle (index.particles (), candidates[i], genMatchedParticle, dRToGenMatchedParticle, usePdgId);
+
+  return genMatchedParticle;
+}
+
+template<class T, int PdgId> void
+osu::GenMatchable<T, PdgId>::matchParticle (const edm::Handle<vector<osu::Mcparticle> > &particles, unsigned i, osu::GenMatchable<T, PdgId>::GenMatchedParticle &genMatchedParticle, osu::GenMatchable<T, PdgId>::DRToGenMatchedParticle &dRToGenMatchedParticle, const bool usePdgId)
+{
+  const osu::Mcparticle * const particle = &particles->at (i);
+  int pdgId = 0;
 #if DATA_FORMAT == MINI_AOD || DATA_FORMAT == AOD || DATA_FORMAT == MINI_AOD_CUSTOM
-      pdgId = particle->pdgId ();
+  pdgId = particle->pdgId ();
 #endif
-      if (usePdgId && abs (pdgId) != PdgId)
-        continue;
+  if (usePdgId && abs (pdgId) != PdgId)
+    return;
 
-      double dR = deltaR (*particle, *this);
-      if (maxDeltaR_ >= 0.0 && dR > maxDeltaR_)
-        continue;
+  double dR = deltaR (*particle, *this);
+  if (maxDeltaR_ >= 0.0 && dR > maxDeltaR_)
+    return;
 
-      if (particle->isPromptFinalState ())
+  if (particle->isPromptFinalState ())
+    {
+      if (dR < dRToGenMatchedParticle.promptFinalState || dRToGenMatchedParticle.promptFinalState < 0.0)
         {
-          if (dR < dRToGenMatchedParticle.promptFinalState || dRToGenMatchedParticle.promptFinalState < 0.0)
-            {
-              dRToGenMatchedParticle.promptFinalState = dR;
-              genMatchedParticle.promptFinalState = edm::Ref<vector<osu::Mcparticle> > (particles, particle - particles->begin ());
-            }
+          dRToGenMatchedParticle.promptFinalState = dR;
+          genMatchedParticle.promptFinalState = edm::Ref<vector<osu::Mcparticle> > (particles, i);
         }
-      if (particle->isDirectPromptTauDecayProductFinalState ())
+    }
+  if (particle->isDirectPromptTauDecayProductFinalState ())
+    {
+      if (dR < dRToGenMatchedParticle.directPromptTauDecayProductFinalState || dRToGenMatchedParticle.directPromptTauDecayProductFinalState < 0.0)
         {
-          if (dR < dRToGenMatchedParticle.directPromptTauDecayProductFinalState || dRToGenMatchedParticle.directPromptTauDecayProductFinalState < 0.0)
-            {
-              dRToGenMatchedParticle.directPromptTauDecayProductFinalState = dR;
-              genMatchedParticle.directPromptTauDecayProductFinalState = edm::Ref<vector<osu::Mcparticle> > (particles, particle - particles->begin ());
-            }
+          dRToGenMatchedParticle.directPromptTauDecayProductFinalState = dR;
+          genMatchedParticle.directPromptTauDecayProductFinalState = edm::Ref<vector<osu::Mcparticle> > (particles, i);
         }
-      if (particle->fromHardProcessFinalState ())
+    }
+  if (particle->fromHardProcessFinalState ())
+    {
+      if (dR < dRToGenMatchedParticle.hardProcessFinalState || dRToGenMatchedParticle.hardProcessFinalState < 0.0)
         {
-          if (dR < dRToGenMatchedParticle.hardProcessFinalState || dRToGenMatchedParticle.hardProcessFinalState < 0.0)
-            {
-              dRToGenMatchedParticle.hardProcessFinalState = dR;
-              genMatchedParticle.hardProcessFinalState = edm::Ref<vector<osu::Mcparticle> > (particles, particle - particles->begin ());
-            }
+          dRToGenMatchedParticle.hardProcessFinalState = dR;
+          genMatchedParticle.hardProcessFinalState = edm::Ref<vector<osu::Mcparticle> > (particles, i);
         }
-      if (particle->isDirectHardProcessTauDecayProductFinalState ())
+    }
+  if (particle->isDirectHardProcessTauDecayProductFinalState ())
+    {
+      if (dR < dRToGenMatchedParticle.directHardProcessTauDecayProductFinalState || dRToGenMatchedParticle.directHardProcessTauDecayProductFinalState < 0.0)
         {
-          if (dR < dRToGenMatchedParticle.directHardProcessTauDecayProductFinalState || dRToGenMatchedParticle.directHardProcessTauDecayProductFinalState < 0.0)
-            {
-              dRToGenMatchedParticle.directHardProcessTauDecayProductFinalState = dR;
-              genMatchedParticle.directHardProcessTauDecayProductFinalState = edm::Ref<vector<osu::Mcparticle> > (particles, particle - particles->begin ());
-            }
+          dRToGenMatchedParticle.directHardProcessTauDecayProductFinalState = dR;
+          genMatchedParticle.directHardProcessTauDecayProductFinalState = edm::Ref<vector<osu::Mcparticle> > (particles, i);
         }
     }
-
-  return genMatchedParticle;
 }
 
 template<class T, int PdgId> const typename osu::GenMatchable<T, PdgId>::GenMatchedParticle
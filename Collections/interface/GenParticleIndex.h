@@ -0,0 +1,78 @@
+#ifndef OSU_GEN_PARTICLE_INDEX
+#define OSU_GEN_PARTICLE_INDEX
+
+#include <vector>
+
+#include "DataFormats/Common/interface/Handle.h"
+#include "DataFormats/Provenance/interface/EventID.h"
+
+#include "OSUT3Analysis/Collections/interface/Mcparticle.h"
+
+/*
+A GenParticleIndex sorts the generator particles of an event into a grid in
+eta and phi, so that gen matching only has to look at the particles near each
+object instead of at every particle in the event.
+
+The cells of the grid are at least as wide as the largest deltaR allowed for a
+match, so any particle which can be matched to an object is in the cell
+containing the object or in one of the eight cells around it. Phi wraps
+around, and values of eta beyond the edges of the grid are put in the first
+or last row, which keeps this true for them as well.
+
+Only particles with at least one of the status flags used by GenMatchable are
+put in the grid, since the others can never be matched. Each entry also keeps
+the absolute value of the PDG ID of the particle, so that matches to particles
+of the same type can skip the others without looking them up.
+
+The index is built once per event with get, which keeps it for each thread, so
+that all the producers running on a thread share it.
+*/
+
+namespace osu
+{
+  class GenParticleIndex
+    {
+      public:
+        GenParticleIndex ();
+        GenParticleIndex (const edm::Handle<vector<osu::Mcparticle> > &, double);
+
+        // Returns the index for the given particles and the given maximum
+        // deltaR, which is only built if it differs from the one returned for
+        // the previous call on this thread.
+        static const GenParticleIndex &get (const edm::EventID &, const edm::Handle<vector<osu::Mcparticle> > &, double);
+
+        const edm::Handle<vector<osu::Mcparticle> > &particles () const;
+        double maxDeltaR () const;
+
+        // Fills the last argument with the indices of the particles which may
+        // be within maxDeltaR of the given eta and phi, in increasing order.
+        // If the PDG ID is nonzero, only particles with that absolute value of
+        // the PDG ID are included.
+        void candidates (double, double, int, vector<unsigned> &) const;
+
+      private:
+        struct Entry
+          {
+            unsigned  index;
+            int       absPdgId;
+          };
+
+        edm::Handle<vector<osu::Mcparticle> > particles_;
+        double maxDeltaR_;
+
+        int nEta_;
+        int nPhi_;
+        double etaWidth_;
+        double phiWidth_;
+
+        // The entries are sorted by cell, with the entries for cell i running
+        // from offsets_[i] to offsets_[i + 1].
+        vector<unsigned> offsets_;
+        vector<Entry> entries_;
+
+        int etaBin (double) const;
+        int phiBin (double) const;
+    };
+}
+
+#endif
@@ -14,6 +14,7 @@ namespace osu
         Genjet (const TYPE(genjets) &);
         Genjet (const TYPE(genjets) &, const edm::Handle<vector<osu::Mcparticle> > &);
         Genjet (const TYPE(genjets) &, const edm::Handle<vector<osu::Mcparticle> > &, const edm::ParameterSet &);
+        Genjet (const TYPE(genjets) &, const osu::GenParticleIndex &, const edm::ParameterSet &);
         ~Genjet ();
     };
 }
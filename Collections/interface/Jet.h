@@ -14,6 +14,7 @@ namespace osu
         Jet (const TYPE(jets) &);
         Jet (const TYPE(jets) &, const edm::Handle<vector<osu::Mcparticle> > &);
         Jet (const TYPE(jets) &, const edm::Handle<vector<osu::Mcparticle> > &, const edm::ParameterSet &);
+        Jet (const TYPE(jets) &, const osu::GenParticleIndex &, const edm::ParameterSet &);
         ~Jet ();
         const float pfCombinedSecondaryVertexV2BJetTags () const;
         const float pfCombinedInclusiveSecondaryVertexV2BJetTags () const;
@@ -14,6 +14,7 @@ namespace osu
         Muon (const TYPE(muons) &);
         Muon (const TYPE(muons) &, const edm::Handle<vector<osu::Mcparticle> > &);
         Muon (const TYPE(muons) &, const edm::Handle<vector<osu::Mcparticle> > &, const edm::ParameterSet &);
+        Muon (const TYPE(muons) &, const osu::GenParticleIndex &, const edm::ParameterSet &);
         ~Muon ();
 
         const bool isTightMuonWRTVtx() const { return isTightMuonWRTVtx_; }
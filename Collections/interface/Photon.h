@@ -14,6 +14,7 @@ namespace osu
         Photon (const TYPE(photons) &);
         Photon (const TYPE(photons) &, const edm::Handle<vector<osu::Mcparticle> > &);
         Photon (const TYPE(photons) &, const edm::Handle<vector<osu::Mcparticle> > &, const edm::ParameterSet &);
+        Photon (const TYPE(photons) &, const osu::GenParticleIndex &, const edm::ParameterSet &);
         ~Photon ();
     };
 }
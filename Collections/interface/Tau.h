@@ -14,6 +14,7 @@ namespace osu
         Tau (const TYPE(taus) &);
         Tau (const TYPE(taus) &, const edm::Handle<vector<osu::Mcparticle> > &);
         Tau (const TYPE(taus) &, const edm::Handle<vector<osu::Mcparticle> > &, const edm::ParameterSet &);
+        Tau (const TYPE(taus) &, const osu::GenParticleIndex &, const edm::ParameterSet &);
         ~Tau ();
     };
 }
@@ -14,6 +14,7 @@ namespace osu
         Track (const TYPE(tracks) &);
         Track (const TYPE(tracks) &, const edm::Handle<vector<osu::Mcparticle> > &);
         Track (const TYPE(tracks) &, const edm::Handle<vector<osu::Mcparticle> > &, const edm::ParameterSet &);
+        Track (const TYPE(tracks) &, const osu::GenParticleIndex &, const edm::ParameterSet &);
         ~Track ();
     };
 }
@@ -14,6 +14,7 @@ namespace osu
         Trigobj (const TYPE(trigobjs) &);
         Trigobj (const TYPE(trigobjs) &, const edm::Handle<vector<osu::Mcparticle> > &);
         Trigobj (const TYPE(trigobjs) &, const edm::Handle<vector<osu::Mcparticle> > &, const edm::ParameterSet &);
+        Trigobj (const TYPE(trigobjs) &, const osu::GenParticleIndex &, const edm::ParameterSet &);
         ~Trigobj ();
     };
 }
@@ -3,11 +3,13 @@
 #if IS_VALID(eventvariables)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 EventvariableProducer::EventvariableProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections"))
 {
   collection_ = collections_.getParameter<edm::InputTag> ("eventvariables");
+  collectionToken_ = anatools::consumeCollection<TYPE (eventvariables)> (collection_, consumesCollector (), true);
 
   produces<osu::Eventvariable> (collection_.instance ());
 }
@@ -19,8 +21,10 @@ EventvariableProducer::~EventvariableProducer ()
 void
 EventvariableProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<TYPE (eventvariables)> collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
 
   pl_ = auto_ptr<osu::Eventvariable> (new osu::Eventvariable (*collection));
@@ -1,14 +1,15 @@
 #ifndef EVENTVARIABLE_PRODUCER
 #define EVENTVARIABLE_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/Eventvariable.h"
 
-class EventvariableProducer : public edm::EDProducer
+class EventvariableProducer : public edm::stream::EDProducer<>
 {
   public:
     EventvariableProducer (const edm::ParameterSet &);
@@ -24,6 +25,12 @@ class EventvariableProducer : public edm::EDProducer
     edm::InputTag      collection_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<TYPE (eventvariables)>   collectionToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<osu::Eventvariable> pl_;
 };
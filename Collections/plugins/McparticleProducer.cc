@@ -3,11 +3,13 @@
 #if IS_VALID(mcparticles)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 McparticleProducer::McparticleProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections"))
 {
   collection_ = collections_.getParameter<edm::InputTag> ("mcparticles");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE (mcparticles)> > (collection_, consumesCollector (), true);
 
   produces<vector<osu::Mcparticle> > (collection_.instance ());
 }
@@ -19,8 +21,10 @@ McparticleProducer::~McparticleProducer ()
 void
 McparticleProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<vector<TYPE (mcparticles)> > collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
 
   pl_ = auto_ptr<vector<osu::Mcparticle> > (new vector<osu::Mcparticle> ());
@@ -1,14 +1,15 @@
 #ifndef MCPARTICLE_PRODUCER
 #define MCPARTICLE_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/Mcparticle.h"
 
-class McparticleProducer : public edm::EDProducer
+class McparticleProducer : public edm::stream::EDProducer<>
 {
   public:
     McparticleProducer (const edm::ParameterSet &);
@@ -24,6 +25,12 @@ class McparticleProducer : public edm::EDProducer
     edm::InputTag      collection_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<vector<TYPE (mcparticles)> >   collectionToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<vector<osu::Mcparticle> > pl_;
 };
@@ -3,12 +3,16 @@
 #if IS_VALID(basicjets)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 OSUBasicjetProducer::OSUBasicjetProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections")),
   cfg_ (cfg)
 {
   collection_ = collections_.getParameter<edm::InputTag> ("basicjets");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE (basicjets)> > (collection_, consumesCollector (), true);
+  if (cfg.getUntrackedParameter<bool> ("genMatching", true))
+    mcparticlesToken_ = anatools::consumeCollection<vector<osu::Mcparticle> > (edm::InputTag ("", ""), consumesCollector ());
 
   produces<vector<osu::Basicjet> > (collection_.instance ());
 }
@@ -20,16 +24,20 @@ OSUBasicjetProducer::~OSUBasicjetProducer ()
 void
 OSUBasicjetProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<vector<TYPE (basicjets)> > collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
   edm::Handle<vector<osu::Mcparticle> > particles;
-  anatools::getCollection (edm::InputTag ("", ""), particles, event);
+  if (mcparticlesToken_.required)
+    anatools::getCollection (mcparticlesToken_, particles, event);
+  const osu::GenParticleIndex &genParticles = osu::GenParticleIndex::get (event.id (), particles, cfg_.getParameter<double> ("maxDeltaRForGenMatching"));
 
   pl_ = auto_ptr<vector<osu::Basicjet> > (new vector<osu::Basicjet> ());
   for (const auto &object : *collection)
     {
-      const osu::Basicjet basicjet (object, particles, cfg_);
+      const osu::Basicjet basicjet (object, genParticles, cfg_);
       pl_->push_back (basicjet);
     }
 
@@ -1,14 +1,15 @@
 #ifndef BASICJET_PRODUCER
 #define BASICJET_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/Basicjet.h"
 
-class OSUBasicjetProducer : public edm::EDProducer
+class OSUBasicjetProducer : public edm::stream::EDProducer<>
 {
   public:
     OSUBasicjetProducer (const edm::ParameterSet &);
@@ -25,6 +26,13 @@ class OSUBasicjetProducer : public edm::EDProducer
     edm::ParameterSet  cfg_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<vector<TYPE (basicjets)> >   collectionToken_;
+    CollectionToken<vector<osu::Mcparticle> >   mcparticlesToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<vector<osu::Basicjet> > pl_;
 };
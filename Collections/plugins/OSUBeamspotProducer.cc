@@ -3,11 +3,13 @@
 #if IS_VALID(beamspots)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 OSUBeamspotProducer::OSUBeamspotProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections"))
 {
   collection_ = collections_.getParameter<edm::InputTag> ("beamspots");
+  collectionToken_ = anatools::consumeCollection<TYPE (beamspots)> (collection_, consumesCollector (), true);
 
   produces<osu::Beamspot> (collection_.instance ());
 }
@@ -19,8 +21,10 @@ OSUBeamspotProducer::~OSUBeamspotProducer ()
 void
 OSUBeamspotProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<TYPE (beamspots)> collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
   pl_ = auto_ptr<osu::Beamspot>  (new osu::Beamspot (*collection));
   event.put (pl_, collection_.instance ());
@@ -1,14 +1,15 @@
 #ifndef BEAMSPOT_PRODUCER
 #define BEAMSPOT_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/Beamspot.h"
 
-class OSUBeamspotProducer : public edm::EDProducer
+class OSUBeamspotProducer : public edm::stream::EDProducer<>
 {
   public:
     OSUBeamspotProducer (const edm::ParameterSet &);
@@ -24,6 +25,12 @@ class OSUBeamspotProducer : public edm::EDProducer
     edm::InputTag      collection_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<TYPE (beamspots)>   collectionToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<osu::Beamspot> pl_;
 };
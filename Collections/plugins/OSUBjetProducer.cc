@@ -3,12 +3,16 @@
 #if IS_VALID(bjets)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 OSUBjetProducer::OSUBjetProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections")),
   cfg_ (cfg)
 {
   collection_ = collections_.getParameter<edm::InputTag> ("bjets");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE (bjets)> > (collection_, consumesCollector (), true);
+  if (cfg.getUntrackedParameter<bool> ("genMatching", true))
+    mcparticlesToken_ = anatools::consumeCollection<vector<osu::Mcparticle> > (edm::InputTag ("", ""), consumesCollector ());
 
   produces<vector<osu::Bjet> > (collection_.instance ());
 }
@@ -20,16 +24,20 @@ OSUBjetProducer::~OSUBjetProducer ()
 void
 OSUBjetProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<vector<TYPE (bjets)> > collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
   edm::Handle<vector<osu::Mcparticle> > particles;
-  anatools::getCollection (edm::InputTag ("", ""), particles, event);
+  if (mcparticlesToken_.required)
+    anatools::getCollection (mcparticlesToken_, particles, event);
+  const osu::GenParticleIndex &genParticles = osu::GenParticleIndex::get (event.id (), particles, cfg_.getParameter<double> ("maxDeltaRForGenMatching"));
 
   pl_ = auto_ptr<vector<osu::Bjet> > (new vector<osu::Bjet> ());
   for (const auto &object : *collection)
     {
-      osu::Bjet bjet (object, particles, cfg_);
+      osu::Bjet bjet (object, genParticles, cfg_);
 #if DATA_FORMAT == MINI_AOD || DATA_FORMAT == MINI_AOD_CUSTOM
       bjet.set_pfCombinedInclusiveSecondaryVertexV2BJetTags(bjet.bDiscriminator("pfCombinedInclusiveSecondaryVertexV2BJetTags"));
       bjet.set_pfCombinedSecondaryVertexV2BJetTags(bjet.bDiscriminator("pfCombinedSecondaryVertexV2BJetTags")); 
@@ -1,14 +1,15 @@
 #ifndef BJET_PRODUCER
 #define BJET_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/Bjet.h"
 
-class OSUBjetProducer : public edm::EDProducer
+class OSUBjetProducer : public edm::stream::EDProducer<>
 {
   public:
     OSUBjetProducer (const edm::ParameterSet &);
@@ -25,6 +26,13 @@ class OSUBjetProducer : public edm::EDProducer
     edm::ParameterSet  cfg_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<vector<TYPE (bjets)> >       collectionToken_;
+    CollectionToken<vector<osu::Mcparticle> >   mcparticlesToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<vector<osu::Bjet> > pl_;
 };
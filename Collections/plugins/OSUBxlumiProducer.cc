@@ -3,11 +3,13 @@
 #if IS_VALID(bxlumis)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 OSUBxlumiProducer::OSUBxlumiProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections"))
 {
   collection_ = collections_.getParameter<edm::InputTag> ("bxlumis");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE (bxlumis)> > (collection_, consumesCollector (), true);
 
   produces<vector<osu::Bxlumi> > (collection_.instance ());
 }
@@ -19,8 +21,10 @@ OSUBxlumiProducer::~OSUBxlumiProducer ()
 void
 OSUBxlumiProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<vector<TYPE (bxlumis)> > collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
 
   pl_ = auto_ptr<vector<osu::Bxlumi> > (new vector<osu::Bxlumi> ());
@@ -1,14 +1,15 @@
 #ifndef BXLUMI_PRODUCER
 #define BXLUMI_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/Bxlumi.h"
 
-class BxlumiProducer : public edm::EDProducer
+class BxlumiProducer : public edm::stream::EDProducer<>
 {
   public:
     BxlumiProducer (const edm::ParameterSet &);
@@ -24,6 +25,12 @@ class BxlumiProducer : public edm::EDProducer
     edm::InputTag      collection_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<vector<TYPE (bxlumis)> >   collectionToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<vector<osu::Bxlumi> > pl_;
 };
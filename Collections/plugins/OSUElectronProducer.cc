@@ -3,6 +3,7 @@
 #if IS_VALID(electrons)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 OSUElectronProducer::OSUElectronProducer (const edm::ParameterSet &cfg) :
   collections_    (cfg.getParameter<edm::ParameterSet> ("collections")),
@@ -11,6 +12,10 @@ OSUElectronProducer::OSUElectronProducer (const edm::ParameterSet &cfg) :
   rho_            (cfg.getParameter<edm::InputTag> ("rho"))
 {
   collection_ = collections_.getParameter<edm::InputTag> ("electrons");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE (electrons)> > (collection_, consumesCollector (), true);
+  if (cfg.getUntrackedParameter<bool> ("genMatching", true))
+    mcparticlesToken_ = anatools::consumeCollection<vector<osu::Mcparticle> > (edm::InputTag ("", ""), consumesCollector ());
+  rhoToken_ = consumes<double> (rho_);
   produces<vector<osu::Electron> > (collection_.instance ());
 }
 
@@ -21,6 +26,8 @@ OSUElectronProducer::~OSUElectronProducer ()
 void
 OSUElectronProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
 #if DATA_FORMAT == MINI_AOD || DATA_FORMAT == MINI_AOD_CUSTOM  
   using namespace edm;
   using namespace reco;
@@ -30,14 +37,16 @@ OSUElectronProducer::produce (edm::Event &event, const edm::EventSetup &setup)
   edm::Handle<double> rho;
   
   edm::Handle<vector<osu::Mcparticle> > particles;
-  anatools::getCollection (edm::InputTag ("", ""), particles, event);
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (mcparticlesToken_.required)
+    anatools::getCollection (mcparticlesToken_, particles, event);
+  const osu::GenParticleIndex &genParticles = osu::GenParticleIndex::get (event.id (), particles, cfg_.getParameter<double> ("maxDeltaRForGenMatching"));
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
   pl_ = auto_ptr<vector<osu::Electron> > (new vector<osu::Electron> ());
   for (const auto &object : *collection)
     {
-      osu::Electron electron (object, particles, cfg_);
-      if(event.getByLabel (rho_, rho))
+      osu::Electron electron (object, genParticles, cfg_);
+      if(event.getByToken (rhoToken_, rho))
         electron.set_rho((float)(*rho)); 
       electron.set_missingInnerHits(object.gsfTrack()->hitPattern ().numberOfHits(reco::HitPattern::MISSING_INNER_HITS));
       float effectiveArea = 0;
@@ -64,15 +73,17 @@ OSUElectronProducer::produce (edm::Event &event, const edm::EventSetup &setup)
   pl_.reset ();
 #else
   edm::Handle<vector<TYPE (electrons)> > collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
   edm:Handle<vector<osu::Mcparticle> > particles;
-  anatools::getCollection (edm::InputTag ("", ""), particles, event);
+  if (mcparticlesToken_.required)
+    anatools::getCollection (mcparticlesToken_, particles, event);
+  const osu::GenParticleIndex &genParticles = osu::GenParticleIndex::get (event.id (), particles, cfg_.getParameter<double> ("maxDeltaRForGenMatching"));
 
   pl_ = auto_ptr<vector<osu::Electron> > (new vector<osu::Electron> ());
   for (const auto &object : *collection)
     {
-      const osu::Electron electron (object, particles, cfg_);
+      const osu::Electron electron (object, genParticles, cfg_);
       pl_->push_back (electron);
     }
 
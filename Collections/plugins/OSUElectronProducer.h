@@ -1,14 +1,15 @@
 #ifndef ELECTRON_PRODUCER
 #define ELECTRON_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "RecoEgamma/EgammaTools/interface/EffectiveAreas.h"
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/Electron.h"
 
-class OSUElectronProducer : public edm::EDProducer
+class OSUElectronProducer : public edm::stream::EDProducer<>
 {
   public:
     OSUElectronProducer (const edm::ParameterSet &);
@@ -27,6 +28,14 @@ class OSUElectronProducer : public edm::EDProducer
     edm::InputTag      rho_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<vector<TYPE (electrons)> >   collectionToken_;
+    CollectionToken<vector<osu::Mcparticle> >   mcparticlesToken_;
+    edm::EDGetTokenT<double>                     rhoToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<vector<osu::Electron> > pl_;
 };
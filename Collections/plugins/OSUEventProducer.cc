@@ -3,11 +3,13 @@
 #if IS_VALID(events)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 OSUEventProducer::OSUEventProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections"))
 {
   collection_ = collections_.getParameter<edm::InputTag> ("events");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE (events)> > (collection_, consumesCollector (), true);
 
   produces<vector<osu::Event> > (collection_.instance ());
 }
@@ -19,8 +21,10 @@ OSUEventProducer::~OSUEventProducer ()
 void
 OSUEventProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<vector<TYPE (events)> > collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
 
   pl_ = auto_ptr<vector<osu::Event> > (new vector<osu::Event> ());
@@ -1,14 +1,15 @@
 #ifndef EVENT_PRODUCER
 #define EVENT_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/Event.h"
 
-class OSUEventProducer : public edm::EDProducer
+class OSUEventProducer : public edm::stream::EDProducer<>
 {
   public:
     OSUEventProducer (const edm::ParameterSet &);
@@ -24,6 +25,12 @@ class OSUEventProducer : public edm::EDProducer
     edm::InputTag      collection_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<vector<TYPE (events)> >   collectionToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<vector<osu::Event> > pl_;
 };
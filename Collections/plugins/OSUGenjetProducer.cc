@@ -3,12 +3,16 @@
 #if IS_VALID(genjets)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 OSUGenjetProducer::OSUGenjetProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections")),
   cfg_ (cfg)
 {
   collection_ = collections_.getParameter<edm::InputTag> ("genjets");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE (genjets)> > (collection_, consumesCollector (), true);
+  if (cfg.getUntrackedParameter<bool> ("genMatching", true))
+    mcparticlesToken_ = anatools::consumeCollection<vector<osu::Mcparticle> > (edm::InputTag ("", ""), consumesCollector ());
 
   produces<vector<osu::Genjet> > (collection_.instance ());
 }
@@ -20,16 +24,20 @@ OSUGenjetProducer::~OSUGenjetProducer ()
 void
 OSUGenjetProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<vector<TYPE (genjets)> > collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
   edm::Handle<vector<osu::Mcparticle> > particles;
-  anatools::getCollection (edm::InputTag ("", ""), particles, event);
+  if (mcparticlesToken_.required)
+    anatools::getCollection (mcparticlesToken_, particles, event);
+  const osu::GenParticleIndex &genParticles = osu::GenParticleIndex::get (event.id (), particles, cfg_.getParameter<double> ("maxDeltaRForGenMatching"));
 
   pl_ = auto_ptr<vector<osu::Genjet> > (new vector<osu::Genjet> ());
   for (const auto &object : *collection)
     {
-      const osu::Genjet genjet (object, particles, cfg_);
+      const osu::Genjet genjet (object, genParticles, cfg_);
       pl_->push_back (genjet);
     }
 
@@ -1,14 +1,15 @@
 #ifndef GENJET_PRODUCER
 #define GENJET_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/Genjet.h"
 
-class OSUGenjetProducer : public edm::EDProducer
+class OSUGenjetProducer : public edm::stream::EDProducer<>
 {
   public:
     OSUGenjetProducer (const edm::ParameterSet &);
@@ -25,6 +26,13 @@ class OSUGenjetProducer : public edm::EDProducer
     edm::ParameterSet  cfg_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<vector<TYPE (genjets)> >     collectionToken_;
+    CollectionToken<vector<osu::Mcparticle> >   mcparticlesToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<vector<osu::Genjet> > pl_;
 };
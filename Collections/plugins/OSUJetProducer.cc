@@ -3,12 +3,16 @@
 #if IS_VALID(jets)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 OSUJetProducer::OSUJetProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections")),
   cfg_ (cfg)
 {
   collection_ = collections_.getParameter<edm::InputTag> ("jets");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE (jets)> > (collection_, consumesCollector (), true);
+  if (cfg.getUntrackedParameter<bool> ("genMatching", true))
+    mcparticlesToken_ = anatools::consumeCollection<vector<osu::Mcparticle> > (edm::InputTag ("", ""), consumesCollector ());
 
   produces<vector<osu::Jet> > (collection_.instance ());
 }
@@ -20,16 +24,20 @@ OSUJetProducer::~OSUJetProducer ()
 void
 OSUJetProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<vector<TYPE (jets)> > collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
   edm::Handle<vector<osu::Mcparticle> > particles;
-  anatools::getCollection (edm::InputTag ("", ""), particles, event);
+  if (mcparticlesToken_.required)
+    anatools::getCollection (mcparticlesToken_, particles, event);
+  const osu::GenParticleIndex &genParticles = osu::GenParticleIndex::get (event.id (), particles, cfg_.getParameter<double> ("maxDeltaRForGenMatching"));
 
   pl_ = auto_ptr<vector<osu::Jet> > (new vector<osu::Jet> ());
   for (const auto &object : *collection)
     {
-      osu::Jet jet (object, particles, cfg_);
+      osu::Jet jet (object, genParticles, cfg_);
 #if DATA_FORMAT == MINI_AOD || DATA_FORMAT == MINI_AOD_CUSTOM
       jet.set_pfCombinedInclusiveSecondaryVertexV2BJetTags(jet.bDiscriminator("pfCombinedInclusiveSecondaryVertexV2BJetTags"));
       jet.set_pfCombinedSecondaryVertexV2BJetTags(jet.bDiscriminator("pfCombinedSecondaryVertexV2BJetTags")); 
@@ -3,11 +3,13 @@
 #if IS_VALID(mets)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 OSUMetProducer::OSUMetProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections"))
 {
   collection_ = collections_.getParameter<edm::InputTag> ("mets");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE (mets)> > (collection_, consumesCollector (), true);
 
   produces<vector<osu::Met> > (collection_.instance ());
 }
@@ -19,8 +21,10 @@ OSUMetProducer::~OSUMetProducer ()
 void
 OSUMetProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<vector<TYPE (mets)> > collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
 
   pl_ = auto_ptr<vector<osu::Met> > (new vector<osu::Met> ());
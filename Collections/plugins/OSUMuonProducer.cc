@@ -2,9 +2,8 @@
 
 #if IS_VALID(muons)
 
-#include "OSUT3Analysis/Collections/interface/Primaryvertex.h"
-
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 OSUMuonProducer::OSUMuonProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections")),
@@ -12,6 +11,11 @@ OSUMuonProducer::OSUMuonProducer (const edm::ParameterSet &cfg) :
 {
   collection_         = collections_.getParameter<edm::InputTag> ("muons");
   collPrimaryvertexs_ = collections_.getParameter<edm::InputTag> ("primaryvertexs");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE (muons)> > (collection_, consumesCollector (), true);
+  if (cfg.getUntrackedParameter<bool> ("genMatching", true))
+    mcparticlesToken_ = anatools::consumeCollection<vector<osu::Mcparticle> > (edm::InputTag ("", ""), consumesCollector ());
+  primaryvertexsToken_ = anatools::consumeCollection<vector<TYPE (primaryvertexs)> > (collPrimaryvertexs_, consumesCollector (), true);
+  osuPrimaryvertexsToken_ = anatools::consumeCollection<vector<osu::Primaryvertex> > (collPrimaryvertexs_, consumesCollector (), true);
 
   produces<vector<osu::Muon> > (collection_.instance ());
 }
@@ -23,22 +27,26 @@ OSUMuonProducer::~OSUMuonProducer ()
 void
 OSUMuonProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<vector<TYPE (muons)> > collection;
   edm::Handle<vector<TYPE(primaryvertexs)> > collPrimaryvertexs;
   edm::Handle<vector<osu::Primaryvertex> > collOSUPrimaryvertexs;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
-  if (!anatools::getCollection (collPrimaryvertexs_, collPrimaryvertexs, event) && !anatools::getCollection (collPrimaryvertexs_, collOSUPrimaryvertexs, event)) {
+  if (!anatools::getCollection (primaryvertexsToken_, collPrimaryvertexs, event) && !anatools::getCollection (osuPrimaryvertexsToken_, collOSUPrimaryvertexs, event)) {
     clog << "ERROR [OSUMuonProducer::produce]:  could not get collection: " << collPrimaryvertexs_ << endl;
     return;
   }
   edm::Handle<vector<osu::Mcparticle> > particles;
-  anatools::getCollection (edm::InputTag ("", ""), particles, event);
+  if (mcparticlesToken_.required)
+    anatools::getCollection (mcparticlesToken_, particles, event);
+  const osu::GenParticleIndex &genParticles = osu::GenParticleIndex::get (event.id (), particles, cfg_.getParameter<double> ("maxDeltaRForGenMatching"));
 
   pl_ = auto_ptr<vector<osu::Muon> > (new vector<osu::Muon> ());
   for (const auto &object : *collection)
     {
-      osu::Muon muon (object, particles, cfg_);
+      osu::Muon muon (object, genParticles, cfg_);
       const reco::Vertex &vtx = collPrimaryvertexs.isValid () ? collPrimaryvertexs->at (0) : collOSUPrimaryvertexs->at (0);
       muon.set_isTightMuonWRTVtx(muon.isTightMuon(vtx));
       pl_->push_back (muon);
@@ -1,14 +1,16 @@
 #ifndef MUON_PRODUCER
 #define MUON_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/Muon.h"
+#include "OSUT3Analysis/Collections/interface/Primaryvertex.h"
 
-class OSUMuonProducer : public edm::EDProducer
+class OSUMuonProducer : public edm::stream::EDProducer<>
 {
   public:
     OSUMuonProducer (const edm::ParameterSet &);
@@ -26,6 +28,15 @@ class OSUMuonProducer : public edm::EDProducer
     edm::InputTag      collPrimaryvertexs_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<vector<TYPE (muons)> >             collectionToken_;
+    CollectionToken<vector<osu::Mcparticle> >         mcparticlesToken_;
+    CollectionToken<vector<TYPE (primaryvertexs)> >   primaryvertexsToken_;
+    CollectionToken<vector<osu::Primaryvertex> >      osuPrimaryvertexsToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<vector<osu::Muon> > pl_;
 };
@@ -3,11 +3,13 @@
 #if IS_VALID(primaryvertexs)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 OSUPrimaryvertexProducer::OSUPrimaryvertexProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections"))
 {
   collection_ = collections_.getParameter<edm::InputTag> ("primaryvertexs");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE (primaryvertexs)> > (collection_, consumesCollector (), true);
 
   produces<vector<osu::Primaryvertex> > (collection_.instance ());
 }
@@ -19,8 +21,10 @@ OSUPrimaryvertexProducer::~OSUPrimaryvertexProducer ()
 void
 OSUPrimaryvertexProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<vector<TYPE (primaryvertexs)> > collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
 
   pl_ = auto_ptr<vector<osu::Primaryvertex> > (new vector<osu::Primaryvertex> ());
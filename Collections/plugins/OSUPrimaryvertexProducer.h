@@ -1,14 +1,15 @@
 #ifndef PRIMARYVERTEX_PRODUCER
 #define PRIMARYVERTEX_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/Primaryvertex.h"
 
-class OSUPrimaryvertexProducer : public edm::EDProducer
+class OSUPrimaryvertexProducer : public edm::stream::EDProducer<>
 {
   public:
     OSUPrimaryvertexProducer (const edm::ParameterSet &);
@@ -24,6 +25,12 @@ class OSUPrimaryvertexProducer : public edm::EDProducer
     edm::InputTag      collection_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<vector<TYPE (primaryvertexs)> >   collectionToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<vector<osu::Primaryvertex> > pl_;
 };
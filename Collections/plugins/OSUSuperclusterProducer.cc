@@ -3,11 +3,13 @@
 #if IS_VALID(superclusters)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 OSUSuperclusterProducer::OSUSuperclusterProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections"))
 {
   collection_ = collections_.getParameter<edm::InputTag> ("superclusters");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE (superclusters)> > (collection_, consumesCollector (), true);
 
   produces<vector<osu::Supercluster> > (collection_.instance ());
 }
@@ -19,8 +21,10 @@ OSUSuperclusterProducer::~OSUSuperclusterProducer ()
 void
 OSUSuperclusterProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<vector<TYPE (superclusters)> > collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
 
   pl_ = auto_ptr<vector<osu::Supercluster> > (new vector<osu::Supercluster> ());
@@ -1,14 +1,15 @@
 #ifndef SUPERCLUSTER_PRODUCER
 #define SUPERCLUSTER_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/Supercluster.h"
 
-class OSUSuperclusterProducer : public edm::EDProducer
+class OSUSuperclusterProducer : public edm::stream::EDProducer<>
 {
   public:
     OSUSuperclusterProducer (const edm::ParameterSet &);
@@ -24,6 +25,12 @@ class OSUSuperclusterProducer : public edm::EDProducer
     edm::InputTag      collection_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<vector<TYPE (superclusters)> >   collectionToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<vector<osu::Supercluster> > pl_;
 };
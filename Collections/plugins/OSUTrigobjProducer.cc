@@ -3,12 +3,16 @@
 #if IS_VALID(trigobjs)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 OSUTrigobjProducer::OSUTrigobjProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections")),
   cfg_ (cfg)
 {
   collection_ = collections_.getParameter<edm::InputTag> ("trigobjs");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE (trigobjs)> > (collection_, consumesCollector (), true);
+  if (cfg.getUntrackedParameter<bool> ("genMatching", true))
+    mcparticlesToken_ = anatools::consumeCollection<vector<osu::Mcparticle> > (edm::InputTag ("", ""), consumesCollector ());
 
   produces<vector<osu::Trigobj> > (collection_.instance ());
 }
@@ -20,16 +24,20 @@ OSUTrigobjProducer::~OSUTrigobjProducer ()
 void
 OSUTrigobjProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<vector<TYPE (trigobjs)> > collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
   edm::Handle<vector<osu::Mcparticle> > particles;
-  anatools::getCollection (edm::InputTag ("", ""), particles, event);
+  if (mcparticlesToken_.required)
+    anatools::getCollection (mcparticlesToken_, particles, event);
+  const osu::GenParticleIndex &genParticles = osu::GenParticleIndex::get (event.id (), particles, cfg_.getParameter<double> ("maxDeltaRForGenMatching"));
 
   pl_ = auto_ptr<vector<osu::Trigobj> > (new vector<osu::Trigobj> ());
   for (const auto &object : *collection)
     {
-      const osu::Trigobj trigobj (object, particles, cfg_);
+      const osu::Trigobj trigobj (object, genParticles, cfg_);
       pl_->push_back (trigobj);
     }
 
@@ -1,14 +1,15 @@
 #ifndef TRIGOBJ_PRODUCER
 #define TRIGOBJ_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/Trigobj.h"
 
-class OSUTrigobjProducer : public edm::EDProducer
+class OSUTrigobjProducer : public edm::stream::EDProducer<>
 {
   public:
     OSUTrigobjProducer (const edm::ParameterSet &);
@@ -25,6 +26,13 @@ class OSUTrigobjProducer : public edm::EDProducer
     edm::ParameterSet  cfg_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<vector<TYPE (trigobjs)> >    collectionToken_;
+    CollectionToken<vector<osu::Mcparticle> >   mcparticlesToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<vector<osu::Trigobj> > pl_;
 };
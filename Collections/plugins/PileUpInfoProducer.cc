@@ -1,4 +1,5 @@
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 #include "OSUT3Analysis/Collections/plugins/PileUpInfoProducer.h"
 
@@ -6,6 +7,7 @@ PileUpInfoProducer::PileUpInfoProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections"))
 {
   collection_ = collections_.getParameter<edm::InputTag> ("pileupinfos");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE(pileupinfos)> > (collection_, consumesCollector (), true);
 
   produces<vector<osu::PileUpInfo> > (collection_.instance ());
 }
@@ -17,8 +19,10 @@ PileUpInfoProducer::~PileUpInfoProducer ()
 void
 PileUpInfoProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<vector<TYPE(pileupinfos)> > collection;
-  bool valid = anatools::getCollection (collection_, collection, event, false);
+  bool valid = anatools::getCollection (collectionToken_, collection, event, false);
   // Specify argument verbose = false to prevent error messages if collection is not found. 
   if(!valid)
     return;
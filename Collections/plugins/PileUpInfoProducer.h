@@ -1,14 +1,15 @@
 #ifndef PILEUPINFO_PRODUCER
 #define PILEUPINFO_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/PileUpInfo.h"
 
-class PileUpInfoProducer : public edm::EDProducer
+class PileUpInfoProducer : public edm::stream::EDProducer<>
 {
   public:
     PileUpInfoProducer (const edm::ParameterSet &);
@@ -24,6 +25,12 @@ class PileUpInfoProducer : public edm::EDProducer
     edm::InputTag      collection_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<vector<TYPE(pileupinfos)> >   collectionToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<vector<osu::PileUpInfo> > pl_;
 };
@@ -3,11 +3,13 @@
 #if IS_VALID(uservariables)
 
 #include "OSUT3Analysis/AnaTools/interface/CommonUtils.h"
+#include "OSUT3Analysis/AnaTools/interface/Instrumentation.h"
 
 UservariableProducer::UservariableProducer (const edm::ParameterSet &cfg) :
   collections_ (cfg.getParameter<edm::ParameterSet> ("collections"))
 {
   collection_ = collections_.getParameter<edm::InputTag> ("uservariables");
+  collectionToken_ = anatools::consumeCollection<vector<TYPE (uservariables)> > (collection_, consumesCollector (), true);
 
   produces<vector<osu::Uservariable> > (collection_.instance ());
 }
@@ -19,8 +21,10 @@ UservariableProducer::~UservariableProducer ()
 void
 UservariableProducer::produce (edm::Event &event, const edm::EventSetup &setup)
 {
+  Instrumentation::Timer timer (moduleDescription ().moduleLabel ());
+
   edm::Handle<vector<TYPE (uservariables)> > collection;
-  if (!anatools::getCollection (collection_, collection, event, false))
+  if (!anatools::getCollection (collectionToken_, collection, event, false))
     return;
 
   pl_ = auto_ptr<vector<osu::Uservariable> > (new vector<osu::Uservariable> ());
@@ -1,14 +1,15 @@
 #ifndef USERVARIABLE_PRODUCER
 #define USERVARIABLE_PRODUCER
 
-#include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 
+#include "OSUT3Analysis/AnaTools/interface/AnalysisTypes.h"
 #include "OSUT3Analysis/Collections/interface/Uservariable.h"
 
-class UservariableProducer : public edm::EDProducer
+class UservariableProducer : public edm::stream::EDProducer<>
 {
   public:
     UservariableProducer (const edm::ParameterSet &);
@@ -24,6 +25,12 @@ class UservariableProducer : public edm::EDProducer
     edm::InputTag      collection_;
     ////////////////////////////////////////////////////////////////////////////
 
+    ////////////////////////////////////////////////////////////////////////////
+    // Tokens for the collections which are retrieved from the event.
+    ////////////////////////////////////////////////////////////////////////////
+    CollectionToken<vector<TYPE (uservariables)> >   collectionToken_;
+    ////////////////////////////////////////////////////////////////////////////
+
     // Payload for this EDFilter.
     auto_ptr<vector<osu::Uservariable> > pl_;
 };
@@ -21,6 +21,11 @@ osu::Basicjet::Basicjet (const TYPE(basicjets) &basicjet, const edm::Handle<vect
 {
 }
 
+osu::Basicjet::Basicjet (const TYPE(basicjets) &basicjet, const osu::GenParticleIndex &genParticles, const edm::ParameterSet &cfg) :
+  GenMatchable (basicjet, genParticles, cfg)
+{
+}
+
 osu::Basicjet::~Basicjet ()
 {
 }
@@ -27,6 +27,13 @@ osu::Bjet::Bjet (const TYPE(bjets) &bjet, const edm::Handle<vector<osu::Mcpartic
 {
 }
 
+osu::Bjet::Bjet (const TYPE(bjets) &bjet, const osu::GenParticleIndex &genParticles, const edm::ParameterSet &cfg) :
+  GenMatchable (bjet, genParticles, cfg),
+  pfCombinedSecondaryVertexV2BJetTags_           (INVALID_VALUE),
+  pfCombinedInclusiveSecondaryVertexV2BJetTags_  (INVALID_VALUE)
+{
+}
+
 const float
 osu::Bjet::pfCombinedSecondaryVertexV2BJetTags () const
 {
@@ -27,6 +27,12 @@ osu::Electron::Electron (const TYPE(electrons) &electron, const edm::Handle<vect
 {
 }
 
+osu::Electron::Electron (const TYPE(electrons) &electron, const osu::GenParticleIndex &genParticles, const edm::ParameterSet &cfg) :
+  GenMatchable (electron, genParticles, cfg),
+  rho_                  (INVALID_VALUE)
+{
+}
+
 const int
 osu::Electron::missingInnerHits () const
 {
@@ -61,6 +67,11 @@ osu::Electron::Electron (const TYPE(electrons) &electron, const edm::Handle<vect
   GenMatchable (electron, particles, cfg)
 {
 }
+
+osu::Electron::Electron (const TYPE(electrons) &electron, const osu::GenParticleIndex &genParticles, const edm::ParameterSet &cfg) :
+  GenMatchable (electron, genParticles, cfg)
+{
+}
 #endif
 
 osu::Electron::~Electron ()
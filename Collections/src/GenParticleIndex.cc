@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cmath>
+
+#include "OSUT3Analysis/Collections/interface/GenParticleIndex.h"
+
+#if IS_VALID(mcparticles)
+
+// Rows of the grid cover |eta| < MAX_ETA, with one more row on each side for
+// everything beyond. Cells are never made narrower than MIN_CELL_WIDTH, which
+// only makes them hold more particles than needed and keeps the grid small
+// when the maximum deltaR is small.
+#define MAX_ETA 5.0
+#define MIN_CELL_WIDTH 0.1
+
+osu::GenParticleIndex::GenParticleIndex () :
+  maxDeltaR_ (-1.0),
+  nEta_ (1),
+  nPhi_ (1),
+  etaWidth_ (0.0),
+  phiWidth_ (0.0),
+  offsets_ (2, 0)
+{
+}
+
+osu::GenParticleIndex::GenParticleIndex (const edm::Handle<vector<osu::Mcparticle> > &particles, double maxDeltaR) :
+  particles_ (particles),
+  maxDeltaR_ (maxDeltaR),
+  nEta_ (1),
+  nPhi_ (1),
+  etaWidth_ (0.0),
+  phiWidth_ (0.0)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Without a maximum deltaR, every particle can be matched to every object,
+  // so the grid has only one cell.
+  //////////////////////////////////////////////////////////////////////////////
+  if (maxDeltaR_ >= 0.0)
+    {
+      double width = max (maxDeltaR_, MIN_CELL_WIDTH);
+      int nRows = 2 * (int) ceil (MAX_ETA / width);
+
+      nEta_ = nRows + 2;
+      etaWidth_ = width;
+      nPhi_ = max ((int) floor (2.0 * M_PI / width), 1);
+      phiWidth_ = 2.0 * M_PI / nPhi_;
+    }
+  offsets_.assign (nEta_ * nPhi_ + 1, 0);
+  if (!particles_.isValid ())
+    return;
+  //////////////////////////////////////////////////////////////////////////////
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Find the cell of each particle which has one of the status flags used for
+  // gen matching, and count the particles in each cell.
+  //////////////////////////////////////////////////////////////////////////////
+  vector<int> cells (particles_->size (), -1);
+  for (unsigned i = 0; i < particles_->size (); i++)
+    {
+      const osu::Mcparticle &particle = particles_->at (i);
+      if (!particle.isPromptFinalState ()
+       && !particle.isDirectPromptTauDecayProductFinalState ()
+       && !particle.fromHardProcessFinalState ()
+       && !particle.isDirectHardProcessTauDecayProductFinalState ())
+        continue;
+
+      cells[i] = etaBin (particle.eta ()) * nPhi_ + phiBin (particle.phi ());
+      offsets_[cells[i] + 1]++;
+    }
+  for (unsigned cell = 1; cell < offsets_.size (); cell++)
+    offsets_[cell] += offsets_[cell - 1];
+  //////////////////////////////////////////////////////////////////////////////
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Fill the entries cell by cell. Since the particles are visited in order,
+  // the entries in each cell are in increasing order of index.
+  //////////////////////////////////////////////////////////////////////////////
+  vector<unsigned> next (offsets_.begin (), offsets_.end () - 1);
+  entries_.resize (offsets_.back ());
+  for (unsigned i = 0; i < particles_->size (); i++)
+    {
+      if (cells[i] < 0)
+        continue;
+
+      Entry &entry = entries_[next[cells[i]]++];
+      entry.index = i;
+      entry.absPdgId = 0;
+#if DATA_FORMAT == MINI_AOD || DATA_FORMAT == AOD || DATA_FORMAT == MINI_AOD_CUSTOM
+      entry.absPdgId = abs (particles_->at (i).pdgId ());
+#endif
+    }
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+const osu::GenParticleIndex &
+osu::GenParticleIndex::get (const edm::EventID &event, const edm::Handle<vector<osu::Mcparticle> > &particles, double maxDeltaR)
+{
+  //////////////////////////////////////////////////////////////////////////////
+  // Each thread keeps the last index it built. A producer runs from start to
+  // finish on one thread, so the index cannot be replaced while it is using
+  // it.
+  //
+  // Without particles, e.g., for data or if gen matching is turned off, the
+  // same empty index is returned for every event.
+  //////////////////////////////////////////////////////////////////////////////
+  static const GenParticleIndex emptyIndex;
+  static thread_local GenParticleIndex index;
+  static thread_local edm::EventID indexEvent;
+
+  if (!particles.isValid ())
+    return emptyIndex;
+  if (!index.particles_.isValid ()
+   || !(indexEvent == event)
+   || index.particles_.product () != particles.product ()
+   || index.maxDeltaR_ != maxDeltaR)
+    {
+      index = GenParticleIndex (particles, maxDeltaR);
+      indexEvent = event;
+    }
+  return index;
+  //////////////////////////////////////////////////////////////////////////////
+}
+
+const edm::Handle<vector<osu::Mcparticle> > &
+osu::GenParticleIndex::particles () const
+{
+  return particles_;
+}
+
+double
+osu::GenParticleIndex::maxDeltaR () const
+{
+  return maxDeltaR_;
+}
+
+void
+osu::GenParticleIndex::candidates (double eta, double phi, int absPdgId, vector<unsigned> &indices) const
+{
+  indices.clear ();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Collect the particles in the cell containing the given point and in the
+  // cells around it. If there are three or fewer columns in phi, all of them
+  // are neighbours.
+  //////////////////////////////////////////////////////////////////////////////
+  int row = etaBin (eta), column = phiBin (phi);
+  int firstRow = max (row - 1, 0), lastRow = min (row + 1, nEta_ - 1);
+  int firstColumn = (nPhi_ > 3 ? column - 1 : 0), lastColumn = (nPhi_ > 3 ? column + 1 : nPhi_ - 1);
+  for (int i = firstRow; i <= lastRow; i++)
+    {
+      for (int j = firstColumn; j <= lastColumn; j++)
+        {
+          int cell = i * nPhi_ + (j + nPhi_) % nPhi_;
+          for (unsigned k = offsets_[cell]; k < offsets_[cell + 1]; k++)
+            {
+              if (absPdgId && entries_[k].absPdgId != absPdgId)
+                continue;
+              indices.push_back (entries_[k].index);
+            }
+        }
+    }
+  //////////////////////////////////////////////////////////////////////////////
+
+  // The particles are returned in the order of the original collection, so
+  // that ties in deltaR are broken the same way as when looping over it.
+  sort (indices.begin (), indices.end ());
+}
+
+int
+osu::GenParticleIndex::etaBin (double eta) const
+{
+  if (nEta_ == 1)
+    return 0;
+
+  // Values beyond the grid, including infinities, go into the first or last
+  // row.
+  double row = floor (eta / etaWidth_) + (nEta_ / 2);
+  if (!(row > 0.0))
+    return 0;
+  if (row > nEta_ - 1)
+    return nEta_ - 1;
+  return (int) row;
+}
+
+int
+osu::GenParticleIndex::phiBin (double phi) const
+{
+  if (nPhi_ == 1 || !(fabs (phi) < 100.0))
+    return 0;
+
+  int column = ((int) floor ((phi + M_PI) / phiWidth_)) % nPhi_;
+  return (column < 0 ? column + nPhi_ : column);
+}
+
+#endif
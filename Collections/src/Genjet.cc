@@ -21,6 +21,11 @@ osu::Genjet::Genjet (const TYPE(genjets) &genjet, const edm::Handle<vector<osu::
 {
 }
 
+osu::Genjet::Genjet (const TYPE(genjets) &genjet, const osu::GenParticleIndex &genParticles, const edm::ParameterSet &cfg) :
+  GenMatchable (genjet, genParticles, cfg)
+{
+}
+
 osu::Genjet::~Genjet ()
 {
 }
@@ -27,6 +27,13 @@ osu::Jet::Jet (const TYPE(jets) &jet, const edm::Handle<vector<osu::Mcparticle>
 {
 }
 
+osu::Jet::Jet (const TYPE(jets) &jet, const osu::GenParticleIndex &genParticles, const edm::ParameterSet &cfg) :
+  GenMatchable (jet, genParticles, cfg),
+  pfCombinedSecondaryVertexV2BJetTags_           (INVALID_VALUE),
+  pfCombinedInclusiveSecondaryVertexV2BJetTags_  (INVALID_VALUE)
+{
+}
+
 const float
 osu::Jet::pfCombinedSecondaryVertexV2BJetTags () const
 {
@@ -25,6 +25,12 @@ osu::Muon::Muon (const TYPE(muons) &muon, const edm::Handle<vector<osu::Mcpartic
   isTightMuonWRTVtx_ = false;
 }
 
+osu::Muon::Muon (const TYPE(muons) &muon, const osu::GenParticleIndex &genParticles, const edm::ParameterSet &cfg) :
+  GenMatchable (muon, genParticles, cfg)
+{
+  isTightMuonWRTVtx_ = false;
+}
+
 osu::Muon::~Muon ()
 {
 }
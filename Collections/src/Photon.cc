@@ -21,6 +21,11 @@ osu::Photon::Photon (const TYPE(photons) &photon, const edm::Handle<vector<osu::
 {
 }
 
+osu::Photon::Photon (const TYPE(photons) &photon, const osu::GenParticleIndex &genParticles, const edm::ParameterSet &cfg) :
+  GenMatchable (photon, genParticles, cfg)
+{
+}
+
 osu::Photon::~Photon ()
 {
 }
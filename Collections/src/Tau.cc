@@ -21,6 +21,11 @@ osu::Tau::Tau (const TYPE(taus) &tau, const edm::Handle<vector<osu::Mcparticle>
 {
 }
 
+osu::Tau::Tau (const TYPE(taus) &tau, const osu::GenParticleIndex &genParticles, const edm::ParameterSet &cfg) :
+  GenMatchable (tau, genParticles, cfg)
+{
+}
+
 osu::Tau::~Tau ()
 {
 }
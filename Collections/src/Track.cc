@@ -21,6 +21,11 @@ osu::Track::Track (const TYPE(tracks) &track, const edm::Handle<vector<osu::Mcpa
 {
 }
 
+osu::Track::Track (const TYPE(tracks) &track, const osu::GenParticleIndex &genParticles, const edm::ParameterSet &cfg) :
+  GenMatchable (track, genParticles, cfg)
+{
+}
+
 osu::Track::~Track ()
 {
 }
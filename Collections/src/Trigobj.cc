@@ -21,6 +21,11 @@ osu::Trigobj::Trigobj (const TYPE(trigobjs) &trigobj, const edm::Handle<vector<o
 {
 }
 
+osu::Trigobj::Trigobj (const TYPE(trigobjs) &trigobj, const osu::GenParticleIndex &genParticles, const edm::ParameterSet &cfg) :
+  GenMatchable (trigobj, genParticles, cfg)
+{
+}
+
 osu::Trigobj::~Trigobj ()
 {
 }
@@ -14,6 +14,7 @@ collectionProducer = CollectionProducer ()
 ################################################################################
 collectionProducer.genMatchables = {
     "maxDeltaRForGenMatching":  cms.double (0.1),
+    "genMatching":              cms.untracked.bool (True),  # set by the genMatching argument of add_channels
 }
 ################################################################################
 
@@ -21,5 +21,8 @@ infoPrinter = cms.EDAnalyzer ("InfoPrinter",
     printTriggerDecision        =  cms.bool  (False),  # print whether the event passes the triggers
     printCutDecision            =  cms.bool  (False),  # print whether the event passes all cuts, not including the triggers
     printEventDecision          =  cms.bool  (False),  # print whether the event passes the triggers and all cuts
-    printAllTriggers            =  cms.bool  (False)   # print all triggers in the event
+    printAllTriggers            =  cms.bool  (False),  # print all triggers in the event
+    outputFile                  =  cms.untracked.string  (""),      # file to write to, or standard error if empty
+    outputFormat                =  cms.untracked.string  ("text"),  # "text" for tables, or "json" for one line of JSON per event
+    outputBufferSize            =  cms.untracked.uint32  (1000),    # number of events held in memory until they are written
 )
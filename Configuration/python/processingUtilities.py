@@ -198,7 +198,47 @@ def get_collections (cuts):
     return sorted (list (collections))
     ############################################################################
 
-def add_channels (process, channels, histogramSets, weights, collections, variableProducers, skim = True):
+def uses_gen_matching (psets):
+    ############################################################################
+    # Return whether any of the given PSets, e.g., cuts, histograms, or
+    # weights, has an expression which uses the result of gen matching, i.e.,
+    # genMatchedParticle or dRToGenMatchedParticle, with or without
+    # OfSameType.
+    ############################################################################
+    for pset in psets:
+        if re.search (r"[gG]enMatchedParticle", pset.dumpPython ()):
+            return True
+    return False
+    ############################################################################
+
+def add_object_producer (process, path, objectProducer):
+    ############################################################################
+    # Add the given object producer to the process and to the path, and return
+    # its label. If an object producer with an identical configuration was
+    # already added, e.g., for another channel, that producer is added to the
+    # path instead, so that the framework only runs it once per event.
+    #
+    # The producers are remembered separately for each process, keyed by its
+    # id. The process is stored along with them, which keeps it alive, so that
+    # its id cannot be reused by another process.
+    ############################################################################
+    if not hasattr (add_object_producer, "producers"):
+        add_object_producer.producers = {}
+    if id (process) not in add_object_producer.producers:
+        add_object_producer.producers[id (process)] = (process, {})
+    producers = add_object_producer.producers[id (process)][1]
+    config = objectProducer.dumpPython ()
+    if config not in producers or not hasattr (process, producers[config]):
+        producerLabel = "objectProducer" + str (add_channels.producerIndex)
+        setattr (process, producerLabel, objectProducer)
+        producers[config] = producerLabel
+        add_channels.producerIndex += 1
+    producerLabel = producers[config]
+    path += getattr (process, producerLabel)
+    return producerLabel
+    ############################################################################
+
+def add_channels (process, channels, histogramSets, weights, collections, variableProducers, skim = True, useMultiChannelCutCalculator = False, earlyExit = False, instrumentationFile = "", genMatching = True):
 
     ############################################################################
     # If only the default scheduler exists, create an empty one
@@ -265,6 +305,55 @@ def add_channels (process, channels, histogramSets, weights, collections, variab
 
     plotCollections = get_collections (histogramSets)
 
+    ############################################################################
+    # Gen matching is the most expensive part of producing the OSU objects. It
+    # is done by default, and can be turned off with genMatching = False. With
+    # genMatching = None, it is only done if a cut, histogram, weight, or value
+    # printed by the info printer uses its result. Since this cannot tell
+    # whether a variable producer or any other module reading the OSU objects
+    # uses it, it is kept on if there are variable producers.
+    ############################################################################
+    if genMatching is None:
+        genMatching = uses_gen_matching (list (channels) + list (histogramSets) + list (weights) + [infoPrinter])
+        if not genMatching and len (variableProducers):
+            print "WARNING [add_channels]: gen matching is kept on, since the variable producers may use it. Use genMatching = False to turn it off."
+            genMatching = True
+        elif not genMatching:
+            print "WARNING [add_channels]: no expression uses gen matching, so it is turned off. Use genMatching = True if any other module needs it."
+    ############################################################################
+
+    ############################################################################
+    # In the early-exit mode, the cut calculators stop evaluating cuts once an
+    # event is known to fail, so the noncumulative flags are incomplete. Since
+    # the info printer would print these, the full mode is kept if it is asked
+    # to.
+    ############################################################################
+    if earlyExit and (infoPrinter.printIndividualObjectFlags.value () or infoPrinter.printIndividualEventFlags.value ()):
+        print "WARNING [add_channels]: the info printer prints noncumulative flags, so all cuts will be evaluated for every event."
+        earlyExit = False
+    ############################################################################
+
+    ############################################################################
+    # If requested, the cut decisions for all the channels are calculated by a
+    # single MultiChannelCutCalculator, which evaluates the cuts shared by
+    # several channels only once. Its channels and collections are filled in as
+    # each channel is added below.
+    ############################################################################
+    multiChannelCutCalculator = None
+    if useMultiChannelCutCalculator:
+        if not hasattr (add_channels, "cutCalculatorIndex"):
+            add_channels.cutCalculatorIndex = 0
+        multiChannelCutCalculatorLabel = "multiChannelCutCalculator" + str (add_channels.cutCalculatorIndex)
+        multiChannelCutCalculator = cms.EDProducer ("MultiChannelCutCalculator",
+            collections = cms.PSet (),
+            channels = cms.VPSet (),
+            earlyExit = cms.untracked.bool (earlyExit),
+            instrumentationFile = cms.untracked.string (instrumentationFile)
+        )
+        setattr (process, multiChannelCutCalculatorLabel, multiChannelCutCalculator)
+        add_channels.cutCalculatorIndex += 1
+    ############################################################################
+
     for channel in channels:
         channelPath = cms.Path ()
         channelName = channel.name.pythonValue ()
@@ -400,7 +489,8 @@ def add_channels (process, channels, histogramSets, weights, collections, variab
 
         ########################################################################
         # Add an OSU object producer for each collection used in a cut or
-        # histogram.
+        # histogram. Producers with identical configurations are shared by all
+        # the channels, so each collection is only produced once per event.
         ########################################################################
         producedCollections = copy.deepcopy (collections)
         cutCollections = get_collections (channel.cuts)
@@ -411,57 +501,53 @@ def add_channels (process, channels, histogramSets, weights, collections, variab
             if hasattr (collections, collection):
                 usedCollections.insert (0, collection)
         for collection in usedCollections:
+            # The user and event variables are read directly from the variable
+            # producers, whose payloads are used as they are.
             if collection is "uservariables" or collection is "eventvariables":
-                newInputTags = cms.VInputTag()
-                inputTags = getattr (collections, collection)
-                for inputTag in inputTags:
-                    eventvariableCollections = copy.deepcopy (collections)
-                    setattr (eventvariableCollections, collection, cms.InputTag ("",""))
-                    setattr (eventvariableCollections, collection,inputTag)
-                    objectProducer = getattr (collectionProducer, collection).clone()
-                    objectProducer.collections = eventvariableCollections
-                    channelPath += objectProducer
-                    setattr (process, "objectProducer" + str (add_channels.producerIndex), objectProducer)
-                    newInputTags.append(cms.InputTag ("objectProducer" + str (add_channels.producerIndex), inputTag.getProductInstanceLabel ()))
-                    if collection in cutCollections: 
-                        dropCommand = "drop *_" + inputTag.getModuleLabel () + "_" + inputTag.getProductInstanceLabel () + "_"
-                        if inputTag.getProcessName ():
-                            dropCommand += inputTag.getProcessName ()
-                        else:
-                            dropCommand += "*"
-                        outputCommands.append (dropCommand)
-                    # if collection not in cutCollections:
-                    #     outputCommands.append ("keep *_objectProducer" + str (add_channels.producerIndex) + "_" + inputTag.getProductInstanceLabel () + "_" + process.name_ ())
-                    add_channels.producerIndex += 1
-                setattr (producedCollections, collection, newInputTags)
-            else:
-                objectProducer = getattr (collectionProducer, collection).clone()
-                objectProducer.collections = collections
-                channelPath += objectProducer
-                setattr (process, "objectProducer" + str (add_channels.producerIndex), objectProducer)
-                originalInputTag = getattr (collections, collection)
-                setattr (producedCollections, collection, cms.InputTag ("objectProducer" + str (add_channels.producerIndex), originalInputTag.getProductInstanceLabel ()))
-                if collection in cutCollections:
-                    dropCommand = "drop *_" + originalInputTag.getModuleLabel () + "_" + originalInputTag.getProductInstanceLabel () + "_"
-                    if originalInputTag.getProcessName ():
-                        dropCommand += originalInputTag.getProcessName ()
-                    else:
-                        dropCommand += "*"
-                    outputCommands.append (dropCommand)
-                # if collection not in cutCollections:
-                #     outputCommands.append ("keep *_objectProducer" + str (add_channels.producerIndex) + "_" + originalInputTag.getProductInstanceLabel () + "_" + process.name_ ())
-                add_channels.producerIndex += 1
-        ########################################################################
-
-        ########################################################################
-        # Add a cut calculator module for this channel to the path.
-        ########################################################################
-        cutCalculator = cms.EDProducer ("CutCalculator",
-            collections = producedCollections,
-            cuts = channel
-        )
-        channelPath += cutCalculator
-        setattr (process, channelName + "CutCalculator", cutCalculator)
+                continue
+            objectProducer = getattr (collectionProducer, collection).clone()
+            objectProducer.collections = collections
+            if hasattr (objectProducer, "genMatching"):
+                objectProducer.genMatching = cms.untracked.bool (genMatching)
+            producerLabel = add_object_producer (process, channelPath, objectProducer)
+            originalInputTag = getattr (collections, collection)
+            setattr (producedCollections, collection, cms.InputTag (producerLabel, originalInputTag.getProductInstanceLabel ()))
+            if collection in cutCollections:
+                dropCommand = "drop *_" + originalInputTag.getModuleLabel () + "_" + originalInputTag.getProductInstanceLabel () + "_"
+                if originalInputTag.getProcessName ():
+                    dropCommand += originalInputTag.getProcessName ()
+                else:
+                    dropCommand += "*"
+                outputCommands.append (dropCommand)
+            # if collection not in cutCollections:
+            #     outputCommands.append ("keep *_" + producerLabel + "_" + originalInputTag.getProductInstanceLabel () + "_" + process.name_ ())
+        ########################################################################
+
+        ########################################################################
+        # Add a cut calculator module for this channel to the path. If the
+        # MultiChannelCutCalculator is used instead, this channel and its
+        # produced collections are added to it, and it is added to the path.
+        # The framework only runs it once per event, however many paths it is
+        # in.
+        ########################################################################
+        if multiChannelCutCalculator:
+            multiChannelCutCalculator.channels.append (channel)
+            for collection in producedCollections.parameterNames_ ():
+                if collection in usedCollections or not hasattr (multiChannelCutCalculator.collections, collection):
+                    setattr (multiChannelCutCalculator.collections, collection, copy.deepcopy (getattr (producedCollections, collection)))
+            channelPath += multiChannelCutCalculator
+            instanceLabel = "".join (c for c in channelName if c.isalnum ())
+            cutDecisions = cms.InputTag (multiChannelCutCalculatorLabel, instanceLabel)
+        else:
+            cutCalculator = cms.EDProducer ("CutCalculator",
+                collections = producedCollections,
+                cuts = channel,
+                earlyExit = cms.untracked.bool (earlyExit),
+                instrumentationFile = cms.untracked.string (instrumentationFile)
+            )
+            channelPath += cutCalculator
+            setattr (process, channelName + "CutCalculator", cutCalculator)
+            cutDecisions = cms.InputTag (channelName + "CutCalculator", "cutDecisions")
         ########################################################################
 
         ########################################################################
@@ -469,7 +555,7 @@ def add_channels (process, channels, histogramSets, weights, collections, variab
         ########################################################################
         cutFlowPlotter = cms.EDAnalyzer ("CutFlowPlotter",
             collections = producedCollections,
-            cutDecisions = cms.InputTag (channelName + "CutCalculator", "cutDecisions")
+            cutDecisions = cutDecisions
         )
         channelPath += cutFlowPlotter
         setattr (process, channelName + "CutFlowPlotter", cutFlowPlotter)
@@ -480,7 +566,8 @@ def add_channels (process, channels, histogramSets, weights, collections, variab
         ########################################################################
         channelInfoPrinter = copy.deepcopy (infoPrinter)
         channelInfoPrinter.collections = producedCollections
-        channelInfoPrinter.cutDecisions = cms.InputTag (channelName + "CutCalculator", "cutDecisions")
+        channelInfoPrinter.cutDecisions = cutDecisions
+        channelInfoPrinter.instrumentationFile = cms.untracked.string (instrumentationFile)
         channelPath += channelInfoPrinter
         setattr (process, channelName + "InfoPrinter", channelInfoPrinter)
         ########################################################################
@@ -489,8 +576,15 @@ def add_channels (process, channels, histogramSets, weights, collections, variab
         # For each collection on which cuts are applied, we add the
         # corresponding object selector to the path. We also trade the original
         # collection for the slimmed collection in the output commands.
+        #
+        # The plotter always reads the unfiltered collections through the
+        # indices of the selected objects, which are given by the "selections"
+        # parameter set, so that user variables, which are stored by the index
+        # of each object in the unfiltered collection, can be looked up. The
+        # selected objects are only copied if they are written to a skim.
         ########################################################################
         filteredCollections = copy.deepcopy (producedCollections)
+        selections = cms.PSet ()
         for collection in cutCollections:
             # Temporary fix for user-defined variables
             # For the moment, they won't be filtered
@@ -500,14 +594,37 @@ def add_channels (process, channels, histogramSets, weights, collections, variab
             objectSelector = cms.EDFilter (filterName,
                 collections = producedCollections,
                 collectionToFilter = cms.string (collection),
-                cutDecisions = cms.InputTag (channelName + "CutCalculator", "cutDecisions")
+                cutDecisions = cutDecisions,
+                copyObjects = cms.untracked.bool (skim)
             )
             channelPath += objectSelector
             setattr (process, "objectSelector" + str (add_channels.filterIndex), objectSelector)
-            originalInputTag = getattr (collections, collection)
-            setattr (filteredCollections, collection, cms.InputTag ("objectSelector" + str (add_channels.filterIndex), originalInputTag.getProductInstanceLabel ()))
-            outputCommands.append ("keep *_objectSelector" + str (add_channels.filterIndex) + "_originalFormat_" + process.name_ ())
+            if skim:
+                outputCommands.append ("keep *_objectSelector" + str (add_channels.filterIndex) + "_originalFormat_" + process.name_ ())
+            setattr (selections, collection, cms.InputTag ("objectSelector" + str (add_channels.filterIndex), "selection"))
             add_channels.filterIndex += 1
+        if len (selections.parameterNames_ ()):
+            filteredCollections.selections = selections
+        ########################################################################
+
+        ########################################################################
+        # User variables are stored by the index of each object in the
+        # unfiltered collection, which no longer matches the filtered copies
+        # written to the skim. So, in skims in which any collection is
+        # filtered, the payloads of the variable producers are replaced by a
+        # single payload from a UserVariableSelector, in which the values are
+        # remapped to the filtered copies. When reading such a skim, the user
+        # variables are given by the InputTag of this payload. Event variables
+        # do not refer to objects and are kept as they are.
+        ########################################################################
+        if skim and len (selections.parameterNames_ ()) and hasattr (filteredCollections, "uservariables"):
+            userVariableSelector = cms.EDProducer ("UserVariableSelector",
+                collections = filteredCollections
+            )
+            channelPath += userVariableSelector
+            setattr (process, channelName + "UserVariableSelector", userVariableSelector)
+            outputCommands.append ("drop *_*_uservariables_*")
+            outputCommands.append ("keep *_" + channelName + "UserVariableSelector_uservariables_" + process.name_ ())
         ########################################################################
 
         ########################################################################
@@ -518,7 +635,8 @@ def add_channels (process, channels, histogramSets, weights, collections, variab
                 collections     =  filteredCollections,
                 histogramSets   =  histogramSets,
                 weights         =  weights,
-                verbose         =  cms.int32 (0)
+                verbose         =  cms.int32 (0),
+                instrumentationFile = cms.untracked.string (instrumentationFile)
             )
             channelPath += plotter
             setattr (process, channelName + "Plotter", plotter)
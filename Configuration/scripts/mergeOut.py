@@ -81,7 +81,9 @@ def MakeMergingConfigForCondor(Directory, OutputDirectory):
         MergeScript.write('exec(\'import outputInfo_\' + dataset +\'_cfg as outputInfo\')\n')
         MergeScript.write('InputFileString = outputInfo.InputFileString\n')
         MergeScript.write('InputWeightString = outputInfo.InputWeightString\n')
-        MergeScript.write('os.system(\'mergeTFileServiceHistograms -i \' + InputFileString + \' -o \' + \'' + OutputDirectory + '/\' + dataset + \'.root\' + \' -w \' + InputWeightString)\n')
+        MergeScript.write('# use as many threads as the slot has CPUs, which condor puts in OMP_NUM_THREADS\n')
+        MergeScript.write('Threads = os.environ.get(\'OMP_NUM_THREADS\', \'1\')\n')
+        MergeScript.write('os.system(\'mergeTFileServiceHistograms -i \' + InputFileString + \' -o \' + \'' + OutputDirectory + '/\' + dataset + \'.root\' + \' -w \' + InputWeightString + \' -j \' + Threads)\n')
         MergeScript.write('print \'Finish merging dataset \' + dataset')
         MergeScript.close()
         os.system('chmod 777 ' + Directory + '/merge.py')
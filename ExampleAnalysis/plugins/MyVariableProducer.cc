@@ -2,25 +2,33 @@
 #include "OSUT3Analysis/ExampleAnalysis/plugins/MyVariableProducer.h"
 
 MyVariableProducer::MyVariableProducer(const edm::ParameterSet &cfg) :
-  VariableProducer(cfg) {}
+  VariableProducer(cfg) {
+
+  // Add all of the needed collections to objectsToGet_
+  objectsToGet_.insert ("muons");
+
+  // declare the needed collections to the framework, which must be done here
+  // rather than in AddVariables
+  anatools::getCollectionTokens (objectsToGet_, collections_, tokens_, consumesCollector ());
+
+  // register the variables, which is also best done here, and keep their IDs
+  muonPt_ = registerUserVar ("muons", "muonPt");
+}
 
 MyVariableProducer::~MyVariableProducer() {}
 
 void
 MyVariableProducer::AddVariables (const edm::Event &event) {
 
-  // Add all of the needed collections to objectsToGet_
-  objectsToGet_.insert ("muons");
-
   // get all the needed collections from the event and put them into the "handles_" collection
-  anatools::getRequiredCollections (objectsToGet_, collections_, handles_, event);
+  anatools::getRequiredCollections (tokens_, handles_, event);
 
   // calculate whatever variables you'd like
 
   // simple case, just muonPt
   for (const auto &muon1 : *handles_.muons) {
     double value = anatools::getMember(muon1, "pt");
-    addUserVar("muonPt", value, muon1);
+    addUserVar (muonPt_, value, handles_.muons, muon1);
   }
 
 }
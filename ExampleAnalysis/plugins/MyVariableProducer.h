@@ -13,6 +13,9 @@ class MyVariableProducer : public VariableProducer
 
     private:
 
+	// IDs of the variables
+	unsigned muonPt_;
+
 	// Functions
 	void AddVariables(const edm::Event &);
   };